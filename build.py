@@ -47,7 +47,7 @@ CFLAGS: list[str] = [
 	"-Werror", "-Wfatal-errors",
 	"-O3"
 ]
-LFLAGS: list[str] = ["-L", LIB, "-lbr"]
+LFLAGS: list[str] = ["-L", LIB, "-lbr", "-lpthread"]
 if not is_release:
 	CFLAGS[-1] = "-O0"
 	CFLAGS.append("-g")
@@ -63,3 +63,6 @@ if is_outdated(LIB/"libbrb.dylib", *SRC.glob("brb_*"), *INCLUDE.glob("*")):
 
 if is_outdated(BIN/"bridge", SRC/"bridge.c", *INCLUDE.glob("*")):
       exec_cmd("cc", *CFLAGS, *LFLAGS, "-o", BIN/"bridge", SRC/"bridge.c")
+
+if is_outdated(BIN/"brtest", PWD/"tests"/"brtest.c", *INCLUDE.glob("*")):
+	exec_cmd("cc", *CFLAGS, *LFLAGS, "-o", BIN/"brtest", PWD/"tests"/"brtest.c")
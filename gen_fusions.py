@@ -0,0 +1,102 @@
+#!python3
+# regenerates the list of superinstructions `XOP_FUSIONS` in `src/libbr_exec.c` from the output of `BR_printOpProfile`
+# usage: gen_fusions.py [-n <max number of superinstructions, 64 by default>] <profiles...>
+# the list in the tree is generated from `tests/profiles/idioms*.txt`, which are the profiles of the programs generated by
+# `tests/gen_idioms.py <1, 2 or 3> 2000`, saved with `build/bin/brtest -p tests/profiles/idioms<N>.txt <program>`;
+# the opcode-mix program, `tests/gen_opmix.py 5000`, is left out of them to check the list on a program it was not made from
+
+import sys
+from pathlib import Path
+
+TARGET: Path = Path(__file__).parent/"src"/"libbr_exec.c"
+BEGIN_MARKER: str = "// fusions: begin\n"
+END_MARKER: str = "// fusions: end\n"
+
+# name: (enum base, int_t, OP, operand)
+BINARY_KINDS: dict[str, tuple[str, str, str]] = {
+	"add":  ("BR_XOP_ADD",  "uint", "+"),
+	"sub":  ("BR_XOP_SUB",  "uint", "-"),
+	"mul":  ("BR_XOP_MUL",  "uint", "*"),
+	"div":  ("BR_XOP_DIV",  "uint", "/"),
+	"divs": ("BR_XOP_DIVS", "int",  "/"),
+	"mod":  ("BR_XOP_MOD",  "uint", "%"),
+	"mods": ("BR_XOP_MODS", "int",  "%"),
+	"and":  ("BR_XOP_AND",  "uint", "&"),
+	"or":   ("BR_XOP_OR",   "uint", "|"),
+	"xor":  ("BR_XOP_XOR",  "uint", "^"),
+	"shl":  ("BR_XOP_SHL",  "uint", "<<"),
+	"shr":  ("BR_XOP_SHR",  "uint", ">>"),
+	"shrs": ("BR_XOP_SHRS", "int",  ">>"),
+}
+IMM_KINDS: dict[str, tuple[str, str, str, str]] = {
+	name + "i": (base + "I", int_t, OP + "=", "operand_s" if name in ("divs", "mods") else "operand_u")
+	for name, (base, int_t, OP) in BINARY_KINDS.items()
+}
+SIMPLE_OPS: set[str] = {
+	"nop", "i8", "i16", "i32", "ptr", "i64", "addr", "dbaddr", "sys", "builtin",
+	"drop", "new", "zero", "get", "set-at", "get-from", "copy"
+}
+
+def int_type(int_t: str, width: str) -> str:
+	return int_t + ("ptr" if width == "p" else width) + "_t"
+
+def to_component(name: str) -> str | None:
+	"converts a name of an operation printed by `BR_printOpProfile` to a component of a superinstruction"
+	kind, *sizes = name.split(":")
+	if sizes:
+		if kind in BINARY_KINDS and len(sizes) == 2:
+			return "C_BIN({}, {}, {}, {}, {})".format(*BINARY_KINDS[kind], *sizes)
+		if kind in IMM_KINDS and len(sizes) == 1:
+			base, int_t, OP, operand = IMM_KINDS[kind]
+			return f"C_IMM({base}, {int_t}, {OP}, {operand}, {sizes[0]})"
+		if kind == "not" and len(sizes) == 1:
+			return f"C_NOT({sizes[0]})"
+		return None
+	if name in SIMPLE_OPS:
+		return f"C_OP({name.replace('-', '').upper()})"
+	kind, _, width = name.partition("@")
+	if not width: return None
+	enum_name = name.replace("-", "").replace("@", "AT").upper()
+	if kind == "not":
+		return f"C_NOTAT({enum_name}, {int_type('uint', width)})"
+	if kind.endswith("-i") and kind[:-2] + "i" in IMM_KINDS:
+		_, int_t, OP, operand = IMM_KINDS[kind[:-2] + "i"]
+		return f"C_IAT({enum_name}, {int_type(int_t, width)}, {OP}, {operand})"
+	return None
+
+def to_ident(name: str) -> str:
+	return name.replace(":", "_").replace("-", "").replace("@", "at")
+
+max_fusions: int = 64
+profiles: list[str] = []
+args = iter(sys.argv[1:])
+for arg in args:
+	if arg == "-n":
+		max_fusions = int(next(args))
+	else:
+		profiles.append(arg)
+if not profiles:
+	print("error: no profiles provided", file=sys.stderr)
+	sys.exit(1)
+
+counts: dict[tuple[str, ...], int] = {}
+for profile in profiles:
+	with open(profile) as f:
+		for line in f:
+			count, *seq = line.split()
+			if all(to_component(name) for name in seq):
+				counts[tuple(seq)] = counts.get(tuple(seq), 0) + int(count)
+
+chosen = sorted(counts.items(), key=lambda item: -item[1])[:max_fusions]
+# longer sequences must come first, see `XOP_FUSIONS`
+chosen.sort(key=lambda item: (-len(item[0]), -item[1]))
+lines: list[str] = ["#define XOP_FUSIONS(F2, F3)"]
+for seq, count in chosen:
+	components = ", ".join(to_component(name) for name in seq)
+	lines.append(f"\tF{len(seq)}({'__'.join(map(to_ident, seq))}, {components})")
+
+src = TARGET.read_text()
+start = src.index(BEGIN_MARKER) + len(BEGIN_MARKER)
+end = src.index(END_MARKER)
+TARGET.write_text(src[:start] + " \\\n".join(lines) + "\n" + src[end:])
+print(f"{len(chosen)} superinstructions written to {TARGET}")
@@ -422,8 +422,8 @@ declArray(BR_Type);
 #define BR_DYN_TYPE(_ctor)    ((BR_Type){.ctor = _ctor})
 
 struct BR_Op {
-	BR_OpType type:8;
-	uint8_t x_op2_size;
+	BR_OpType type:16; // execution may replace operations with its internal ones, numbered past `BR_N_OPS`; in bytecode it is still encoded with 1 byte
+	uint8_t x_op2_size; // during execution, also whether the operand of `dbaddr` is an offset into the run's own copy of the mutable data blocks
 	uint32_t x_op1_size; // only for the `add` operation and only during execution
 	union {
 		uint64_t operand_u;	
@@ -440,6 +440,8 @@ typedef struct {
 	BR_OpArray body;
 	BR_Type ret_type;
 	BR_TypeArray args;
+	sbuf pending_body; // the encoded body of the procedure if it's not decoded yet, see `BR_LOAD_LAZY`; `body` is empty until then
+	uint32_t n_pending_ops;
 } BR_Proc;
 declArray(BR_Proc);
 #define BR_MAX_N_PROCS UINT32_MAX
@@ -470,10 +472,8 @@ extern const sbuf BR_builtinNames[];
 
 typedef struct {
 	const char* name;
-	union {
-		BR_OpArray body;
-		sbuf data;
-	};
+	BR_OpArray body;
+	sbuf data; // pre-evaluated contents of the block, see `BR_snapshotDataBlocks`; if not empty, `body` is empty and is not evaluated
 	bool is_mutable;
 } BR_DataBlock;
 declArray(BR_DataBlock);
@@ -492,10 +492,35 @@ typedef struct {
 	BR_ProcArray seg_exec;
 	BR_DataBlockArray seg_data;
 	size_t exec_entry_point;
+	sbuf image; // the contents of the file the module was loaded from by `BR_loadFromBytecode`; the names of the declarations point into it
+	bool is_image_mapped; // whether `image` is a memory mapping of the file rather than a heap allocation
+	sbuf names; // the decompressed names section of the file, if it's compressed there; the names of the declarations then point into it instead of `image`
 } BR_Module;
 
 #define BR_HEADER_SIZE 8
 #define BR_V1_HEADER sbuf_fromcstr("BRBv1\0\0\0")
+#define BR_V2_HEADER sbuf_fromcstr("BRBv2\0\0\0")
+// sections of a BRB v2 module; they follow the header, and are followed by the section table, in which every entry is the kind of a section,
+// its offset from the start of the module and its size as 32-, 64- and 64-bit integers; the last 4 bytes of the module are the amount of entries in the table
+// sections of unknown kinds are ignored by the loader
+typedef enum {
+	BR_SECTION_DECLS, // amounts of structs, data blocks and procedures, their declarations and the entry point, encoded just like in BRB v1
+	BR_SECTION_DATA, // bodies of the data blocks, or contents of the pre-evaluated ones
+	BR_SECTION_PROCS, // bodies of the procedures
+	BR_SECTION_PROC_INDEX, // offset of the body of every procedure in `BR_SECTION_PROCS` as a 32-bit integer, followed by the size of `BR_SECTION_PROCS`
+	BR_SECTION_NAMES, // names of the declarations, each one terminated by a NUL
+	BR_N_SECTION_KINDS
+} BR_SectionKind;
+#define BR_SECTION_ENTRY_SIZE 20
+// set in the kind of `BR_SECTION_PROCS` or `BR_SECTION_NAMES` in the section table if the section is compressed, see `BR_WRITE_COMPRESS`;
+// a compressed section is a sequence of blocks, each one being its original size and its compressed size as 32-bit integers, followed by the compressed data,
+// or by the original data if both sizes are the same; every block is compressed on its own by `BR_compressBlock`
+#define BR_SECTION_COMPRESSED 0x100
+#define BR_LZ_BLOCK_SIZE (64 * 1024) // maximum original size of a block of a compressed section
+#define BR_LZ_MAX_COMPRESSED_SIZE(size) ((size) + (size) / 255 + 16)
+// flags of a data block declaration in a `.brb` file
+#define BR_DBF_MUTABLE   0x1
+#define BR_DBF_EVALUATED 0x2 // the body of the block is its raw contents, in the byte order of the machine that saved it, instead of operations
 
 typedef enum {
 	BR_ERR_OK,
@@ -516,6 +541,7 @@ typedef enum {
 	BR_ERR_NO_PROC_BODY_SIZE,
 	BR_ERR_NO_DB_NAME,
 	BR_ERR_NO_DB_BODY_SIZE,
+	BR_ERR_NO_DB_BODY,
 	BR_ERR_NO_ENTRY,
 	BR_ERR_INVALID_ENTRY,
 	BR_ERR_INVALID_ENTRY_PROTOTYPE,
@@ -545,6 +571,9 @@ typedef enum {
 	BR_ERR_STRUCT_ID_EXPECTED,
 	BR_ERR_INVALID_STRUCT_ID,
 	BR_ERR_INVALID_TYPE_KIND,
+	BR_ERR_INVALID_SECTIONS,
+	BR_ERR_INVALID_IMAGE,
+	BR_ERR_WRITE_FAILURE,
 	BR_N_ERROR_TYPES
 } BR_ErrorType;
 
@@ -574,17 +603,37 @@ typedef struct {
 
 struct BR_stacknode_t {
 	BR_StackNode prev;
+	BR_StackNode jump; // a node further down the stack, allows reaching any node in a logarithmic number of steps
 	const char* name;
+	size_t rt_offset; // run-time size of the node and all the nodes below it
+	uint32_t depth; // number of nodes in the stack, including this one
+	uint32_t n_items; // same as `depth`, but excluding the nodes that belong to the stack frame of the procedure
 	BR_Type type;
 	uint8_t flags;
 };
 declArray(BR_StackNode);
 declArray(BR_StackNodeArray);
+declArray_as(size_t, BR_SizeArray);
+
+// an open-addressing hash table that maps names of declarations of one kind to their indices
+typedef struct {
+	struct BR_nameindexslot_t {
+		const char* name; // NULL for an empty slot
+		uint32_t id;
+	}* slots;
+	uint32_t cap; // 0 or a power of 2
+	uint32_t length;
+} BR_NameIndex;
 
 typedef struct {
 	BR_Module module;
 	BR_StackNodeArrayArray procs;
 	BR_StackNodeArrayArray data_blocks;
+	BR_SizeArray procs_max_rt_size; // running maximum of the run-time stack size of every procedure
+	BR_SizeArray data_blocks_max_rt_size;
+	BR_NameIndex proc_names;
+	BR_NameIndex data_block_names;
+	BR_NameIndex struct_names;
 	BR_Error error;
 	Arena arena;
 } BR_ModuleBuilder;
@@ -629,7 +678,7 @@ typedef struct {
 	FILE* err;
 } BR_ProcessInfo;
 
-// exEcutes the command in a subshell and returns the IO descriptors and the exitcode of the process
+// executes the program `argv[0]`, looked up in PATH, with the arguments `argv`, and returns the IO descriptors and the exitcode of the process
 bool BR_execProcess(char* argv[], BR_ProcessInfo* info);
 // same as execProcess(), but command is provided in the form of a sized buffer
 bool BR_execProcess_s(sbuf command, BR_ProcessInfo* info);
@@ -669,9 +718,12 @@ sbuf BR_fileBaseName_s(sbuf path);
 
 declArray(sbuf);
 #define BR_DEFAULT_STACK_SIZE (512 * 1024) /* 512 KBs, just like in JVM */
+typedef struct BR_PreparedModule BR_PreparedModule;
+// the state of a single run of a module; the prepared module itself is never modified by its runs, so any number of them can be executed in parallel
 typedef struct {
-	sbufArray seg_data;
-	BR_ProcArray seg_exec;
+	sbufArray seg_data; // shared with the prepared module
+	BR_ProcArray seg_exec; // shared with the prepared module
+	sbuf mut_data; // the run's own copy of the mutable data blocks, see `BR_PreparedModule`
 	const BR_Op* cur_proc;
 	sbuf stack;
 	char* stack_head;
@@ -680,8 +732,58 @@ typedef struct {
 	sbuf* exec_argv;
 	uint32_t exec_argc;
 	uint32_t entry_point;
+	BR_PreparedModule* own_module; // the module prepared by `BR_execModule` for the run, freed by `BR_delExecEnv`; NULL if the env is only used with `BR_runPreparedModule`
 } BR_ExecEnv;
 
+// flags for `BR_execModule`
+#define BR_EXEC_THREADED  0x1 // dispatch the operations through threaded code with computed `goto`s instead of calling `BR_execOp` for each of them; ignored if the compiler does not support it
+#define BR_EXEC_FUSE      0x2 // replace common sequences of operations in the procedures with superinstructions; only has effect together with `BR_EXEC_THREADED`
+#define BR_EXEC_CACHE_TOP 0x4 // keep the top stack item in a register when it is passed from one operation straight to the next one; only has effect together with `BR_EXEC_THREADED`
+#define BR_EXEC_JIT       0x8 // compile a procedure to machine code once it has been interpreted `BR_PreparedModule::jit_threshold` times, and run the machine code from then on; only supported on x86-64, ignored elsewhere
+// the interruptor passed to `BR_execModule` is polled before the first operation and then once in every `BR_INTERRUPT_POLL_INTERVAL` dispatches
+// (a superinstruction is dispatched once), so the execution stops at most that many dispatches after the interruptor is set;
+// the threaded engine also polls it right after every syscall, since that is where the execution might have been blocked for long
+#define BR_INTERRUPT_POLL_INTERVAL 1024
+#define BR_DEFAULT_JIT_THRESHOLD 1
+
+typedef struct BR_JITProc BR_JITProc;
+
+// a module prepared for execution once with `BR_prepareModule` and then executed any number of times with `BR_runPreparedModule`
+struct BR_PreparedModule {
+	BR_ProcArray seg_exec; // the procedures with their operations prepared for execution
+	sbufArray seg_data; // the evaluated data blocks; the mutable ones are views into `mut_data`
+	sbuf mut_data; // initial state of all the mutable data blocks, copied into `BR_ExecEnv::mut_data` before every run
+	size_t max_stack_size; // size of the deepest state of the entry point
+	uint32_t entry_point;
+	uint32_t flags;
+	uint32_t jit_threshold; // see `BR_EXEC_JIT`; set to `BR_DEFAULT_JIT_THRESHOLD` by `BR_prepareModule`, may be changed before the first run
+	BR_JITProc* jit; // the state of `BR_EXEC_JIT` for every procedure; NULL without the flag
+	sbuf image; // the contents of the file the module was loaded from by `BR_loadImage`; the operations and the data blocks are views into it
+	bool is_image_mapped; // whether `image` is a memory mapping of the file rather than a heap allocation
+};
+#define BR_IMAGE_HEADER sbuf_fromcstr("BRBimg\0\0")
+
+// a single run of a module within a batch executed by `BR_runBatch`
+typedef struct {
+	char** args; // NULL-terminated, passed to `BR_runPreparedModule` as is
+	BR_Error err; // set by `BR_runBatch`
+	BR_ExecStatus status; // set by `BR_runBatch`
+	float time; // time taken by the run in milliseconds; set by `BR_runBatch`
+} BR_BatchRun;
+declArray(BR_BatchRun);
+
+typedef struct {
+	BR_BatchRunArray runs;
+	char** args; // the argument vectors of all the runs, each terminated by a NULL
+	sbuf src; // the text the arguments point into
+} BR_Batch;
+
+// called by `BR_runBatch` once for every finished run, never concurrently
+typedef void (*BR_BatchCallback)(const BR_BatchRun* run, uint32_t run_id, void* ctx);
+
+// flags for `BR_runBatch`
+#define BR_BATCH_IN_ORDER 0x1 // report the runs in the order they were provided in, instead of the order in which they finished
+
 typedef int64_t BR_id; // an ID of either a procedure or a data block
 #define BR_INVALID_ID INT64_MIN
 
@@ -714,21 +816,25 @@ void     BR_delModule(BR_Module module);
 BR_Error BR_extractModule(BR_ModuleBuilder builder, BR_Module* dst);
 BR_Error BR_setEntryPoint(BR_ModuleBuilder* builder, size_t proc_id);
 BR_Error BR_addOp(BR_ModuleBuilder* builder, BR_id proc_id, BR_Op op);
+BR_Error BR_indexNames(BR_ModuleBuilder* builder); // rebuilds the name indexes, only needed if the names of the declarations were changed after adding them
+bool     BR_addToNameIndex(BR_NameIndex* index, const char* name, uint32_t id); // a NULL `name` is ignored; if `name` is already in the index, the index is left as is
+uint32_t BR_findInNameIndex(const BR_NameIndex* index, const char* name); // returns UINT32_MAX if `name` is not in the index
+void     BR_delNameIndex(BR_NameIndex* index);
 
 BR_Error BR_preallocStructs(BR_ModuleBuilder* builder, uint32_t n_structs_hint);
 void     BR_deallocStructs(BR_Module* module);
 BR_Error BR_addStruct(BR_ModuleBuilder* builder, BR_id* struct_id_p, const char* name, uint32_t n_fields, BR_Type* fields);
-BR_id    BR_getStructIdByName(const BR_Module* module, const char* name);
+BR_id    BR_getStructIdByName(const BR_ModuleBuilder* builder, const char* name);
 
 BR_Error BR_preallocProcs(BR_ModuleBuilder* builder, uint32_t n_procs_hint);
 void     BR_deallocProcs(BR_Module* module);
 BR_Error BR_addProc(BR_ModuleBuilder* builder, BR_id* proc_id_p, const char* name, size_t n_args, const BR_Type* args, BR_Type ret_type, uint32_t n_ops_hint);
-BR_id    BR_getProcIdByName(const BR_Module* module, const char* name); // returns BR_INVALID_ID on error
+BR_id    BR_getProcIdByName(const BR_ModuleBuilder* builder, const char* name); // returns BR_INVALID_ID on error
 
 BR_Error BR_preallocDataBlocks(BR_ModuleBuilder* builder, uint32_t n_dbs_hint);
 void     BR_deallocDataBlocks(BR_Module* module);
 BR_Error BR_addDataBlock(BR_ModuleBuilder* builder, BR_id* db_id_p, const char* name, bool is_mutable, uint32_t n_pieces_hint);
-BR_id    BR_getDataBlockIdByName(const BR_Module* module, const char* name); // returns BR_INVALID_ID on error
+BR_id    BR_getDataBlockIdByName(const BR_ModuleBuilder* builder, const char* name); // returns BR_INVALID_ID on error
 
 BR_Op*   BR_getOp(BR_Module* module, BR_id proc_id, uint32_t op_id);
 BR_Error BR_labelStackItem(BR_ModuleBuilder* builder, BR_id proc_id, uint32_t op_id, uint32_t item_id, const char* name);
@@ -741,14 +847,40 @@ size_t   BR_getStackItemIdByName(const BR_ModuleBuilder* builder, BR_id proc_id,
 size_t   BR_getTypeRTSize(const BR_Module* module, BR_Type type);
 
 // implemented in `src/libbr_write.c`
-long     BR_writeModule(BR_Module src, FILE* dst);
+// flags for `BR_writeModule`
+#define BR_WRITE_COMPRESS 0x1 // compress the procedure bodies and the names, see `BR_SECTION_COMPRESSED`; `BR_loadFromBytecode` then always decodes all the bodies, ignoring `BR_LOAD_LAZY`
+long     BR_writeModule(BR_Module src, FILE* dst, uint32_t flags); // writes the module in the BRB v2 format, copying pending procedure bodies as is; returns the size of the written module in bytes, or -1 on failure
+
+// implemented in `src/libbr_lz.c`
+size_t   BR_compressBlock(const uint8_t* src, size_t size, uint8_t* dst); // `size` must not exceed `BR_LZ_BLOCK_SIZE`, `dst` must have room for `BR_LZ_MAX_COMPRESSED_SIZE(size)` bytes; returns the compressed size
+bool     BR_decompressBlock(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size); // returns false if `src` is not a valid compressed block of exactly `dst_size` bytes
 
 // implemented in `src/libbr_load.c`
-BR_Error BR_loadFromBytecode(FILE* src, BR_ModuleBuilder* dst);
+// flags for `BR_loadFromBytecode`
+#define BR_LOAD_LAZY 0x1 // leave the bodies of all the procedures but the entry point undecoded until `BR_loadProcBody` is called on them; only BRB v2 modules have them indexed, others are decoded whole; `BR_disassembleModule` and the compilers expect all the bodies to be decoded
+BR_Error BR_loadFromBytecode(FILE* src, BR_ModuleBuilder* dst, uint32_t flags); // memory-maps `src` if it's a regular file, the resulting module owns the mapping
+BR_Error BR_loadFromBytecodeBuffer(sbuf src, BR_ModuleBuilder* dst, uint32_t flags); // the names of the declarations, unless they're compressed, and the pending procedure bodies point into `src`, so it must outlive the module
+BR_Error BR_loadProcBody(BR_ModuleBuilder* builder, BR_id proc_id); // decodes the body of a procedure left pending by `BR_LOAD_LAZY`, does nothing if it's decoded already
 
 // implemented in `src/libbr_exec.c`
-BR_Error BR_execModule(BR_Module module, BR_ExecEnv* env, char* args[], size_t stack_size, const volatile bool* interruptor);
+BR_Error BR_prepareModule(BR_Module module, BR_PreparedModule* dst, const volatile bool* interruptor, uint32_t flags); // `module` is not modified; `flags` are the same as for `BR_execModule`
+BR_Error BR_runPreparedModule(const BR_PreparedModule* module, BR_ExecEnv* env, char* args[], size_t stack_size, const volatile bool* interruptor); // `env` must be either zero-initialized or left by a previous run, whose memory is then reused; any number of runs with different `env`s can be executed in parallel
+void     BR_delPreparedModule(BR_PreparedModule* module);
+// images are modules prepared for execution and saved as they are laid out in memory, so that loading them takes only mapping the file
+// and patching the addresses of the data blocks into the operations; the data blocks that depend on addresses or have side effects are evaluated on load;
+// an image can only be loaded on the same kind of host it was saved on, and its operations are not verified on load, so it must come from `BR_writeImage`
+BR_Error BR_writeImage(BR_Module module, FILE* dst, const volatile bool* interruptor, uint32_t flags); // prepares `module` like `BR_prepareModule` does and saves the result to `dst`
+BR_Error BR_loadImage(FILE* src, BR_PreparedModule* dst, const volatile bool* interruptor); // memory-maps `src` if it's a regular file, the resulting module owns the mapping
+BR_Error BR_snapshotDataBlocks(BR_Module* module, const volatile bool* interruptor); // replaces the bodies of the immutable data blocks whose contents don't depend on addresses or on the pointer size with their pre-evaluated contents
+BR_Error BR_execModule(BR_Module module, BR_ExecEnv* env, char* args[], size_t stack_size, const volatile bool* interruptor, uint32_t flags);
 void     BR_delExecEnv(BR_ExecEnv* env);
+long     BR_printOpProfile(const BR_ExecEnv* env, FILE* dst); // prints how many times every sequence of 2 or 3 operations occurs in the procedures of the executed module, most frequent first; for generating `XOP_FUSIONS` in `src/libbr_exec.c`
+long     BR_printFusionReport(const BR_ExecEnv* env, FILE* dst); // prints how many dispatches were removed from every procedure by `BR_EXEC_FUSE`
+
+// implemented in `src/libbr_batch.c`
+BR_Error BR_loadBatch(FILE* src, char* program_name, bool nul_separated, BR_Batch* dst); // reads argument vectors one per line, with arguments separated by spaces or tabs, or, if `nul_separated` is true, with every argument terminated by a NUL and every vector by an empty argument; `program_name` becomes the first argument of every vector
+BR_Error BR_runBatch(const BR_PreparedModule* module, BR_Batch* batch, uint32_t n_workers, size_t stack_size, uint32_t flags, BR_BatchCallback callback, void* ctx); // `n_workers` = 0 means one worker per online CPU
+void     BR_delBatch(BR_Batch* batch);
 
 // implemented in `src/libbr_asm.c`
 BR_Error BR_loadFromAssembly(FILE* input, const char* input_name, BR_ModuleBuilder* dst);
@@ -758,7 +890,10 @@ long     BR_printType(BR_Type type, FILE* dst);
 long     BR_disassembleModule(const BR_Module* module, FILE* dst);
 
 // implemented in `src/libbr_native_codegen.c`
-long     BR_compileModule_darwin_arm64(const BR_Module* module, FILE* dst, char** entry_point_name);
+long     BR_compileModule_darwin_arm64(const BR_Module* module, FILE* dst, char** entry_point_name, uint32_t n_workers); // the procedures are compiled on `n_workers` threads, 0 meaning one per online CPU; the output doesn't depend on it
+long     BR_compileModule_linux_x86_64(const BR_Module* module, FILE* dst, char** entry_point_name); // emits GAS assembly for a static executable that uses no libc; `entry_point_name` is the symbol to be passed to the linker as the entry point
+long     BR_compileModuleELF_linux_x86_64(const BR_Module* module, FILE* dst, bool executable); // same as `BR_compileModule_linux_x86_64`, but emits the machine code directly, either as a ready-to-run static executable or as an object file
+long     BR_compileModule_c(const BR_Module* module, FILE* dst); // emits C11 code for a program that only depends on the POSIX `write`, `read` and `_exit`
 
 // implemented in `src/libbr_compiler.c`
 BR_CompilationError BR_loadFromSource(FILE* input, const char* input_name, BR_ModuleBuilder* dst);
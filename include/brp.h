@@ -228,6 +228,12 @@ bool BRP_setSymbols(BRP* obj, sbuf symbols[])
 	return true;
 }
 
+static void appendPiece(sbuf* dst, sbuf piece)
+{
+	memcpy(dst->data + dst->length, piece.data, piece.length);
+	dst->length += piece.length;
+}
+
 static sbuf removeComments(sbuf buffer)
 {
 	char* to_free = buffer.data;
@@ -238,29 +244,41 @@ static sbuf removeComments(sbuf buffer)
 		sbuf_fromcstr("/*"),
 		(sbuf){0}
 	};
-	sbuf res = sbuf_fromcstr("");
+// the result is written into a single buffer: removing comments never makes the input longer, except for adding the closing quote of an unterminated literal
+	sbuf res = sbuf_alloc(buffer.length + 1);
+	if (!res.data) {
+		free(to_free);
+		return res;
+	}
+	res.length = 0;
 // TODO: make the preprocessor aware of comments for them not to screw up the tokens' source locations
 	while (buffer.length) {
 		sbuf part, other_part;
 		switch ((sbuf_split_v(&buffer, &part, comment_delims))) {
 			case 0: // double quote
 				sbuf_splitesc(&buffer, &other_part, comment_delims[0]);
-				res = sbuf_concat(res, part, comment_delims[0], other_part, comment_delims[0]);
+				appendPiece(&res, part);
+				appendPiece(&res, comment_delims[0]);
+				appendPiece(&res, other_part);
+				appendPiece(&res, comment_delims[0]);
 				break;
 			case 1: // single quote
 				sbuf_splitesc(&buffer, &other_part, comment_delims[1]);
-				res = sbuf_concat(res, part, comment_delims[1], other_part, comment_delims[1]);
+				appendPiece(&res, part);
+				appendPiece(&res, comment_delims[1]);
+				appendPiece(&res, other_part);
+				appendPiece(&res, comment_delims[1]);
 				break;
 			case 2: // line-terminated comment (like the one this text is in)
 				sbuf_split(&buffer, &other_part, SBUF_NEWLINE);
-				res = sbuf_concat(res, part);
+				appendPiece(&res, part);
 				break;
 			case 3: /* free-form comment (like the one this text is in) */
 				sbuf_split(&buffer, &other_part, sbuf_fromcstr("*/"));
-				res = sbuf_concat(res, part);
+				appendPiece(&res, part);
 				break;
 			default:
-				res = sbuf_concat(res, part);
+				appendPiece(&res, part);
 				break;
 		}
 	}
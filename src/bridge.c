@@ -1,5 +1,7 @@
 #include <br.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 static char* shiftArgs(int* argc_p, char*** argv_p)
 {
@@ -18,19 +20,53 @@ defArray_as(char*, strArray);
 static strArray inputs = {0};
 static sbuf as_format; 
 static char* output;
+static uint32_t n_instances;
+static char* batch_path;
+static bool batch_nul_separated;
+static bool batch_in_order;
+static uint32_t n_workers;
+static bool save_bytecode;
+static bool save_image;
+static bool snapshot_data;
+static bool compress_bytecode;
+static bool use_system_toolchain;
+static bool save_object;
+static bool compile_via_c;
+static uint32_t exec_flags = BR_EXEC_THREADED | BR_EXEC_FUSE;
+static uint32_t jit_threshold = BR_DEFAULT_JIT_THRESHOLD;
 
 static const char* help_msg = 	"bridge - all-in-one tool for working with BRidge\n"
 				"usage: %s [options] <inputs>\n"
+				"by default, the module is compiled to a native executable, which is saved to <input> without the extension\n"
 				"options:\n"
 				"\t-h, --help\tPrint this message and quit\n"
 				"\t-o <path>\tSave output to <path>\n"
+				"\t-r <n>\t\tRun the module in <n> parallel instances and report the throughput instead of compiling it\n"
+				"\t-b <path>\tRun the module once for every argument vector in <path>, one per line, instead of compiling it;\n"
+				"\t\t\tthe exit status and the time of every run are reported to stderr; `-` means stdin\n"
+				"\t-0\t\tArguments in the input of `-b` are terminated by NULs, and argument vectors by empty arguments\n"
+				"\t-j <n>\t\tExecute the runs of `-b`, or generate the arm64 code of the procedures, on <n> worker threads;\n"
+				"\t\t\tdefaults to the number of CPUs\n"
+				"\t-k\t\tReport the runs of `-b` in the order of the input instead of the order of completion\n"
+				"\t-J <n>\t\tCompile the module to machine code after <n> interpreted runs of `-r` or `-b`; only on x86-64\n"
+				"\t-B\t\tSave the module as BRidge bytecode instead of compiling it; the output defaults to <input>.brb\n"
+				"\t-i\t\tSave the module as an image prepared for execution instead of compiling it; the output defaults to <input>.brbi;\n"
+				"\t\t\tthe image is run with `-r` or `-b` without preparing the module again, with the execution options it was saved with,\n"
+				"\t\t\tbut only on the same kind of host\n"
+				"\t-S\t\tSave the immutable data blocks in the output of `-B` pre-evaluated, so that they are not evaluated at every start\n"
+				"\t-z\t\tCompress the procedure bodies and the names in the output of `-B`; such a module is always decoded whole\n"
+				"\t-a\t\tCompile the module to assembly and build the executable with the system assembler and linker;\n"
+				"\t\t\ton Linux x86-64, the executable is emitted directly by default\n"
+				"\t-c\t\tSave the module as an object file instead of an executable; the output defaults to <input>.o; only on Linux x86-64\n"
+				"\t-C\t\tCompile the module to C and build the executable with the system C compiler\n"
 				"\t-x<format>\tForce <inputs> to be interpreted as <format> input\n"
 				"\t\t<format> coresponds to the file endings of supported input formats:\n"
 				"\t\t\tbr\tBRidge source code\n"
 				"\t\t\tvbrb\tBRidge assembly code\n"
-				"\t\t\tbrb\tBRidge bytecode\n";
+				"\t\t\tbrb\tBRidge bytecode\n"
+				"\t\t\tbrbi\tBRidge module image, see `-i`\n";
 
-static const sbuf formats[] = {sbuf_fromcstr("br"), sbuf_fromcstr("brb"), sbuf_fromcstr("vbrb")};
+static const sbuf formats[] = {sbuf_fromcstr("br"), sbuf_fromcstr("brb"), sbuf_fromcstr("vbrb"), sbuf_fromcstr("brbi")};
 
 
 static int parseArgs(int argc, char** argv)
@@ -56,6 +92,64 @@ static int parseArgs(int argc, char** argv)
 				case 'o':
 					shiftArgs(&argc, &argv);
 					output = *argv;
+					*argv = "";
+					break;
+				case 'r':
+					shiftArgs(&argc, &argv);
+					if (!*argv || !(n_instances = strtoul(*argv, NULL, 10)))
+						return eprintf("error: option `-r` expects a positive number of instances\n"), 1;
+					*argv = "";
+					break;
+				case 'b':
+					shiftArgs(&argc, &argv);
+					if (!(batch_path = *argv))
+						return eprintf("error: option `-b` expects a path\n"), 1;
+					*argv = "";
+					break;
+				case '0':
+					batch_nul_separated = true;
+					break;
+				case 'j':
+					shiftArgs(&argc, &argv);
+					if (!*argv || !(n_workers = strtoul(*argv, NULL, 10)))
+						return eprintf("error: option `-j` expects a positive number of workers\n"), 1;
+					*argv = "";
+					break;
+				case 'k':
+					batch_in_order = true;
+					break;
+				case 'J': {
+					shiftArgs(&argc, &argv);
+					char* end;
+					if (!*argv || !**argv || (jit_threshold = strtoul(*argv, &end, 10), *end))
+						return eprintf("error: option `-J` expects a number of runs\n"), 1;
+					exec_flags |= BR_EXEC_JIT;
+					*argv = "";
+					break;
+				}
+				case 'B':
+					save_bytecode = true;
+					break;
+				case 'i':
+					save_image = true;
+					break;
+				case 'S':
+					snapshot_data = true;
+					break;
+				case 'z':
+					compress_bytecode = true;
+					break;
+				case 'a':
+					use_system_toolchain = true;
+					break;
+				case 'c':
+					save_object = true;
+					break;
+				case 'C':
+					compile_via_c = true;
+					break;
+// end of a group of options; options that take a value also end the group by emptying the argument they are in
+				case '\0':
 					break;
 				case 'x':
 					shiftStr(argv);
@@ -68,7 +162,8 @@ static int parseArgs(int argc, char** argv)
 						}
 					if (!x_flag_set)
 						return eprintf("error: unknown input format `%.*s`\n"
-								"\tsupported formats: br, vbrb, brb\n", sbuf_unpack(format_s)), 1;
+								"\tsupported formats: br, vbrb, brb, brbi\n", sbuf_unpack(format_s)), 1;
+					*argv = "";
 					break;
 				default:
 					return eprintf("error: unknown option `-%c`\n", **argv), 1;
@@ -86,14 +181,279 @@ static int parseArgs(int argc, char** argv)
 		}
 	}
 	if (!inputs.length) return eprintf("error: no input provided\n"), 1;
-	if (!output) output = *arrayhead(inputs);
+	if (!output) output = BR_setFileExt(*arrayhead(inputs), save_bytecode ? "brb" : save_image ? "brbi" : save_object ? "o" : "");
 	return -1;
 }
 
+static const char* const exec_status_names[N_BR_EXCS] = {
+	[BR_EXC_CONTINUE]       = "running",
+	[BR_EXC_EXIT]           = "exit",
+	[BR_EXC_END]            = "end",
+	[BR_EXC_INTERRUPT]      = "interrupted",
+	[BR_EXC_UNKNOWN_OP]     = "unknown operation",
+	[BR_EXC_STACK_OVERFLOW] = "stack overflow"
+};
+
+typedef struct {
+	const BR_PreparedModule* module;
+	BR_ExecEnv env;
+	BR_Error err;
+} Instance;
+
+static void* runInstance(void* arg)
+{
+	Instance* const instance = arg;
+	instance->err = BR_runPreparedModule(instance->module, &instance->env, (char*[]){*arrayhead(inputs), NULL}, BR_DEFAULT_STACK_SIZE, NULL);
+	return NULL;
+}
+
+// runs `n_instances` instances of the module in parallel, each in its own thread
+static int runInstances(const BR_PreparedModule* prepared)
+{
+	Instance* const instances = calloc(n_instances, sizeof(Instance));
+	pthread_t* const threads = malloc(n_instances * sizeof(pthread_t));
+	assert(instances && threads, "memory allocation failure during execution");
+	struct timespec start;
+	BR_startTimerAt(&start);
+	for (uint32_t i = 0; i < n_instances; ++i) {
+		instances[i].module = prepared;
+		assert(!pthread_create(&threads[i], NULL, runInstance, &instances[i]),
+			"could not create a thread (reason: %s)", strerror(errno));
+	}
+	for (uint32_t i = 0; i < n_instances; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	const float elapsed = BR_endTimerAt(&start);
+// the exit code is the one the module exited with, unless any of the instances failed
+	int exitcode = 0;
+	bool failed = false;
+	for (uint32_t i = 0; i < n_instances; ++i) {
+		const BR_ExecStatus status = instances[i].env.exec_status;
+		if (instances[i].err.type) {
+			BR_printErrorMsg(stderr, instances[i].err, "execution error");
+			failed = true;
+		} else if (status.type == BR_EXC_EXIT) {
+			exitcode = status.exit_code;
+		} else if (status.type != BR_EXC_END) {
+			eprintf("instance %u: %s\n", i, exec_status_names[status.type]);
+			failed = true;
+		}
+		BR_delExecEnv(&instances[i].env);
+	}
+	if (failed) exitcode = 1;
+	eprintf("%u instances run in %.3f ms (%.1f runs per second)\n", n_instances, elapsed, n_instances / elapsed * 1000);
+	free(threads);
+	free(instances);
+	return exitcode;
+}
+
+static void reportBatchRun(const BR_BatchRun* run, uint32_t run_id, void* ctx)
+{
+	if (run->err.type) {
+		eprintf("%u\t", run_id);
+		BR_printErrorMsg(stderr, run->err, "execution error");
+	} else if (run->status.type == BR_EXC_EXIT) {
+		eprintf("%u\texit %u\t%.1f us\n", run_id, run->status.exit_code, run->time * 1000);
+	} else eprintf("%u\t%s\t%.1f us\n", run_id, exec_status_names[run->status.type], run->time * 1000);
+}
+
+// saves the module to `output` as bytecode, pre-evaluating its data blocks if `snapshot_data` is set and compressing it if `compress_bytecode` is set
+static int saveBytecode(BR_ModuleBuilder builder)
+{
+	BR_Module module;
+	BR_Error err = BR_extractModule(builder, &module);
+	if (err.type) return BR_printErrorMsg(stderr, err, "loading error"), 1;
+	if (snapshot_data && (err = BR_snapshotDataBlocks(&module, NULL)).type)
+		return BR_printErrorMsg(stderr, err, "data block evaluation error"), 1;
+	FILE* const output_fd = fopen(output, "wb");
+	if (!output_fd)
+		return eprintf("error: could not open `%s` (reason: %s)\n", output, strerror(errno)), 1;
+	const bool failed = BR_writeModule(module, output_fd, compress_bytecode ? BR_WRITE_COMPRESS : 0) < 0;
+	fclose(output_fd);
+	BR_delModule(module);
+	if (failed)
+		return eprintf("error: could not write the module to `%s`\n", output), 1;
+	return 0;
+}
+
+// runs the module once for every argument vector read from `batch_path`
+static int runBatch(const BR_PreparedModule* prepared)
+{
+	FILE* const src = str_eq(batch_path, "-") ? stdin : fopen(batch_path, "r");
+	if (!src)
+		return eprintf("error: could not open `%s` (reason: %s)\n", batch_path, strerror(errno)), 1;
+	BR_Batch batch;
+	BR_Error err = BR_loadBatch(src, *arrayhead(inputs), batch_nul_separated, &batch);
+	if (src != stdin) fclose(src);
+	if (err.type) return BR_printErrorMsg(stderr, err, "batch loading error"), 1;
+	struct timespec start;
+	BR_startTimerAt(&start);
+	err = BR_runBatch(prepared, &batch, n_workers, BR_DEFAULT_STACK_SIZE, batch_in_order ? BR_BATCH_IN_ORDER : 0, reportBatchRun, NULL);
+	if (err.type) {
+		BR_printErrorMsg(stderr, err, "execution error");
+		BR_delBatch(&batch);
+		return 1;
+	}
+	const float elapsed = BR_endTimerAt(&start);
+	eprintf("%u runs in %.3f ms (%.1f runs per second)\n", batch.runs.length, elapsed, batch.runs.length / elapsed * 1000);
+	BR_delBatch(&batch);
+	return 0;
+}
+
+// prepares the module for execution and runs it as requested by `-r` or `-b`
+static int runModule(BR_ModuleBuilder builder)
+{
+	BR_Module module;
+	BR_Error err = BR_extractModule(builder, &module);
+	if (err.type) return BR_printErrorMsg(stderr, err, "loading error"), 1;
+	BR_PreparedModule prepared;
+	if ((err = BR_prepareModule(module, &prepared, NULL, exec_flags)).type)
+		return BR_printErrorMsg(stderr, err, "execution error"), 1;
+	prepared.jit_threshold = jit_threshold;
+	const int exitcode = batch_path ? runBatch(&prepared) : runInstances(&prepared);
+	BR_delPreparedModule(&prepared);
+	BR_delModule(module);
+	return exitcode;
+}
+
+// runs the image at the only input as requested by `-r` or `-b`; the image is already prepared, so the module builder is not needed
+static int runImage(void)
+{
+	if (save_bytecode || save_image || (!batch_path && !n_instances))
+		return eprintf("error: module images can only be run, with `-r` or `-b`\n"), 1;
+	if (inputs.length > 1)
+		return eprintf("error: a module image can't be combined with other inputs\n"), 1;
+	FILE* const input_fd = fopen(*arrayhead(inputs), "rb");
+	if (!input_fd)
+		return eprintf("error: could not open `%s` (reason: %s)\n", *arrayhead(inputs), strerror(errno)), 1;
+	BR_PreparedModule prepared;
+	const BR_Error err = BR_loadImage(input_fd, &prepared, NULL);
+	fclose(input_fd);
+	if (err.type) return BR_printErrorMsg(stderr, err, "image loading error"), 1;
+	prepared.jit_threshold = jit_threshold;
+	const int exitcode = batch_path ? runBatch(&prepared) : runInstances(&prepared);
+	BR_delPreparedModule(&prepared);
+	return exitcode;
+}
+
+// saves the module to `output` as an image prepared for execution with `exec_flags`
+static int saveImage(BR_ModuleBuilder builder)
+{
+	BR_Module module;
+	BR_Error err = BR_extractModule(builder, &module);
+	if (err.type) return BR_printErrorMsg(stderr, err, "loading error"), 1;
+	FILE* const output_fd = fopen(output, "wb");
+	if (!output_fd)
+		return eprintf("error: could not open `%s` (reason: %s)\n", output, strerror(errno)), 1;
+	err = BR_writeImage(module, output_fd, NULL, exec_flags);
+	const bool failed = fclose(output_fd);
+	BR_delModule(module);
+	if (err.type) return BR_printErrorMsg(stderr, err, "image error"), 1;
+	if (failed)
+		return eprintf("error: could not write the image to `%s`\n", output), 1;
+	return 0;
+}
+
+// compiles the module to a native executable at `output` with the system assembler and linker
+static int compileNative(BR_ModuleBuilder builder)
+{
+	BR_Module module;
+	BR_Error err = BR_extractModule(builder, &module);
+	if (err.type) return BR_printErrorMsg(stderr, err, "loading error"), 1;
+#if defined(__linux__) && defined(__x86_64__)
+	if (!use_system_toolchain || save_object) {
+		FILE* const output_fd = fopen(output, "wb");
+		if (!output_fd)
+			return eprintf("error: could not open `%s` (reason: %s)\n", output, strerror(errno)), 1;
+		BR_compileModuleELF_linux_x86_64(&module, output_fd, !save_object);
+		BR_delModule(module);
+		if (fclose(output_fd))
+			return eprintf("error: could not write to `%s` (reason: %s)\n", output, strerror(errno)), 1;
+		if (!save_object && chmod(output, 0755))
+			return eprintf("error: could not make `%s` executable (reason: %s)\n", output, strerror(errno)), 1;
+		return 0;
+	}
+#else
+	if (save_object)
+		return eprintf("error: saving object files is not supported on this platform\n"), 1;
+#endif
+	char* const asm_path = sbuf_tostr(sbuf_fromstr(output), sbuf_fromcstr(".s"));
+	char* const obj_path = sbuf_tostr(sbuf_fromstr(output), sbuf_fromcstr(".o"));
+	FILE* const asm_fd = fopen(asm_path, "w");
+	if (!asm_fd)
+		return eprintf("error: could not open `%s` (reason: %s)\n", asm_path, strerror(errno)), 1;
+	char* native_entry_point;
+#if defined(__linux__) && defined(__x86_64__)
+	BR_compileModule_linux_x86_64(&module, asm_fd, &native_entry_point);
+	fclose(asm_fd);
+	char* const as_argv[] = {"as", "--64", "-o", obj_path, asm_path, NULL};
+	char* const ld_argv[] = {"ld", "-static", "-e", native_entry_point, "-o", output, obj_path, NULL};
+#elif defined(__APPLE__) && defined(__aarch64__)
+	BR_compileModule_darwin_arm64(&module, asm_fd, &native_entry_point, n_workers);
+	fclose(asm_fd);
+	FILE* syslibroot_fd = popen("xcrun --show-sdk-path", "r");
+	if (!syslibroot_fd) return eprintf("native linker error\n"), 1;
+	sbuf syslibroot = sbuf_fromfile(syslibroot_fd);
+	if (!syslibroot.data) return eprintf("native linker error\n"), 1;
+	pclose(syslibroot_fd);
+	syslibroot.data[syslibroot.length - 1] = '\0';
+	char* const as_argv[] = {"as", "-arch", "arm64", "-o", obj_path, asm_path, NULL};
+	char* const ld_argv[] = {"ld", "-syslibroot", syslibroot.data, "-lSystem", "-e", native_entry_point, "-arch", "arm64", "-o", output, obj_path, NULL};
+#else
+	fclose(asm_fd);
+	remove(asm_path);
+	return eprintf("error: compilation to native code is not supported on this platform\n"), 1;
+#endif
+	BR_delModule(module);
+// calling native assembler
+	BR_ProcessInfo proc = {.out = stdout, .err = stderr};
+	assert(BR_execProcess((char**)as_argv, &proc),
+		"could not call the native assembler (reason: %s)", strerror(errno));
+	remove(asm_path);
+	if (proc.exitcode)
+		return eprintf("native assembler error: subprocess exited with code %i\n", proc.exitcode), 1;
+// calling native linker
+	proc = (BR_ProcessInfo){.out = stdout, .err = stderr};
+	assert(BR_execProcess((char**)ld_argv, &proc),
+		"could not call the native linker (reason: %s)", strerror(errno));
+	remove(obj_path);
+	if (proc.exitcode)
+		return eprintf("native linker error: subprocess exited with code %i\n", proc.exitcode), 1;
+	free(native_entry_point);
+	free(obj_path);
+	free(asm_path);
+	return 0;
+}
+
+static int compileViaC(BR_ModuleBuilder builder)
+{
+	BR_Module module;
+	BR_Error err = BR_extractModule(builder, &module);
+	if (err.type) return BR_printErrorMsg(stderr, err, "loading error"), 1;
+	char* const c_path = sbuf_tostr(sbuf_fromstr(output), sbuf_fromcstr(".c"));
+	FILE* const c_fd = fopen(c_path, "w");
+	if (!c_fd)
+		return eprintf("error: could not open `%s` (reason: %s)\n", c_path, strerror(errno)), 1;
+	BR_compileModule_c(&module, c_fd);
+	fclose(c_fd);
+	BR_delModule(module);
+// calling the C compiler
+	char* const cc_argv[] = {"cc", "-O2", "-o", output, c_path, NULL};
+	BR_ProcessInfo proc = {.out = stdout, .err = stderr};
+	assert(BR_execProcess((char**)cc_argv, &proc),
+		"could not call the C compiler (reason: %s)", strerror(errno));
+	remove(c_path);
+	if (proc.exitcode)
+		return eprintf("C compiler error: subprocess exited with code %i\n", proc.exitcode), 1;
+	free(c_path);
+	return 0;
+}
+
 int main(int argc, char* argv[])
 {
 	int exitcode;
 	if ((exitcode = parseArgs(argc, argv)) > 0) return exitcode;
+	if (sbuf_eq(as_format, sbuf_fromcstr("brbi"))) return runImage();
 // initializing the builder
 	BR_ModuleBuilder builder;
 	BR_initModuleBuilder(&builder);
@@ -117,42 +477,20 @@ int main(int argc, char* argv[])
 				return BR_printErrorMsg(stderr, err, "assembly error"), 1;
 		}
 	} else if (sbuf_eq(as_format, sbuf_fromcstr("brb"))) {
+	// only the entry point is ever executed, so the bodies of the other procedures are only needed when compiling or saving the module
+		const uint32_t load_flags = (batch_path || n_instances) && !save_image ? BR_LOAD_LAZY : 0;
 		arrayForeach_as (char*, strArray, input, inputs) {
 			FILE* input_fd = fopen(*input, "rb");
 			if (!input_fd)
 				return eprintf("error: could not open `%s` (reason: %s)\n", *input, strerror(errno)), 1;
-			BR_Error err = BR_loadFromBytecode(input_fd, &builder);
+			BR_Error err = BR_loadFromBytecode(input_fd, &builder, load_flags);
 			if (err.type)
 				return BR_printErrorMsg(stderr, err, "loading error"), 1;
 		}
 	} else return eprintf("error: unknown input format `%.*s`\n"
-			      "\tsupported formats: br, vbrb, brb\n", sbuf_unpack(as_format)), 1;
-	return 0;
-// compiling the output
-	BR_Module module;
-	BR_Error err = BR_extractModule(builder, &module);
-	if (err.type) return BR_printErrorMsg(stderr, err, "loading error"), 1;
-	FILE* output_fd = fopen(output, "w");
-	if (!output_fd)
-		return eprintf("error: could not open `%s` (reason: %s)\n", output, strerror(errno)), 1;
-	char* native_entry_point;
-	BR_compileModule_darwin_arm64(&module, output_fd, &native_entry_point);
-// calling native assembler
-	BR_ProcessInfo proc = {.out = stdout, .err = stderr};
-	assert(BR_execProcess((char*[]){"as", "-arch", "arm64", output, "-o", output, NULL}, &proc),
-		"could not call the native assembler (reason: %s)", strerror(errno));
-	if (proc.exitcode)
-		return eprintf("native assembler error: subprocess exited with code %i\n", proc.exitcode), 1;
-// calling native linker
-	proc = (BR_ProcessInfo){.out = stdout, .err = stderr};
-	FILE* syslibroot_fd = popen("xcrun --show-sdk-path", "r");
-	if (!syslibroot_fd) return eprintf("native linker error\n"), 1;
-	sbuf syslibroot = sbuf_fromfile(syslibroot_fd);
-	if (!syslibroot.data) return eprintf("native linker error\n"), 1;
-	pclose(syslibroot_fd);
-	syslibroot.data[syslibroot.length - 1] = '\0';
-	assert(BR_execProcess((char*[]){"ld", "-syslibroot", syslibroot.data, "-lSystem", "-e", native_entry_point, "-arch", "arm64", "-o", output, output}, &proc),
-		"could not call the native linker (reason: %s)", strerror(errno));
-	if (proc.exitcode)
-		return eprintf("native linker error: subprocess exited with code %i\n", proc.exitcode), 1;
+			      "\tsupported formats: br, vbrb, brb, brbi\n", sbuf_unpack(as_format)), 1;
+	if (save_bytecode) return saveBytecode(builder);
+	if (save_image) return saveImage(builder);
+	if (batch_path || n_instances) return runModule(builder);
+	return compile_via_c ? compileViaC(builder) : compileNative(builder);
 }
@@ -311,7 +311,7 @@ static BR_Error getName(BRP* obj, char** name_p)
 	return (BR_Error){0};
 }
 
-static BR_Error getType(BRP* obj, BR_Module* module, BR_Type* res_p)
+static BR_Error getType(BRP* obj, BR_ModuleBuilder* builder, BR_Type* res_p)
 {
 	*res_p = (BR_Type){0};
 // fetching the type kind
@@ -331,7 +331,7 @@ static BR_Error getType(BRP* obj, BR_Module* module, BR_Type* res_p)
 			char* struct_name;
 			BR_Error err = getName(obj, &struct_name);
 			if (err.type) return err;
-			BR_id struct_id = BR_getStructIdByName(module, struct_name);
+			BR_id struct_id = BR_getStructIdByName(builder, struct_name);
 			if (struct_id == BR_INVALID_ID)
 				return addLoc((BR_Error){.type = BR_ERR_UNKNOWN_STRUCT, .name = struct_name}, token);
 			res_p->struct_id = struct_id;
@@ -396,13 +396,13 @@ static BR_Error getOp(BRP* obj, BR_ModuleBuilder* builder, BR_id proc_id, BR_Op*
 				char* name;
 				if ((err = getName(obj, &name)).type)
 					return addLoc((BR_Error){.type = BR_ERR_INT_OR_DB_NAME_EXPECTED}, token);
-				op->operand_s = BR_getDataBlockIdByName(&builder->module, name);
+				op->operand_s = BR_getDataBlockIdByName(builder, name);
 				if (op->operand_s == BR_INVALID_ID)
 					return addLoc((BR_Error){.type = BR_ERR_UNKNOWN_DB, .name = name}, token);
 			}
 			break;
 		case BR_OPERAND_TYPE:
-			if ((err = getType(obj, &builder->module, &op->operand_type)).type) return err;
+			if ((err = getType(obj, builder, &op->operand_type)).type) return err;
 			break;
 		case BR_OPERAND_BUILTIN: {
 			char* name_c;
@@ -450,7 +450,7 @@ BR_Error BR_loadFromAssembly(FILE* input, const char* input_name, BR_ModuleBuild
 				BRP_unfetchToken(&prep, token);
 // getting return type of the procedure
 				BR_Type ret_type;
-				if ((err = getType(&prep, &dst->module, &ret_type)).type) return err;
+				if ((err = getType(&prep, dst, &ret_type)).type) return err;
 // getting procedure name
 				char* proc_name;
 				if ((err = getName(&prep, &proc_name)).type) return err;
@@ -462,11 +462,11 @@ BR_Error BR_loadFromAssembly(FILE* input, const char* input_name, BR_ModuleBuild
 				if (BRP_getTokenSymbolId(BRP_peekToken(&prep)) != BR_SYM_BRACKET_R) {
 					do {
 						if (!BR_TypeArray_incrlen(&args, 1)) return (BR_Error){.type = BR_ERR_NO_MEMORY};
-						if ((err = getType(&prep, &dst->module, arrayhead(args))).type) return err;
+						if ((err = getType(&prep, dst, arrayhead(args))).type) return err;
 					} while (BRP_getTokenSymbolId(BRP_fetchToken(&prep)) != BR_SYM_BRACKET_R);
 				} else BRP_fetchToken(&prep);
 // adding the declaration
-				BR_id proc_id = BR_getProcIdByName(&dst->module, proc_name);
+				BR_id proc_id = BR_getProcIdByName(dst, proc_name);
 				if (proc_id == BR_INVALID_ID) {
 					if ((err = BR_addProc(dst, &proc_id, proc_name, args.length, args.data, ret_type, 0)).type) return addLoc(err, token);
 				} else {
@@ -504,7 +504,7 @@ BR_Error BR_loadFromAssembly(FILE* input, const char* input_name, BR_ModuleBuild
 				token = BRP_peekToken(&prep);
 				if ((err = getName(&prep, &db_name)).type) return err;
 // adding the declaration
-				BR_id db_id = BR_getDataBlockIdByName(&dst->module, db_name);
+				BR_id db_id = BR_getDataBlockIdByName(dst, db_name);
 				if (db_id == BR_INVALID_ID)
 					if ((err = BR_addDataBlock(dst, &db_id, db_name, is_mutable, 0)).type) return addLoc(err, token);
 // optionally fetching the body
@@ -536,7 +536,7 @@ BR_Error BR_loadFromAssembly(FILE* input, const char* input_name, BR_ModuleBuild
 				BR_TypeArray fields = {0};
 				while (BRP_getTokenSymbolId(token = BRP_peekToken(&prep)) != BR_SYM_CBRACKET_R) {
 					BR_Type* field = BR_TypeArray_incrlen(&fields, 1);
-					if ((err = getType(&prep, &dst->module, field)).type) return err;
+					if ((err = getType(&prep, dst, field)).type) return err;
 				}
 				token = BRP_fetchToken(&prep);
 				BR_id struct_id;
@@ -0,0 +1,223 @@
+// implementation for running a module over many argument vectors on a pool of worker threads
+#include <br.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+implArray(BR_BatchRun);
+
+static bool isArgSeparator(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+// splits `batch->src` into argument vectors; if `fill` is false, only counts the vectors and the arguments, including the terminating NULLs;
+// the arguments are terminated in place only when `fill` is true, so that both passes see the same input
+static void splitBatch(BR_Batch* batch, char* program_name, bool nul_separated, bool fill, size_t* n_args_p, uint32_t* n_runs_p)
+{
+	size_t n_args = 0;
+	uint32_t n_runs = 0;
+	char* const end = batch->src.data + batch->src.length;
+	char* cur = batch->src.data;
+	while (cur < end) {
+		if (fill) {
+			batch->runs.data[n_runs].args = &batch->args[n_args];
+			batch->args[n_args] = program_name;
+		}
+		++n_args;
+		if (nul_separated) {
+			while (cur < end && *cur) {
+				if (fill) batch->args[n_args] = cur;
+				++n_args;
+				cur += strnlen(cur, end - cur) + 1;
+			}
+// skipping the empty argument that ends the vector
+			++cur;
+		} else while (cur < end) {
+			if (*cur == '\n') {
+				++cur;
+				break;
+			}
+			if (isArgSeparator(*cur)) {
+				++cur;
+				continue;
+			}
+			if (fill) batch->args[n_args] = cur;
+			++n_args;
+			while (cur < end && !isArgSeparator(*cur)) ++cur;
+			const bool line_end = cur < end && *cur == '\n';
+			if (fill) *cur = '\0';
+			++cur;
+			if (line_end) break;
+		}
+		if (fill) batch->args[n_args] = NULL;
+		++n_args;
+		++n_runs;
+	}
+	*n_args_p = n_args;
+	*n_runs_p = n_runs;
+}
+
+BR_Error BR_loadBatch(FILE* src, char* program_name, bool nul_separated, BR_Batch* dst)
+{
+	*dst = (BR_Batch){0};
+	dst->src = sbuf_fromfile(src);
+// reserving a byte past the end of the input for terminating the last argument in place
+	if (!sbuf_realloc(&dst->src, dst->src.length + 1))
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	dst->src.data[--dst->src.length] = '\0';
+	size_t n_args;
+	uint32_t n_runs;
+	splitBatch(dst, program_name, nul_separated, false, &n_args, &n_runs);
+	if (!(dst->args = malloc(n_args * sizeof(char*))) && n_args)
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	if (!BR_BatchRunArray_incrlen(&dst->runs, n_runs) && n_runs)
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	memset(dst->runs.data, 0, n_runs * sizeof(BR_BatchRun));
+	splitBatch(dst, program_name, nul_separated, true, &n_args, &n_runs);
+	return (BR_Error){0};
+}
+
+void BR_delBatch(BR_Batch* batch)
+{
+	BR_BatchRunArray_clear(&batch->runs);
+	free(batch->args);
+	sbuf_dealloc(&batch->src);
+	*batch = (BR_Batch){0};
+}
+
+// the runs not yet taken by a worker, `begin | end << 32`; both the worker itself and the thieves only ever change it with a CAS
+typedef _Atomic uint64_t BR_RunRange;
+#define RUN_RANGE(begin, end) ((uint64_t)(begin) | (uint64_t)(end) << 32)
+#define RUN_RANGE_BEGIN(range) ((uint32_t)(range))
+#define RUN_RANGE_END(range) ((uint32_t)((range) >> 32))
+
+typedef struct BR_BatchRunner BR_BatchRunner;
+
+typedef struct {
+	BR_BatchRunner* runner;
+	BR_RunRange range;
+	BR_ExecEnv env;
+	pthread_t thread;
+} BR_BatchWorker;
+
+struct BR_BatchRunner {
+	const BR_PreparedModule* module;
+	BR_Batch* batch;
+	size_t stack_size;
+	uint32_t flags;
+	BR_BatchCallback callback;
+	void* ctx;
+	BR_BatchWorker* workers;
+	uint32_t n_workers;
+// reporting state, guarded by `lock`
+	pthread_mutex_t lock;
+	bool* finished; // only for `BR_BATCH_IN_ORDER`
+	uint32_t next_reported; // only for `BR_BATCH_IN_ORDER`
+};
+
+// takes the next run from the worker's own range; returns UINT32_MAX if the range is empty
+static uint32_t popRun(BR_BatchWorker* worker)
+{
+	uint64_t range = atomic_load(&worker->range);
+	while (RUN_RANGE_BEGIN(range) < RUN_RANGE_END(range)) {
+		if (atomic_compare_exchange_weak(&worker->range, &range, RUN_RANGE(RUN_RANGE_BEGIN(range) + 1, RUN_RANGE_END(range))))
+			return RUN_RANGE_BEGIN(range);
+	}
+	return UINT32_MAX;
+}
+
+// moves the latter half of the range of another worker to the worker's own range; returns false if all the other workers are out of runs
+static bool stealRuns(BR_BatchWorker* worker)
+{
+	BR_BatchRunner* const runner = worker->runner;
+	const uint32_t self_id = worker - runner->workers;
+	for (uint32_t i = 1; i < runner->n_workers; ++i) {
+		BR_BatchWorker* const victim = &runner->workers[(self_id + i) % runner->n_workers];
+		uint64_t range = atomic_load(&victim->range);
+		while (RUN_RANGE_BEGIN(range) < RUN_RANGE_END(range)) {
+			const uint32_t mid = RUN_RANGE_END(range) - (RUN_RANGE_END(range) - RUN_RANGE_BEGIN(range) + 1) / 2;
+			if (atomic_compare_exchange_weak(&victim->range, &range, RUN_RANGE(RUN_RANGE_BEGIN(range), mid))) {
+// the own range is empty, so no thief can be changing it at the moment
+				atomic_store(&worker->range, RUN_RANGE(mid, RUN_RANGE_END(range)));
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void reportRun(BR_BatchRunner* runner, uint32_t run_id)
+{
+	pthread_mutex_lock(&runner->lock);
+	if (runner->flags & BR_BATCH_IN_ORDER) {
+		runner->finished[run_id] = true;
+		while (runner->next_reported < runner->batch->runs.length && runner->finished[runner->next_reported]) {
+			runner->callback(&runner->batch->runs.data[runner->next_reported], runner->next_reported, runner->ctx);
+			++runner->next_reported;
+		}
+	} else runner->callback(&runner->batch->runs.data[run_id], run_id, runner->ctx);
+	pthread_mutex_unlock(&runner->lock);
+}
+
+static void* runWorker(void* arg)
+{
+	BR_BatchWorker* const worker = arg;
+	BR_BatchRunner* const runner = worker->runner;
+	do {
+		uint32_t run_id;
+		while ((run_id = popRun(worker)) != UINT32_MAX) {
+			BR_BatchRun* const run = &runner->batch->runs.data[run_id];
+			struct timespec start;
+			BR_startTimerAt(&start);
+			run->err = BR_runPreparedModule(runner->module, &worker->env, run->args, runner->stack_size, NULL);
+			run->time = BR_endTimerAt(&start);
+			run->status = worker->env.exec_status;
+			if (runner->callback) reportRun(runner, run_id);
+		}
+	} while (stealRuns(worker));
+	return NULL;
+}
+
+BR_Error BR_runBatch(const BR_PreparedModule* module, BR_Batch* batch, uint32_t n_workers, size_t stack_size, uint32_t flags, BR_BatchCallback callback, void* ctx)
+{
+	if (!n_workers) n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_workers > batch->runs.length) n_workers = batch->runs.length;
+	if (!n_workers) return (BR_Error){0};
+	BR_BatchRunner runner = {
+		.module = module,
+		.batch = batch,
+		.stack_size = stack_size,
+		.flags = flags,
+		.callback = callback,
+		.ctx = ctx,
+		.n_workers = n_workers,
+	};
+	if (!(runner.workers = calloc(n_workers, sizeof(BR_BatchWorker))))
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	if ((flags & BR_BATCH_IN_ORDER) && !(runner.finished = calloc(batch->runs.length, sizeof(bool)))) {
+		free(runner.workers);
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	}
+	pthread_mutex_init(&runner.lock, NULL);
+// distributing the runs evenly between the workers; the ones that are done early steal from the rest
+	for (uint32_t i = 0; i < n_workers; ++i) {
+		runner.workers[i].runner = &runner;
+		atomic_init(&runner.workers[i].range, RUN_RANGE(
+			(uint64_t)batch->runs.length * i / n_workers,
+			(uint64_t)batch->runs.length * (i + 1) / n_workers
+		));
+	}
+	uint32_t n_started = 0;
+	while (n_started < n_workers && !pthread_create(&runner.workers[n_started].thread, NULL, runWorker, &runner.workers[n_started]))
+		++n_started;
+// if not all the threads could be started, the ones that were steal the runs of the rest
+	for (uint32_t i = 0; i < n_started; ++i) {
+		pthread_join(runner.workers[i].thread, NULL);
+		BR_delExecEnv(&runner.workers[i].env);
+	}
+	pthread_mutex_destroy(&runner.lock);
+	free(runner.finished);
+	free(runner.workers);
+	return n_started ? (BR_Error){0} : (BR_Error){.type = BR_ERR_NO_MEMORY};
+}
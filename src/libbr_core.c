@@ -10,6 +10,7 @@
 #include <spawn.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #define ARENA_IMPLEMENTATION
 #include <external/arena.h>
 extern char** environ;
@@ -21,6 +22,7 @@ implArray(BR_Op);
 implArray(BR_DataBlock);
 implArray(BR_StackNode);
 implArray(BR_StackNodeArray);
+implArray_as(size_t, BR_SizeArray);
 
 #define BR_SNF_STACKFRAME 0x1
 
@@ -352,7 +354,7 @@ bool BR_execProcess(char* argv[], BR_ProcessInfo* info)
 		}
 	}
 
-	if ((local_errno = posix_spawn(&pid, "/bin/sh", &file_actions, NULL, argv, environ))) {
+	if ((local_errno = posix_spawnp(&pid, argv[0], &file_actions, NULL, argv, environ))) {
 		errno = local_errno;
 		return false;
 	}
@@ -507,6 +509,9 @@ void BR_printErrorMsg(FILE* dst, BR_Error err, const char* prefix)
 		case BR_ERR_NO_DB_BODY_SIZE:
 			fprintf(dst, "unexpected end of input whole loading body size of a data block\n");
 			break;
+		case BR_ERR_NO_DB_BODY:
+			fprintf(dst, "unexpected end of input while loading contents of a data block\n");
+			break;
 		case BR_ERR_NO_ENTRY:
 			fprintf(dst, "unexpected end of input while loading the entry point\n");
 			break;
@@ -600,6 +605,15 @@ void BR_printErrorMsg(FILE* dst, BR_Error err, const char* prefix)
 		case BR_ERR_INVALID_TYPE_KIND:
 			fprintf(dst, "invalid type kind: %llu\n", err.operand);
 			break;
+		case BR_ERR_INVALID_SECTIONS:
+			fputs("invalid section table or procedure body index\n", dst);
+			break;
+		case BR_ERR_INVALID_IMAGE:
+			fputs("invalid module image, or one saved on a different kind of host\n", dst);
+			break;
+		case BR_ERR_WRITE_FAILURE:
+			fputs("could not write the output\n", dst);
+			break;
 		case BR_ERR_OK:
 		case BR_N_ERROR_TYPES:
 		default:
@@ -607,6 +621,89 @@ void BR_printErrorMsg(FILE* dst, BR_Error err, const char* prefix)
 	}
 }
 
+// FNV-1a
+static uint32_t hashName(const char* name)
+{
+	uint32_t res = 2166136261u;
+	while (*name) res = (res ^ (uint8_t)*name++) * 16777619u;
+	return res;
+}
+
+// makes sure the index can hold `min_length` entries while staying at most half full
+static bool reserveNameIndex(BR_NameIndex* index, uint32_t min_length)
+{
+	if (min_length > UINT32_MAX / 4) return false;
+	uint32_t new_cap = index->cap ? index->cap : 16;
+	while (new_cap / 2 < min_length) new_cap *= 2;
+	if (new_cap == index->cap) return true;
+	struct BR_nameindexslot_t* new_slots = calloc(new_cap, sizeof(struct BR_nameindexslot_t));
+	if (!new_slots) return false;
+	for (uint32_t i = 0; i < index->cap; ++i) {
+		if (!index->slots[i].name) continue;
+		uint32_t slot_id = hashName(index->slots[i].name) & (new_cap - 1);
+		while (new_slots[slot_id].name) slot_id = (slot_id + 1) & (new_cap - 1);
+		new_slots[slot_id] = index->slots[i];
+	}
+	free(index->slots);
+	index->slots = new_slots;
+	index->cap = new_cap;
+	return true;
+}
+
+bool BR_addToNameIndex(BR_NameIndex* index, const char* name, uint32_t id)
+{
+	if (!name) return true;
+	if (!reserveNameIndex(index, index->length + 1)) return false;
+	for (uint32_t slot_id = hashName(name) & (index->cap - 1);; slot_id = (slot_id + 1) & (index->cap - 1)) {
+		struct BR_nameindexslot_t* slot = &index->slots[slot_id];
+		if (!slot->name) {
+			*slot = (struct BR_nameindexslot_t){.name = name, .id = id};
+			++index->length;
+			return true;
+		}
+	// if the name is already taken, the first declaration with it is the one that's found, just like with a linear search
+		if (str_eq(slot->name, name)) return true;
+	}
+}
+
+uint32_t BR_findInNameIndex(const BR_NameIndex* index, const char* name)
+{
+	if (!index->cap) return UINT32_MAX;
+	for (uint32_t slot_id = hashName(name) & (index->cap - 1);; slot_id = (slot_id + 1) & (index->cap - 1)) {
+		const struct BR_nameindexslot_t* slot = &index->slots[slot_id];
+		if (!slot->name) return UINT32_MAX;
+		if (str_eq(slot->name, name)) return slot->id;
+	}
+}
+
+void BR_delNameIndex(BR_NameIndex* index)
+{
+	free(index->slots);
+	*index = (BR_NameIndex){0};
+}
+
+BR_Error BR_indexNames(BR_ModuleBuilder* builder)
+{
+	if (builder->error.type) return builder->error;
+	BR_delNameIndex(&builder->proc_names);
+	BR_delNameIndex(&builder->data_block_names);
+	BR_delNameIndex(&builder->struct_names);
+	if (!reserveNameIndex(&builder->proc_names, builder->module.seg_exec.length)
+		|| !reserveNameIndex(&builder->data_block_names, builder->module.seg_data.length)
+		|| !reserveNameIndex(&builder->struct_names, builder->module.seg_typeinfo.length))
+		return builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY};
+	arrayForeach (BR_Proc, proc, builder->module.seg_exec) {
+		BR_addToNameIndex(&builder->proc_names, proc->name, proc - builder->module.seg_exec.data);
+	}
+	arrayForeach (BR_DataBlock, block, builder->module.seg_data) {
+		BR_addToNameIndex(&builder->data_block_names, block->name, block - builder->module.seg_data.data);
+	}
+	arrayForeach (BR_Struct, obj, builder->module.seg_typeinfo) {
+		BR_addToNameIndex(&builder->struct_names, obj->name, obj - builder->module.seg_typeinfo.data);
+	}
+	return (BR_Error){0};
+}
+
 BR_Error BR_initModuleBuilder(BR_ModuleBuilder* builder)
 {
 	*builder = (BR_ModuleBuilder){0};
@@ -631,6 +728,9 @@ BR_Error BR_analyzeModule(const BR_Module* module, BR_ModuleBuilder* dst)
 	arrayForeach (BR_Proc, proc, module->seg_exec) {
 		BR_id _;
 		if (BR_addProc(dst, &_, proc->name, proc->args.length, proc->args.data, proc->ret_type, proc->body.length).type) return dst->error;
+	// a pending body is left for `BR_loadProcBody`
+		arrayhead(dst->module.seg_exec)->pending_body = proc->pending_body;
+		arrayhead(dst->module.seg_exec)->n_pending_ops = proc->n_pending_ops;
 	}
 	arrayForeach (BR_DataBlock, block, module->seg_data) {
 		arrayForeach (BR_Op, op, block->body) {
@@ -657,6 +757,10 @@ void BR_delModule(BR_Module module)
 	BR_deallocProcs(&module);
 	BR_deallocDataBlocks(&module);
 	BR_deallocStructs(&module);
+	if (module.is_image_mapped) {
+		munmap(module.image.data, module.image.length);
+	} else sbuf_dealloc(&module.image);
+	sbuf_dealloc(&module.names);
 }
 
 BR_Error BR_extractModule(BR_ModuleBuilder builder, BR_Module* dst)
@@ -669,6 +773,11 @@ BR_Error BR_extractModule(BR_ModuleBuilder builder, BR_Module* dst)
 		BR_StackNodeArray_clear(data_block_info);
 	}
 	BR_StackNodeArrayArray_clear(&builder.data_blocks);
+	BR_SizeArray_clear(&builder.procs_max_rt_size);
+	BR_SizeArray_clear(&builder.data_blocks_max_rt_size);
+	BR_delNameIndex(&builder.proc_names);
+	BR_delNameIndex(&builder.data_block_names);
+	BR_delNameIndex(&builder.struct_names);
 	arena_free(&builder.arena);
 	*dst = builder.module;
 	return builder.error;
@@ -695,32 +804,62 @@ FILE* BR_findModule(const char* name, const char* search_paths[])
 	return NULL;
 }
 
-static BR_StackNode getNthStackNode(BR_StackNode head, size_t n)
+// sets up the cached fields of a new stack node, expects `node->type` and `node->flags` to be already set
+// jump pointers are assigned according to the skew-binary scheme, which keeps the number of steps needed to reach a node at any depth logarithmic
+static void initStackNode(const BR_Module* module, BR_StackNode node, BR_StackNode prev)
+{
+	node->prev = prev;
+	if (!prev) {
+		node->jump = NULL;
+		node->depth = 1;
+		node->n_items = !(node->flags & BR_SNF_STACKFRAME);
+		node->rt_offset = BR_getTypeRTSize(module, node->type);
+		return;
+	}
+	node->depth = prev->depth + 1;
+	node->n_items = prev->n_items + !(node->flags & BR_SNF_STACKFRAME);
+	BR_StackNode jump = prev->jump;
+	node->jump = (jump ? prev->depth - jump->depth == jump->depth - (jump->jump ? jump->jump->depth : 0) : false)
+		? jump->jump
+		: prev;
+	const size_t node_size = BR_getTypeRTSize(module, node->type);
+	node->rt_offset = node_size == SIZE_MAX || prev->rt_offset == SIZE_MAX ? SIZE_MAX : prev->rt_offset + node_size;
+}
+
+// returns the node in the stack that has exactly `depth` nodes in its part of the stack, `depth` must not exceed that of `head`
+static BR_StackNode getStackNodeAtDepth(BR_StackNode head, uint32_t depth)
 {
-	while (head && n--) head = head->prev;
+	while (head ? head->depth > depth : false) {
+		head = (head->jump ? head->jump->depth : 0) >= depth ? head->jump : head->prev;
+	}
 	return head;
 }
 
+static size_t getStackLength(BR_StackNode head)
+{
+	return head ? head->depth : 0;
+}
+
+static BR_StackNode getNthStackNode(BR_StackNode head, size_t n)
+{
+	return n < getStackLength(head) ? getStackNodeAtDepth(head, head->depth - n) : NULL;
+}
+
+// the stack frame of a procedure is always at the bottom of the stack, hence the first `head->n_items` nodes are never a part of it
 static BR_StackNode getNthStackNode_nonInternal(BR_StackNode head, size_t n)
 {
 	if (head && !n ? head->flags & BR_SNF_STACKFRAME : false) {
 		return head->prev;
 	}
-	while (head && n--) {
-		if (head->flags & BR_SNF_STACKFRAME) ++n;
-		head = head->prev;
-	}
-	return head;
+	return (head ? n <= head->n_items : false)
+		? getStackNodeAtDepth(head, head->depth - n)
+		: NULL;
 }
 
-static size_t getStackLength(BR_StackNode head)
+// what `BR_getStackRTSize` returns: a stack that only consists of the stack frame of the procedure is considered empty
+static size_t getStackRTSize(BR_StackNode head)
 {
-	size_t res = 0;
-	while (head) {
-		head = head->prev;
-		++res;
-	}
-	return res;
+	return head ? head->flags & BR_SNF_STACKFRAME ? 0 : head->rt_offset : 0;
 }
 
 static bool compareTypes(BR_Type field, BR_Type entry)
@@ -749,7 +888,7 @@ static void __unused printStack(BR_StackNode head)
 	putchar(']');
 }
 
-static BR_Error changeStack(BR_StackNodeArray* stack, BR_Op op, size_t n_in, BR_Type* in_types, size_t n_out, BR_Type* out_types, Arena* allocator)
+static BR_Error changeStack(const BR_Module* module, BR_StackNodeArray* stack, BR_Op op, size_t n_in, BR_Type* in_types, size_t n_out, BR_Type* out_types, Arena* allocator)
 {
 	BR_StackNode iter = *arrayhead(*stack);
 	if (getStackLength(iter) < n_in)
@@ -778,8 +917,8 @@ static BR_Error changeStack(BR_StackNodeArray* stack, BR_Op op, size_t n_in, BR_
 		prev = node;
 		if (!(node = arena_alloc(allocator, sizeof(struct BR_stacknode_t)))) return (BR_Error){.type = BR_ERR_NO_MEMORY};
 		*node = (struct BR_stacknode_t){0};
-		node->prev = prev;
 		node->type = type->kind ? *type : type->ctor(op, *arrayhead(*stack));
+		initStackNode(module, node, prev);
 	}
 	return (BR_Error){.type = BR_StackNodeArray_append(stack, node) ? 0 : BR_ERR_NO_MEMORY};
 }
@@ -791,7 +930,9 @@ BR_Error BR_addProc(BR_ModuleBuilder* builder, BR_id* proc_id_p, const char* nam
 // validating the return type
 	if ((err = validateType(&builder->module, &ret_type)).type) return err;
 	if (!BR_ProcArray_append(&builder->module.seg_exec, (BR_Proc){.name = name, .ret_type = ret_type})
-		|| !BR_StackNodeArrayArray_append(&builder->procs, (BR_StackNodeArray){0}))
+		|| !BR_StackNodeArrayArray_append(&builder->procs, (BR_StackNodeArray){0})
+		|| !BR_SizeArray_append(&builder->procs_max_rt_size, 0)
+		|| !BR_addToNameIndex(&builder->proc_names, name, builder->module.seg_exec.length - 1))
 		return builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY};
 // copying the argumants
 	if (!(arrayhead(builder->module.seg_exec)->args = BR_TypeArray_copy((BR_TypeArray){ .data = (BR_Type*)args, .length = n_args })).data)
@@ -811,18 +952,18 @@ BR_Error BR_addProc(BR_ModuleBuilder* builder, BR_id* proc_id_p, const char* nam
 		prev = input;
 		if (!(input = arena_alloc(&builder->arena, sizeof(struct BR_stacknode_t))))
 			return builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY};
-		input->prev = prev;
 		input->type = args[n_args];
 		input->name = NULL;
 		input->flags = BR_SNF_STACKFRAME;
+		initStackNode(&builder->module, input, prev);
 	}
 	prev = input;
 	if (!(input = arena_alloc(&builder->arena, sizeof(struct BR_stacknode_t))))
 		return builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY};
-	input->prev = prev;
 	input->type = BR_PTR_TYPE(2);
 	input->name = NULL;
 	input->flags = BR_SNF_STACKFRAME;
+	initStackNode(&builder->module, input, prev);
 	*proc_id_p = builder->module.seg_exec.length - 1;
 	return builder->error = (BR_Error){.type = BR_StackNodeArray_append(arrayhead(builder->procs), input) ? 0 : BR_ERR_NO_MEMORY};
 }
@@ -1377,12 +1518,15 @@ BR_Error BR_addOp(BR_ModuleBuilder* builder, BR_id proc_id, BR_Op op)
 	if (builder->error.type) return builder->error;
 	BR_OpArray* body;
 	BR_StackNodeArray* vframe;
+	size_t* max_rt_size;
 	if (proc_id < 0) {
 		body = &builder->module.seg_data.data[~proc_id].body;
 		vframe = &builder->data_blocks.data[~proc_id];
+		max_rt_size = &builder->data_blocks_max_rt_size.data[~proc_id];
 	} else {
 		body = &builder->module.seg_exec.data[proc_id].body;
 		vframe = &builder->procs.data[proc_id];
+		max_rt_size = &builder->procs_max_rt_size.data[proc_id];
 	}
 // validating the type operand, if there is one
 	if (BR_GET_OPERAND_TYPE(op.type) == BR_OPERAND_TYPE)
@@ -1431,6 +1575,7 @@ BR_Error BR_addOp(BR_ModuleBuilder* builder, BR_id proc_id, BR_Op op)
 	}
 // registering the changes in the stack
 	if ((builder->error = changeStack(
+		&builder->module,
 		vframe,
 		op,
 		n_in[op.type], in_types[op.type],
@@ -1440,6 +1585,8 @@ BR_Error BR_addOp(BR_ModuleBuilder* builder, BR_id proc_id, BR_Op op)
 		--body->length;
 		return builder->error;
 	}
+	const size_t rt_size = getStackRTSize(*arrayhead(*vframe));
+	if (rt_size != SIZE_MAX && rt_size > *max_rt_size) *max_rt_size = rt_size;
 	return (BR_Error){0};
 }
 
@@ -1465,7 +1612,9 @@ BR_Error BR_addDataBlock(BR_ModuleBuilder* builder, BR_id* db_id_p, const char*
 {
 	if (builder->error.type) return builder->error;
 	if (!BR_DataBlockArray_append(&builder->module.seg_data, (BR_DataBlock){ .name = name, .is_mutable = is_mutable })
-		|| !BR_StackNodeArrayArray_append(&builder->data_blocks, (BR_StackNodeArray){0}))
+		|| !BR_StackNodeArrayArray_append(&builder->data_blocks, (BR_StackNodeArray){0})
+		|| !BR_SizeArray_append(&builder->data_blocks_max_rt_size, 0)
+		|| !BR_addToNameIndex(&builder->data_block_names, name, builder->module.seg_data.length - 1))
 		return (builder->error = (BR_Error){ .type = BR_ERR_NO_MEMORY });
 
 	if (!(arrayhead(builder->module.seg_data)->body = BR_OpArray_new(-(int32_t)n_ops_hint)).data)
@@ -1478,12 +1627,10 @@ BR_Error BR_addDataBlock(BR_ModuleBuilder* builder, BR_id* db_id_p, const char*
 	return (BR_Error){0};
 }
 
-BR_id BR_getDataBlockIdByName(const BR_Module* module, const char* name)
+BR_id BR_getDataBlockIdByName(const BR_ModuleBuilder* builder, const char* name)
 {
-	arrayForeach (BR_DataBlock, block, module->seg_data) {
-		if (str_eq(block->name, name)) return ~(block - module->seg_data.data);
-	}
-	return BR_INVALID_ID;
+	const uint32_t res = BR_findInNameIndex(&builder->data_block_names, name);
+	return res == UINT32_MAX ? BR_INVALID_ID : ~(BR_id)res;
 }
 
 static size_t getTypeAlignment(BR_Module* module, BR_Type type)
@@ -1535,17 +1682,12 @@ size_t BR_getStackItemRTOffset(const BR_ModuleBuilder* builder, BR_id proc_id, u
 	}
 	if (++op_id >= vframe->length) return SIZE_MAX;
 	// `++op_id` because the first element in the state stack is always the initial state, determined by proc args
-	size_t res = 0;
-	BR_StackNode node = vframe->data[op_id];
-	while (node ? node->flags & BR_SNF_STACKFRAME : false) node = node->prev; // setting up the iterator
-	while (node && item_id) {
-		size_t node_size = BR_getTypeRTSize(&builder->module, node->type);
-		if (node_size == SIZE_MAX) return SIZE_MAX;
-		res += node_size;
-		if (!(node->flags & BR_SNF_STACKFRAME)) --item_id;
-		node = node->prev;
-	}
-	return item_id && strict ? SIZE_MAX : res;
+	BR_StackNode head = vframe->data[op_id];
+	if (head ? head->flags & BR_SNF_STACKFRAME : true) return item_id && strict ? SIZE_MAX : 0;
+	if (head->rt_offset == SIZE_MAX) return SIZE_MAX;
+	if (item_id > head->n_items) return strict ? SIZE_MAX : head->rt_offset;
+	BR_StackNode target = getStackNodeAtDepth(head, head->depth - item_id);
+	return head->rt_offset - (target ? target->rt_offset : 0);
 }
 
 size_t BR_getStackRTSize(const BR_ModuleBuilder* builder, BR_id proc_id, uint32_t op_id)
@@ -1555,13 +1697,9 @@ size_t BR_getStackRTSize(const BR_ModuleBuilder* builder, BR_id proc_id, uint32_
 
 size_t BR_getMaxStackRTSize(const BR_ModuleBuilder* builder, BR_id proc_id)
 {
-	size_t res = 0, i = -1;
-	while (true) {
-		size_t cur_size = BR_getStackRTSize(builder, proc_id, i++);
-		if (cur_size == SIZE_MAX) break;
-		if (cur_size > res) res = cur_size;
-	}
-	return res;
+	if (proc_id < 0)
+		return ~proc_id < builder->data_blocks_max_rt_size.length ? builder->data_blocks_max_rt_size.data[~proc_id] : 0;
+	return proc_id < builder->procs_max_rt_size.length ? builder->procs_max_rt_size.data[proc_id] : 0;
 }
 
 bool BR_getStackItemType(const BR_ModuleBuilder* builder, BR_Type* dst, BR_id proc_id, uint32_t op_id, uint32_t item_id)
@@ -1576,8 +1714,7 @@ bool BR_getStackItemType(const BR_ModuleBuilder* builder, BR_Type* dst, BR_id pr
 	}
 	if (++op_id >= vframe->length) return false;
 	// `++op_id` because the first element in the state stack is always the initial state, determined by proc args
-	BR_StackNode node = vframe->data[op_id];
-	while (node && item_id--) node = node->prev;
+	BR_StackNode node = getNthStackNode(vframe->data[op_id], item_id);
 	if (!node) return false;
 	*dst = node->type;
 	return true;
@@ -1590,12 +1727,10 @@ size_t BR_getStackItemRTSize(const BR_ModuleBuilder* builder, BR_id proc_id, uin
 	return BR_getTypeRTSize(&builder->module, res);
 }
 
-BR_id BR_getProcIdByName(const BR_Module* module, const char* name)
+BR_id BR_getProcIdByName(const BR_ModuleBuilder* builder, const char* name)
 {
-	arrayForeach (BR_Proc, proc, module->seg_exec) {
-		if (str_eq(name, proc->name)) return proc - module->seg_exec.data;
-	}
-	return BR_INVALID_ID;
+	const uint32_t res = BR_findInNameIndex(&builder->proc_names, name);
+	return res == UINT32_MAX ? BR_INVALID_ID : res;
 }
 
 size_t BR_getStackItemIdByName(const BR_ModuleBuilder* builder, BR_id proc_id, uint32_t op_id, const char* name)
@@ -1622,6 +1757,8 @@ BR_Error BR_preallocProcs(BR_ModuleBuilder* builder, uint32_t n_procs_hint)
 {
 	if (builder->error.type) return builder->error;
 	if (!(builder->procs = BR_StackNodeArrayArray_new(-(int64_t)n_procs_hint)).data) return (builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY});
+	if (!(builder->procs_max_rt_size = BR_SizeArray_new(-(int64_t)n_procs_hint)).data) return (builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY});
+	if (!reserveNameIndex(&builder->proc_names, n_procs_hint)) return (builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY});
 	if (!(builder->module.seg_exec = BR_ProcArray_new(-(int64_t)n_procs_hint)).data) return (builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY});
 	return (BR_Error){0};
 }
@@ -1630,6 +1767,8 @@ BR_Error BR_preallocDataBlocks(BR_ModuleBuilder* builder, uint32_t n_dbs_hint)
 {
 	if (builder->error.type) return builder->error;
 	if (!(builder->data_blocks = BR_StackNodeArrayArray_new(-(int64_t)n_dbs_hint)).data) return (builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY});
+	if (!(builder->data_blocks_max_rt_size = BR_SizeArray_new(-(int64_t)n_dbs_hint)).data) return (builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY});
+	if (!reserveNameIndex(&builder->data_block_names, n_dbs_hint)) return (builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY});
 	if (!(builder->module.seg_data = BR_DataBlockArray_new(-(int64_t)n_dbs_hint)).data) return (builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY});
 	return (BR_Error){0};
 }
@@ -1655,6 +1794,7 @@ void BR_deallocDataBlocks(BR_Module* module)
 				free(op->operand_ptr);
 		}
 		BR_OpArray_clear(&block->body);
+		sbuf_dealloc(&block->data);
 	}
 	BR_DataBlockArray_clear(&module->seg_data);
 }
@@ -1666,7 +1806,8 @@ BR_Error BR_addStruct(BR_ModuleBuilder* builder, BR_id* struct_id_p, const char*
 	if (builder->module.seg_typeinfo.length == MAX_N_STRUCTS)
 		return builder->error = (BR_Error){.type = BR_ERR_TOO_MANY_STRUCTS};
 	*struct_id_p = builder->module.seg_typeinfo.length;
-	if (!BR_StructArray_append(&builder->module.seg_typeinfo, (BR_Struct){.name = name}))
+	if (!BR_StructArray_append(&builder->module.seg_typeinfo, (BR_Struct){.name = name})
+		|| !BR_addToNameIndex(&builder->struct_names, name, *struct_id_p))
 		return builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY};
 	BR_Struct* obj = &builder->module.seg_typeinfo.data[*struct_id_p];
 // copying the fields
@@ -1695,7 +1836,8 @@ BR_Error BR_addStruct(BR_ModuleBuilder* builder, BR_id* struct_id_p, const char*
 BR_Error BR_preallocStructs(BR_ModuleBuilder* builder, uint32_t n_structs_hint)
 {
 	if (builder->error.type) return builder->error;
-	if (!(builder->module.seg_typeinfo = BR_StructArray_new(-(int64_t)n_structs_hint)).data)
+	if (!(builder->module.seg_typeinfo = BR_StructArray_new(-(int64_t)n_structs_hint)).data
+		|| !reserveNameIndex(&builder->struct_names, n_structs_hint))
 		return builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY};
 	return (BR_Error){0};
 }
@@ -1708,10 +1850,8 @@ void BR_deallocStructs(BR_Module* module)
 	BR_StructArray_clear(&module->seg_typeinfo);
 }
 
-BR_id BR_getStructIdByName(const BR_Module* module, const char* name)
+BR_id BR_getStructIdByName(const BR_ModuleBuilder* builder, const char* name)
 {
-	arrayForeach (BR_Struct, obj, module->seg_typeinfo) {
-		if (str_eq(obj->name, name)) return obj - module->seg_typeinfo.data;
-	}
-	return BR_INVALID_ID;
+	const uint32_t res = BR_findInNameIndex(&builder->struct_names, name);
+	return res == UINT32_MAX ? BR_INVALID_ID : res;
 }
@@ -99,6 +99,10 @@ long BR_disassembleModule(const BR_Module* module, FILE* dst)
 		arrayForeach (BR_Op, op, block->body) {
 			acc += printOp(*op, module, dst);
 		}
+// the contents of a pre-evaluated data block are printed as pushes of its bytes, the last one first, since the stack grows down
+		for (size_t i = block->data.length; i--;) {
+			acc += fprintf(dst, "\ti8 %hhu\n", block->data.data[i]);
+		}
 		acc += str_fput(dst, "}\n");
 	}
 	acc += str_fput(dst, "\n");
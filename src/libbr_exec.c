@@ -1,10 +1,410 @@
 // implementation for execution of BRB modules
 #include <br.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#ifdef __GNUC__
+#define BR_THREADED_DISPATCH // computed `goto`s are supported by the compiler
+#endif
+#ifdef __x86_64__
+#define BR_JIT // `BR_EXEC_JIT` is supported
+#endif
 
 implArray(sbuf);
+implArray(BR_Proc);
+implArray(BR_Type);
+implArray(BR_Op);
+
+// superinstructions: sequences of operations that the threaded engine executes with a single dispatch;
+// listed as `F2(name, c1, c2)` or `F3(name, c1, c2, c3)`, where each component `c*` is one of:
+// 	C_OP(name)                             - `BR_OP_<name>`, executed as `OPB_<name>`
+// 	C_IAT(name, T, OP, operand)            - `BR_OP_<name>`, one of the `*-i@*` operations
+// 	C_NOTAT(name, T)                       - `BR_OP_<name>`, one of the `not@*` operations
+// 	C_BIN(base, int_t, OP, bits1, bits2)   - an execution-only binary operation, see `XOP_BINARY_KINDS`
+// 	C_IMM(base, int_t, OP, operand, bits)  - an execution-only operation with an immediate operand, see `XOP_IMM_KINDS`
+// 	C_NOT(bits)                            - an execution-only `not` operation
+// when several sequences match, the one listed first is chosen, so the longer ones come first.
+// the list between the markers below is generated by `gen_fusions.py` from the output of `BR_printOpProfile`, see the script for its inputs
+// fusions: begin
+#define XOP_FUSIONS(F2, F3) \
+	F3(dbaddr__addiat64__add_64_64, C_OP(DBADDR), C_IAT(ADDIAT64, uint64_t, +=, operand_u), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F3(get__shli_64__xor_64_64, C_OP(GET), C_IMM(BR_XOP_SHLI, uint, <<=, operand_u, 64), C_BIN(BR_XOP_XOR, uint, ^, 64, 64)) \
+	F3(ptr__dbaddr__builtin, C_OP(PTR), C_OP(DBADDR), C_OP(BUILTIN)) \
+	F3(dbaddr__builtin__sys, C_OP(DBADDR), C_OP(BUILTIN), C_OP(SYS)) \
+	F3(builtin__sys__drop, C_OP(BUILTIN), C_OP(SYS), C_OP(DROP)) \
+	F3(get__shri_64__xor_64_64, C_OP(GET), C_IMM(BR_XOP_SHRI, uint, >>=, operand_u, 64), C_BIN(BR_XOP_XOR, uint, ^, 64, 64)) \
+	F3(add_64_64__addr__getfrom, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(ADDR), C_OP(GETFROM)) \
+	F3(add_64_64__dbaddr__addiat64, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(DBADDR), C_IAT(ADDIAT64, uint64_t, +=, operand_u)) \
+	F3(add_64_64__get__shli_64, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(GET), C_IMM(BR_XOP_SHLI, uint, <<=, operand_u, 64)) \
+	F3(addiat64__add_64_64__get, C_IAT(ADDIAT64, uint64_t, +=, operand_u), C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(GET)) \
+	F3(dbaddr__addiat64__add_64_32, C_OP(DBADDR), C_IAT(ADDIAT64, uint64_t, +=, operand_u), C_BIN(BR_XOP_ADD, uint, +, 64, 32)) \
+	F3(addr__getfrom__muli_64, C_OP(ADDR), C_OP(GETFROM), C_IMM(BR_XOP_MULI, uint, *=, operand_u, 64)) \
+	F3(getfrom__muli_64__add_64_64, C_OP(GETFROM), C_IMM(BR_XOP_MULI, uint, *=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F3(addr__getfrom__subi_64, C_OP(ADDR), C_OP(GETFROM), C_IMM(BR_XOP_SUBI, uint, -=, operand_u, 64)) \
+	F3(getfrom__subi_64__add_64_64, C_OP(GETFROM), C_IMM(BR_XOP_SUBI, uint, -=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F3(addr__getfrom__addi_64, C_OP(ADDR), C_OP(GETFROM), C_IMM(BR_XOP_ADDI, uint, +=, operand_u, 64)) \
+	F3(getfrom__addi_64__add_64_64, C_OP(GETFROM), C_IMM(BR_XOP_ADDI, uint, +=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F3(add_64_64__get__shri_64, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(GET), C_IMM(BR_XOP_SHRI, uint, >>=, operand_u, 64)) \
+	F3(get__shli_64__add_64_64, C_OP(GET), C_IMM(BR_XOP_SHLI, uint, <<=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F3(get__muli_64__add_64_64, C_OP(GET), C_IMM(BR_XOP_MULI, uint, *=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F3(get__andi_64__add_64_64, C_OP(GET), C_IMM(BR_XOP_ANDI, uint, &=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F3(sys__drop__get, C_OP(SYS), C_OP(DROP), C_OP(GET)) \
+	F3(add_64_64__ptr__dbaddr, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(PTR), C_OP(DBADDR)) \
+	F3(xor_64_64__dbaddr__addiat64, C_BIN(BR_XOP_XOR, uint, ^, 64, 64), C_OP(DBADDR), C_IAT(ADDIAT64, uint64_t, +=, operand_u)) \
+	F3(get__addi_64__add_64_64, C_OP(GET), C_IMM(BR_XOP_ADDI, uint, +=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F3(get__shri_32__xor_32_32, C_OP(GET), C_IMM(BR_XOP_SHRI, uint, >>=, operand_u, 32), C_BIN(BR_XOP_XOR, uint, ^, 32, 32)) \
+	F2(addr__getfrom, C_OP(ADDR), C_OP(GETFROM)) \
+	F2(dbaddr__addiat64, C_OP(DBADDR), C_IAT(ADDIAT64, uint64_t, +=, operand_u)) \
+	F2(add_64_64__get, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(GET)) \
+	F2(addiat64__add_64_64, C_IAT(ADDIAT64, uint64_t, +=, operand_u), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F2(get__shli_64, C_OP(GET), C_IMM(BR_XOP_SHLI, uint, <<=, operand_u, 64)) \
+	F2(shli_64__xor_64_64, C_IMM(BR_XOP_SHLI, uint, <<=, operand_u, 64), C_BIN(BR_XOP_XOR, uint, ^, 64, 64)) \
+	F2(ptr__dbaddr, C_OP(PTR), C_OP(DBADDR)) \
+	F2(dbaddr__builtin, C_OP(DBADDR), C_OP(BUILTIN)) \
+	F2(sys__drop, C_OP(SYS), C_OP(DROP)) \
+	F2(builtin__sys, C_OP(BUILTIN), C_OP(SYS)) \
+	F2(add_64_64__i64, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(I64)) \
+	F2(muli_64__add_64_64, C_IMM(BR_XOP_MULI, uint, *=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F2(get__shri_64, C_OP(GET), C_IMM(BR_XOP_SHRI, uint, >>=, operand_u, 64)) \
+	F2(shri_64__xor_64_64, C_IMM(BR_XOP_SHRI, uint, >>=, operand_u, 64), C_BIN(BR_XOP_XOR, uint, ^, 64, 64)) \
+	F2(addi_64__add_64_64, C_IMM(BR_XOP_ADDI, uint, +=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F2(add_64_64__addr, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(ADDR)) \
+	F2(add_64_64__dbaddr, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(DBADDR)) \
+	F2(xor_64_64__get, C_BIN(BR_XOP_XOR, uint, ^, 64, 64), C_OP(GET)) \
+	F2(addiat64__add_64_32, C_IAT(ADDIAT64, uint64_t, +=, operand_u), C_BIN(BR_XOP_ADD, uint, +, 64, 32)) \
+	F2(getfrom__muli_64, C_OP(GETFROM), C_IMM(BR_XOP_MULI, uint, *=, operand_u, 64)) \
+	F2(getfrom__subi_64, C_OP(GETFROM), C_IMM(BR_XOP_SUBI, uint, -=, operand_u, 64)) \
+	F2(subi_64__add_64_64, C_IMM(BR_XOP_SUBI, uint, -=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F2(add_64_64__i32, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(I32)) \
+	F2(getfrom__addi_64, C_OP(GETFROM), C_IMM(BR_XOP_ADDI, uint, +=, operand_u, 64)) \
+	F2(get__shli_32, C_OP(GET), C_IMM(BR_XOP_SHLI, uint, <<=, operand_u, 32)) \
+	F2(shli_64__add_64_64, C_IMM(BR_XOP_SHLI, uint, <<=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F2(xor_64_64__i64, C_BIN(BR_XOP_XOR, uint, ^, 64, 64), C_OP(I64)) \
+	F2(get__muli_64, C_OP(GET), C_IMM(BR_XOP_MULI, uint, *=, operand_u, 64)) \
+	F2(get__andi_64, C_OP(GET), C_IMM(BR_XOP_ANDI, uint, &=, operand_u, 64)) \
+	F2(andi_64__add_64_64, C_IMM(BR_XOP_ANDI, uint, &=, operand_u, 64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F2(i64__add_64_64, C_OP(I64), C_BIN(BR_XOP_ADD, uint, +, 64, 64)) \
+	F2(drop__get, C_OP(DROP), C_OP(GET)) \
+	F2(i64__mul_64_64, C_OP(I64), C_BIN(BR_XOP_MUL, uint, *, 64, 64)) \
+	F2(add_64_64__ptr, C_BIN(BR_XOP_ADD, uint, +, 64, 64), C_OP(PTR)) \
+	F2(xor_64_64__dbaddr, C_BIN(BR_XOP_XOR, uint, ^, 64, 64), C_OP(DBADDR)) \
+	F2(get__addi_64, C_OP(GET), C_IMM(BR_XOP_ADDI, uint, +=, operand_u, 64)) \
+	F2(get__shri_32, C_OP(GET), C_IMM(BR_XOP_SHRI, uint, >>=, operand_u, 32)) \
+	F2(shri_32__xor_32_32, C_IMM(BR_XOP_SHRI, uint, >>=, operand_u, 32), C_BIN(BR_XOP_XOR, uint, ^, 32, 32))
+// fusions: end
+
+// execution-only operations; `prepareOpForExec` replaces every arithmetic operation with one of these,
+// specialized for the exact sizes of its operands, so that the execution loop is left with no size dispatch.
+// they only ever exist in the prepared copy of a module made by `BR_prepareModule`, thus are never seen by `BR_writeModule` or `BR_disassembleModule`
+typedef enum {
+// binary operations, 16 variants each, see `XOP_BINARY`
+	BR_XOP_ADD   = BR_N_OPS,
+	BR_XOP_SUB   = BR_XOP_ADD   + 16,
+	BR_XOP_MUL   = BR_XOP_SUB   + 16,
+	BR_XOP_DIV   = BR_XOP_MUL   + 16,
+	BR_XOP_DIVS  = BR_XOP_DIV   + 16,
+	BR_XOP_MOD   = BR_XOP_DIVS  + 16,
+	BR_XOP_MODS  = BR_XOP_MOD   + 16,
+	BR_XOP_AND   = BR_XOP_MODS  + 16,
+	BR_XOP_OR    = BR_XOP_AND   + 16,
+	BR_XOP_XOR   = BR_XOP_OR    + 16,
+	BR_XOP_SHL   = BR_XOP_XOR   + 16,
+	BR_XOP_SHR   = BR_XOP_SHL   + 16,
+	BR_XOP_SHRS  = BR_XOP_SHR   + 16,
+// unary operations and operations with an immediate operand, 4 variants each, see `XOP_UNARY`
+	BR_XOP_ADDI  = BR_XOP_SHRS  + 16,
+	BR_XOP_SUBI  = BR_XOP_ADDI  + 4,
+	BR_XOP_MULI  = BR_XOP_SUBI  + 4,
+	BR_XOP_DIVI  = BR_XOP_MULI  + 4,
+	BR_XOP_DIVSI = BR_XOP_DIVI  + 4,
+	BR_XOP_MODI  = BR_XOP_DIVSI + 4,
+	BR_XOP_MODSI = BR_XOP_MODI  + 4,
+	BR_XOP_ANDI  = BR_XOP_MODSI + 4,
+	BR_XOP_ORI   = BR_XOP_ANDI  + 4,
+	BR_XOP_XORI  = BR_XOP_ORI   + 4,
+	BR_XOP_SHLI  = BR_XOP_XORI  + 4,
+	BR_XOP_SHRI  = BR_XOP_SHLI  + 4,
+	BR_XOP_SHRSI = BR_XOP_SHRI  + 4,
+	BR_XOP_NOT   = BR_XOP_SHRSI + 4,
+// superinstructions, see `XOP_FUSIONS`
+	BR_XOP_PRE_FUSED = BR_XOP_NOT + 3,
+#define F2(name, ...) BR_XOP_FUSED_##name,
+#define F3(name, ...) BR_XOP_FUSED_##name,
+	XOP_FUSIONS(F2, F3)
+#undef F3
+#undef F2
+// variants of the operations above that take their input from the cached top stack item and/or leave their result in it, see `XOP_CACHED`
+	BR_XOP_ARITH_CACHED,
+// variants of the pushing operations that leave their result in the cached top stack item, and of `drop` that drops it
+	BR_XOP_I8_C = BR_XOP_ARITH_CACHED + (BR_XOP_NOT + 4 - BR_XOP_ADD) * 3,
+	BR_XOP_I16_C,
+	BR_XOP_I32_C,
+	BR_XOP_PTR_C,
+	BR_XOP_I64_C,
+	BR_XOP_ADDR_C,
+	BR_XOP_DBADDR_C,
+	BR_XOP_DROP_C,
+	BR_N_XOPS
+} BR_XOpType;
+#define BR_XOP_FUSED (BR_XOP_PRE_FUSED + 1)
+#define BR_XOP_FUSED_END BR_XOP_ARITH_CACHED
+
+// variants of the cached arithmetic operations
+typedef enum {
+	BR_CACHED_IN,  // the input is taken from the cached top stack item, the output is written to the stack
+	BR_CACHED_OUT, // the input is taken from the stack, the output is left in the cached top stack item
+	BR_CACHED_IN_OUT
+} BR_CachedVariant;
+#define XOP_CACHED(type, variant) ((BR_OpType)(BR_XOP_ARITH_CACHED + ((type) - BR_XOP_ADD) * 3 + (variant)))
+static_assert(BR_N_XOPS <= 1 << 16, "execution-only operations do not fit in `BR_Op::type`");
+
+static const BR_XOpType xop_bases[BR_N_OPS] = {
+	[BR_OP_ADD]   = BR_XOP_ADD,
+	[BR_OP_SUB]   = BR_XOP_SUB,
+	[BR_OP_MUL]   = BR_XOP_MUL,
+	[BR_OP_DIV]   = BR_XOP_DIV,
+	[BR_OP_DIVS]  = BR_XOP_DIVS,
+	[BR_OP_MOD]   = BR_XOP_MOD,
+	[BR_OP_MODS]  = BR_XOP_MODS,
+	[BR_OP_AND]   = BR_XOP_AND,
+	[BR_OP_OR]    = BR_XOP_OR,
+	[BR_OP_XOR]   = BR_XOP_XOR,
+	[BR_OP_SHL]   = BR_XOP_SHL,
+	[BR_OP_SHR]   = BR_XOP_SHR,
+	[BR_OP_SHRS]  = BR_XOP_SHRS,
+	[BR_OP_ADDI]  = BR_XOP_ADDI,
+	[BR_OP_SUBI]  = BR_XOP_SUBI,
+	[BR_OP_MULI]  = BR_XOP_MULI,
+	[BR_OP_DIVI]  = BR_XOP_DIVI,
+	[BR_OP_DIVSI] = BR_XOP_DIVSI,
+	[BR_OP_MODI]  = BR_XOP_MODI,
+	[BR_OP_MODSI] = BR_XOP_MODSI,
+	[BR_OP_ANDI]  = BR_XOP_ANDI,
+	[BR_OP_ORI]   = BR_XOP_ORI,
+	[BR_OP_XORI]  = BR_XOP_XORI,
+	[BR_OP_SHLI]  = BR_XOP_SHLI,
+	[BR_OP_SHRI]  = BR_XOP_SHRI,
+	[BR_OP_SHRSI] = BR_XOP_SHRSI,
+	[BR_OP_NOT]   = BR_XOP_NOT
+};
+
+#define XOP_SIZE_ID(size) ((size) == 1 ? 0 : (size) == 2 ? 1 : (size) == 4 ? 2 : 3)
+#define XOP_BINARY(base, op1_size, op2_size) ((BR_OpType)((base) + XOP_SIZE_ID(op1_size) * 4 + XOP_SIZE_ID(op2_size)))
+#define XOP_UNARY(base, op_size) ((BR_OpType)((base) + XOP_SIZE_ID(op_size)))
+
+// X-macros for generating the handlers of the execution-only operations in both execution engines
+#define XOP_SIZES(X, ...) \
+	X(0, 8,  __VA_ARGS__) \
+	X(1, 16, __VA_ARGS__) \
+	X(2, 32, __VA_ARGS__) \
+	X(3, 64, __VA_ARGS__)
+#define XOP_SIZE_PAIRS_FOR(id1, bits1, X, ...) \
+	X(id1, bits1, 0, 8,  __VA_ARGS__) \
+	X(id1, bits1, 1, 16, __VA_ARGS__) \
+	X(id1, bits1, 2, 32, __VA_ARGS__) \
+	X(id1, bits1, 3, 64, __VA_ARGS__)
+#define XOP_SIZE_PAIRS(X, ...) XOP_SIZES(XOP_SIZE_PAIRS_FOR, X, __VA_ARGS__)
+// X(base, name, int_t, OP)
+#define XOP_BINARY_KINDS(X) \
+	X(BR_XOP_ADD,  add,  uint, +) \
+	X(BR_XOP_SUB,  sub,  uint, -) \
+	X(BR_XOP_MUL,  mul,  uint, *) \
+	X(BR_XOP_DIV,  div,  uint, /) \
+	X(BR_XOP_DIVS, divs, int,  /) \
+	X(BR_XOP_MOD,  mod,  uint, %) \
+	X(BR_XOP_MODS, mods, int,  %) \
+	X(BR_XOP_AND,  and,  uint, &) \
+	X(BR_XOP_OR,   or,   uint, |) \
+	X(BR_XOP_XOR,  xor,  uint, ^) \
+	X(BR_XOP_SHL,  shl,  uint, <<) \
+	X(BR_XOP_SHR,  shr,  uint, >>) \
+	X(BR_XOP_SHRS, shrs, int,  >>)
+// X(base, name, int_t, OP, operand)
+#define XOP_IMM_KINDS(X) \
+	X(BR_XOP_ADDI,  addi,  uint, +=,  operand_u) \
+	X(BR_XOP_SUBI,  subi,  uint, -=,  operand_u) \
+	X(BR_XOP_MULI,  muli,  uint, *=,  operand_u) \
+	X(BR_XOP_DIVI,  divi,  uint, /=,  operand_u) \
+	X(BR_XOP_DIVSI, divsi, int,  /=,  operand_s) \
+	X(BR_XOP_MODI,  modi,  uint, %=,  operand_u) \
+	X(BR_XOP_MODSI, modsi, int,  %=,  operand_s) \
+	X(BR_XOP_ANDI,  andi,  uint, &=,  operand_u) \
+	X(BR_XOP_ORI,   ori,   uint, |=,  operand_u) \
+	X(BR_XOP_XORI,  xori,  uint, ^=,  operand_u) \
+	X(BR_XOP_SHLI,  shli,  uint, <<=, operand_u) \
+	X(BR_XOP_SHRI,  shri,  uint, >>=, operand_u) \
+	X(BR_XOP_SHRSI, shrsi, int,  >>=, operand_u)
+// the operations themselves, `head` being the stack head
+#define XOP_BINARY_BODY(head, int_t, OP, bits1, bits2) \
+	*(int_t##bits1##_t*)((head) + bits2 / 8) = *(int_t##bits1##_t*)(head) OP (int_t##64_t)*(int_t##bits2##_t*)((head) + bits1 / 8); \
+	(head) += bits2 / 8;
+#define XOP_IMM_BODY(head, int_t, OP, operand, bits) \
+	*(int_t##bits##_t*)(head) OP (operand);
+#define XOP_NOT_BODY(head, bits) \
+	*(uint##bits##_t*)(head) = ~*(uint##bits##_t*)(head);
+
+// names of the execution-only operations, as printed by `BR_printOpProfile`
+static const char* const xop_names[BR_N_XOPS - BR_N_OPS] = {
+#define BINARY_XOP_NAME(id1, bits1, id2, bits2, base, name, int_t, OP) [base - BR_N_OPS + id1 * 4 + id2] = #name ":" #bits1 ":" #bits2,
+#define BINARY_XOP_NAMES(base, name, int_t, OP) XOP_SIZE_PAIRS(BINARY_XOP_NAME, base, name, int_t, OP)
+#define IMM_XOP_NAME(id, bits, base, name, int_t, OP, operand) [base - BR_N_OPS + id] = #name ":" #bits,
+#define IMM_XOP_NAMES(base, name, int_t, OP, operand) XOP_SIZES(IMM_XOP_NAME, base, name, int_t, OP, operand)
+#define NOT_XOP_NAME(id, bits, _) [BR_XOP_NOT - BR_N_OPS + id] = "not:" #bits,
+#define F2(name, ...) [BR_XOP_FUSED_##name - BR_N_OPS] = "fused:" #name,
+#define F3(name, ...) [BR_XOP_FUSED_##name - BR_N_OPS] = "fused:" #name,
+#define CACHED_BINARY_XOP_NAME(id1, bits1, id2, bits2, base, name, int_t, OP) \
+	[XOP_CACHED(base + id1 * 4 + id2, BR_CACHED_IN) - BR_N_OPS]     = #name ":" #bits1 ":" #bits2 ":cm", \
+	[XOP_CACHED(base + id1 * 4 + id2, BR_CACHED_OUT) - BR_N_OPS]    = #name ":" #bits1 ":" #bits2 ":mc", \
+	[XOP_CACHED(base + id1 * 4 + id2, BR_CACHED_IN_OUT) - BR_N_OPS] = #name ":" #bits1 ":" #bits2 ":cc",
+#define CACHED_BINARY_XOP_NAMES(base, name, int_t, OP) XOP_SIZE_PAIRS(CACHED_BINARY_XOP_NAME, base, name, int_t, OP)
+#define CACHED_IMM_XOP_NAME(id, bits, base, name, int_t, OP, operand) \
+	[XOP_CACHED(base + id, BR_CACHED_IN) - BR_N_OPS]     = #name ":" #bits ":cm", \
+	[XOP_CACHED(base + id, BR_CACHED_OUT) - BR_N_OPS]    = #name ":" #bits ":mc", \
+	[XOP_CACHED(base + id, BR_CACHED_IN_OUT) - BR_N_OPS] = #name ":" #bits ":cc",
+#define CACHED_IMM_XOP_NAMES(base, name, int_t, OP, operand) XOP_SIZES(CACHED_IMM_XOP_NAME, base, name, int_t, OP, operand)
+#define CACHED_NOT_XOP_NAME(id, bits, _) \
+	[XOP_CACHED(BR_XOP_NOT + id, BR_CACHED_IN) - BR_N_OPS]     = "not:" #bits ":cm", \
+	[XOP_CACHED(BR_XOP_NOT + id, BR_CACHED_OUT) - BR_N_OPS]    = "not:" #bits ":mc", \
+	[XOP_CACHED(BR_XOP_NOT + id, BR_CACHED_IN_OUT) - BR_N_OPS] = "not:" #bits ":cc",
+	XOP_BINARY_KINDS(BINARY_XOP_NAMES)
+	XOP_IMM_KINDS(IMM_XOP_NAMES)
+	XOP_SIZES(NOT_XOP_NAME, _)
+	XOP_FUSIONS(F2, F3)
+	XOP_BINARY_KINDS(CACHED_BINARY_XOP_NAMES)
+	XOP_IMM_KINDS(CACHED_IMM_XOP_NAMES)
+	XOP_SIZES(CACHED_NOT_XOP_NAME, _)
+	[BR_XOP_I8_C - BR_N_OPS]   = "i8:c",
+	[BR_XOP_I16_C - BR_N_OPS]  = "i16:c",
+	[BR_XOP_I32_C - BR_N_OPS]  = "i32:c",
+	[BR_XOP_PTR_C - BR_N_OPS]  = "ptr:c",
+	[BR_XOP_I64_C - BR_N_OPS]  = "i64:c",
+	[BR_XOP_ADDR_C - BR_N_OPS]   = "addr:c",
+	[BR_XOP_DBADDR_C - BR_N_OPS] = "dbaddr:c",
+	[BR_XOP_DROP_C - BR_N_OPS]   = "drop:c"
+#undef CACHED_NOT_XOP_NAME
+#undef CACHED_IMM_XOP_NAMES
+#undef CACHED_IMM_XOP_NAME
+#undef CACHED_BINARY_XOP_NAMES
+#undef CACHED_BINARY_XOP_NAME
+#undef F3
+#undef F2
+#undef NOT_XOP_NAME
+#undef IMM_XOP_NAMES
+#undef IMM_XOP_NAME
+#undef BINARY_XOP_NAMES
+#undef BINARY_XOP_NAME
+};
+
+static sbuf getOpName(uint16_t type)
+{
+	return type < BR_N_OPS ? BR_opNames[type] : sbuf_fromstr((char*)xop_names[type - BR_N_OPS]);
+}
+
+typedef struct {
+	uint16_t seq[3];
+	uint8_t length;
+} BR_Fusion;
+
+// indexed by `type - BR_XOP_FUSED`
+static const BR_Fusion fusions[] = {
+#define C_OP(name) BR_OP_##name
+#define C_IAT(name, T, OP, operand) BR_OP_##name
+#define C_NOTAT(name, T) BR_OP_##name
+#define C_BIN(base, int_t, OP, bits1, bits2) XOP_BINARY(base, bits1 / 8, bits2 / 8)
+#define C_IMM(base, int_t, OP, operand, bits) XOP_UNARY(base, bits / 8)
+#define C_NOT(bits) XOP_UNARY(BR_XOP_NOT, bits / 8)
+#define F2(name, c1, c2) {.seq = {c1, c2}, .length = 2},
+#define F3(name, c1, c2, c3) {.seq = {c1, c2, c3}, .length = 3},
+	XOP_FUSIONS(F2, F3)
+#undef F3
+#undef F2
+#undef C_NOT
+#undef C_IMM
+#undef C_BIN
+#undef C_NOTAT
+#undef C_IAT
+#undef C_OP
+};
+#define N_FUSIONS (sizeof(fusions) / sizeof(fusions[0]))
+static_assert(N_FUSIONS == BR_XOP_FUSED_END - BR_XOP_FUSED, "superinstructions and their definitions are out of sync");
+
+// replaces sequences of operations in `body` with superinstructions; the operations after the first one in a sequence
+// are left in place, so that the indices of all the operations stay the same, but are never dispatched to
+static void fuseOps(BR_OpArray body)
+{
+	for (uint32_t i = 0; i < body.length;) {
+		const BR_Fusion* fusion = fusions;
+		for (; fusion < fusions + N_FUSIONS; ++fusion) {
+			if (fusion->length > body.length - i) continue;
+			uint8_t n = 0;
+			while (n < fusion->length && body.data[i + n].type == fusion->seq[n]) ++n;
+			if (n == fusion->length) break;
+		}
+		if (fusion < fusions + N_FUSIONS) {
+			body.data[i].type = BR_XOP_FUSED + (fusion - fusions);
+			i += fusion->length;
+		} else ++i;
+	}
+}
+
+// the number of operations in `body` executed by an operation of type `type`
+static uint8_t getOpSpan(uint16_t type)
+{
+	return type >= BR_XOP_FUSED && type < BR_XOP_FUSED_END ? fusions[type - BR_XOP_FUSED].length : 1;
+}
+
+static const uint16_t cached_pushes[BR_N_OPS] = {
+	[BR_OP_I8]      = BR_XOP_I8_C,
+	[BR_OP_I16]     = BR_XOP_I16_C,
+	[BR_OP_I32]     = BR_XOP_I32_C,
+	[BR_OP_PTR]     = BR_XOP_PTR_C,
+	[BR_OP_I64]     = BR_XOP_I64_C,
+	[BR_OP_ADDR]    = BR_XOP_ADDR_C,
+	[BR_OP_DBADDR]  = BR_XOP_DBADDR_C,
+	[BR_OP_BUILTIN] = BR_XOP_PTR_C
+};
+
+static bool isArithXOp(uint16_t type)
+{
+	return type >= BR_XOP_ADD && type < BR_XOP_NOT + 4;
+}
+
+// whether the operation can take the top stack item from the cache
+static bool canTakeCachedItem(uint16_t type)
+{
+	return isArithXOp(type) || type == BR_OP_DROP;
+}
+
+// whether the operation can leave the new top stack item in the cache
+static bool canLeaveCachedItem(uint16_t type)
+{
+	return isArithXOp(type) || (type < BR_N_OPS && cached_pushes[type]);
+}
+
+// decides statically which operations pass the top stack item on to the next one in a register instead of the memory;
+// the item is only ever cached between a producer and a consumer right after it, so every other operation sees the stack in the memory,
+// and the stack head is always the same as without caching, so spilling the item is a single store
+static void cacheTopItem(BR_OpArray body)
+{
+	bool input_cached = false;
+	for (uint32_t i = 0; i < body.length; i += getOpSpan(body.data[i].type)) {
+		BR_Op* const op = &body.data[i];
+		const uint32_t next = i + getOpSpan(op->type);
+		const bool output_cached = next < body.length && canLeaveCachedItem(op->type) && canTakeCachedItem(body.data[next].type);
+		if (isArithXOp(op->type)) {
+			if (input_cached || output_cached)
+				op->type = XOP_CACHED(op->type, input_cached ? (output_cached ? BR_CACHED_IN_OUT : BR_CACHED_IN) : BR_CACHED_OUT);
+		} else if (input_cached) {
+			op->type = BR_XOP_DROP_C;
+		} else if (output_cached) op->type = cached_pushes[op->type];
+		input_cached = output_cached;
+	}
+}
 
-static void prepareOpForExec(BR_ModuleBuilder* builder, sbufArray seg_data, BR_id proc_id, uint32_t op_id)
+static void prepareOpForExec(BR_ModuleBuilder* builder, const BR_PreparedModule* module, BR_id proc_id, uint32_t op_id)
 {
 	BR_Op *const op = BR_getOp(&builder->module, proc_id, op_id);
 	switch (op->type) {
@@ -90,9 +490,15 @@ static void prepareOpForExec(BR_ModuleBuilder* builder, sbufArray seg_data, BR_i
 			case BR_OP_ADDR:
 				op->operand_u = BR_getStackItemRTOffset(builder, proc_id, op_id, op->operand_u);
 				break;
-			case BR_OP_DBADDR:
-				op->operand_ptr = seg_data.data[~op->operand_s].data;
+			case BR_OP_DBADDR: {
+// every run has its own copy of the mutable data blocks, so the procedures address them relative to it;
+// the data blocks are evaluated only once, and only ever see the initial copy
+				const BR_id db_id = ~op->operand_s;
+				if ((op->x_op2_size = proc_id >= 0 && builder->module.seg_data.data[db_id].is_mutable)) {
+					op->operand_u = module->seg_data.data[db_id].data - module->mut_data.data;
+				} else op->operand_ptr = module->seg_data.data[db_id].data;
 				break;
+			}
 			case BR_OP_BUILTIN:
 				op->operand_u = BR_builtinValues[op->operand_u];
 				break;
@@ -110,6 +516,9 @@ static void prepareOpForExec(BR_ModuleBuilder* builder, sbufArray seg_data, BR_i
 			case BR_OP_SHR:
 			case BR_OP_SHRS:
 				op->x_op2_size = BR_getStackItemRTSize(builder, proc_id, op_id - 1, 1);
+				op->x_op1_size = BR_getStackItemRTSize(builder, proc_id, op_id - 1, 0);
+				op->type = XOP_BINARY(xop_bases[op->type], op->x_op1_size, op->x_op2_size);
+				break;
 			case BR_OP_ADDI:
 			case BR_OP_SUBI:
 			case BR_OP_MULI:
@@ -125,6 +534,7 @@ static void prepareOpForExec(BR_ModuleBuilder* builder, sbufArray seg_data, BR_i
 			case BR_OP_SHRSI:
 			case BR_OP_NOT:
 				op->x_op1_size = BR_getStackItemRTSize(builder, proc_id, op_id - 1, 0);
+				op->type = XOP_UNARY(xop_bases[op->type], op->x_op1_size);
 				break;
 			case BR_OP_DROP:
 				op->operand_u = BR_getStackItemRTSize(builder, proc_id, op_id - 1, 0);
@@ -201,12 +611,49 @@ static const BR_syscall BR_syscalls[] = {
 };
 static_assert(sizeof(BR_syscalls) / sizeof(BR_syscall) == BR_N_SYSCALLS, "not all syscalls have their implementations defined");
 
+static bool execXOp(BR_ExecEnv* env, BR_Op op)
+{
+#define BINARY_XOP_CASE(id1, bits1, id2, bits2, base, name, int_t, OP) \
+		case base + id1 * 4 + id2: \
+			XOP_BINARY_BODY(env->stack_head, int_t, OP, bits1, bits2) \
+			++env->exec_index; \
+			return false;
+#define BINARY_XOP_CASES(base, name, int_t, OP) XOP_SIZE_PAIRS(BINARY_XOP_CASE, base, name, int_t, OP)
+#define IMM_XOP_CASE(id, bits, base, name, int_t, OP, operand) \
+		case base + id: \
+			XOP_IMM_BODY(env->stack_head, int_t, OP, op.operand, bits) \
+			++env->exec_index; \
+			return false;
+#define IMM_XOP_CASES(base, name, int_t, OP, operand) XOP_SIZES(IMM_XOP_CASE, base, name, int_t, OP, operand)
+#define NOT_XOP_CASE(id, bits, _) \
+		case BR_XOP_NOT + id: \
+			XOP_NOT_BODY(env->stack_head, bits) \
+			++env->exec_index; \
+			return false;
+
+// the enumeration only names the first variant of every operation, hence the plain integer
+	switch ((uint16_t)op.type) {
+		XOP_BINARY_KINDS(BINARY_XOP_CASES)
+		XOP_IMM_KINDS(IMM_XOP_CASES)
+		XOP_SIZES(NOT_XOP_CASE, _)
+		default:
+			env->exec_status.type = BR_EXC_UNKNOWN_OP;
+			return true;
+	}
+#undef NOT_XOP_CASE
+#undef IMM_XOP_CASES
+#undef IMM_XOP_CASE
+#undef BINARY_XOP_CASES
+#undef BINARY_XOP_CASE
+}
+
 bool BR_execOp(BR_ExecEnv* env)
 {
-#define ALLOC_STACK_SPACE(incr) \
-	if ((env->stack_head -= (incr)) < env->stack.data) return (env->exec_status.type = BR_EXC_STACK_OVERFLOW);
+// no overflow checks: `BR_runPreparedModule` makes sure that the stack fits the deepest state of the procedure before executing it
+#define ALLOC_STACK_SPACE(incr) env->stack_head -= (incr);
 
 	const BR_Op op = env->cur_proc[env->exec_index];
+	if (op.type >= BR_N_OPS) return execXOp(env, op);
 	switch (op.type) {
 		case BR_OP_NOP:
 			++env->exec_index;
@@ -230,12 +677,16 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		case BR_OP_PTR:
-		case BR_OP_DBADDR:
 		case BR_OP_BUILTIN:
 			ALLOC_STACK_SPACE(sizeof(intptr_t));
 			*(uintptr_t*)env->stack_head = op.operand_u;
 			++env->exec_index;
 			return false;
+		case BR_OP_DBADDR:
+			ALLOC_STACK_SPACE(sizeof(intptr_t));
+			*(uintptr_t*)env->stack_head = (op.x_op2_size ? (uintptr_t)env->mut_data.data : 0) + op.operand_u;
+			++env->exec_index;
+			return false;
 		case BR_OP_I64:
 			ALLOC_STACK_SPACE(8);
 			*(uint64_t*)env->stack_head = op.operand_u;
@@ -248,34 +699,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			return false;
 		case BR_OP_SYS:
 			return BR_syscalls[op.operand_u](env);
-		case BR_OP_ADD: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head + op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head + op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head + op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head + op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_ADDI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head += op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head += op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head += op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head += op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_ADDIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp += op.operand_u);
@@ -306,34 +729,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_SUB: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head - op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head - op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head - op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head - op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_SUBI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head -= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head -= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head -= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head -= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_SUBIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp -= op.operand_u);
@@ -364,34 +759,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_MUL: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head * op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head * op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head * op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head * op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_MULI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head *= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head *= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head *= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head *= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_MULIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp *= op.operand_u);
@@ -422,34 +789,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_DIV: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head / op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head / op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head / op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head / op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_DIVI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head /= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head /= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head /= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head /= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_DIVIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp /= op.operand_u);
@@ -480,34 +819,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_DIVS: {
-			int64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(int8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(int16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(int32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(int64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(int8_t *)(env->stack_head + op.x_op2_size) = *(int8_t *)env->stack_head / op2; break;
-				case 2: *(int16_t*)(env->stack_head + op.x_op2_size) = *(int16_t*)env->stack_head / op2; break;
-				case 4: *(int32_t*)(env->stack_head + op.x_op2_size) = *(int32_t*)env->stack_head / op2; break;
-				case 8: *(int64_t*)(env->stack_head + op.x_op2_size) = *(int64_t*)env->stack_head / op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_DIVSI:
-			switch (op.x_op1_size) {
-				case 1: *(int8_t *)env->stack_head /= op.operand_s; break;
-				case 2: *(int16_t*)env->stack_head /= op.operand_s; break;
-				case 4: *(int32_t*)env->stack_head /= op.operand_s; break;
-				case 8: *(int64_t*)env->stack_head /= op.operand_s; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_DIVSIAT8: {
 			register int8_t* temp = *(int8_t**)env->stack_head;
 			*(int8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp /= op.operand_s);
@@ -538,34 +849,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_MOD: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head % op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head % op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head % op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head % op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_MODI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head %= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head %= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head %= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head %= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_MODIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp %= op.operand_u);
@@ -596,34 +879,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_MODS: {
-			int64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(int8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(int16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(int32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(int64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(int8_t *)(env->stack_head + op.x_op2_size) = *(int8_t *)env->stack_head % op2; break;
-				case 2: *(int16_t*)(env->stack_head + op.x_op2_size) = *(int16_t*)env->stack_head % op2; break;
-				case 4: *(int32_t*)(env->stack_head + op.x_op2_size) = *(int32_t*)env->stack_head % op2; break;
-				case 8: *(int64_t*)(env->stack_head + op.x_op2_size) = *(int64_t*)env->stack_head % op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_MODSI:
-			switch (op.x_op1_size) {
-				case 1: *(int8_t *)env->stack_head %= op.operand_s; break;
-				case 2: *(int16_t*)env->stack_head %= op.operand_s; break;
-				case 4: *(int32_t*)env->stack_head %= op.operand_s; break;
-				case 8: *(int64_t*)env->stack_head %= op.operand_s; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_MODSIAT8: {
 			register int8_t* temp = *(int8_t**)env->stack_head;
 			*(int8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp %= op.operand_s);
@@ -654,34 +909,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_AND: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head & op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head & op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head & op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head & op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_ANDI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head &= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head &= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head &= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head &= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_ANDIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp &= op.operand_u);
@@ -712,34 +939,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_OR: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head | op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head | op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head | op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head | op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_ORI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head |= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head |= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head |= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head |= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_ORIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp |= op.operand_u);
@@ -770,34 +969,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_XOR: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head ^ op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head ^ op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head ^ op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head ^ op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_XORI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head ^= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head ^= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head ^= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head ^= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_XORIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp ^= op.operand_u);
@@ -828,34 +999,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_SHL: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head << op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head << op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head << op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head << op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_SHLI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head <<= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head <<= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head <<= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head <<= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_SHLIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp <<= op.operand_u);
@@ -886,34 +1029,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_SHR: {
-			uint64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(uint8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(uint16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(uint32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(uint64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)(env->stack_head + op.x_op2_size) = *(uint8_t *)env->stack_head >> op2; break;
-				case 2: *(uint16_t*)(env->stack_head + op.x_op2_size) = *(uint16_t*)env->stack_head >> op2; break;
-				case 4: *(uint32_t*)(env->stack_head + op.x_op2_size) = *(uint32_t*)env->stack_head >> op2; break;
-				case 8: *(uint64_t*)(env->stack_head + op.x_op2_size) = *(uint64_t*)env->stack_head >> op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_SHRI:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t *)env->stack_head >>= op.operand_u; break;
-				case 2: *(uint16_t*)env->stack_head >>= op.operand_u; break;
-				case 4: *(uint32_t*)env->stack_head >>= op.operand_u; break;
-				case 8: *(uint64_t*)env->stack_head >>= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_SHRIAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp >>= op.operand_u);
@@ -944,34 +1059,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_SHRS: {
-			int64_t op2;
-			switch (op.x_op2_size) {
-				case 1:  op2 = *(int8_t *)(env->stack_head + op.x_op1_size); break;
-				case 2:  op2 = *(int16_t*)(env->stack_head + op.x_op1_size); break;
-				case 4:  op2 = *(int32_t*)(env->stack_head + op.x_op1_size); break;
-				case 8:  op2 = *(int64_t*)(env->stack_head + op.x_op1_size); break;
-				default: assert(false, "unknown argument size");
-			}
-			switch (op.x_op1_size) {
-				case 1: *(int8_t *)(env->stack_head + op.x_op2_size) = *(int8_t *)env->stack_head >> op2; break;
-				case 2: *(int16_t*)(env->stack_head + op.x_op2_size) = *(int16_t*)env->stack_head >> op2; break;
-				case 4: *(int32_t*)(env->stack_head + op.x_op2_size) = *(int32_t*)env->stack_head >> op2; break;
-				case 8: *(int64_t*)(env->stack_head + op.x_op2_size) = *(int64_t*)env->stack_head >> op2; break;
-			}
-			env->stack_head += op.x_op2_size;
-			++env->exec_index;
-			return false;
-		}
-		case BR_OP_SHRSI:
-			switch (op.x_op1_size) {
-				case 1: *(int8_t *)env->stack_head >>= op.operand_u; break;
-				case 2: *(int16_t*)env->stack_head >>= op.operand_u; break;
-				case 4: *(int32_t*)env->stack_head >>= op.operand_u; break;
-				case 8: *(int64_t*)env->stack_head >>= op.operand_u; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_SHRSIAT8: {
 			register int8_t* temp = *(int8_t**)env->stack_head;
 			*(int8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp >>= op.operand_u);
@@ -1002,15 +1089,6 @@ bool BR_execOp(BR_ExecEnv* env)
 			++env->exec_index;
 			return false;
 		}
-		case BR_OP_NOT:
-			switch (op.x_op1_size) {
-				case 1: *(uint8_t*)env->stack_head = ~*(uint8_t*)env->stack_head; break;
-				case 2: *(uint16_t*)env->stack_head = ~*(uint16_t*)env->stack_head; break;
-				case 4: *(uint32_t*)env->stack_head = ~*(uint32_t*)env->stack_head; break;
-				case 8: *(uint64_t*)env->stack_head = ~*(uint64_t*)env->stack_head; break;
-			}
-			++env->exec_index;
-			return false;
 		case BR_OP_NOTAT8: {
 			register uint8_t* temp = *(uint8_t**)env->stack_head;
 			*(uint8_t*)(env->stack_head += sizeof(void*) - 1) = (*temp = ~*temp);
@@ -1042,7 +1120,7 @@ bool BR_execOp(BR_ExecEnv* env)
 			return false;
 		}
 		case BR_OP_DROP:
-			env->stack_head += op.x_op1_size;
+			env->stack_head += op.operand_u;
 			++env->exec_index;
 			return false;
 		case BR_OP_NEW:
@@ -1059,10 +1137,13 @@ bool BR_execOp(BR_ExecEnv* env)
 			memcpy(env->stack_head, env->stack_head + op.operand_u, op.x_op1_size);
 			++env->exec_index;
 			return false; 
-		case BR_OP_SETAT:
-			memcpy(*(void**)env->stack_head, env->stack_head += sizeof(void*), op.operand_u);
+		case BR_OP_SETAT: {
+			void* const dst = *(void**)env->stack_head;
+			env->stack_head += sizeof(void*);
+			memcpy(dst, env->stack_head, op.operand_u);
 			++env->exec_index;
 			return false;
+		}
 		case BR_OP_GETFROM:
 			ALLOC_STACK_SPACE(op.operand_u - sizeof(void*));
 			memcpy(env->stack_head, *(void**)(env->stack_head + op.operand_u - sizeof(void*)), op.operand_u);
@@ -1074,6 +1155,34 @@ bool BR_execOp(BR_ExecEnv* env)
 			env->stack_head += sizeof(void*);
 			++env->exec_index;
 			return false;
+// replaced with execution-only operations by `prepareOpForExec`
+		case BR_OP_ADD:
+		case BR_OP_ADDI:
+		case BR_OP_SUB:
+		case BR_OP_SUBI:
+		case BR_OP_MUL:
+		case BR_OP_MULI:
+		case BR_OP_DIV:
+		case BR_OP_DIVI:
+		case BR_OP_DIVS:
+		case BR_OP_DIVSI:
+		case BR_OP_MOD:
+		case BR_OP_MODI:
+		case BR_OP_MODS:
+		case BR_OP_MODSI:
+		case BR_OP_AND:
+		case BR_OP_ANDI:
+		case BR_OP_OR:
+		case BR_OP_ORI:
+		case BR_OP_XOR:
+		case BR_OP_XORI:
+		case BR_OP_SHL:
+		case BR_OP_SHLI:
+		case BR_OP_SHR:
+		case BR_OP_SHRI:
+		case BR_OP_SHRS:
+		case BR_OP_SHRSI:
+		case BR_OP_NOT:
 		case BR_N_OPS:
 		default:
 			env->exec_status.type = BR_EXC_UNKNOWN_OP;
@@ -1081,99 +1190,1851 @@ bool BR_execOp(BR_ExecEnv* env)
 	}
 }
 
-static sbuf allocDataBlock(BR_ModuleBuilder* builder, BR_id db_id)
+#ifdef BR_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wgnu-label-as-value"
+#endif
+// same as calling `BR_execOp` until it returns `true`, but every handler jumps straight to the handler of the next operation,
+// and the stack head and the instruction pointer are kept in local variables instead of `env`
+static void execThreaded(BR_ExecEnv* env, BR_OpArray body, const volatile bool* interruptor)
 {
-	return sbuf_alloc(BR_getMaxStackRTSize(builder, db_id));
+#define BINARY_XOP_ENTRY(id1, bits1, id2, bits2, base, name, int_t, OP) [base + id1 * 4 + id2] = &&xop_##name##_##bits1##_##bits2,
+#define BINARY_XOP_ENTRIES(base, name, int_t, OP) XOP_SIZE_PAIRS(BINARY_XOP_ENTRY, base, name, int_t, OP)
+#define IMM_XOP_ENTRY(id, bits, base, name, int_t, OP, operand) [base + id] = &&xop_##name##_##bits,
+#define IMM_XOP_ENTRIES(base, name, int_t, OP, operand) XOP_SIZES(IMM_XOP_ENTRY, base, name, int_t, OP, operand)
+#define NOT_XOP_ENTRY(id, bits, _) [BR_XOP_NOT + id] = &&xop_not_##bits,
+#define FUSED_XOP_ENTRY(name, ...) [BR_XOP_FUSED_##name] = &&xop_fused_##name,
+#define CACHED_BINARY_XOP_ENTRY(id1, bits1, id2, bits2, base, name, int_t, OP) \
+	[XOP_CACHED(base + id1 * 4 + id2, BR_CACHED_IN)]     = &&xop_##name##_##bits1##_##bits2##_cm, \
+	[XOP_CACHED(base + id1 * 4 + id2, BR_CACHED_OUT)]    = &&xop_##name##_##bits1##_##bits2##_mc, \
+	[XOP_CACHED(base + id1 * 4 + id2, BR_CACHED_IN_OUT)] = &&xop_##name##_##bits1##_##bits2##_cc,
+#define CACHED_BINARY_XOP_ENTRIES(base, name, int_t, OP) XOP_SIZE_PAIRS(CACHED_BINARY_XOP_ENTRY, base, name, int_t, OP)
+#define CACHED_IMM_XOP_ENTRY(id, bits, base, name, int_t, OP, operand) \
+	[XOP_CACHED(base + id, BR_CACHED_IN)]     = &&xop_##name##_##bits##_cm, \
+	[XOP_CACHED(base + id, BR_CACHED_OUT)]    = &&xop_##name##_##bits##_mc, \
+	[XOP_CACHED(base + id, BR_CACHED_IN_OUT)] = &&xop_##name##_##bits##_cc,
+#define CACHED_IMM_XOP_ENTRIES(base, name, int_t, OP, operand) XOP_SIZES(CACHED_IMM_XOP_ENTRY, base, name, int_t, OP, operand)
+#define CACHED_NOT_XOP_ENTRY(id, bits, _) \
+	[XOP_CACHED(BR_XOP_NOT + id, BR_CACHED_IN)]     = &&xop_not_##bits##_cm, \
+	[XOP_CACHED(BR_XOP_NOT + id, BR_CACHED_OUT)]    = &&xop_not_##bits##_mc, \
+	[XOP_CACHED(BR_XOP_NOT + id, BR_CACHED_IN_OUT)] = &&xop_not_##bits##_cc,
+	static const void* const handlers[BR_N_XOPS] = {
+		[0 ... BR_N_XOPS - 1] = &&op_unknown,
+		[BR_OP_NOP]       = &&op_nop,
+		[BR_OP_END]       = &&op_end,
+		[BR_OP_I8]        = &&op_i8,
+		[BR_OP_I16]       = &&op_i16,
+		[BR_OP_I32]       = &&op_i32,
+		[BR_OP_PTR]       = &&op_ptr,
+		[BR_OP_I64]       = &&op_i64,
+		[BR_OP_ADDR]      = &&op_addr,
+		[BR_OP_DBADDR]    = &&op_dbaddr,
+		[BR_OP_SYS]       = &&op_sys,
+		[BR_OP_BUILTIN]   = &&op_ptr,
+		[BR_OP_ADDIAT8]   = &&op_addiat8,
+		[BR_OP_ADDIAT16]  = &&op_addiat16,
+		[BR_OP_ADDIAT32]  = &&op_addiat32,
+		[BR_OP_ADDIATP]   = &&op_addiatp,
+		[BR_OP_ADDIAT64]  = &&op_addiat64,
+		[BR_OP_SUBIAT8]   = &&op_subiat8,
+		[BR_OP_SUBIAT16]  = &&op_subiat16,
+		[BR_OP_SUBIAT32]  = &&op_subiat32,
+		[BR_OP_SUBIATP]   = &&op_subiatp,
+		[BR_OP_SUBIAT64]  = &&op_subiat64,
+		[BR_OP_MULIAT8]   = &&op_muliat8,
+		[BR_OP_MULIAT16]  = &&op_muliat16,
+		[BR_OP_MULIAT32]  = &&op_muliat32,
+		[BR_OP_MULIATP]   = &&op_muliatp,
+		[BR_OP_MULIAT64]  = &&op_muliat64,
+		[BR_OP_DIVIAT8]   = &&op_diviat8,
+		[BR_OP_DIVIAT16]  = &&op_diviat16,
+		[BR_OP_DIVIAT32]  = &&op_diviat32,
+		[BR_OP_DIVIATP]   = &&op_diviatp,
+		[BR_OP_DIVIAT64]  = &&op_diviat64,
+		[BR_OP_DIVSIAT8]  = &&op_divsiat8,
+		[BR_OP_DIVSIAT16] = &&op_divsiat16,
+		[BR_OP_DIVSIAT32] = &&op_divsiat32,
+		[BR_OP_DIVSIATP]  = &&op_divsiatp,
+		[BR_OP_DIVSIAT64] = &&op_divsiat64,
+		[BR_OP_MODIAT8]   = &&op_modiat8,
+		[BR_OP_MODIAT16]  = &&op_modiat16,
+		[BR_OP_MODIAT32]  = &&op_modiat32,
+		[BR_OP_MODIATP]   = &&op_modiatp,
+		[BR_OP_MODIAT64]  = &&op_modiat64,
+		[BR_OP_MODSIAT8]  = &&op_modsiat8,
+		[BR_OP_MODSIAT16] = &&op_modsiat16,
+		[BR_OP_MODSIAT32] = &&op_modsiat32,
+		[BR_OP_MODSIATP]  = &&op_modsiatp,
+		[BR_OP_MODSIAT64] = &&op_modsiat64,
+		[BR_OP_ANDIAT8]   = &&op_andiat8,
+		[BR_OP_ANDIAT16]  = &&op_andiat16,
+		[BR_OP_ANDIAT32]  = &&op_andiat32,
+		[BR_OP_ANDIATP]   = &&op_andiatp,
+		[BR_OP_ANDIAT64]  = &&op_andiat64,
+		[BR_OP_ORIAT8]    = &&op_oriat8,
+		[BR_OP_ORIAT16]   = &&op_oriat16,
+		[BR_OP_ORIAT32]   = &&op_oriat32,
+		[BR_OP_ORIATP]    = &&op_oriatp,
+		[BR_OP_ORIAT64]   = &&op_oriat64,
+		[BR_OP_XORIAT8]   = &&op_xoriat8,
+		[BR_OP_XORIAT16]  = &&op_xoriat16,
+		[BR_OP_XORIAT32]  = &&op_xoriat32,
+		[BR_OP_XORIATP]   = &&op_xoriatp,
+		[BR_OP_XORIAT64]  = &&op_xoriat64,
+		[BR_OP_SHLIAT8]   = &&op_shliat8,
+		[BR_OP_SHLIAT16]  = &&op_shliat16,
+		[BR_OP_SHLIAT32]  = &&op_shliat32,
+		[BR_OP_SHLIATP]   = &&op_shliatp,
+		[BR_OP_SHLIAT64]  = &&op_shliat64,
+		[BR_OP_SHRIAT8]   = &&op_shriat8,
+		[BR_OP_SHRIAT16]  = &&op_shriat16,
+		[BR_OP_SHRIAT32]  = &&op_shriat32,
+		[BR_OP_SHRIATP]   = &&op_shriatp,
+		[BR_OP_SHRIAT64]  = &&op_shriat64,
+		[BR_OP_SHRSIAT8]  = &&op_shrsiat8,
+		[BR_OP_SHRSIAT16] = &&op_shrsiat16,
+		[BR_OP_SHRSIAT32] = &&op_shrsiat32,
+		[BR_OP_SHRSIATP]  = &&op_shrsiatp,
+		[BR_OP_SHRSIAT64] = &&op_shrsiat64,
+		[BR_OP_NOTAT8]    = &&op_notat8,
+		[BR_OP_NOTAT16]   = &&op_notat16,
+		[BR_OP_NOTAT32]   = &&op_notat32,
+		[BR_OP_NOTATP]    = &&op_notatp,
+		[BR_OP_NOTAT64]   = &&op_notat64,
+		[BR_OP_DROP]      = &&op_drop,
+		[BR_OP_NEW]       = &&op_new,
+		[BR_OP_ZERO]      = &&op_zero,
+		[BR_OP_GET]       = &&op_get,
+		[BR_OP_SETAT]     = &&op_setat,
+		[BR_OP_GETFROM]   = &&op_getfrom,
+		[BR_OP_COPY]      = &&op_copy,
+		XOP_BINARY_KINDS(BINARY_XOP_ENTRIES)
+		XOP_IMM_KINDS(IMM_XOP_ENTRIES)
+		XOP_SIZES(NOT_XOP_ENTRY, _)
+		XOP_FUSIONS(FUSED_XOP_ENTRY, FUSED_XOP_ENTRY)
+		XOP_BINARY_KINDS(CACHED_BINARY_XOP_ENTRIES)
+		XOP_IMM_KINDS(CACHED_IMM_XOP_ENTRIES)
+		XOP_SIZES(CACHED_NOT_XOP_ENTRY, _)
+		[BR_XOP_I8_C]     = &&op_i8_c,
+		[BR_XOP_I16_C]    = &&op_i16_c,
+		[BR_XOP_I32_C]    = &&op_i32_c,
+		[BR_XOP_PTR_C]    = &&op_ptr_c,
+		[BR_XOP_I64_C]    = &&op_i64_c,
+		[BR_XOP_ADDR_C]   = &&op_addr_c,
+		[BR_XOP_DBADDR_C] = &&op_dbaddr_c,
+		[BR_XOP_DROP_C]   = &&op_drop_c
+	};
+	static_assert(BR_N_OPS == 115, "not all operations have their threaded handlers defined");
+#undef CACHED_NOT_XOP_ENTRY
+#undef CACHED_IMM_XOP_ENTRIES
+#undef CACHED_IMM_XOP_ENTRY
+#undef CACHED_BINARY_XOP_ENTRIES
+#undef CACHED_BINARY_XOP_ENTRY
+#undef FUSED_XOP_ENTRY
+#undef NOT_XOP_ENTRY
+#undef IMM_XOP_ENTRIES
+#undef IMM_XOP_ENTRY
+#undef BINARY_XOP_ENTRIES
+#undef BINARY_XOP_ENTRY
+
+	register const BR_Op* ip = body.data + env->exec_index;
+	register char* head = env->stack_head;
+// the cached top stack item; the memory it occupies on the stack is reserved, but its contents are stale
+	register uint64_t tos = 0;
+// dispatches left until the interruptor is polled; see `BR_INTERRUPT_POLL_INTERVAL`
+	register uint32_t poll_countdown = 1;
+// base address of the mutable data blocks of this run
+	const uintptr_t mut_data = (uintptr_t)env->mut_data.data;
+#define DISPATCH() \
+	if (!--poll_countdown) goto poll; \
+	goto *handlers[ip->type];
+#define NEXT() ++ip; DISPATCH()
+// the interruptor is not checked between the operation that has cached the top stack item and the one that consumes it,
+// so that the stack in `env` is always complete when the execution stops
+#define NEXT_CACHED() ++ip; goto *handlers[ip->type];
+#define ALLOC_STACK_SPACE_L(incr) head -= (incr);
+// bodies of the handlers; each of them leaves `ip` pointing at the operation it has executed
+#define OPB_NOP
+#define OPB_I8 \
+	ALLOC_STACK_SPACE_L(1); \
+	*(uint8_t*)head = ip->operand_u;
+#define OPB_I16 \
+	ALLOC_STACK_SPACE_L(2); \
+	*(uint16_t*)head = ip->operand_u;
+#define OPB_I32 \
+	ALLOC_STACK_SPACE_L(4); \
+	*(uint32_t*)head = ip->operand_u;
+#define OPB_PTR \
+	ALLOC_STACK_SPACE_L(sizeof(intptr_t)); \
+	*(uintptr_t*)head = ip->operand_u;
+#define OPB_DBADDR \
+	ALLOC_STACK_SPACE_L(sizeof(intptr_t)); \
+	*(uintptr_t*)head = (ip->x_op2_size ? mut_data : 0) + ip->operand_u;
+#define OPB_BUILTIN OPB_PTR
+#define OPB_I64 \
+	ALLOC_STACK_SPACE_L(8); \
+	*(uint64_t*)head = ip->operand_u;
+#define OPB_ADDR \
+	ALLOC_STACK_SPACE_L(sizeof(void*)); \
+	*(void**)head = head + ip->operand_u;
+// syscalls operate on `env`, so the local state is synchronized with it before the call and reloaded after it
+#define OPB_SYS \
+	env->stack_head = head; \
+	env->exec_index = ip - body.data; \
+	if (BR_syscalls[ip->operand_u](env)) { \
+		head = env->stack_head; \
+		ip = body.data + env->exec_index; \
+		goto exit; \
+	} \
+	head = env->stack_head; \
+	ip = body.data + env->exec_index - 1; \
+	poll_countdown = 1;
+#define OPB_DROP \
+	head += ip->operand_u;
+#define OPB_NEW \
+	ALLOC_STACK_SPACE_L(ip->operand_u);
+#define OPB_ZERO \
+	ALLOC_STACK_SPACE_L(ip->operand_u); \
+	memset(head, 0, ip->operand_u);
+#define OPB_GET \
+	ALLOC_STACK_SPACE_L(ip->x_op1_size); \
+	memcpy(head, head + ip->operand_u, ip->x_op1_size);
+#define OPB_SETAT { \
+	void* const dst = *(void**)head; \
+	head += sizeof(void*); \
+	memcpy(dst, head, ip->operand_u); \
+}
+#define OPB_GETFROM \
+	ALLOC_STACK_SPACE_L(ip->operand_u - sizeof(void*)); \
+	memcpy(head, *(void**)(head + ip->operand_u - sizeof(void*)), ip->operand_u);
+#define OPB_COPY \
+	memcpy(*(void**)head, *(void**)(head + sizeof(void*)), ip->operand_u); \
+	*(void**)(head + sizeof(void*)) = *(void**)head; \
+	head += sizeof(void*);
+#define IAT_BODY(T, OP, operand) { \
+	register T* temp = *(T**)head; \
+	*(T*)(head += sizeof(void*) - sizeof(T)) = (*temp OP ip->operand); \
+}
+#define NOTAT_BODY(T) { \
+	register T* temp = *(T**)head; \
+	*(T*)(head += sizeof(void*) - sizeof(T)) = (*temp = ~*temp); \
+}
+// the handlers themselves
+#define BINARY_XOP(id1, bits1, id2, bits2, base, name, int_t, OP) \
+	xop_##name##_##bits1##_##bits2: \
+		XOP_BINARY_BODY(head, int_t, OP, bits1, bits2) \
+		NEXT();
+#define BINARY_XOPS(base, name, int_t, OP) XOP_SIZE_PAIRS(BINARY_XOP, base, name, int_t, OP)
+#define IMM_XOP(id, bits, base, name, int_t, OP, operand) \
+	xop_##name##_##bits: \
+		XOP_IMM_BODY(head, int_t, OP, ip->operand, bits) \
+		NEXT();
+#define IMM_XOPS(base, name, int_t, OP, operand) XOP_SIZES(IMM_XOP, base, name, int_t, OP, operand)
+#define NOT_XOP(id, bits, _) \
+	xop_not_##bits: \
+		XOP_NOT_BODY(head, bits) \
+		NEXT();
+#define IAT_OP(label, T, OP, operand) \
+	label: \
+		IAT_BODY(T, OP, operand) \
+		NEXT();
+#define IAT_OPS(prefix, int_t, OP, operand) \
+	IAT_OP(prefix##at8,  int_t##8_t,  OP, operand) \
+	IAT_OP(prefix##at16, int_t##16_t, OP, operand) \
+	IAT_OP(prefix##at32, int_t##32_t, OP, operand) \
+	IAT_OP(prefix##atp,  int_t##ptr_t, OP, operand) \
+	IAT_OP(prefix##at64, int_t##64_t, OP, operand)
+#define NOTAT_OP(label, T) \
+	label: \
+		NOTAT_BODY(T) \
+		NEXT();
+// superinstructions, see `XOP_FUSIONS`; moving on to the next component is just an increment of `ip`
+#define C_OP(name) OPB_##name
+#define C_IAT(name, T, OP, operand) IAT_BODY(T, OP, operand)
+#define C_NOTAT(name, T) NOTAT_BODY(T)
+#define C_BIN(base, int_t, OP, bits1, bits2) XOP_BINARY_BODY(head, int_t, OP, bits1, bits2)
+#define C_IMM(base, int_t, OP, operand, bits) XOP_IMM_BODY(head, int_t, OP, ip->operand, bits)
+#define C_NOT(bits) XOP_NOT_BODY(head, bits)
+#define FUSED_XOP2(name, c1, c2) \
+	xop_fused_##name: \
+		c1 ++ip; \
+		c2 NEXT();
+#define FUSED_XOP3(name, c1, c2, c3) \
+	xop_fused_##name: \
+		c1 ++ip; \
+		c2 ++ip; \
+		c3 NEXT();
+// top-of-stack caching, see `cacheTopItem`; results are truncated to their type before being cached, exactly as stores to the stack do
+#define CACHED_BINARY_XOP(id1, bits1, id2, bits2, base, name, int_t, OP) \
+	xop_##name##_##bits1##_##bits2##_cm: \
+		*(int_t##bits1##_t*)(head + bits2 / 8) = (int_t##bits1##_t)tos OP (int_t##64_t)*(int_t##bits2##_t*)(head + bits1 / 8); \
+		head += bits2 / 8; \
+		NEXT(); \
+	xop_##name##_##bits1##_##bits2##_mc: \
+		tos = (int_t##bits1##_t)(*(int_t##bits1##_t*)head OP (int_t##64_t)*(int_t##bits2##_t*)(head + bits1 / 8)); \
+		head += bits2 / 8; \
+		NEXT_CACHED(); \
+	xop_##name##_##bits1##_##bits2##_cc: \
+		tos = (int_t##bits1##_t)((int_t##bits1##_t)tos OP (int_t##64_t)*(int_t##bits2##_t*)(head + bits1 / 8)); \
+		head += bits2 / 8; \
+		NEXT_CACHED();
+#define CACHED_BINARY_XOPS(base, name, int_t, OP) XOP_SIZE_PAIRS(CACHED_BINARY_XOP, base, name, int_t, OP)
+#define CACHED_IMM_XOP(id, bits, base, name, int_t, OP, operand) \
+	xop_##name##_##bits##_cm: { \
+		int_t##bits##_t item = tos; \
+		item OP ip->operand; \
+		*(int_t##bits##_t*)head = item; \
+		NEXT(); \
+	} \
+	xop_##name##_##bits##_mc: { \
+		int_t##bits##_t item = *(int_t##bits##_t*)head; \
+		item OP ip->operand; \
+		tos = item; \
+		NEXT_CACHED(); \
+	} \
+	xop_##name##_##bits##_cc: { \
+		int_t##bits##_t item = tos; \
+		item OP ip->operand; \
+		tos = item; \
+		NEXT_CACHED(); \
+	}
+#define CACHED_IMM_XOPS(base, name, int_t, OP, operand) XOP_SIZES(CACHED_IMM_XOP, base, name, int_t, OP, operand)
+#define CACHED_NOT_XOP(id, bits, _) \
+	xop_not_##bits##_cm: \
+		*(uint##bits##_t*)head = ~(uint##bits##_t)tos; \
+		NEXT(); \
+	xop_not_##bits##_mc: \
+		tos = (uint##bits##_t)~*(uint##bits##_t*)head; \
+		NEXT_CACHED(); \
+	xop_not_##bits##_cc: \
+		tos = (uint##bits##_t)~(uint##bits##_t)tos; \
+		NEXT_CACHED();
+
+	DISPATCH();
+
+	op_nop:
+		NEXT();
+	op_end:
+		env->exec_status.type = BR_EXC_END;
+		goto exit;
+	op_i8:
+		OPB_I8
+		NEXT();
+	op_i16:
+		OPB_I16
+		NEXT();
+	op_i32:
+		OPB_I32
+		NEXT();
+	op_ptr:
+		OPB_PTR
+		NEXT();
+	op_dbaddr:
+		OPB_DBADDR
+		NEXT();
+	op_i64:
+		OPB_I64
+		NEXT();
+	op_addr:
+		OPB_ADDR
+		NEXT();
+	op_sys:
+		OPB_SYS
+		NEXT();
+	IAT_OPS(op_addi, uint, +=, operand_u)
+	IAT_OPS(op_subi, uint, -=, operand_u)
+	IAT_OPS(op_muli, uint, *=, operand_u)
+	IAT_OPS(op_divi, uint, /=, operand_u)
+	IAT_OPS(op_divsi, int, /=, operand_s)
+	IAT_OPS(op_modi, uint, %=, operand_u)
+	IAT_OPS(op_modsi, int, %=, operand_s)
+	IAT_OPS(op_andi, uint, &=, operand_u)
+	IAT_OPS(op_ori, uint, |=, operand_u)
+	IAT_OPS(op_xori, uint, ^=, operand_u)
+	IAT_OPS(op_shli, uint, <<=, operand_u)
+	IAT_OPS(op_shri, uint, >>=, operand_u)
+	IAT_OPS(op_shrsi, int, >>=, operand_u)
+	NOTAT_OP(op_notat8,  uint8_t)
+	NOTAT_OP(op_notat16, uint16_t)
+	NOTAT_OP(op_notat32, uint32_t)
+	NOTAT_OP(op_notatp,  uintptr_t)
+	NOTAT_OP(op_notat64, uint64_t)
+	XOP_BINARY_KINDS(BINARY_XOPS)
+	XOP_IMM_KINDS(IMM_XOPS)
+	XOP_SIZES(NOT_XOP, _)
+	XOP_FUSIONS(FUSED_XOP2, FUSED_XOP3)
+	XOP_BINARY_KINDS(CACHED_BINARY_XOPS)
+	XOP_IMM_KINDS(CACHED_IMM_XOPS)
+	XOP_SIZES(CACHED_NOT_XOP, _)
+	op_i8_c:
+		ALLOC_STACK_SPACE_L(1);
+		tos = ip->operand_u;
+		NEXT_CACHED();
+	op_i16_c:
+		ALLOC_STACK_SPACE_L(2);
+		tos = ip->operand_u;
+		NEXT_CACHED();
+	op_i32_c:
+		ALLOC_STACK_SPACE_L(4);
+		tos = ip->operand_u;
+		NEXT_CACHED();
+	op_ptr_c:
+		ALLOC_STACK_SPACE_L(sizeof(intptr_t));
+		tos = ip->operand_u;
+		NEXT_CACHED();
+	op_i64_c:
+		ALLOC_STACK_SPACE_L(8);
+		tos = ip->operand_u;
+		NEXT_CACHED();
+	op_addr_c:
+		ALLOC_STACK_SPACE_L(sizeof(void*));
+		tos = (uintptr_t)(head + ip->operand_u);
+		NEXT_CACHED();
+	op_dbaddr_c:
+		ALLOC_STACK_SPACE_L(sizeof(intptr_t));
+		tos = (ip->x_op2_size ? mut_data : 0) + ip->operand_u;
+		NEXT_CACHED();
+	op_drop_c:
+		head += ip->operand_u;
+		NEXT();
+	op_drop:
+		OPB_DROP
+		NEXT();
+	op_new:
+		OPB_NEW
+		NEXT();
+	op_zero:
+		OPB_ZERO
+		NEXT();
+	op_get:
+		OPB_GET
+		NEXT();
+	op_setat:
+		OPB_SETAT
+		NEXT();
+	op_getfrom:
+		OPB_GETFROM
+		NEXT();
+	op_copy:
+		OPB_COPY
+		NEXT();
+	op_unknown:
+		env->exec_status.type = BR_EXC_UNKNOWN_OP;
+		goto exit;
+	poll:
+		if (*interruptor) goto interrupt;
+		poll_countdown = BR_INTERRUPT_POLL_INTERVAL;
+		goto *handlers[ip->type];
+	interrupt:
+		env->exec_status.type = BR_EXC_INTERRUPT;
+	exit:
+		env->stack_head = head;
+		env->exec_index = ip - body.data;
+		return;
+#undef CACHED_NOT_XOP
+#undef CACHED_IMM_XOPS
+#undef CACHED_IMM_XOP
+#undef CACHED_BINARY_XOPS
+#undef CACHED_BINARY_XOP
+#undef FUSED_XOP3
+#undef FUSED_XOP2
+#undef C_NOT
+#undef C_IMM
+#undef C_BIN
+#undef C_NOTAT
+#undef C_IAT
+#undef C_OP
+#undef NOTAT_OP
+#undef IAT_OPS
+#undef IAT_OP
+#undef NOT_XOP
+#undef IMM_XOPS
+#undef IMM_XOP
+#undef BINARY_XOPS
+#undef BINARY_XOP
+#undef NOTAT_BODY
+#undef IAT_BODY
+#undef OPB_COPY
+#undef OPB_GETFROM
+#undef OPB_SETAT
+#undef OPB_GET
+#undef OPB_ZERO
+#undef OPB_NEW
+#undef OPB_DROP
+#undef OPB_SYS
+#undef OPB_ADDR
+#undef OPB_I64
+#undef OPB_BUILTIN
+#undef OPB_DBADDR
+#undef OPB_PTR
+#undef OPB_I32
+#undef OPB_I16
+#undef OPB_I8
+#undef OPB_NOP
+#undef ALLOC_STACK_SPACE_L
+#undef NEXT_CACHED
+#undef NEXT
+#undef DISPATCH
 }
+#pragma GCC diagnostic pop
+#endif // BR_THREADED_DISPATCH
 
-BR_Error BR_execModule(BR_Module module, BR_ExecEnv* env, char* args[], size_t stack_size, const volatile bool* interruptor)
+// executes `body` of either a procedure or a data block, starting from the operation at `env->exec_index`, until the execution is stopped
+static void execProc(BR_ExecEnv* env, BR_OpArray body, const volatile bool* interruptor, uint32_t flags)
 {
-	BR_ExecEnv env_l;
-	if (!env) env = &env_l;
-	*env = (BR_ExecEnv){0};
-// validating the entry point
-	if (module.exec_entry_point >= module.seg_exec.length)
-		return (BR_Error){.type = BR_ERR_INVALID_ENTRY};
-	const BR_Proc* const proc = &module.seg_exec.data[module.exec_entry_point];
-	if (proc->ret_type.kind != BR_TYPE_VOID || proc->args.length)
-		return (BR_Error){.type = BR_ERR_INVALID_ENTRY_PROTOTYPE};
-// setting the arguments
-	env->exec_argc = 0;
-	if (*args) while (args[++env->exec_argc]);
-	env->exec_argv = malloc(env->exec_argc * sizeof(sbuf));
-	for (uint32_t i = 0; i < env->exec_argc; i += 1) {
-		env->exec_argv[i] = sbuf_fromstr((char*)args[i]);
-		env->exec_argv[i].length += 1;
-	}
-// setting a default interruptor if the `interruptor` is NULL
-	bool stub_interruptor = false;
-	if (!interruptor) interruptor = &stub_interruptor;
-// pre-allocating the data blocks array
-	if (!sbufArray_incrlen(&env->seg_data, module.seg_data.length) && module.seg_data.length)
-		return (BR_Error){.type = BR_ERR_NO_MEMORY};
-// initializing the module analyzer
-	BR_ModuleBuilder builder;
-	BR_Error err;
-	if ((err = BR_analyzeModule(&module, &builder)).type) return err;
-// allocating the data blocks
-	arrayForeach (BR_DataBlock, block, builder.module.seg_data) {
-		if (!(env->seg_data.data[block - builder.module.seg_data.data] = allocDataBlock(&builder, ~(block - builder.module.seg_data.data))).data)
-			return (BR_Error){.type = BR_ERR_NO_MEMORY};
-	}
-// pre-evaluating the data blocks
-	arrayForeach (BR_DataBlock, block, builder.module.seg_data) {
-		for (uint32_t op_id = 0; op_id < block->body.length; ++op_id) {
-			prepareOpForExec(&builder, env->seg_data, ~(block - builder.module.seg_data.data), op_id);
-		}
-		if ((err = BR_addOp(&builder, ~(block - builder.module.seg_data.data), (BR_Op){.type = BR_OP_END})).type)
-			return err;
-		env->cur_proc = block->body.data;
-		env->exec_index = 0;
-		env->stack = env->seg_data.data[block - builder.module.seg_data.data];
-		env->stack_head = env->stack.data + env->stack.length;
-		while (true) {
-			if (*interruptor)
-				return (BR_Error){.type = BR_ERR_MODULE_LOAD_INTERRUPT};
-			if (BR_execOp(env)) break;
-		}
-	}
-// TODO: add recursive pre-evaluation of data blocks when one block is referencing another; this probably has to be done after `call`s and `ret`urns are added
-// allocating the stack
-	if (!(env->stack = sbuf_alloc(stack_size)).data)
-		return (BR_Error){.type = BR_ERR_NO_MEMORY};
-	env->stack_head = env->stack.data + env->stack.length;
-// pre-evaluating operands of the operations for faster execution
-	arrayForeach (BR_Proc, proc, builder.module.seg_exec) {
-		for (uint32_t op_id = 0; op_id < proc->body.length; ++op_id) {
-			prepareOpForExec(&builder, env->seg_data, proc - builder.module.seg_exec.data, op_id);
-		}
+	env->cur_proc = body.data;
+#ifdef BR_THREADED_DISPATCH
+	if (flags & BR_EXEC_THREADED) {
+		execThreaded(env, body, interruptor);
+		return;
 	}
-// setting up the entry point
-	BR_addOp(&builder, module.exec_entry_point, (BR_Op){.type = BR_OP_END});
-	env->entry_point = module.exec_entry_point;
-	env->exec_index = 0;
-	BR_setEntryPoint(&builder, module.exec_entry_point);
-// cleaning up the analyzer
-	if ((err = BR_extractModule(builder, &module)).type) return err;
-	BR_deallocDataBlocks(&module);
-	env->seg_exec = module.seg_exec;
-	env->cur_proc = env->seg_exec.data[env->entry_point].body.data;
-// main execution loop
+#endif
 	while (true) {
 		if (*interruptor) {
 			env->exec_status.type = BR_EXC_INTERRUPT;
 			break;
 		}
-		if (BR_execOp(env)) break;
+		for (uint32_t i = 0; i < BR_INTERRUPT_POLL_INTERVAL; ++i) {
+			if (BR_execOp(env)) return;
+		}
 	}
-// cleanup
-	env->exec_argv = NULL;
-	free(env->exec_argv);
-	env->exec_argc = 0;
-	if (env == &env_l) BR_delExecEnv(env);
-	return (BR_Error){0};
+}
+
+#ifdef BR_JIT
+// baseline JIT: a procedure is translated into x86-64 machine code operation by operation, following the System V ABI.
+// While BRB has no jumps, the depth of the stack before every operation is known statically, so the machine code never moves
+// the stack head: every stack item is addressed at a constant displacement from the head at the entry.
+defArray(uint8_t);
+
+typedef struct {
+	uint8_tArray code;
+	bool failed; // set if the buffer could not be grown
+} BR_MachineCode;
+
+typedef void (*BR_JITFunc)(BR_ExecEnv* env, const volatile bool* interruptor);
+
+struct BR_JITProc {
+	atomic_uint n_runs; // number of runs of the procedure started while it wasn't compiled, saturated slightly above the threshold
+	_Atomic(void*) code; // a `BR_JITFunc`; NULL until the procedure is compiled
+	size_t code_size;
+};
+
+// general-purpose registers, numbered as in the encoding
+#define JIT_RAX 0
+#define JIT_RCX 1
+#define JIT_RDX 2
+#define JIT_RSI 6
+#define JIT_RDI 7
+// registers that hold the state of a compiled procedure; all of them are callee-saved
+#define JIT_HEAD 3  // rbx: `BR_ExecEnv::stack_head` at the entry
+#define JIT_ENV  5  // rbp: the `BR_ExecEnv`
+#define JIT_MUT  13 // r13: `BR_ExecEnv::mut_data.data`
+#define JIT_INTR 14 // r14: the interruptor
+
+static_assert(sizeof(BR_ExecStatusType) == 4, "`BR_ExecStatus::type` is stored by the compiled code as a 32-bit integer");
+static_assert(sizeof(void*) == 8, "the compiled code assumes 64-bit pointers");
+
+static void emit(BR_MachineCode* mc, uint32_t n, const uint8_t* bytes)
+{
+	uint8_t* const dst = uint8_tArray_incrlen(&mc->code, n);
+	if (dst) {
+		memcpy(dst, bytes, n);
+	} else mc->failed = true;
+}
+#define EMIT(mc, ...) emit(mc, sizeof((uint8_t[]){__VA_ARGS__}), (uint8_t[]){__VA_ARGS__})
+
+static void emitImm32(BR_MachineCode* mc, uint32_t value)
+{
+	EMIT(mc, value, value >> 8, value >> 16, value >> 24);
+}
+
+// emits `<opcode> reg, [base + disp]`; `w` selects the 64-bit operand size, `prefix` is 0x66 for the 16-bit one or 0 otherwise;
+// `base` must not be rsp or r12, which need a SIB byte
+static void emitMem(BR_MachineCode* mc, uint8_t prefix, bool w, uint16_t opcode, uint8_t reg, uint8_t base, int32_t disp)
+{
+	if (prefix) EMIT(mc, prefix);
+	const uint8_t rex = 0x40 | w << 3 | (reg >> 3) << 2 | base >> 3;
+	if (rex != 0x40) EMIT(mc, rex);
+	if (opcode > 0xFF) EMIT(mc, opcode >> 8);
+	EMIT(mc, opcode, 0x80 | (reg & 7) << 3 | (base & 7));
+	emitImm32(mc, disp);
+}
+
+// emits `<opcode> rm, reg` with both operands in registers
+static void emitReg(BR_MachineCode* mc, bool w, uint16_t opcode, uint8_t reg, uint8_t rm)
+{
+	const uint8_t rex = 0x40 | w << 3 | (reg >> 3) << 2 | rm >> 3;
+	if (rex != 0x40) EMIT(mc, rex);
+	if (opcode > 0xFF) EMIT(mc, opcode >> 8);
+	EMIT(mc, opcode, 0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+static void emitMovImm(BR_MachineCode* mc, uint8_t reg, uint64_t value)
+{
+	if (value <= UINT32_MAX) {
+		if (reg >= 8) EMIT(mc, 0x41);
+		EMIT(mc, 0xB8 + (reg & 7));
+		emitImm32(mc, value);
+	} else if ((int64_t)value == (int32_t)value) {
+		EMIT(mc, 0x48 | reg >> 3, 0xC7, 0xC0 | (reg & 7));
+		emitImm32(mc, value);
+	} else {
+		EMIT(mc, 0x48 | reg >> 3, 0xB8 + (reg & 7));
+		emitImm32(mc, value);
+		emitImm32(mc, value >> 32);
+	}
+}
+
+// loads an integer of `size` bytes into `reg`, extending it to 64 bits
+static void emitLoad(BR_MachineCode* mc, uint8_t reg, uint8_t base, int32_t disp, uint8_t size, bool is_signed)
+{
+	switch (size) {
+		case 1:
+			emitMem(mc, 0, is_signed, is_signed ? 0x0FBE : 0x0FB6, reg, base, disp);
+			break;
+		case 2:
+			emitMem(mc, 0, is_signed, is_signed ? 0x0FBF : 0x0FB7, reg, base, disp);
+			break;
+		case 4:
+			emitMem(mc, 0, is_signed, is_signed ? 0x63 : 0x8B, reg, base, disp);
+			break;
+		default:
+			emitMem(mc, 0, true, 0x8B, reg, base, disp);
+	}
+}
+
+// stores the lowest `size` bytes of `reg`; `reg` must be one of rax, rcx or rdx if `size` is 1
+static void emitStore(BR_MachineCode* mc, uint8_t reg, uint8_t base, int32_t disp, uint8_t size)
+{
+	switch (size) {
+		case 1:
+			emitMem(mc, 0, false, 0x88, reg, base, disp);
+			break;
+		case 2:
+			emitMem(mc, 0x66, false, 0x89, reg, base, disp);
+			break;
+		case 4:
+			emitMem(mc, 0, false, 0x89, reg, base, disp);
+			break;
+		default:
+			emitMem(mc, 0, true, 0x89, reg, base, disp);
+	}
+}
+
+static void emitLea(BR_MachineCode* mc, uint8_t reg, uint8_t base, int32_t disp)
+{
+	emitMem(mc, 0, true, 0x8D, reg, base, disp);
+}
+
+static void emitCall(BR_MachineCode* mc, uintptr_t func)
+{
+	emitMovImm(mc, JIT_RAX, func);
+	EMIT(mc, 0xFF, 0xD0); // call rax
+}
+
+// the kinds of arithmetic operations, in the order of `XOP_BINARY_KINDS`, which is also the order of the `*-i@*` operations
+typedef enum {
+	JIT_ADD,
+	JIT_SUB,
+	JIT_MUL,
+	JIT_DIV,
+	JIT_DIVS,
+	JIT_MOD,
+	JIT_MODS,
+	JIT_AND,
+	JIT_OR,
+	JIT_XOR,
+	JIT_SHL,
+	JIT_SHR,
+	JIT_SHRS,
+	JIT_N_ARITH_KINDS
+} BR_JITArithKind;
+static_assert(BR_XOP_SHRS - BR_XOP_ADD == JIT_SHRS * 16, "arithmetic operation kinds are out of sync with the execution-only operations");
+
+static bool isArithKindSigned(BR_JITArithKind kind)
+{
+	return kind == JIT_DIVS || kind == JIT_MODS || kind == JIT_SHRS;
+}
+
+// rax = rax OP rcx, where rax holds an operand of `size` bytes extended to 64 bits, and rcx is the 64-bit second operand;
+// as in C, the operand of a shift is first promoted to `int` if it's narrower, and the rest of the operations are done in 64 bits
+static void emitArith(BR_MachineCode* mc, BR_JITArithKind kind, uint8_t size)
+{
+	switch (kind) {
+		case JIT_ADD:
+			emitReg(mc, true, 0x01, JIT_RCX, JIT_RAX);
+			break;
+		case JIT_SUB:
+			emitReg(mc, true, 0x29, JIT_RCX, JIT_RAX);
+			break;
+		case JIT_MUL:
+			emitReg(mc, true, 0x0FAF, JIT_RAX, JIT_RCX);
+			break;
+		case JIT_DIV:
+		case JIT_MOD:
+			emitReg(mc, false, 0x31, JIT_RDX, JIT_RDX); // xor edx, edx
+			emitReg(mc, true, 0xF7, 6, JIT_RCX); // div rcx
+			if (kind == JIT_MOD) emitReg(mc, true, 0x89, JIT_RDX, JIT_RAX);
+			break;
+		case JIT_DIVS:
+		case JIT_MODS:
+			EMIT(mc, 0x48, 0x99); // cqo
+			emitReg(mc, true, 0xF7, 7, JIT_RCX); // idiv rcx
+			if (kind == JIT_MODS) emitReg(mc, true, 0x89, JIT_RDX, JIT_RAX);
+			break;
+		case JIT_AND:
+			emitReg(mc, true, 0x21, JIT_RCX, JIT_RAX);
+			break;
+		case JIT_OR:
+			emitReg(mc, true, 0x09, JIT_RCX, JIT_RAX);
+			break;
+		case JIT_XOR:
+			emitReg(mc, true, 0x31, JIT_RCX, JIT_RAX);
+			break;
+		case JIT_SHL:
+			emitReg(mc, size == 8, 0xD3, 4, JIT_RAX);
+			break;
+		case JIT_SHR:
+			emitReg(mc, size == 8, 0xD3, 5, JIT_RAX);
+			break;
+		case JIT_SHRS:
+			emitReg(mc, size == 8, 0xD3, 7, JIT_RAX);
+			break;
+		case JIT_N_ARITH_KINDS:
+		default:
+			assert(false, "unknown arithmetic operation kind %u\n", kind);
+	}
+}
+
+// copies `size` bytes from `[src_base + src_disp]` to `[dst_base + dst_disp]`; small copies are done inline, the rest with `memcpy`
+static void emitCopy(BR_MachineCode* mc, uint8_t dst_base, int32_t dst_disp, uint8_t src_base, int32_t src_disp, uint64_t size)
+{
+	if (size > 64) {
+		emitLea(mc, JIT_RDI, dst_base, dst_disp);
+		emitLea(mc, JIT_RSI, src_base, src_disp);
+		emitMovImm(mc, JIT_RDX, size);
+		emitCall(mc, (uintptr_t)memcpy);
+		return;
+	}
+	for (uint8_t chunk = 8; chunk; chunk /= 2) {
+		for (; size >= chunk; size -= chunk, dst_disp += chunk, src_disp += chunk) {
+			emitLoad(mc, JIT_RAX, src_base, src_disp, chunk, false);
+			emitStore(mc, JIT_RAX, dst_base, dst_disp, chunk);
+		}
+	}
+}
+
+static void emitZero(BR_MachineCode* mc, int32_t disp, uint64_t size)
+{
+	if (size > 64) {
+		emitLea(mc, JIT_RDI, JIT_HEAD, disp);
+		emitReg(mc, false, 0x31, JIT_RSI, JIT_RSI); // xor esi, esi
+		emitMovImm(mc, JIT_RDX, size);
+		emitCall(mc, (uintptr_t)memset);
+		return;
+	}
+	emitReg(mc, false, 0x31, JIT_RAX, JIT_RAX); // xor eax, eax
+	for (uint8_t chunk = 8; chunk; chunk /= 2) {
+		for (; size >= chunk; size -= chunk, disp += chunk) {
+			emitStore(mc, JIT_RAX, JIT_HEAD, disp, chunk);
+		}
+	}
+}
+
+static void emitEpilogue(BR_MachineCode* mc)
+{
+	EMIT(mc,
+		0x48, 0x83, 0xC4, 0x08, // add rsp, 8
+		0x41, 0x5E,             // pop r14
+		0x41, 0x5D,             // pop r13
+		0x5D,                   // pop rbp
+		0x5B,                   // pop rbx
+		0xC3                    // ret
+	);
+}
+
+// leaves the state of the execution in `env` as the interpreter would, and returns from the compiled procedure
+static void emitExit(BR_MachineCode* mc, uint32_t op_id, int32_t depth, BR_ExecStatusType status)
+{
+	emitMem(mc, 0, false, 0xC7, 0, JIT_ENV, offsetof(BR_ExecEnv, exec_index));
+	emitImm32(mc, op_id);
+	emitLea(mc, JIT_RAX, JIT_HEAD, -depth);
+	emitStore(mc, JIT_RAX, JIT_ENV, offsetof(BR_ExecEnv, stack_head), sizeof(void*));
+	emitMem(mc, 0, false, 0xC7, 0, JIT_ENV, offsetof(BR_ExecEnv, exec_status.type));
+	emitImm32(mc, status);
+	emitEpilogue(mc);
+}
+
+// emits `j<cond> rel32` with the displacement to be filled in by `patchJump`; returns the position of the displacement
+static uint32_t emitJump(BR_MachineCode* mc, uint8_t cond)
+{
+	EMIT(mc, 0x0F, cond);
+	emitImm32(mc, 0);
+	return mc->code.length - 4;
+}
+
+// makes the jump emitted at `pos` go to the end of the code
+static void patchJump(BR_MachineCode* mc, uint32_t pos)
+{
+	if (mc->failed) return;
+	const uint32_t rel = mc->code.length - (pos + 4);
+	memcpy(mc->code.data + pos, &rel, 4);
+}
+
+// stops the execution before the operation `op_id` if the interruptor is set
+static void emitPoll(BR_MachineCode* mc, uint32_t op_id, int32_t depth)
+{
+	emitMem(mc, 0, false, 0x80, 7, JIT_INTR, 0); // cmp byte [r14], ...
+	EMIT(mc, 0);                                 // ... 0
+	const uint32_t skip = emitJump(mc, 0x84);    // je
+	emitExit(mc, op_id, depth, BR_EXC_INTERRUPT);
+	patchJump(mc, skip);
+}
+
+// returns the operation that `type` was made from by `fuseOps` or `cacheTopItem`, i.e. the one to be compiled in its place;
+// the operations after the first one in a superinstruction are left in place by `fuseOps`, and are compiled as they are
+static uint16_t getBaseOpType(uint16_t type)
+{
+	if (type >= BR_XOP_FUSED && type < BR_XOP_FUSED_END) return fusions[type - BR_XOP_FUSED].seq[0];
+	if (type >= BR_XOP_ARITH_CACHED && type < BR_XOP_I8_C) return BR_XOP_ADD + (type - BR_XOP_ARITH_CACHED) / 3;
+	switch (type) {
+		case BR_XOP_I8_C:     return BR_OP_I8;
+		case BR_XOP_I16_C:    return BR_OP_I16;
+		case BR_XOP_I32_C:    return BR_OP_I32;
+		case BR_XOP_PTR_C:    return BR_OP_PTR;
+		case BR_XOP_I64_C:    return BR_OP_I64;
+		case BR_XOP_ADDR_C:   return BR_OP_ADDR;
+		case BR_XOP_DBADDR_C: return BR_OP_DBADDR;
+		case BR_XOP_DROP_C:   return BR_OP_DROP;
+		default:              return type;
+	}
+}
+
+// the number of bytes every syscall removes from the stack
+static const uint8_t syscall_pops[] = {
+	[BR_SYS_EXIT] = sizeof(uintptr_t),
+	[BR_SYS_WRITE] = 2 * sizeof(void*),
+	[BR_SYS_READ] = 2 * sizeof(void*)
+};
+static_assert(sizeof(syscall_pops) == BR_N_SYSCALLS, "not all syscalls have their effect on the stack defined");
+
+#define IAT_STRIDE (BR_OP_SUBIAT8 - BR_OP_ADDIAT8)
+static_assert(BR_OP_SHRSIAT64 - BR_OP_ADDIAT8 == JIT_SHRS * IAT_STRIDE + 4, "the `*-i@*` operations are out of order");
+static_assert(BR_OP_NOTAT64 - BR_OP_NOTAT8 == 4, "the `not@*` operations are out of order");
+
+// the size of the operand of a `*-i@*` or `not@*` operation by its offset from the first operation of its kind
+static uint8_t getAtOpSize(uint32_t offset)
+{
+	return offset == 3 ? sizeof(uintptr_t) : offset == 4 ? 8 : 1 << offset;
+}
+
+// compiles the operation `op_id` of a procedure; `depth_p` points to the depth of the stack before the operation, and is updated to the depth after it;
+// returns false if the operation can't be compiled
+static bool compileOp(BR_MachineCode* mc, BR_Op op, uint32_t op_id, int64_t* depth_p)
+{
+	int64_t depth = *depth_p;
+	const uint16_t type = getBaseOpType(op.type);
+	if (type >= BR_XOP_ADD && type < BR_XOP_ADDI) {
+// [A, B] -> [A OP B], where A is on top of the stack
+		const BR_JITArithKind kind = (type - BR_XOP_ADD) / 16;
+		const uint8_t size1 = 1 << (type - BR_XOP_ADD) % 16 / 4, size2 = 1 << (type - BR_XOP_ADD) % 4;
+		emitLoad(mc, JIT_RAX, JIT_HEAD, -depth, size1, isArithKindSigned(kind));
+		emitLoad(mc, JIT_RCX, JIT_HEAD, -depth + size1, size2, isArithKindSigned(kind));
+		emitArith(mc, kind, size1);
+		depth -= size2;
+		emitStore(mc, JIT_RAX, JIT_HEAD, -depth, size1);
+	} else if (type >= BR_XOP_ADDI && type < BR_XOP_NOT) {
+		const BR_JITArithKind kind = (type - BR_XOP_ADDI) / 4;
+		const uint8_t size = 1 << (type - BR_XOP_ADDI) % 4;
+		emitLoad(mc, JIT_RAX, JIT_HEAD, -depth, size, isArithKindSigned(kind));
+		emitMovImm(mc, JIT_RCX, op.operand_u);
+		emitArith(mc, kind, size);
+		emitStore(mc, JIT_RAX, JIT_HEAD, -depth, size);
+	} else if (type >= BR_XOP_NOT && type < BR_XOP_NOT + 4) {
+		const uint8_t size = 1 << (type - BR_XOP_NOT);
+		emitLoad(mc, JIT_RAX, JIT_HEAD, -depth, size, false);
+		emitReg(mc, true, 0xF7, 2, JIT_RAX); // not rax
+		emitStore(mc, JIT_RAX, JIT_HEAD, -depth, size);
+	} else if ((type >= BR_OP_ADDIAT8 && type <= BR_OP_SHRSIAT64 && (type - BR_OP_ADDIAT8) % IAT_STRIDE < 5)
+		|| (type >= BR_OP_NOTAT8 && type <= BR_OP_NOTAT64)) {
+// [A] -> [*A OP= operand], or [*A = ~*A] for `not@*`
+		const bool is_not = type >= BR_OP_NOTAT8;
+		const BR_JITArithKind kind = is_not ? JIT_XOR : (type - BR_OP_ADDIAT8) / IAT_STRIDE;
+		const uint8_t size = getAtOpSize(is_not ? type - BR_OP_NOTAT8 : (type - BR_OP_ADDIAT8) % IAT_STRIDE);
+		emitLoad(mc, JIT_RSI, JIT_HEAD, -depth, sizeof(void*), false);
+		emitLoad(mc, JIT_RAX, JIT_RSI, 0, size, !is_not && isArithKindSigned(kind));
+		if (is_not) {
+			emitReg(mc, true, 0xF7, 2, JIT_RAX); // not rax
+		} else {
+			emitMovImm(mc, JIT_RCX, op.operand_u);
+			emitArith(mc, kind, size);
+		}
+		emitStore(mc, JIT_RAX, JIT_RSI, 0, size);
+		depth -= sizeof(void*) - size;
+		emitStore(mc, JIT_RAX, JIT_HEAD, -depth, size);
+	} else switch (type) {
+		case BR_OP_NOP:
+			break;
+		case BR_OP_END:
+			emitExit(mc, op_id, depth, BR_EXC_END);
+			break;
+		case BR_OP_I8:
+		case BR_OP_I16:
+		case BR_OP_I32:
+		case BR_OP_PTR:
+		case BR_OP_I64:
+		case BR_OP_BUILTIN: {
+			const uint8_t size = type == BR_OP_I8 ? 1 : type == BR_OP_I16 ? 2 : type == BR_OP_I32 ? 4 : 8;
+			depth += size;
+			emitMovImm(mc, JIT_RAX, op.operand_u);
+			emitStore(mc, JIT_RAX, JIT_HEAD, -depth, size);
+			break;
+		}
+		case BR_OP_DBADDR:
+			depth += sizeof(void*);
+			emitMovImm(mc, JIT_RAX, op.operand_u);
+			if (op.x_op2_size) emitReg(mc, true, 0x01, JIT_MUT, JIT_RAX); // add rax, r13
+			emitStore(mc, JIT_RAX, JIT_HEAD, -depth, sizeof(void*));
+			break;
+		case BR_OP_ADDR:
+			depth += sizeof(void*);
+			emitLea(mc, JIT_RAX, JIT_HEAD, op.operand_u - depth);
+			emitStore(mc, JIT_RAX, JIT_HEAD, -depth, sizeof(void*));
+			break;
+		case BR_OP_SYS: {
+// the syscalls operate on `env`, so the stack head is synchronized with it before the call
+			if (op.operand_u >= BR_N_SYSCALLS) return false;
+			emitMem(mc, 0, false, 0xC7, 0, JIT_ENV, offsetof(BR_ExecEnv, exec_index));
+			emitImm32(mc, op_id);
+			emitLea(mc, JIT_RAX, JIT_HEAD, -depth);
+			emitStore(mc, JIT_RAX, JIT_ENV, offsetof(BR_ExecEnv, stack_head), sizeof(void*));
+			emitReg(mc, true, 0x89, JIT_ENV, JIT_RDI); // mov rdi, rbp
+			emitCall(mc, (uintptr_t)BR_syscalls[op.operand_u]);
+			EMIT(mc, 0x84, 0xC0); // test al, al
+			const uint32_t resume = emitJump(mc, 0x84); // je
+// the syscall has left the state of the execution in `env` itself
+			emitEpilogue(mc);
+			patchJump(mc, resume);
+			depth -= syscall_pops[op.operand_u];
+// the execution might have been blocked in the syscall for long, hence the poll, like in the threaded engine
+			emitPoll(mc, op_id + 1, depth);
+			break;
+		}
+		case BR_OP_DROP:
+			depth -= op.operand_u;
+			break;
+		case BR_OP_NEW:
+			depth += op.operand_u;
+			break;
+		case BR_OP_ZERO:
+			depth += op.operand_u;
+			emitZero(mc, -depth, op.operand_u);
+			break;
+		case BR_OP_GET:
+			depth += op.x_op1_size;
+			emitCopy(mc, JIT_HEAD, -depth, JIT_HEAD, op.operand_u - depth, op.x_op1_size);
+			break;
+		case BR_OP_SETAT:
+			emitLoad(mc, JIT_RDI, JIT_HEAD, -depth, sizeof(void*), false);
+			depth -= sizeof(void*);
+			emitCopy(mc, JIT_RDI, 0, JIT_HEAD, -depth, op.operand_u);
+			break;
+		case BR_OP_GETFROM:
+			emitLoad(mc, JIT_RSI, JIT_HEAD, -depth, sizeof(void*), false);
+			depth += op.operand_u - sizeof(void*);
+			emitCopy(mc, JIT_HEAD, -depth, JIT_RSI, 0, op.operand_u);
+			break;
+		case BR_OP_COPY:
+			emitLoad(mc, JIT_RDI, JIT_HEAD, -depth, sizeof(void*), false);
+			emitLoad(mc, JIT_RSI, JIT_HEAD, -depth + sizeof(void*), sizeof(void*), false);
+			emitCopy(mc, JIT_RDI, 0, JIT_RSI, 0, op.operand_u);
+// the destination address is reloaded, since the copy might have overwritten it, just like in the interpreter
+			emitLoad(mc, JIT_RAX, JIT_HEAD, -depth, sizeof(void*), false);
+			depth -= sizeof(void*);
+			emitStore(mc, JIT_RAX, JIT_HEAD, -depth, sizeof(void*));
+			break;
+		default:
+			return false;
+	}
+// the displacements of the stack items are 32-bit
+	if (depth < 0 || depth > INT32_MAX / 2) return false;
+	*depth_p = depth;
+	return true;
+}
+
+// compiles the procedure `proc_id` of `module` into executable memory; returns NULL if the procedure can't be compiled
+static void* compileProc(const BR_PreparedModule* module, uint32_t proc_id, size_t* size_p)
+{
+	const BR_OpArray body = module->seg_exec.data[proc_id].body;
+// the compiled code doesn't check whether it has reached the end of the procedure
+	if (!body.length || body.data[body.length - 1].type != BR_OP_END) return NULL;
+	BR_MachineCode mc = {0};
+// prologue; the 4 pushes and the adjustment of rsp keep it aligned to 16 bytes at the calls
+	EMIT(&mc,
+		0x53,                  // push rbx
+		0x55,                  // push rbp
+		0x41, 0x55,            // push r13
+		0x41, 0x56,            // push r14
+		0x48, 0x83, 0xEC, 0x08 // sub rsp, 8
+	);
+	emitReg(&mc, true, 0x89, JIT_RDI, JIT_ENV);
+	emitReg(&mc, true, 0x89, JIT_RSI, JIT_INTR);
+	emitLoad(&mc, JIT_HEAD, JIT_ENV, offsetof(BR_ExecEnv, stack_head), sizeof(void*), false);
+	emitLoad(&mc, JIT_MUT, JIT_ENV, offsetof(BR_ExecEnv, mut_data.data), sizeof(void*), false);
+	int64_t depth = 0;
+	for (uint32_t op_id = 0; op_id < body.length; ++op_id) {
+		if (!(op_id % BR_INTERRUPT_POLL_INTERVAL)) emitPoll(&mc, op_id, depth);
+		if (!compileOp(&mc, body.data[op_id], op_id, &depth)) {
+			uint8_tArray_clear(&mc.code);
+			return NULL;
+		}
+	}
+	if (mc.failed) {
+		uint8_tArray_clear(&mc.code);
+		return NULL;
+	}
+// the code is written while the memory is writable, and only then made executable
+	void* code = mmap(NULL, mc.code.length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED) {
+		code = NULL;
+	} else {
+		memcpy(code, mc.code.data, mc.code.length);
+		if (mprotect(code, mc.code.length, PROT_READ | PROT_EXEC)) {
+			munmap(code, mc.code.length);
+			code = NULL;
+		} else *size_p = mc.code.length;
+	}
+	uint8_tArray_clear(&mc.code);
+	return code;
+}
+
+// runs the procedure `proc_id` as machine code if it's compiled or has just been run enough times to be compiled;
+// returns false if the procedure has to be interpreted instead
+static bool runCompiledProc(const BR_PreparedModule* module, BR_ExecEnv* env, uint32_t proc_id, const volatile bool* interruptor)
+{
+	if (!module->jit) return false;
+	BR_JITProc* const jit = &module->jit[proc_id];
+	void* code = atomic_load_explicit(&jit->code, memory_order_acquire);
+	if (!code) {
+// only the run that finds exactly `jit_threshold` runs before it compiles the procedure, while the concurrent runs keep interpreting it;
+// if the compilation fails, it's never retried
+		if (atomic_load_explicit(&jit->n_runs, memory_order_relaxed) > module->jit_threshold
+			|| atomic_fetch_add_explicit(&jit->n_runs, 1, memory_order_relaxed) != module->jit_threshold
+			|| !(code = compileProc(module, proc_id, &jit->code_size)))
+			return false;
+		atomic_store_explicit(&jit->code, code, memory_order_release);
+	}
+// ISO C has no conversions between object and function pointers
+	BR_JITFunc func;
+	memcpy(&func, &code, sizeof(func));
+	env->cur_proc = module->seg_exec.data[proc_id].body.data;
+	func(env, interruptor);
+	return true;
+}
+
+static void delJITProcs(BR_PreparedModule* module)
+{
+	if (!module->jit) return;
+	for (uint32_t i = 0; i < module->seg_exec.length; ++i) {
+		void* const code = atomic_load(&module->jit[i].code);
+		if (code) munmap(code, module->jit[i].code_size);
+	}
+	free(module->jit);
+	module->jit = NULL;
+}
+#undef IAT_STRIDE
+#undef EMIT
+#undef JIT_INTR
+#undef JIT_MUT
+#undef JIT_ENV
+#undef JIT_HEAD
+#undef JIT_RDI
+#undef JIT_RSI
+#undef JIT_RDX
+#undef JIT_RCX
+#undef JIT_RAX
+#else
+static bool runCompiledProc(const BR_PreparedModule* module, BR_ExecEnv* env, uint32_t proc_id, const volatile bool* interruptor)
+{
+	return false;
+}
+
+static void delJITProcs(BR_PreparedModule* module) {}
+#endif // BR_JIT
+
+// alignment of every mutable data block within `BR_PreparedModule::mut_data`
+#define MUT_DATA_ALIGNMENT 16
+
+// returns the size of the contents of a data block of `module`, which is analyzed by `builder`
+static size_t getDataBlockSize(const BR_Module* module, const BR_ModuleBuilder* builder, BR_id db_id)
+{
+	const sbuf snapshot = module->seg_data.data[~db_id].data;
+	return snapshot.length ? snapshot.length : BR_getMaxStackRTSize(builder, db_id);
+}
+
+static sbuf allocDataBlock(const BR_Module* module, BR_ModuleBuilder* builder, BR_id db_id)
+{
+	return sbuf_alloc(getDataBlockSize(module, builder, db_id));
+}
+
+// the stack is preceded by an inaccessible guard page, so that if an overflow ever gets past the check in `BR_runPreparedModule`,
+// it faults instead of silently corrupting the memory below the stack
+static sbuf allocStack(size_t size)
+{
+	const size_t page_size = sysconf(_SC_PAGESIZE);
+	size = (size + page_size - 1) / page_size * page_size;
+	char* const base = mmap(NULL, size + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) return (sbuf){0};
+	if (mprotect(base, page_size, PROT_NONE)) {
+		munmap(base, size + page_size);
+		return (sbuf){0};
+	}
+	return (sbuf){.data = base + page_size, .length = size};
+}
+
+static void freeStack(sbuf stack)
+{
+	if (!stack.data) return;
+	const size_t page_size = sysconf(_SC_PAGESIZE);
+	munmap(stack.data - page_size, stack.length + page_size);
+}
+
+// whether the contents of a data block depend on where the blocks or the stack are, or whether its evaluation has side effects;
+// such blocks can't be saved in an image evaluated, so they are evaluated by `BR_loadImage` instead
+static bool mustEvaluateOnLoad(const BR_DataBlock* block)
+{
+	arrayForeach (BR_Op, op, block->body) {
+		if (op->type == BR_OP_ADDR || op->type == BR_OP_DBADDR || op->type == BR_OP_SYS) return true;
+	}
+	return false;
+}
+
+// if `deferred_bodies` is not NULL, the module is prepared for `BR_writeImage`: the data blocks are zeroed before the evaluation,
+// and the ones for which `mustEvaluateOnLoad` holds are only prepared, their bodies are moved to `deferred_bodies`
+static BR_Error prepareModule(BR_Module module, BR_PreparedModule* dst, const volatile bool* interruptor, uint32_t flags, BR_OpArray* deferred_bodies)
+{
+	*dst = (BR_PreparedModule){.flags = flags, .jit_threshold = BR_DEFAULT_JIT_THRESHOLD};
+// validating the entry point
+	if (module.exec_entry_point >= module.seg_exec.length)
+		return (BR_Error){.type = BR_ERR_INVALID_ENTRY};
+	const BR_Proc* const proc = &module.seg_exec.data[module.exec_entry_point];
+	if (proc->ret_type.kind != BR_TYPE_VOID || proc->args.length)
+		return (BR_Error){.type = BR_ERR_INVALID_ENTRY_PROTOTYPE};
+// setting a default interruptor if the `interruptor` is NULL
+	bool stub_interruptor = false;
+	if (!interruptor) interruptor = &stub_interruptor;
+// pre-allocating the data blocks array
+	if (!sbufArray_incrlen(&dst->seg_data, module.seg_data.length) && module.seg_data.length)
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+// initializing the module analyzer
+	BR_ModuleBuilder builder;
+	BR_Error err;
+	if ((err = BR_analyzeModule(&module, &builder)).type) return err;
+// allocating the data blocks; the mutable ones are placed together in `mut_data`, so that a run could copy all of them at once
+	arrayForeach (BR_DataBlock, block, builder.module.seg_data) {
+		if (block->is_mutable)
+			dst->mut_data.length += alignby(getDataBlockSize(&module, &builder, ~(block - builder.module.seg_data.data)), MUT_DATA_ALIGNMENT);
+	}
+	if (dst->mut_data.length && !(dst->mut_data = deferred_bodies ? sbuf_alloc_z(dst->mut_data.length) : sbuf_alloc(dst->mut_data.length)).data)
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	size_t mut_data_offset = 0;
+	arrayForeach (BR_DataBlock, block, builder.module.seg_data) {
+		sbuf* const data = &dst->seg_data.data[block - builder.module.seg_data.data];
+		if (block->is_mutable) {
+			data->length = getDataBlockSize(&module, &builder, ~(block - builder.module.seg_data.data));
+			data->data = dst->mut_data.data + mut_data_offset;
+			mut_data_offset += alignby(data->length, MUT_DATA_ALIGNMENT);
+		} else {
+			*data = deferred_bodies
+				? sbuf_alloc_z(getDataBlockSize(&module, &builder, ~(block - builder.module.seg_data.data)))
+				: allocDataBlock(&module, &builder, ~(block - builder.module.seg_data.data));
+			if (!data->data) return (BR_Error){.type = BR_ERR_NO_MEMORY};
+		}
+	}
+// pre-evaluating the data blocks; the contents of the ones evaluated by `BR_snapshotDataBlocks` are just copied
+	BR_ExecEnv env = {.seg_data = dst->seg_data};
+	arrayForeach (BR_DataBlock, block, builder.module.seg_data) {
+		const sbuf snapshot = module.seg_data.data[block - builder.module.seg_data.data].data;
+		if (snapshot.length) {
+			memcpy(dst->seg_data.data[block - builder.module.seg_data.data].data, snapshot.data, snapshot.length);
+			continue;
+		}
+		for (uint32_t op_id = 0; op_id < block->body.length; ++op_id) {
+			prepareOpForExec(&builder, dst, ~(block - builder.module.seg_data.data), op_id);
+		}
+		if ((err = BR_addOp(&builder, ~(block - builder.module.seg_data.data), (BR_Op){.type = BR_OP_END})).type)
+			return err;
+		if (deferred_bodies && mustEvaluateOnLoad(&module.seg_data.data[block - builder.module.seg_data.data])) {
+			deferred_bodies[block - builder.module.seg_data.data] = block->body;
+			block->body = (BR_OpArray){0};
+			continue;
+		}
+		env.exec_index = 0;
+		env.stack = dst->seg_data.data[block - builder.module.seg_data.data];
+		env.stack_head = env.stack.data + env.stack.length;
+		execProc(&env, block->body, interruptor, flags);
+		if (env.exec_status.type == BR_EXC_INTERRUPT)
+			return (BR_Error){.type = BR_ERR_MODULE_LOAD_INTERRUPT};
+	}
+// TODO: add recursive pre-evaluation of data blocks when one block is referencing another; this probably has to be done after `call`s and `ret`urns are added
+	dst->max_stack_size = BR_getMaxStackRTSize(&builder, module.exec_entry_point);
+// pre-evaluating operands of the operations for faster execution
+	arrayForeach (BR_Proc, proc, builder.module.seg_exec) {
+		for (uint32_t op_id = 0; op_id < proc->body.length; ++op_id) {
+			prepareOpForExec(&builder, dst, proc - builder.module.seg_exec.data, op_id);
+		}
+	}
+#ifdef BR_THREADED_DISPATCH
+// replacing common sequences of operations with superinstructions
+	if ((flags & BR_EXEC_FUSE) && (flags & BR_EXEC_THREADED)) {
+		arrayForeach (BR_Proc, proc, builder.module.seg_exec) {
+			fuseOps(proc->body);
+		}
+	}
+// caching the top stack item in a register between the operations
+	if ((flags & BR_EXEC_CACHE_TOP) && (flags & BR_EXEC_THREADED)) {
+		arrayForeach (BR_Proc, proc, builder.module.seg_exec) {
+			cacheTopItem(proc->body);
+		}
+	}
+#endif
+// setting up the entry point
+	BR_addOp(&builder, module.exec_entry_point, (BR_Op){.type = BR_OP_END});
+	dst->entry_point = module.exec_entry_point;
+	BR_setEntryPoint(&builder, module.exec_entry_point);
+// cleaning up the analyzer; the bodies of the data blocks are prepared, thus contain execution-only operations, which `BR_deallocDataBlocks` doesn't know about
+	if ((err = BR_extractModule(builder, &module)).type) return err;
+	arrayForeach (BR_DataBlock, block, module.seg_data) {
+		BR_OpArray_clear(&block->body);
+	}
+	BR_deallocDataBlocks(&module);
+	BR_deallocStructs(&module);
+	dst->seg_exec = module.seg_exec;
+#ifdef BR_JIT
+	if ((flags & BR_EXEC_JIT) && !(dst->jit = calloc(dst->seg_exec.length, sizeof(BR_JITProc))))
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+#endif
+	return (BR_Error){0};
+}
+
+BR_Error BR_prepareModule(BR_Module module, BR_PreparedModule* dst, const volatile bool* interruptor, uint32_t flags)
+{
+	return prepareModule(module, dst, interruptor, flags, NULL);
+}
+
+BR_Error BR_runPreparedModule(const BR_PreparedModule* module, BR_ExecEnv* env, char* args[], size_t stack_size, const volatile bool* interruptor)
+{
+// copying the initial state of the mutable data blocks; a copy left from the previous run is overwritten
+	if (env->mut_data.length != module->mut_data.length) {
+		sbuf_dealloc(&env->mut_data);
+		if (module->mut_data.length && !(env->mut_data = sbuf_alloc(module->mut_data.length)).data)
+			return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	}
+	memcpy(env->mut_data.data, module->mut_data.data, module->mut_data.length);
+// (re)allocating the stack; a stack left from the previous run is reused if it's big enough
+	if (!env->stack.data || env->stack.length < stack_size) {
+		freeStack(env->stack);
+		if (!(env->stack = allocStack(stack_size)).data)
+			return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	}
+	env->stack_head = env->stack.data + env->stack.length;
+	env->seg_data = module->seg_data;
+	env->seg_exec = module->seg_exec;
+	env->entry_point = module->entry_point;
+	env->exec_index = 0;
+	env->exec_status = (BR_ExecStatus){0};
+// setting the arguments
+	env->exec_argc = 0;
+	if (*args) while (args[++env->exec_argc]);
+	env->exec_argv = malloc(env->exec_argc * sizeof(sbuf));
+	for (uint32_t i = 0; i < env->exec_argc; i += 1) {
+		env->exec_argv[i] = sbuf_fromstr((char*)args[i]);
+		env->exec_argv[i].length += 1;
+	}
+// setting a default interruptor if the `interruptor` is NULL
+	bool stub_interruptor = false;
+	if (!interruptor) interruptor = &stub_interruptor;
+// checking whether the deepest state of the entry point fits into the stack; the operations themselves don't check for overflows
+	if (module->max_stack_size > env->stack.length)
+		env->exec_status.type = BR_EXC_STACK_OVERFLOW;
+// main execution loop
+	else if (!runCompiledProc(module, env, env->entry_point, interruptor))
+		execProc(env, env->seg_exec.data[env->entry_point].body, interruptor, module->flags);
+// cleanup
+	free(env->exec_argv);
+	env->exec_argv = NULL;
+	env->exec_argc = 0;
+	return (BR_Error){0};
+}
+
+void BR_delPreparedModule(BR_PreparedModule* module)
+{
+// the procedures and the data blocks of a module loaded by `BR_loadImage` are views into the image
+	if (!module->image.data) {
+// `BR_deallocProcs` can't be used, since it doesn't know about the execution-only operations
+		arrayForeach (BR_Proc, proc, module->seg_exec) {
+			BR_TypeArray_clear(&proc->args);
+			BR_OpArray_clear(&proc->body);
+		}
+		arrayForeach (sbuf, data, module->seg_data) {
+			if (!isSlice(data->data, data->length, module->mut_data.data, module->mut_data.length)) sbuf_dealloc(data);
+		}
+		sbuf_dealloc(&module->mut_data);
+	} else if (module->is_image_mapped) {
+		munmap(module->image.data, module->image.length);
+	} else sbuf_dealloc(&module->image);
+	delJITProcs(module);
+	BR_ProcArray_clear(&module->seg_exec);
+	sbufArray_clear(&module->seg_data);
+}
+
+// alignment of every section of an image, and of every immutable data block within its section
+#define IMAGE_ALIGNMENT 16
+static_assert(IMAGE_ALIGNMENT >= MUT_DATA_ALIGNMENT, "the mutable data blocks in an image are less aligned than in a prepared module");
+
+// the beginning of an image; all the offsets are from the start of the image, and the offsets of the operations are counted in operations
+typedef struct {
+	char header[BR_HEADER_SIZE];
+	uint64_t host; // see `getImageHost`
+	uint64_t max_stack_size;
+	uint32_t entry_point;
+	uint32_t flags;
+	uint32_t n_procs;
+	uint32_t n_data_blocks;
+	uint64_t n_relocs;
+	uint64_t n_ops;
+	uint64_t n_arg_types;
+	uint64_t mut_data_size;
+	uint64_t data_size;
+	uint64_t names_size;
+	uint64_t procs_offset; // `ImageProc[n_procs]`
+	uint64_t data_blocks_offset; // `ImageDataBlock[n_data_blocks]`
+	uint64_t relocs_offset; // `ImageReloc[n_relocs]`
+	uint64_t ops_offset; // `BR_Op[n_ops]`, the bodies of the procedures, followed by the bodies of the data blocks evaluated on load
+	uint64_t arg_types_offset; // `BR_Type[n_arg_types]`
+	uint64_t mut_data_offset; // the initial state of the mutable data blocks, laid out like `BR_PreparedModule::mut_data`
+	uint64_t data_offset; // the contents of the immutable data blocks
+	uint64_t names_offset; // NUL-terminated names of the procedures
+} ImageHeader;
+
+typedef struct {
+	uint64_t body_offset;
+	uint64_t args_offset;
+	uint64_t name_offset;
+	BR_Type ret_type;
+	uint32_t body_length;
+	uint32_t n_args;
+} ImageProc;
+
+typedef struct {
+	uint64_t offset; // into the mutable data section if `is_mutable` is set, otherwise into the immutable data section
+	uint64_t size;
+	uint64_t body_offset;
+	uint32_t body_length; // 0 if the contents are saved evaluated, otherwise the body is evaluated by `BR_loadImage`
+	uint32_t is_mutable;
+} ImageDataBlock;
+
+// an operation whose operand is the address of a data block; those are the only pointers in a prepared module
+typedef struct {
+	uint64_t op_offset;
+	uint64_t db_id;
+} ImageReloc;
+defArray(ImageReloc);
+
+// identifies the layout of prepared modules on the host, an image is only valid on the hosts with the same layout
+static uint64_t getImageHost(void)
+{
+	const uint16_t byte_order = 1;
+	return (uint64_t)BR_N_XOPS << 32 | N_FUSIONS << 24 | sizeof(BR_Op) << 16 | sizeof(void*) << 8 | *(const uint8_t*)&byte_order;
+}
+
+static uint64_t alignImageOffset(uint64_t* offset_p, uint64_t size)
+{
+	const uint64_t res = alignby(*offset_p, IMAGE_ALIGNMENT);
+	*offset_p = res + size;
+	return res;
+}
+
+typedef struct {
+	FILE* dst;
+	uint64_t offset;
+	bool failed;
+} ImageWriter;
+
+static void writeImageBytes(ImageWriter* writer, const void* data, size_t size)
+{
+	if (size && fwrite(data, 1, size, writer->dst) != size) writer->failed = true;
+	writer->offset += size;
+}
+
+// pads the image with zeros up to `offset`, which must be past the end of the written part
+static void padImage(ImageWriter* writer, uint64_t offset)
+{
+	static const char zeros[IMAGE_ALIGNMENT] = {0};
+	assert(offset - writer->offset <= IMAGE_ALIGNMENT, "the sections of an image are written out of order");
+	writeImageBytes(writer, zeros, offset - writer->offset);
+}
+
+// the operations are copied field by field, so that the padding within them is saved zeroed, and an image of a module is always the same
+static void writeImageOps(ImageWriter* writer, BR_OpArray ops)
+{
+	arrayForeach (BR_Op, op, ops) {
+		BR_Op res;
+		memset(&res, 0, sizeof(res));
+		res.type = op->type;
+		res.x_op2_size = op->x_op2_size;
+		res.x_op1_size = op->x_op1_size;
+		res.operand_u = op->operand_u;
+		writeImageBytes(writer, &res, sizeof(res));
+	}
+}
+
+BR_Error BR_writeImage(BR_Module module, FILE* dst, const volatile bool* interruptor, uint32_t flags)
+{
+	BR_OpArray* const deferred_bodies = calloc(module.seg_data.length + 1, sizeof(BR_OpArray));
+	if (!deferred_bodies) return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	BR_PreparedModule prepared;
+	BR_Error err = prepareModule(module, &prepared, interruptor, flags, deferred_bodies);
+	if (err.type) {
+		free(deferred_bodies);
+		return err;
+	}
+// laying out the sections
+	ImageHeader header = {
+		.host = getImageHost(),
+		.max_stack_size = prepared.max_stack_size,
+		.entry_point = prepared.entry_point,
+		.flags = flags,
+		.n_procs = prepared.seg_exec.length,
+		.n_data_blocks = prepared.seg_data.length,
+		.mut_data_size = prepared.mut_data.length
+	};
+	memcpy(header.header, BR_IMAGE_HEADER.data, BR_HEADER_SIZE);
+	ImageRelocArray relocs = {0};
+	arrayForeach (BR_Proc, proc, prepared.seg_exec) {
+// the operations are never moved by the preparation, so the source operation at the same index tells whether the prepared one has an address;
+// the addresses of the mutable data blocks in the procedures are offsets into the run's own copy of them
+		const BR_OpArray src_body = module.seg_exec.data[proc - prepared.seg_exec.data].body;
+		for (uint32_t op_id = 0; op_id < src_body.length; ++op_id) {
+			const BR_Op* const op = &src_body.data[op_id];
+			if (op->type != BR_OP_DBADDR || module.seg_data.data[~op->operand_s].is_mutable) continue;
+			if (!ImageRelocArray_append(&relocs, (ImageReloc){.op_offset = header.n_ops + op_id, .db_id = ~op->operand_s})) {
+				err = (BR_Error){.type = BR_ERR_NO_MEMORY};
+				goto cleanup;
+			}
+// the address is patched in on load anyway, and is saved zeroed, so that an image of a module is always the same
+			proc->body.data[op_id].operand_ptr = NULL;
+		}
+		header.n_ops += proc->body.length;
+		header.n_arg_types += proc->args.length;
+		header.names_size += strlen(proc->name) + 1;
+	}
+	for (uint32_t db_id = 0; db_id < prepared.seg_data.length; ++db_id) {
+		if (deferred_bodies[db_id].length) {
+// the data blocks only ever see the initial state of the mutable data blocks, so all their addresses are absolute
+			const BR_OpArray src_body = module.seg_data.data[db_id].body;
+			for (uint32_t op_id = 0; op_id < src_body.length; ++op_id) {
+				if (src_body.data[op_id].type != BR_OP_DBADDR) continue;
+				if (!ImageRelocArray_append(&relocs, (ImageReloc){.op_offset = header.n_ops + op_id, .db_id = ~src_body.data[op_id].operand_s})) {
+					err = (BR_Error){.type = BR_ERR_NO_MEMORY};
+					goto cleanup;
+				}
+				deferred_bodies[db_id].data[op_id].operand_ptr = NULL;
+			}
+			header.n_ops += deferred_bodies[db_id].length;
+		}
+		if (!module.seg_data.data[db_id].is_mutable) alignImageOffset(&header.data_size, prepared.seg_data.data[db_id].length);
+	}
+	header.n_relocs = relocs.length;
+	uint64_t offset = sizeof(header);
+	header.procs_offset = alignImageOffset(&offset, header.n_procs * sizeof(ImageProc));
+	header.data_blocks_offset = alignImageOffset(&offset, header.n_data_blocks * sizeof(ImageDataBlock));
+	header.relocs_offset = alignImageOffset(&offset, header.n_relocs * sizeof(ImageReloc));
+	header.ops_offset = alignImageOffset(&offset, header.n_ops * sizeof(BR_Op));
+	header.arg_types_offset = alignImageOffset(&offset, header.n_arg_types * sizeof(BR_Type));
+	header.mut_data_offset = alignImageOffset(&offset, header.mut_data_size);
+	header.data_offset = alignImageOffset(&offset, header.data_size);
+	header.names_offset = alignImageOffset(&offset, header.names_size);
+// writing the sections
+	ImageWriter writer = {.dst = dst};
+	writeImageBytes(&writer, &header, sizeof(header));
+	padImage(&writer, header.procs_offset);
+	uint64_t ops_offset = 0, args_offset = 0, name_offset = 0;
+	arrayForeach (BR_Proc, proc, prepared.seg_exec) {
+		const ImageProc info = {
+			.body_offset = ops_offset,
+			.args_offset = args_offset,
+			.name_offset = name_offset,
+			.ret_type = proc->ret_type,
+			.body_length = proc->body.length,
+			.n_args = proc->args.length
+		};
+		writeImageBytes(&writer, &info, sizeof(info));
+		ops_offset += proc->body.length;
+		args_offset += proc->args.length;
+		name_offset += strlen(proc->name) + 1;
+	}
+	padImage(&writer, header.data_blocks_offset);
+	uint64_t data_offset = 0;
+	for (uint32_t db_id = 0; db_id < prepared.seg_data.length; ++db_id) {
+		const sbuf data = prepared.seg_data.data[db_id];
+		ImageDataBlock info = {
+			.size = data.length,
+			.body_offset = ops_offset,
+			.body_length = deferred_bodies[db_id].length,
+			.is_mutable = module.seg_data.data[db_id].is_mutable
+		};
+		if (info.is_mutable) {
+			info.offset = data.data - prepared.mut_data.data;
+		} else info.offset = alignImageOffset(&data_offset, data.length);
+		writeImageBytes(&writer, &info, sizeof(info));
+		ops_offset += deferred_bodies[db_id].length;
+	}
+	padImage(&writer, header.relocs_offset);
+	writeImageBytes(&writer, relocs.data, relocs.length * sizeof(ImageReloc));
+	padImage(&writer, header.ops_offset);
+	arrayForeach (BR_Proc, proc, prepared.seg_exec) {
+		writeImageOps(&writer, proc->body);
+	}
+	for (uint32_t db_id = 0; db_id < prepared.seg_data.length; ++db_id) {
+		writeImageOps(&writer, deferred_bodies[db_id]);
+	}
+	padImage(&writer, header.arg_types_offset);
+	arrayForeach (BR_Proc, proc, prepared.seg_exec) {
+		writeImageBytes(&writer, proc->args.data, proc->args.length * sizeof(BR_Type));
+	}
+	padImage(&writer, header.mut_data_offset);
+	writeImageBytes(&writer, prepared.mut_data.data, prepared.mut_data.length);
+	padImage(&writer, header.data_offset);
+	for (uint32_t db_id = 0; db_id < prepared.seg_data.length; ++db_id) {
+		if (module.seg_data.data[db_id].is_mutable) continue;
+		padImage(&writer, alignby(writer.offset, IMAGE_ALIGNMENT));
+		writeImageBytes(&writer, prepared.seg_data.data[db_id].data, prepared.seg_data.data[db_id].length);
+	}
+	padImage(&writer, header.names_offset);
+	arrayForeach (BR_Proc, proc, prepared.seg_exec) {
+		writeImageBytes(&writer, proc->name, strlen(proc->name) + 1);
+	}
+	if (writer.failed || fflush(dst)) err = (BR_Error){.type = BR_ERR_WRITE_FAILURE};
+cleanup:
+	ImageRelocArray_clear(&relocs);
+	for (uint32_t db_id = 0; db_id < prepared.seg_data.length; ++db_id) {
+		BR_OpArray_clear(&deferred_bodies[db_id]);
+	}
+	free(deferred_bodies);
+	BR_delPreparedModule(&prepared);
+	return err;
+}
+
+// returns the section of `image` at `offset` that is `n_items` items of size `item_size`, or NULL if it's out of bounds or misaligned
+static void* getImageSection(sbuf image, uint64_t offset, uint64_t n_items, size_t item_size)
+{
+	if (offset % IMAGE_ALIGNMENT || offset > image.length || n_items > (image.length - offset) / item_size) return NULL;
+	return image.data + offset;
+}
+
+static BR_Error loadImage(sbuf image, BR_PreparedModule* dst, const volatile bool* interruptor)
+{
+	if (image.length < BR_HEADER_SIZE) return (BR_Error){.type = BR_ERR_NO_HEADER};
+	if (!sbuf_startswith(image, BR_IMAGE_HEADER)) {
+		BR_Error err = {.type = BR_ERR_INVALID_HEADER};
+		memcpy(err.header, image.data, BR_HEADER_SIZE);
+		return err;
+	}
+	if (image.length < sizeof(ImageHeader)) return (BR_Error){.type = BR_ERR_INVALID_IMAGE};
+	ImageHeader header;
+	memcpy(&header, image.data, sizeof(header));
+	const ImageProc* const procs = getImageSection(image, header.procs_offset, header.n_procs, sizeof(ImageProc));
+	const ImageDataBlock* const data_blocks = getImageSection(image, header.data_blocks_offset, header.n_data_blocks, sizeof(ImageDataBlock));
+	const ImageReloc* const relocs = getImageSection(image, header.relocs_offset, header.n_relocs, sizeof(ImageReloc));
+	BR_Op* const ops = getImageSection(image, header.ops_offset, header.n_ops, sizeof(BR_Op));
+	BR_Type* const arg_types = getImageSection(image, header.arg_types_offset, header.n_arg_types, sizeof(BR_Type));
+	char* const mut_data = getImageSection(image, header.mut_data_offset, header.mut_data_size, 1);
+	char* const data = getImageSection(image, header.data_offset, header.data_size, 1);
+	const char* const names = getImageSection(image, header.names_offset, header.names_size, 1);
+	if (header.host != getImageHost() || !procs || !data_blocks || !relocs || !ops || !arg_types || !mut_data || !data || !names
+		|| header.entry_point >= header.n_procs || (header.names_size && names[header.names_size - 1]))
+		return (BR_Error){.type = BR_ERR_INVALID_IMAGE};
+	*dst = (BR_PreparedModule){
+		.mut_data = {.data = mut_data, .length = header.mut_data_size},
+		.max_stack_size = header.max_stack_size,
+		.entry_point = header.entry_point,
+		.flags = header.flags,
+		.jit_threshold = BR_DEFAULT_JIT_THRESHOLD,
+		.image = image
+	};
+// the arrays themselves are allocated, so that the module could be deleted with `BR_delPreparedModule` right away, even if it's not loaded fully
+	if ((!BR_ProcArray_incrlen(&dst->seg_exec, header.n_procs) && header.n_procs)
+		|| (!sbufArray_incrlen(&dst->seg_data, header.n_data_blocks) && header.n_data_blocks))
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	for (uint32_t proc_id = 0; proc_id < header.n_procs; ++proc_id) {
+		const ImageProc* const info = &procs[proc_id];
+		if (info->body_offset > header.n_ops || info->body_length > header.n_ops - info->body_offset
+			|| info->args_offset > header.n_arg_types || info->n_args > header.n_arg_types - info->args_offset
+			|| info->name_offset >= header.names_size)
+			return (BR_Error){.type = BR_ERR_INVALID_IMAGE};
+		dst->seg_exec.data[proc_id] = (BR_Proc){
+			.name = names + info->name_offset,
+			.body = {.data = ops + info->body_offset, .length = info->body_length},
+			.ret_type = info->ret_type,
+			.args = {.data = arg_types + info->args_offset, .length = info->n_args}
+		};
+	}
+	for (uint32_t db_id = 0; db_id < header.n_data_blocks; ++db_id) {
+		const ImageDataBlock* const info = &data_blocks[db_id];
+		const uint64_t section_size = info->is_mutable ? header.mut_data_size : header.data_size;
+		if (info->offset > section_size || info->size > section_size - info->offset
+			|| info->body_offset > header.n_ops || info->body_length > header.n_ops - info->body_offset)
+			return (BR_Error){.type = BR_ERR_INVALID_IMAGE};
+		dst->seg_data.data[db_id] = (sbuf){.data = (info->is_mutable ? mut_data : data) + info->offset, .length = info->size};
+	}
+// patching the addresses of the data blocks into the operations; the image is mapped privately, so the file itself stays intact
+	for (uint64_t i = 0; i < header.n_relocs; ++i) {
+		if (relocs[i].op_offset >= header.n_ops || relocs[i].db_id >= header.n_data_blocks)
+			return (BR_Error){.type = BR_ERR_INVALID_IMAGE};
+		ops[relocs[i].op_offset].operand_ptr = dst->seg_data.data[relocs[i].db_id].data;
+	}
+// evaluating the data blocks that could not be saved evaluated, in the same order as `BR_prepareModule` does
+	bool stub_interruptor = false;
+	if (!interruptor) interruptor = &stub_interruptor;
+	BR_ExecEnv env = {.seg_data = dst->seg_data};
+	for (uint32_t db_id = 0; db_id < header.n_data_blocks; ++db_id) {
+		const ImageDataBlock* const info = &data_blocks[db_id];
+		if (!info->body_length) continue;
+		env.exec_index = 0;
+		env.stack = dst->seg_data.data[db_id];
+		env.stack_head = env.stack.data + env.stack.length;
+		execProc(&env, (BR_OpArray){.data = ops + info->body_offset, .length = info->body_length}, interruptor, dst->flags);
+		if (env.exec_status.type == BR_EXC_INTERRUPT)
+			return (BR_Error){.type = BR_ERR_MODULE_LOAD_INTERRUPT};
+	}
+#ifdef BR_JIT
+	if ((dst->flags & BR_EXEC_JIT) && !(dst->jit = calloc(dst->seg_exec.length, sizeof(BR_JITProc))))
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+#endif
+	return (BR_Error){0};
+}
+
+BR_Error BR_loadImage(FILE* src, BR_PreparedModule* dst, const volatile bool* interruptor)
+{
+// memory-mapping the file if it's a regular one, otherwise reading the rest of the stream into memory;
+// the mapping is private and writable, since the relocations and the data blocks evaluated on load are written into it
+	*dst = (BR_PreparedModule){0};
+	sbuf image = {0};
+	bool is_mapped = false;
+	struct stat src_info;
+	if (ftello(src) == 0 && !fstat(fileno(src), &src_info) && S_ISREG(src_info.st_mode) && src_info.st_size > 0) {
+		void* mapping = mmap(NULL, src_info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(src), 0);
+		if (mapping != MAP_FAILED) {
+			image = (sbuf){.data = mapping, .length = src_info.st_size};
+			is_mapped = true;
+			fseeko(src, 0, SEEK_END);
+		}
+	}
+// the heap buffer is aligned at least as much as `BR_Op` and the data blocks need
+	if (!is_mapped) {
+		image = sbuf_fromfile(src);
+		if (ferror(src)) {
+			sbuf_dealloc(&image);
+			return (BR_Error){.type = BR_ERR_NO_HEADER};
+		}
+	}
+	const BR_Error err = loadImage(image, dst, interruptor);
+	if (!dst->image.data) {
+		if (is_mapped) {
+			munmap(image.data, image.length);
+		} else sbuf_dealloc(&image);
+	} else dst->is_image_mapped = is_mapped;
+	if (err.type) BR_delPreparedModule(dst);
+	return err;
+}
+
+static bool typeDependsOnPtrSize(const BR_Module* module, BR_Type type)
+{
+	if (type.kind == BR_TYPE_PTR) return true;
+	if (type.kind != BR_TYPE_STRUCT) return false;
+	arrayForeach (BR_Type, field, module->seg_typeinfo.data[type.struct_id].fields) {
+		if (typeDependsOnPtrSize(module, *field)) return true;
+	}
+	return false;
+}
+
+// whether the contents of a data block are the same whenever and wherever it's evaluated, i.e. whether they can be saved instead of its body
+static bool isDataBlockSnapshotable(const BR_ModuleBuilder* builder, BR_id db_id)
+{
+	const BR_DataBlock* const block = &builder->module.seg_data.data[~db_id];
+	if (block->is_mutable || !BR_getMaxStackRTSize(builder, db_id)) return false;
+	for (uint32_t op_id = 0; op_id < block->body.length; ++op_id) {
+		const BR_OpType type = block->body.data[op_id].type;
+		if (type == BR_OP_ADDR || type == BR_OP_DBADDR || type == BR_OP_SYS || type == BR_OP_BUILTIN) return false;
+// every stack item is on top of the stack right after the operation that pushed it, so checking the top items checks all of them, including the intermediate ones
+		BR_Type item_type;
+		if (BR_getStackItemType(builder, &item_type, db_id, op_id, 0) && typeDependsOnPtrSize(&builder->module, item_type)) return false;
+	}
+	return true;
+}
+
+BR_Error BR_snapshotDataBlocks(BR_Module* module, const volatile bool* interruptor)
+{
+// setting a default interruptor if the `interruptor` is NULL
+	bool stub_interruptor = false;
+	if (!interruptor) interruptor = &stub_interruptor;
+	BR_ModuleBuilder builder;
+	BR_Error err;
+	if ((err = BR_analyzeModule(module, &builder)).type) return err;
+// the snapshotable blocks have no `dbaddr`s, which are the only operations that need the prepared module
+	const BR_PreparedModule stub_module = {0};
+	BR_ExecEnv env = {0};
+	arrayForeach (BR_DataBlock, block, builder.module.seg_data) {
+		const BR_id db_id = ~(block - builder.module.seg_data.data);
+		if (!isDataBlockSnapshotable(&builder, db_id)) continue;
+// zeroing the block, so that the bytes that are never written to are saved the same every time
+		sbuf data = sbuf_alloc_z(BR_getMaxStackRTSize(&builder, db_id));
+		if (!data.data) {
+			err = (BR_Error){.type = BR_ERR_NO_MEMORY};
+			break;
+		}
+		for (uint32_t op_id = 0; op_id < block->body.length; ++op_id) {
+			prepareOpForExec(&builder, &stub_module, db_id, op_id);
+		}
+		if ((err = BR_addOp(&builder, db_id, (BR_Op){.type = BR_OP_END})).type) {
+			sbuf_dealloc(&data);
+			break;
+		}
+		env.exec_index = 0;
+		env.stack = data;
+		env.stack_head = data.data + data.length;
+		execProc(&env, block->body, interruptor, 0);
+// the prepared body contains execution-only operations, which `BR_delModuleBuilder` doesn't know about
+		BR_OpArray_clear(&block->body);
+		if (env.exec_status.type == BR_EXC_INTERRUPT) {
+			sbuf_dealloc(&data);
+			err = (BR_Error){.type = BR_ERR_MODULE_LOAD_INTERRUPT};
+			break;
+		}
+		BR_OpArray_clear(&module->seg_data.data[~db_id].body);
+		module->seg_data.data[~db_id].data = data;
+	}
+	BR_delModuleBuilder(builder);
+	return err;
+}
+
+BR_Error BR_execModule(BR_Module module, BR_ExecEnv* env, char* args[], size_t stack_size, const volatile bool* interruptor, uint32_t flags)
+{
+	BR_ExecEnv env_l;
+	if (!env) env = &env_l;
+	*env = (BR_ExecEnv){0};
+	if (!(env->own_module = malloc(sizeof(BR_PreparedModule)))) return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	BR_Error err;
+	if ((err = BR_prepareModule(module, env->own_module, interruptor, flags)).type) {
+		free(env->own_module);
+		env->own_module = NULL;
+		return err;
+	}
+	err = BR_runPreparedModule(env->own_module, env, args, stack_size, interruptor);
+	delJITProcs(env->own_module);
+// the procedures and the data blocks are left to the execution environment, e.g. for `BR_printOpProfile`
+	if (env == &env_l || err.type) BR_delExecEnv(env);
+	return err;
 }
 
 void BR_delExecEnv(BR_ExecEnv* env)
-// TODO
-{}
+{
+	freeStack(env->stack);
+	env->stack = (sbuf){0};
+	env->stack_head = NULL;
+	sbuf_dealloc(&env->mut_data);
+	if (env->own_module) {
+		BR_delPreparedModule(env->own_module);
+		free(env->own_module);
+		env->own_module = NULL;
+	}
+}
+
+typedef struct {
+	uint16_t seq[3];
+	uint8_t length;
+	uint32_t count;
+} BR_OpSeq;
+
+static int cmpOpSeqs(const void* a, const void* b)
+{
+	const BR_OpSeq *const x = a, *const y = b;
+	if (x->length != y->length) return x->length - y->length;
+	for (uint8_t i = 0; i < x->length; ++i) {
+		if (x->seq[i] != y->seq[i]) return x->seq[i] - y->seq[i];
+	}
+	return 0;
+}
+
+static int cmpOpSeqCounts(const void* a, const void* b)
+{
+	const BR_OpSeq *const x = a, *const y = b;
+	if (x->count != y->count) return x->count < y->count ? 1 : -1;
+	return cmpOpSeqs(a, b);
+}
+
+// while BRB has no jumps or calls, every operation is executed exactly once, so the counts are taken straight from the procedure bodies
+long BR_printOpProfile(const BR_ExecEnv* env, FILE* dst)
+{
+	size_t n_seqs = 0;
+	arrayForeach (BR_Proc, proc, env->seg_exec) {
+		n_seqs += proc->body.length * 2;
+	}
+	BR_OpSeq* const seqs = malloc(n_seqs * sizeof(BR_OpSeq));
+	if (!seqs && n_seqs) return -1;
+// collecting all the sequences, except those that cross the end of a procedure
+	n_seqs = 0;
+	arrayForeach (BR_Proc, proc, env->seg_exec) {
+		for (uint32_t i = 0; i < proc->body.length; ++i) {
+			for (uint8_t length = 2; length <= 3 && i + length <= proc->body.length; ++length) {
+				if (proc->body.data[i + length - 1].type == BR_OP_END) break;
+				BR_OpSeq* const seq = &seqs[n_seqs++];
+				*seq = (BR_OpSeq){.length = length, .count = 1};
+				for (uint8_t j = 0; j < length; ++j) {
+					seq->seq[j] = proc->body.data[i + j].type;
+				}
+			}
+		}
+	}
+// merging the duplicates
+	qsort(seqs, n_seqs, sizeof(BR_OpSeq), cmpOpSeqs);
+	size_t n_unique = 0;
+	for (size_t i = 0; i < n_seqs; ++i) {
+		if (n_unique && !cmpOpSeqs(&seqs[n_unique - 1], &seqs[i])) {
+			++seqs[n_unique - 1].count;
+		} else seqs[n_unique++] = seqs[i];
+	}
+	qsort(seqs, n_unique, sizeof(BR_OpSeq), cmpOpSeqCounts);
+// printing the result
+	long acc = 0;
+	for (size_t i = 0; i < n_unique; ++i) {
+		acc += fprintf(dst, "%u", seqs[i].count);
+		for (uint8_t j = 0; j < seqs[i].length; ++j) {
+			acc += fprintf(dst, " %.*s", sbuf_unpack(getOpName(seqs[i].seq[j])));
+		}
+		acc += fputc('\n', dst) != EOF;
+	}
+	free(seqs);
+	return acc;
+}
+
+long BR_printFusionReport(const BR_ExecEnv* env, FILE* dst)
+{
+	long acc = 0;
+	uint64_t total = 0, total_removed = 0;
+	arrayForeach (BR_Proc, proc, env->seg_exec) {
+		uint32_t removed = 0;
+		for (uint32_t i = 0, span; i < proc->body.length; i += span) {
+			span = getOpSpan(proc->body.data[i].type);
+			removed += span - 1;
+		}
+		acc += fprintf(dst, "%s: %u of %u dispatches removed\n", proc->name, removed, proc->body.length);
+		total += proc->body.length;
+		total_removed += removed;
+	}
+	acc += fprintf(dst, "total: %llu of %llu dispatches removed\n", (unsigned long long)total_removed, (unsigned long long)total);
+	return acc;
+}
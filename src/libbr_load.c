@@ -1,302 +1,589 @@
 // implementation for loading BRB modules from `.brb` files
 #include <br.h>
 #include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+implArray(BR_Op);
 
 typedef struct {
 	BR_ModuleBuilder* builder;
-	FILE* src;
-	long n_fetched;
+	const uint8_t* cur;
+	const uint8_t* end;
+	bool half_byte_pending; // set by `loadHalfByte`: the low half of the byte at `cur` is yet to be read as a separate byte
+	bool failed; // set when an attempt is made to read past `end`
+// set for a compressed section, which is decompressed one block at a time into `window`, between `cur` and `end`;
+// `next_block` is the first block yet to be decompressed, `window_offset` is the offset of `window` in the decompressed section
+	uint8_t* window;
+	const uint8_t* next_block;
+	const uint8_t* blocks_end;
+	uint64_t window_offset;
 } BR_ModuleLoader;
 
-static uint8_t loadInt8(FILE* fd, long* n_fetched)
+// the unread part of the window that's kept before the next block is at most the size of the biggest integer read at once
+#define BR_LOAD_WINDOW_SIZE (BR_LZ_BLOCK_SIZE + 8)
+
+static uint32_t getBE32(const uint8_t* src)
 {
-	char res;
-	if (!fread(&res, 1, 1, fd)) {
-		*n_fetched = -*n_fetched;
-		return 0;
+	return (uint32_t)src[0] << 24 | (uint32_t)src[1] << 16 | (uint32_t)src[2] << 8 | src[3];
+}
+
+// decompresses the block of a compressed section at `*src_p` into `dst`, which must have room for `BR_LZ_BLOCK_SIZE` bytes, and advances `*src_p` past it;
+// returns the decompressed size, or 0 if the block is invalid
+static size_t decompressNextBlock(const uint8_t** src_p, const uint8_t* end, uint8_t* dst)
+{
+	const uint8_t* src = *src_p;
+	if (end - src < 8) return 0;
+	const uint32_t raw_size = getBE32(src),
+		size = getBE32(src + 4);
+	src += 8;
+	if (!raw_size || raw_size > BR_LZ_BLOCK_SIZE || size > raw_size || size > (size_t)(end - src)) return 0;
+	if (size == raw_size) {
+		memcpy(dst, src, size);
+	} else if (!BR_decompressBlock(src, size, dst, raw_size)) return 0;
+	*src_p = src + size;
+	return raw_size;
+}
+
+// makes at least `size` bytes available after `cur`, decompressing as many blocks as needed; returns false if the section ends before that or is invalid
+static bool hasInput(BR_ModuleLoader* loader, size_t size)
+{
+	if (!loader->window) return (size_t)(loader->end - loader->cur) >= size;
+	while ((size_t)(loader->end - loader->cur) < size) {
+		if (loader->next_block >= loader->blocks_end) return false;
+		const size_t n_left = loader->end - loader->cur;
+		memmove(loader->window, loader->cur, n_left);
+		loader->window_offset += loader->cur - loader->window;
+		const size_t n_decompressed = decompressNextBlock(&loader->next_block, loader->blocks_end, loader->window + n_left);
+		if (!n_decompressed) {
+			loader->next_block = loader->blocks_end;
+			return false;
+		}
+		loader->cur = loader->window;
+		loader->end = loader->window + n_left + n_decompressed;
 	}
-	*n_fetched += 1;
-	return res;
+	return true;
 }
 
-static uint16_t loadInt16(FILE* fd, long* n_fetched)
+// returns the offset of `cur` in the decompressed section; only valid for a compressed section
+static uint64_t getInputOffset(const BR_ModuleLoader* loader)
 {
-	char res[2];
-	if (!fread(res, 2, 1, fd)) {
-		*n_fetched = -*n_fetched;
+	return loader->window_offset + (loader->cur - loader->window);
+}
+
+// all the multi-byte integers are stored in big-endian byte order
+static uint8_t loadInt8(BR_ModuleLoader* loader)
+{
+	if (loader->cur >= loader->end && !hasInput(loader, 1)) {
+		loader->failed = true;
 		return 0;
 	}
-	*n_fetched += 2;
-	return *(uint16_t*)BRByteOrder(&res, 2); 
+	uint8_t res = *loader->cur++;
+	if (loader->half_byte_pending) {
+		loader->half_byte_pending = false;
+		return res & 0xF;
+	}
+	return res;
 }
 
-static uint32_t loadInt32(FILE* fd, long* n_fetched)
+static uint16_t loadInt16(BR_ModuleLoader* loader)
 {
-	char res[4];
-	if (!fread(res, 4, 1, fd)) {
-		*n_fetched = -*n_fetched;
+	if (loader->end - loader->cur < 2 && !hasInput(loader, 2)) {
+		loader->failed = true;
 		return 0;
 	}
-	*n_fetched += 4;
-	return *(uint32_t*)BRByteOrder(&res, 4);
+	const uint8_t* src = loader->cur;
+	loader->cur += 2;
+	return (uint16_t)src[0] << 8 | src[1];
 }
 
-static uint64_t loadInt64(FILE* fd, long* n_fetched)
+static uint32_t loadInt32(BR_ModuleLoader* loader)
 {
-	char res[8];
-	if (!fread(res, 8, 1, fd)) {
-		*n_fetched = -*n_fetched;
+	if (loader->end - loader->cur < 4 && !hasInput(loader, 4)) {
+		loader->failed = true;
 		return 0;
 	}
-	*n_fetched += 8;
-	return *(uint64_t*)BRByteOrder(&res, 8);
+	loader->cur += 4;
+	return getBE32(loader->cur - 4);
 }
 
+static uint64_t loadInt64(BR_ModuleLoader* loader)
+{
+	const uint64_t high = loadInt32(loader);
+	return high << 32 | loadInt32(loader);
+}
 
-int64_t loadInt(FILE* fd, long* n_fetched)
+static int64_t loadInt(BR_ModuleLoader* loader)
 {
-	register uint8_t size = loadInt8(fd, n_fetched);
-	if (*n_fetched < 0) return 0;
+	register uint8_t size = loadInt8(loader);
+	if (loader->failed) return 0;
 	switch (size) {
-		case 8:  return loadInt8(fd, n_fetched);
-		case 9:  return loadInt16(fd, n_fetched);
-		case 10: return loadInt32(fd, n_fetched);
-		case 11: return loadInt64(fd, n_fetched);
-		case 12: return -loadInt8(fd, n_fetched);
-		case 13: return -loadInt16(fd, n_fetched);
-		case 14: return -loadInt32(fd, n_fetched);
-		case 15: return -loadInt64(fd, n_fetched);
+		case 8:  return loadInt8(loader);
+		case 9:  return loadInt16(loader);
+		case 10: return loadInt32(loader);
+		case 11: return loadInt64(loader);
+		case 12: return -loadInt8(loader);
+		case 13: return -loadInt16(loader);
+		case 14: return -loadInt32(loader);
+		case 15: return -loadInt64(loader);
 		default: return size;
 	}
 }
 
-static uint8_t loadHalfByte(FILE* fd, long* n_fetched)
+// the low half of the byte is then read as the next byte
+static uint8_t loadHalfByte(BR_ModuleLoader* loader)
 {
-	register uint8_t res = loadInt8(fd, n_fetched);
-	if (*n_fetched < 0) return 0;
-	if (ungetc(res & 0xF, fd) == EOF) {
-		*n_fetched = -*n_fetched;
+	if (loader->cur >= loader->end && !hasInput(loader, 1)) {
+		loader->failed = true;
 		return 0;
 	}
-	return res >> 4;
+	loader->half_byte_pending = true;
+	return *loader->cur >> 4;
 }
 
-static void load2Ints(FILE* fd, uint64_t* x, uint64_t* y, long* n_fetched)
+static void load2Ints(BR_ModuleLoader* loader, uint64_t* x, uint64_t* y)
 {
-	uint8_t sizes = loadInt8(fd, n_fetched);
-	if (*n_fetched < 0) return;
+	uint8_t sizes = loadInt8(loader);
+	if (loader->failed) return;
 
 	switch (sizes >> 4) {
-		case 8:  *x = loadInt8(fd, n_fetched); break;
-		case 9:  *x = loadInt16(fd, n_fetched); break;
-		case 10: *x = loadInt32(fd, n_fetched); break;
-		case 11: *x = loadInt64(fd, n_fetched); break;
-		case 12: *x = -(int64_t)loadInt8(fd, n_fetched); break;
-		case 13: *x = -(int64_t)loadInt16(fd, n_fetched); break;
-		case 14: *x = -(int64_t)loadInt32(fd, n_fetched); break;
-		case 15: *x = -(int64_t)loadInt64(fd, n_fetched); break;
+		case 8:  *x = loadInt8(loader); break;
+		case 9:  *x = loadInt16(loader); break;
+		case 10: *x = loadInt32(loader); break;
+		case 11: *x = loadInt64(loader); break;
+		case 12: *x = -(int64_t)loadInt8(loader); break;
+		case 13: *x = -(int64_t)loadInt16(loader); break;
+		case 14: *x = -(int64_t)loadInt32(loader); break;
+		case 15: *x = -(int64_t)loadInt64(loader); break;
 		default: *x = sizes >> 4; break;
 	}
 
 	switch (sizes & 0xF) {
-		case 8:  *y = loadInt8(fd, n_fetched); break;
-		case 9:  *y = loadInt16(fd, n_fetched); break;
-		case 10: *y = loadInt32(fd, n_fetched); break;
-		case 11: *y = loadInt64(fd, n_fetched); break;
-		case 12: *y = -(int64_t)loadInt8(fd, n_fetched); break;
-		case 13: *y = -(int64_t)loadInt16(fd, n_fetched); break;
-		case 14: *y = -(int64_t)loadInt32(fd, n_fetched); break;
-		case 15: *y = -(int64_t)loadInt64(fd, n_fetched); break;
+		case 8:  *y = loadInt8(loader); break;
+		case 9:  *y = loadInt16(loader); break;
+		case 10: *y = loadInt32(loader); break;
+		case 11: *y = loadInt64(loader); break;
+		case 12: *y = -(int64_t)loadInt8(loader); break;
+		case 13: *y = -(int64_t)loadInt16(loader); break;
+		case 14: *y = -(int64_t)loadInt32(loader); break;
+		case 15: *y = -(int64_t)loadInt64(loader); break;
 		default: *y = sizes & 0xF; break;
 	}
 }
 
-static BR_Type loadType(FILE* src, long* n_fetched)
+static BR_Type loadType(BR_ModuleLoader* loader)
 {
-	uint8_t hb = loadHalfByte(src, n_fetched);
+	uint8_t hb = loadHalfByte(loader);
 	BR_Type res = {
 		.kind = 1 << hb,
-		.n_items = loadInt(src, n_fetched),
+		.n_items = loadInt(loader),
 	};
 	if (res.kind == BR_TYPE_STRUCT)
-		res.struct_id = loadInt(src, n_fetched);
+		res.struct_id = loadInt(loader);
 	return res;
 }
 
-static BR_Error loadDataBlockDecl(BR_ModuleLoader* loader, uint32_t* n_pieces_p)
+static BR_Error loadDataBlockDecl(BR_ModuleLoader* loader, uint32_t* n_pieces_p, bool* is_evaluated_p)
 {
 // loading the flags
-	bool is_mutable = loadHalfByte(loader->src, &loader->n_fetched);
+	uint8_t flags = loadHalfByte(loader);
+	*is_evaluated_p = flags & BR_DBF_EVALUATED;
 // loading the name ID
-	const char* name = (const char*)loadInt(loader->src, &loader->n_fetched);
-	if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_DB_NAME};
+	const char* name = (const char*)loadInt(loader);
+	if (loader->failed) return (BR_Error){.type = BR_ERR_NO_DB_NAME};
 // loading the body size
 	BR_id db_id;
-	*n_pieces_p = loadInt(loader->src, &loader->n_fetched);
-	if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_DB_BODY_SIZE};
-	return BR_addDataBlock(loader->builder, &db_id, name, is_mutable, *n_pieces_p);
+	*n_pieces_p = loadInt(loader);
+	if (loader->failed) return (BR_Error){.type = BR_ERR_NO_DB_BODY_SIZE};
+	BR_Error err = BR_addDataBlock(loader->builder, &db_id, NULL, flags & BR_DBF_MUTABLE, *is_evaluated_p ? 0 : *n_pieces_p);
+	if (err.type) return err;
+// the name ID is kept in place of the name until the names are loaded, bypassing the name index of the builder
+	loader->builder->module.seg_data.data[~db_id].name = name;
+	return (BR_Error){0};
+}
+
+// loads the contents of a pre-evaluated data block as is, so that it's never evaluated
+static BR_Error loadDataBlockContents(BR_ModuleLoader* loader, BR_id db_id, size_t size)
+{
+	sbuf* const data = &loader->builder->module.seg_data.data[~db_id].data;
+	if ((size_t)(loader->end - loader->cur) < size)
+		return (BR_Error){.type = BR_ERR_NO_DB_BODY};
+	if (!(*data = sbuf_alloc(size)).data && size)
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	memcpy(data->data, loader->cur, size);
+	loader->cur += size;
+	return (BR_Error){0};
 }
 
-static BR_Error loadOp(BR_ModuleLoader* loader, BR_id proc_id)
+// decodes the whole op stream of a procedure or a data block in one go
+static BR_Error loadOps(BR_ModuleLoader* loader, BR_id proc_id, uint32_t n_ops)
 {
-	BR_Op op;
-// loading the type
-	op.type = loadInt8(loader->src, &loader->n_fetched);
-	if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_OPCODE};
-	if (op.type >= BR_N_OPS) return (BR_Error){.type = BR_ERR_INVALID_OPCODE, .opcode = op.type};
-// loading the operand, if needed
-	switch (BR_GET_OPERAND_TYPE(op.type)) {
-		case BR_OPERAND_INT8:
-			op.operand_u = loadInt8(loader->src, &loader->n_fetched);
-			break;
-		case BR_OPERAND_INT:
-		case BR_OPERAND_BUILTIN:
-		case BR_OPERAND_VAR_NAME:
-		case BR_OPERAND_SYSCALL_NAME:
-			op.operand_u = loadInt(loader->src, &loader->n_fetched);
-			break;
-		case BR_OPERAND_DB_NAME:
-			op.operand_s = ~loadInt(loader->src, &loader->n_fetched);
-			break;
-		case BR_OPERAND_TYPE:
-			op.operand_type = loadType(loader->src, &loader->n_fetched);
-		case BR_OPERAND_NONE:
-			break;
-		default:
-			assert(false, "invalid operation type info");
-	}
-	if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_OPERAND, .opcode = op.type};
-	return BR_addOp(loader->builder, proc_id, op);
+	BR_Error err;
+	while (n_ops--) {
+		BR_Op op;
+	// loading the type
+		op.type = loadInt8(loader);
+		if (loader->failed) return (BR_Error){.type = BR_ERR_NO_OPCODE};
+		if (op.type >= BR_N_OPS) return (BR_Error){.type = BR_ERR_INVALID_OPCODE, .opcode = op.type};
+	// loading the operand, if needed
+		switch (BR_GET_OPERAND_TYPE(op.type)) {
+			case BR_OPERAND_INT8:
+				op.operand_u = loadInt8(loader);
+				break;
+			case BR_OPERAND_INT:
+			case BR_OPERAND_BUILTIN:
+			case BR_OPERAND_VAR_NAME:
+			case BR_OPERAND_SYSCALL_NAME:
+				op.operand_u = loadInt(loader);
+				break;
+			case BR_OPERAND_DB_NAME:
+				op.operand_s = ~loadInt(loader);
+				break;
+			case BR_OPERAND_TYPE:
+				op.operand_type = loadType(loader);
+			case BR_OPERAND_NONE:
+				break;
+			default:
+				assert(false, "invalid operation type info");
+		}
+		if (loader->failed) return (BR_Error){.type = BR_ERR_NO_OPERAND, .opcode = op.type};
+		if ((err = BR_addOp(loader->builder, proc_id, op)).type) return err;
+	}
+	return (BR_Error){0};
 }
 
-static BR_Error loadProcDecl(BR_ModuleLoader* loader, uint32_t* n_ops_p)
+// the body is pre-allocated only if `is_decoded_now` is set
+static BR_Error loadProcDecl(BR_ModuleLoader* loader, uint32_t* n_ops_p, bool is_decoded_now)
 {
 // loading the return type
-	BR_Type ret_type = loadType(loader->src, &loader->n_fetched);
-	if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_PROC_RET_TYPE};
+	BR_Type ret_type = loadType(loader);
+	if (loader->failed) return (BR_Error){.type = BR_ERR_NO_PROC_RET_TYPE};
 // loading the name ID and amount of arguments
 	uint64_t n_args, proc_name;
-	load2Ints(loader->src, &proc_name, &n_args, &loader->n_fetched);
-	if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_PROC_NAME};
+	load2Ints(loader, &proc_name, &n_args);
+	if (loader->failed) return (BR_Error){.type = BR_ERR_NO_PROC_NAME};
 // loading the arguments
 	BR_Type args[n_args];
 	for (size_t i = 0; i < n_args; ++i) {
-		args[i] = loadType(loader->src, &loader->n_fetched);
-		if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_PROC_ARG};
+		args[i] = loadType(loader);
+		if (loader->failed) return (BR_Error){.type = BR_ERR_NO_PROC_ARG};
 	}
 // loading the body size
 	BR_id proc_id;
-	*n_ops_p = loadInt(loader->src, &loader->n_fetched);
-	if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_PROC_BODY_SIZE};
-	return BR_addProc(loader->builder, &proc_id, (char*)proc_name, n_args, args, ret_type, *n_ops_p);
+	*n_ops_p = loadInt(loader);
+	if (loader->failed) return (BR_Error){.type = BR_ERR_NO_PROC_BODY_SIZE};
+	BR_Error err = BR_addProc(loader->builder, &proc_id, NULL, n_args, args, ret_type, is_decoded_now ? *n_ops_p : 0);
+	if (err.type) return err;
+	loader->builder->module.seg_exec.data[proc_id].name = (char*)proc_name;
+	return (BR_Error){0};
 }
 
 static BR_Error loadStruct(BR_ModuleLoader* loader)
 {
 	uint64_t name_id, n_fields;
-	load2Ints(loader->src, &name_id, &n_fields, &loader->n_fetched);
-	if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_STRUCT_DECL};
+	load2Ints(loader, &name_id, &n_fields);
+	if (loader->failed) return (BR_Error){.type = BR_ERR_NO_STRUCT_DECL};
 	BR_Type fields[n_fields];
 	for (uint64_t i = 0; i < n_fields; ++i) {
-		fields[i] = loadType(loader->src, &loader->n_fetched);
-		if (loader->n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_STRUCT_FIELD};
+		fields[i] = loadType(loader);
+		if (loader->failed) return (BR_Error){.type = BR_ERR_NO_STRUCT_FIELD};
 	}
 	BR_id struct_id;
-	return BR_addStruct(loader->builder, &struct_id, (char*)name_id, n_fields, fields);
+	BR_Error err = BR_addStruct(loader->builder, &struct_id, NULL, n_fields, fields);
+	if (err.type) return err;
+	loader->builder->module.seg_typeinfo.data[struct_id].name = (char*)name_id;
+	return (BR_Error){0};
 }
 
-defArray_as(const char**, fieldArray);
+defArray_as(const char*, nameArray);
+
+// binds the name ID stored in `*name_p` to its string from `names`
+static bool resolveName(const char** name_p, nameArray names)
+{
+	const uintptr_t name_id = (uintptr_t)*name_p;
+	if (name_id >= names.length) return false;
+	*name_p = names.data[name_id];
+	return true;
+}
 
-static fieldArray getNameFields(BR_Module* module)
+// loads the names until the end of input; they are used right where they are, without copying
+static BR_Error loadNames(BR_ModuleLoader* loader)
 {
-	fieldArray res = fieldArray_new(-(int64_t)module->seg_data.length - module->seg_exec.length);
+	nameArray names = nameArray_new(0);
+	while (loader->cur < loader->end) {
+		const uint8_t* name_end = memchr(loader->cur, '\0', loader->end - loader->cur);
+		if (!name_end) {
+			nameArray_clear(&names);
+			return (BR_Error){.type = BR_ERR_INVALID_NAME};
+		}
+		if (!nameArray_append(&names, (const char*)loader->cur)) {
+			nameArray_clear(&names);
+			return (BR_Error){.type = BR_ERR_NO_MEMORY};
+		}
+		loader->cur = name_end + 1;
+	}
+// binding the name IDs stored in the declarations to the names themselves
+	BR_Module* module = &loader->builder->module;
+	bool resolved = true;
 	arrayForeach (BR_DataBlock, block, module->seg_data) {
-		fieldArray_append(&res, &block->name);
+		resolved &= resolveName(&block->name, names);
 	}
 	arrayForeach (BR_Proc, proc, module->seg_exec) {
-		fieldArray_append(&res, &proc->name);
+		resolved &= resolveName(&proc->name, names);
 	}
 	arrayForeach (BR_Struct, _struct, module->seg_typeinfo) {
-		fieldArray_append(&res, &_struct->name);
+		resolved &= resolveName(&_struct->name, names);
 	}
-	return res;
+	nameArray_clear(&names);
+	if (!resolved) return (BR_Error){.type = BR_ERR_NAMES_NOT_RESOLVED};
+	return BR_indexNames(loader->builder);
 }
 
-BR_Error BR_loadFromBytecode(FILE* src, BR_ModuleBuilder* dst)
+// loads the module from the loaders of its parts, which are all the same one for BRB v1, where the parts just follow each other;
+// `proc_index` is empty for BRB v1, and for BRB v2 is the index of the procedure bodies in `procs`
+static BR_Error loadModule(BR_ModuleLoader* decls, BR_ModuleLoader* data, BR_ModuleLoader* procs, BR_ModuleLoader* names, sbuf proc_index, uint32_t flags)
 {
-	if (dst->error.type) return dst->error;
-	BR_ModuleLoader loader = {.builder = dst};
 	BR_Error err;
-	loader.src = src;
-// loading the header
-	char header[BR_HEADER_SIZE];
-	if (!fread(header, sizeof(header), 1, src))
-		return (BR_Error){.type = BR_ERR_NO_HEADER};
-	loader.n_fetched += sizeof(header);
-	if (*(uint64_t*)header != *(uint64_t*)BR_V1_HEADER.data)
-		return (BR_Error){.type = BR_ERR_INVALID_HEADER};
+	const bool is_lazy = (flags & BR_LOAD_LAZY) && proc_index.data && !procs->window;
 // loading the amount of data blocks, procedures and structs
-	uint64_t n_structs = loadInt(src, &loader.n_fetched),
+	uint64_t n_structs = loadInt(decls),
 		n_dbs, n_procs;
-	load2Ints(src, &n_dbs, &n_procs, &loader.n_fetched);
-	if (loader.n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_SEG_SIZES};
-	if ((err = BR_preallocDataBlocks(loader.builder, n_dbs)).type) return err;
-	if ((err = BR_preallocProcs(loader.builder, n_procs)).type) return err;
-	if ((err = BR_preallocStructs(loader.builder, n_structs)).type) return err;
+	load2Ints(decls, &n_dbs, &n_procs);
+	if (decls->failed) return (BR_Error){.type = BR_ERR_NO_SEG_SIZES};
+	if ((err = BR_preallocDataBlocks(decls->builder, n_dbs)).type) return err;
+	if ((err = BR_preallocProcs(decls->builder, n_procs)).type) return err;
+	if ((err = BR_preallocStructs(decls->builder, n_structs)).type) return err;
 // loading the structs 
 	for (uint32_t i = 0; i < n_structs; ++i) {
-		if ((err = loadStruct(&loader)).type) return err;
+		if ((err = loadStruct(decls)).type) return err;
 	}
 // loading the data block declarations
 	uint32_t n_pieces_per_db[n_dbs];
+	bool is_db_evaluated[n_dbs];
 	for (uint32_t i = 0; i < n_dbs; ++i) {
-		if ((err = loadDataBlockDecl(&loader, &n_pieces_per_db[i])).type) return err;
+		if ((err = loadDataBlockDecl(decls, &n_pieces_per_db[i], &is_db_evaluated[i])).type) return err;
 	}
 // loading the procedure declarations
 	uint32_t n_ops_per_proc[n_procs];
 	for (uint32_t i = 0; i < n_procs; ++i) {
-		if ((err = loadProcDecl(&loader, &n_ops_per_proc[i])).type) return err;
+		if ((err = loadProcDecl(decls, &n_ops_per_proc[i], !is_lazy)).type) return err;
 	}
 // loading the execution entry point
-	loader.builder->module.exec_entry_point = loadInt(src, &loader.n_fetched);
-	if (loader.n_fetched < 0) return (BR_Error){.type = BR_ERR_NO_ENTRY};
-// loading the operations for the data blocks
+	BR_Module* const module = &decls->builder->module;
+	module->exec_entry_point = loadInt(decls);
+	if (decls->failed) return (BR_Error){.type = BR_ERR_NO_ENTRY};
+// loading the operations for the data blocks, or the contents of the pre-evaluated ones
 	for (size_t i = 0; i < (size_t)n_dbs; ++i) {
-		repeat (n_pieces_per_db[i]) {
-			if ((err = loadOp(&loader, ~(BR_id)i)).type) return err;
+		err = is_db_evaluated[i]
+			? loadDataBlockContents(data, ~(BR_id)i, n_pieces_per_db[i])
+			: loadOps(data, ~(BR_id)i, n_pieces_per_db[i]);
+		if (err.type) return err;
+	}
+// loading the operations for the procedures; in BRB v2, every body is bounded by the index, and, if `is_lazy` is set, only the body of the entry point is decoded;
+// compressed bodies are decoded one after another as the section is decompressed, and are only checked against the index
+	if (proc_index.data && proc_index.length != (n_procs + 1) * 4)
+		return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+	const uint8_t* const procs_start = procs->cur;
+	const size_t procs_size = procs->end - procs->cur;
+	if (procs->window) {
+		for (size_t i = 0; i < (size_t)n_procs; ++i) {
+			if (getInputOffset(procs) != getBE32((uint8_t*)proc_index.data + i * 4))
+				return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+			if ((err = loadOps(procs, i, n_ops_per_proc[i])).type) return err;
+		}
+		if (getInputOffset(procs) != getBE32((uint8_t*)proc_index.data + n_procs * 4) || hasInput(procs, 1))
+			return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+	} else for (size_t i = 0; i < (size_t)n_procs; ++i) {
+		if (proc_index.data) {
+			const uint32_t start = getBE32((uint8_t*)proc_index.data + i * 4),
+				end = getBE32((uint8_t*)proc_index.data + i * 4 + 4);
+			if (start > end || end > procs_size)
+				return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+			procs->cur = procs_start + start;
+			procs->end = procs_start + end;
+			if (is_lazy && i != module->exec_entry_point) {
+				module->seg_exec.data[i].pending_body = (sbuf){.data = (char*)procs->cur, .length = end - start};
+				module->seg_exec.data[i].n_pending_ops = n_ops_per_proc[i];
+				continue;
+			}
 		}
+		if ((err = loadOps(procs, i, n_ops_per_proc[i])).type) return err;
+		if (proc_index.data && procs->cur != procs->end)
+			return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+	}
+	return loadNames(names);
+}
+
+// finds the section of kind `kind` in the section table of a BRB v2 module; returns an empty sbuf with NULL data if there's none;
+// if `is_compressed_p` is not NULL, the section may also be compressed, which is reported through it
+static sbuf getSection(sbuf src, sbuf table, BR_SectionKind kind, bool* is_compressed_p)
+{
+	for (size_t i = 0; i < table.length; i += BR_SECTION_ENTRY_SIZE) {
+		const uint8_t* entry = (uint8_t*)table.data + i;
+		if (getBE32(entry) != kind && (!is_compressed_p || getBE32(entry) != (kind | BR_SECTION_COMPRESSED))) continue;
+		if (is_compressed_p) *is_compressed_p = getBE32(entry) != kind;
+		const uint64_t offset = (uint64_t)getBE32(entry + 4) << 32 | getBE32(entry + 8),
+			size = (uint64_t)getBE32(entry + 12) << 32 | getBE32(entry + 16);
+		if (offset > src.length || size > src.length - offset) break;
+		return (sbuf){.data = src.data + offset, .length = size};
+	}
+	return (sbuf){0};
+}
+
+// decompresses a whole compressed section into a new buffer
+static BR_Error decompressSection(sbuf src, sbuf* dst)
+{
+	const uint8_t* block = (uint8_t*)src.data;
+	const uint8_t* const end = block + src.length;
+	size_t size = 0;
+	while (end - block >= 8 && getBE32(block + 4) <= (size_t)(end - block - 8)) {
+		size += getBE32(block);
+		block += 8 + getBE32(block + 4);
 	}
-// loading the operations for the procedures
-	for (size_t i = 0; i < (size_t)n_procs; ++i) {
-		repeat (n_ops_per_proc[i]) {
-			if ((err = loadOp(&loader, i)).type) return err;
+	if (block != end)
+		return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+	if (!(*dst = sbuf_alloc(size)).data && size)
+		return (BR_Error){.type = BR_ERR_NO_MEMORY};
+	uint8_t* output = (uint8_t*)dst->data;
+	for (block = (uint8_t*)src.data; block < end;) {
+		const size_t n_decompressed = decompressNextBlock(&block, end, output);
+		if (!n_decompressed) {
+			sbuf_dealloc(dst);
+			return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
 		}
+		output += n_decompressed;
+	}
+	return (BR_Error){0};
+}
+
+static BR_Error loadV2(sbuf src, BR_ModuleBuilder* dst, uint32_t flags)
+{
+// loading the section table
+	if (src.length < BR_HEADER_SIZE + 4)
+		return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+	const uint32_t n_sections = getBE32((uint8_t*)src.data + src.length - 4);
+	if (n_sections > (src.length - BR_HEADER_SIZE - 4) / BR_SECTION_ENTRY_SIZE)
+		return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+	const sbuf table = {
+		.data = src.data + src.length - 4 - n_sections * BR_SECTION_ENTRY_SIZE,
+		.length = n_sections * BR_SECTION_ENTRY_SIZE
+	};
+	sbuf sections[BR_N_SECTION_KINDS];
+	bool is_compressed[BR_N_SECTION_KINDS] = {0};
+	for (uint8_t i = 0; i < BR_N_SECTION_KINDS; ++i) {
+		const bool may_be_compressed = i == BR_SECTION_PROCS || i == BR_SECTION_NAMES;
+		if (!(sections[i] = getSection(src, table, i, may_be_compressed ? &is_compressed[i] : NULL)).data)
+			return (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+	}
+// every part of the module is loaded from its own section
+	BR_ModuleLoader loaders[BR_N_SECTION_KINDS];
+	for (uint8_t i = 0; i < BR_N_SECTION_KINDS; ++i) {
+		loaders[i] = (BR_ModuleLoader){
+			.builder = dst,
+			.cur = (uint8_t*)sections[i].data,
+			.end = (uint8_t*)sections[i].data + sections[i].length
+		};
+	}
+// compressed names are decompressed whole, and the module takes ownership of them, as the names of the declarations point into them
+	if (is_compressed[BR_SECTION_NAMES]) {
+		sbuf names;
+		BR_Error err = decompressSection(sections[BR_SECTION_NAMES], &names);
+		if (err.type) return err;
+		if (!dst->module.names.data) dst->module.names = names;
+		loaders[BR_SECTION_NAMES].cur = (uint8_t*)names.data;
+		loaders[BR_SECTION_NAMES].end = (uint8_t*)names.data + names.length;
+	}
+// compressed procedure bodies are decoded as the blocks are decompressed, so only one block is in memory at a time
+	BR_ModuleLoader* const procs = &loaders[BR_SECTION_PROCS];
+	if (is_compressed[BR_SECTION_PROCS]) {
+		if (!(procs->window = malloc(BR_LOAD_WINDOW_SIZE)))
+			return (BR_Error){.type = BR_ERR_NO_MEMORY};
+		procs->next_block = procs->cur;
+		procs->blocks_end = procs->end;
+		procs->cur = procs->end = procs->window;
 	}
-// loading the names
-	fieldArray unresolved = getNameFields(&loader.builder->module);
-	uint32_t resolved = 0;
-	sbuf name = {0};
-	for (uint32_t i = 0; true; ++i) {
-		name.length = getdelim(&name.data, &name.length, '\0', src);
-		if ((ssize_t)name.length < 0) {
-			if (ferror(src) || errno)
-				return (BR_Error){.type = BR_ERR_INVALID_NAME};
-			break;
+	BR_Error err = loadModule(
+		&loaders[BR_SECTION_DECLS],
+		&loaders[BR_SECTION_DATA],
+		procs,
+		&loaders[BR_SECTION_NAMES],
+		sections[BR_SECTION_PROC_INDEX],
+		flags
+	);
+	free(procs->window);
+	return err;
+}
+
+BR_Error BR_loadFromBytecodeBuffer(sbuf src, BR_ModuleBuilder* dst, uint32_t flags)
+{
+	if (dst->error.type) return dst->error;
+// loading the header
+	if (src.length < BR_HEADER_SIZE)
+		return (BR_Error){.type = BR_ERR_NO_HEADER};
+	if (!memcmp(src.data, BR_V2_HEADER.data, BR_HEADER_SIZE))
+		return loadV2(src, dst, flags);
+	if (memcmp(src.data, BR_V1_HEADER.data, BR_HEADER_SIZE)) {
+		BR_Error err = {.type = BR_ERR_INVALID_HEADER};
+		memcpy(err.header, src.data, BR_HEADER_SIZE);
+		return err;
+	}
+// in BRB v1, all parts of the module just follow each other
+	BR_ModuleLoader loader = {
+		.builder = dst,
+		.cur = (uint8_t*)src.data + BR_HEADER_SIZE,
+		.end = (uint8_t*)src.data + src.length
+	};
+	return loadModule(&loader, &loader, &loader, &loader, (sbuf){0}, flags);
+}
+
+BR_Error BR_loadProcBody(BR_ModuleBuilder* builder, BR_id proc_id)
+{
+	if (builder->error.type) return builder->error;
+	BR_Proc* const proc = &builder->module.seg_exec.data[proc_id];
+	if (!proc->pending_body.data) return (BR_Error){0};
+	BR_ModuleLoader loader = {
+		.builder = builder,
+		.cur = (uint8_t*)proc->pending_body.data,
+		.end = (uint8_t*)proc->pending_body.data + proc->pending_body.length
+	};
+	const uint32_t n_ops = proc->n_pending_ops;
+	proc->pending_body = (sbuf){0};
+	proc->n_pending_ops = 0;
+	if (!(proc->body = BR_OpArray_new(-(int32_t)n_ops)).data && n_ops)
+		return builder->error = (BR_Error){.type = BR_ERR_NO_MEMORY};
+	BR_Error err = loadOps(&loader, proc_id, n_ops);
+	if (err.type) return err;
+	return loader.cur == loader.end ? (BR_Error){0} : (BR_Error){.type = BR_ERR_INVALID_SECTIONS};
+}
+
+BR_Error BR_loadFromBytecode(FILE* src, BR_ModuleBuilder* dst, uint32_t flags)
+{
+	if (dst->error.type) return dst->error;
+// memory-mapping the file if it's a regular one, otherwise reading the rest of the stream into memory
+	sbuf image = {0}, input;
+	bool is_mapped = false;
+	struct stat src_info;
+	const off_t offset = ftello(src);
+	if (offset >= 0 && !fstat(fileno(src), &src_info) && S_ISREG(src_info.st_mode) && src_info.st_size > offset) {
+		void* mapping = mmap(NULL, src_info.st_size, PROT_READ, MAP_PRIVATE, fileno(src), 0);
+		if (mapping != MAP_FAILED) {
+			image = (sbuf){.data = mapping, .length = src_info.st_size};
+			input = (sbuf){.data = image.data + offset, .length = image.length - offset};
+			is_mapped = true;
+			fseeko(src, 0, SEEK_END);
 		}
-		if (name.data[name.length - 1] != '\0')
-			return (BR_Error){.type = BR_ERR_INVALID_NAME};
-		arrayForeach_as (const char**, fieldArray, name_p, unresolved) {
-			if ((uintptr_t)**name_p == i) {
-				**name_p = strdup(name.data);
-				++resolved;
-			}
+	}
+	if (!is_mapped) {
+		input = image = sbuf_fromfile(src);
+		if (ferror(src)) {
+			sbuf_dealloc(&image);
+			return (BR_Error){.type = BR_ERR_NO_HEADER};
 		}
 	}
-	sbuf_dealloc(&name);
-	if (resolved != unresolved.length) {
-		fieldArray_clear(&unresolved);
-		return (BR_Error){.type = BR_ERR_NAMES_NOT_RESOLVED};
+// the module takes ownership of the image, as the names of the declarations point into it
+	if (!dst->module.image.data) {
+		dst->module.image = image;
+		dst->module.is_image_mapped = is_mapped;
 	}
-	fieldArray_clear(&unresolved);
-	return (BR_Error){0};
+	return BR_loadFromBytecodeBuffer(input, dst, flags);
 }
@@ -0,0 +1,110 @@
+// implementation of the LZ77 block compression used for the compressed sections of BRB modules
+#include <br.h>
+
+// a compressed block is a sequence of runs, each one being a token, the literals and the match:
+// the high 4 bits of the token are the amount of literals, the low 4 bits are the length of the match minus `MIN_MATCH`,
+// and either of them being 15 means that it's continued by the bytes after the token (or after the literals for the match length),
+// which are added to it until one that is less than 255; the match is then the offset back from the current position as a 16-bit little-endian integer;
+// the last run of a block has only the literals
+#define MIN_MATCH 4
+#define HASH_BITS 14
+static_assert(BR_LZ_BLOCK_SIZE <= 65536, "match offsets in a block do not fit into 16 bits");
+
+static uint32_t hashSeq(const uint8_t* src)
+{
+	uint32_t seq;
+	memcpy(&seq, src, sizeof(seq));
+	return seq * 2654435761u >> (32 - HASH_BITS);
+}
+
+static uint8_t* writeLength(uint8_t* dst, size_t length)
+{
+	for (; length >= 255; length -= 255) *dst++ = 255;
+	*dst++ = length;
+	return dst;
+}
+
+static uint8_t* writeRun(uint8_t* dst, const uint8_t* literals, size_t n_literals, size_t offset, size_t match_length)
+{
+	uint8_t* const token = dst++;
+	*token = (n_literals < 15 ? n_literals : 15) << 4;
+	if (n_literals >= 15) dst = writeLength(dst, n_literals - 15);
+	memcpy(dst, literals, n_literals);
+	dst += n_literals;
+	if (!match_length) return dst;
+	*dst++ = offset;
+	*dst++ = offset >> 8;
+	match_length -= MIN_MATCH;
+	*token |= match_length < 15 ? match_length : 15;
+	if (match_length >= 15) dst = writeLength(dst, match_length - 15);
+	return dst;
+}
+
+size_t BR_compressBlock(const uint8_t* src, size_t size, uint8_t* dst)
+{
+	assert(size <= BR_LZ_BLOCK_SIZE, "the block to be compressed is too big");
+// every entry is the position of the last sequence of `MIN_MATCH` bytes with that hash, plus 1, so that 0 means none
+	uint32_t last_pos[1 << HASH_BITS] = {0};
+	uint8_t* const dst_start = dst;
+	size_t anchor = 0, pos = 0;
+	while (pos + MIN_MATCH <= size) {
+		const uint32_t hash = hashSeq(src + pos);
+		const size_t match = last_pos[hash];
+		last_pos[hash] = pos + 1;
+		if (!match || memcmp(src + match - 1, src + pos, MIN_MATCH)) {
+			++pos;
+			continue;
+		}
+		size_t length = MIN_MATCH;
+		while (pos + length < size && src[match - 1 + length] == src[pos + length]) ++length;
+		dst = writeRun(dst, src + anchor, pos - anchor, pos - (match - 1), length);
+		pos += length;
+		anchor = pos;
+	}
+	dst = writeRun(dst, src + anchor, size - anchor, 0, 0);
+	return dst - dst_start;
+}
+
+// returns false if the length is not terminated before `end`
+static bool readLength(const uint8_t** src_p, const uint8_t* end, size_t* length_p)
+{
+	uint8_t byte;
+	do {
+		if (*src_p >= end) return false;
+		byte = *(*src_p)++;
+		*length_p += byte;
+	} while (byte == 255);
+	return true;
+}
+
+bool BR_decompressBlock(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size)
+{
+	const uint8_t* const src_end = src + src_size;
+	uint8_t* const dst_start = dst;
+	uint8_t* const dst_end = dst + dst_size;
+	while (src < src_end) {
+		const uint8_t token = *src++;
+	// copying the literals
+		size_t n_literals = token >> 4;
+		if (n_literals == 15 && !readLength(&src, src_end, &n_literals)) return false;
+		if (n_literals > (size_t)(src_end - src) || n_literals > (size_t)(dst_end - dst)) return false;
+		memcpy(dst, src, n_literals);
+		dst += n_literals;
+		src += n_literals;
+		if (src == src_end) break;
+	// copying the match; it may overlap with its own output, repeating the bytes before it
+		if (src_end - src < 2) return false;
+		const size_t offset = src[0] | src[1] << 8;
+		src += 2;
+		size_t length = token & 15;
+		if (length == 15 && !readLength(&src, src_end, &length)) return false;
+		length += MIN_MATCH;
+		if (!offset || offset > (size_t)(dst - dst_start) || length > (size_t)(dst_end - dst)) return false;
+		const uint8_t* match = dst - offset;
+		if (offset >= length) {
+			memcpy(dst, match, length);
+			dst += length;
+		} else while (length--) *dst++ = *match++;
+	}
+	return dst == dst_end;
+}
@@ -1,7 +1,10 @@
-// implementation for AOT compilation of BRB modules to native assembly code
+// implementation for AOT compilation of BRB modules to native assembly or machine code, and to C
 #include <br.h>
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
 
 #define ARM64_STACK_ALIGNMENT 16
 
@@ -13,6 +16,129 @@ static long printLabel(FILE* dst, const char* label, const char* prefix)
 		+ str_fput(dst, "\"");
 }
 
+// the peephole optimizer shared by the native backends: a backend describes every instruction of a procedure with an `mi_Instr`,
+// calls `optimizeInstrs` on the descriptions, and then emits its instructions as the updated descriptions say
+typedef enum {
+	MI_DELETED,
+	MI_OTHER,      // only writes the registers in `defs`
+	MI_MOVE,       // reg = reg2
+	MI_LOAD,       // reg = `size` bytes at `disp` relative to the frame register
+	MI_STORE,      // `size` bytes at `disp` relative to the frame register = reg
+	MI_LOAD_PAIR,  // reg = `size` bytes at `disp`, reg2 = `size` bytes at `disp + size`
+	MI_STORE_PAIR, // `size` bytes at `disp` = reg, `size` bytes at `disp + size` = reg2
+	MI_BARRIER     // may access any memory or change the frame register, e.g. a call, a syscall or an access through a pointer
+} mi_InstrType;
+
+typedef struct {
+	mi_InstrType type;
+	uint8_t reg;
+	uint8_t reg2;
+	uint8_t size;
+	bool whole; // whether the accessed bytes are the whole value of `reg`, i.e. whether loading the stored bytes back is a copy of the register
+	bool is_signed;
+	int64_t disp;
+	uint64_t defs; // a mask of the registers written by the instruction
+} mi_Instr;
+
+// decides whether 2 adjacent loads or stores of the same size, `lo` being at the lower address, can be done as 1 instruction
+typedef bool (*mi_PairPredicate)(mi_Instr lo, mi_Instr hi);
+
+// the maximum distance between 2 instructions considered by the optimizer, which keeps it linear
+#define MI_WINDOW 64
+
+static bool mi_overlap(mi_Instr a, mi_Instr b)
+{
+	return a.disp < b.disp + b.size && b.disp < a.disp + a.size;
+}
+
+// replaces the loads of a value that is still in a register with register moves, and removes the moves that have no effect
+static void forwardLoads(mi_Instr* instrs, uint32_t n_instrs)
+{
+	for (uint32_t i = 0; i < n_instrs; ++i) {
+		mi_Instr* const instr = &instrs[i];
+		uint64_t clobbered = 0;
+		if (instr->type == MI_LOAD && instr->whole) {
+// looking for the last access to the same bytes; the loads in between don't change them
+			for (uint32_t j = i; j-- > 0 && i - j <= MI_WINDOW;) {
+				const mi_Instr prev = instrs[j];
+				if (prev.type == MI_BARRIER) break;
+				if ((prev.type == MI_LOAD || prev.type == MI_STORE) && mi_overlap(prev, *instr)) {
+					if (prev.whole && prev.disp == instr->disp && prev.size == instr->size && !(clobbered >> prev.reg & 1)) {
+						instr->type = MI_MOVE;
+						instr->reg2 = prev.reg;
+						break;
+					}
+					if (prev.type == MI_STORE) break;
+				}
+				clobbered |= prev.defs;
+			}
+		}
+		if (instr->type != MI_MOVE) continue;
+		if (instr->reg == instr->reg2) {
+			instr->type = MI_DELETED;
+			continue;
+		}
+// the move is also redundant if it reverses or repeats a previous one
+		clobbered = 0;
+		for (uint32_t j = i; j-- > 0 && i - j <= MI_WINDOW;) {
+			const mi_Instr prev = instrs[j];
+			if (prev.type == MI_MOVE
+				&& ((prev.reg == instr->reg2 && prev.reg2 == instr->reg) || (prev.reg == instr->reg && prev.reg2 == instr->reg2))
+				&& !(clobbered >> instr->reg & 1) && !(clobbered >> instr->reg2 & 1)) {
+				instr->type = MI_DELETED;
+				break;
+			}
+			if (prev.type == MI_BARRIER) break;
+			clobbered |= prev.defs;
+		}
+	}
+}
+
+// removes the stores that are overwritten before anything might read them
+static void removeDeadStores(mi_Instr* instrs, uint32_t n_instrs)
+{
+	for (uint32_t i = 0; i < n_instrs; ++i) {
+		if (instrs[i].type != MI_STORE) continue;
+		for (uint32_t j = i + 1; j < n_instrs && j - i <= MI_WINDOW; ++j) {
+			const mi_Instr next = instrs[j];
+			if (next.type == MI_BARRIER || (next.type == MI_LOAD && mi_overlap(next, instrs[i]))) break;
+			if (next.type == MI_STORE && next.disp <= instrs[i].disp && instrs[i].disp + instrs[i].size <= next.disp + next.size) {
+				instrs[i].type = MI_DELETED;
+				break;
+			}
+		}
+	}
+}
+
+// merges adjacent loads or stores of neighbouring frame slots
+static void pairAccesses(mi_Instr* instrs, uint32_t n_instrs, mi_PairPredicate canPair)
+{
+	for (uint32_t i = 0, j; i < n_instrs; i = j) {
+		for (j = i + 1; j < n_instrs && instrs[j].type == MI_DELETED; ++j);
+		if (j == n_instrs) break;
+		mi_Instr* const first = &instrs[i];
+		mi_Instr* const second = &instrs[j];
+		if ((first->type != MI_LOAD && first->type != MI_STORE) || second->type != first->type || second->size != first->size) continue;
+		const mi_Instr lo = first->disp < second->disp ? *first : *second,
+			hi = first->disp < second->disp ? *second : *first;
+		if (hi.disp - lo.disp != lo.size || (first->type == MI_LOAD && lo.reg == hi.reg) || !canPair(lo, hi)) continue;
+		*first = lo;
+		first->type = lo.type == MI_LOAD ? MI_LOAD_PAIR : MI_STORE_PAIR;
+		first->reg2 = hi.reg;
+		first->defs |= hi.defs;
+		second->type = MI_DELETED;
+		++j;
+	}
+}
+
+// `canPair` may be NULL if the target has no paired loads and stores
+static void optimizeInstrs(mi_Instr* instrs, uint32_t n_instrs, mi_PairPredicate canPair)
+{
+	forwardLoads(instrs, n_instrs);
+	removeDeadStores(instrs, n_instrs);
+	if (canPair) pairAccesses(instrs, n_instrs, canPair);
+}
+
 typedef struct { // a rule specifying what literal values are allowed
 	int16_t r1_min;
 	int16_t r1_max;
@@ -55,35 +181,42 @@ static uptr compileIntLiteral_arm64(FILE* dst, s64 value, u8 reg_id, arm64_ImmVa
 		return 0;
 	}
 	snprintf(retbuf, retbuf_size, "x%hhu", reg_id);
-	bool inverted;
-	if ((inverted = value < 0)) value = -value;
+	if (value < 0) {
+// `movn` fills the upper bits with ones, so only the chunks that aren't all ones need to be set
+		uptr acc = fprintf(dst, "\tmovn\tx%hhu, %llu\n", reg_id, ~value & 0xFFFF);
+		for (u8 shift = 16; shift < 64; shift += 16) {
+			if ((value >> shift & 0xFFFF) != 0xFFFF)
+				acc += fprintf(dst, "\tmovk\tx%hhu, %llu, lsl %hhu\n", reg_id, value >> shift & 0xFFFF, shift);
+		}
+		return acc;
+	}
 	if (!(value >> 16))
 		return fprintf(dst,
-			"\t%s\tx%hhu, %lld\n",
-			inverted ? "movn" : "mov", reg_id, value);
+			"\tmov\tx%hhu, %lld\n",
+			reg_id, value);
 	if (!(value >> 32))
 		return fprintf(dst,
-			"\t%s\tx%hhu, %lld\n"
+			"\tmov\tx%hhu, %lld\n"
 			"\tmovk\tx%hhu, %llu, lsl 16\n",
-			inverted ? "movn" : "mov", reg_id, value & 0xFFFF,
-			reg_id, (inverted ? -value : value) >> 16);
+			reg_id, value & 0xFFFF,
+			reg_id, value >> 16);
 	if (!(value >> 48))
 		return fprintf(dst,
-			"\t%s\tx%hhu, %lld\n"
+			"\tmov\tx%hhu, %lld\n"
 			"\tmovk\tx%hhu, %llu, lsl 16\n"
 			"\tmovk\tx%hhu, %llu, lsl 32\n",
-			inverted ? "movn" : "mov", reg_id, value & 0xFFFF,
-			reg_id, ((inverted ? -value : value) >> 16) & 0xFFFF,
-			reg_id, (inverted ? -value : value) >> 32);
+			reg_id, value & 0xFFFF,
+			reg_id, (value >> 16) & 0xFFFF,
+			reg_id, value >> 32);
 	return fprintf(dst,
-		"\t%s\tx%hhd, %lld\n"
+		"\tmov\tx%hhd, %lld\n"
 		"\tmovk\tx%hhd, %llu, lsl 16\n"
 		"\tmovk\tx%hhd, %llu, lsl 32\n"
 		"\tmovk\tx%hhd, %llu, lsl 48\n",
-		inverted ? "movn" : "mov", reg_id, value & 0xFFFF,
-		reg_id, ((inverted ? -value : value) >> 16) & 0xFFFF,
-		reg_id, ((inverted ? -value : value) >> 32) & 0xFFFF,
-		reg_id, (inverted ? -value : value) >> 48);
+		reg_id, value & 0xFFFF,
+		reg_id, (value >> 16) & 0xFFFF,
+		reg_id, (value >> 32) & 0xFFFF,
+		reg_id, value >> 48);
 }
 
 typedef struct { // contains specification of valid immediate values for an address offset in a certain instruction type
@@ -154,11 +287,46 @@ typedef struct { // contains specification of valid immediate values for an addr
 
 #define ARM64_N_GP_REGS 29
 // even though x29 and x30 are considered general-purpose registers by the arm64 specs, in practice they are used for calling procedures, thus needing special handling
+
+// an item on the stack of a procedure, from the operation that creates it up to the last operation that reads it
+typedef struct {
+	uint32_t def;
+	uint32_t last_use;
+	uint32_t size;
+	bool in_memory; // whether the value must be kept in the stack frame, e.g. because its address is taken
+	int8_t reg; // the register holding the value throughout its lifetime, or -1 if the value is kept in the stack frame
+} arm64_Value;
+
+#define ARM64_NO_VALUE UINT32_MAX
+// the values an operation reads, starting from the top of the stack, and the value it creates
+typedef struct {
+	uint32_t args[3];
+	uint32_t res;
+} arm64_OpValues;
+
 typedef struct {
+	const BR_Module* module; // the module being compiled; unlike `builder.module`, it has the pre-evaluated contents of the data blocks
 	BR_ModuleBuilder builder;
 	FILE* dst;
+	arm64_Value* values; // the values of the procedure or the data block being compiled
+	arm64_OpValues* op_values; // the values read and created by each operation of the procedure or the data block being compiled
 } arm64_CodegenCtx;
 
+static const char* arm64_op_postfix[] = {
+	[1]  = "b\tw",
+	[2]  = "h\tw",
+	[4]  = "\tw",
+	[8]  = "\tx",
+	[16] = "\tq"
+};
+// the postfixes of the `ldr` instructions that sign-extend the loaded value to 64 bits
+static const char* arm64_signed_load_postfix[] = {
+	[1] = "sb\tx",
+	[2] = "sh\tx",
+	[4] = "sw\tx",
+	[8] = "\tx"
+};
+
 typedef struct {
 	uint32_t last_offset;
 	bool last_use;
@@ -176,48 +344,437 @@ getStackAddr_arm64(arm64_CodegenCtx* ctx, const char* sp, uptr offset, u8 reg_id
 		return 0;
 	}
 	char offset_s[32];
+	long acc;
 	if (reg_ctx->last_use) {
 		if (reg_ctx->last_offset) {
-			return compileIntLiteral_arm64(ctx->dst, offset - ~reg_ctx->last_offset, reg_id, aor.base, sizeof(offset_s), offset_s)
-				+ 0 * snprintf(retbuf, retbuf_size, "[x%hhu, %s]", reg_id, offset_s);
+			acc = compileIntLiteral_arm64(ctx->dst, offset - ~reg_ctx->last_offset, 13, aor.base, sizeof(offset_s), offset_s);
+			snprintf(retbuf, retbuf_size, "[x%hhu, %s]", reg_id, offset_s);
+			return acc;
 		}
-		return compileIntLiteral_arm64(ctx->dst, offset - ~reg_ctx->last_offset, reg_id, ARM64_REGONLY_RULE, sizeof(offset_s), offset_s)
-			+ 0 * snprintf(retbuf, retbuf_size, "[%s, %s]", sp, offset_s);
+		acc = compileIntLiteral_arm64(ctx->dst, offset, reg_id, ARM64_REGONLY_RULE, sizeof(offset_s), offset_s);
+		snprintf(retbuf, retbuf_size, "[%s, %s]", sp, offset_s);
+		return acc;
 	}
 	if (reg_ctx->last_offset) {
-		if (matchesRule(aor.pre, offset - ~reg_ctx->last_offset))
-			return 0 * snprintf(retbuf, retbuf_size, "[x%hhu, %zi]!", reg_id, offset - ~reg_ctx->last_offset);
-		return compileIntLiteral_arm64(ctx->dst, offset - ~reg_ctx->last_offset, 13, ARM64_ADDSUB_RULE, sizeof(offset_s), offset_s)
-			+ fprintf(ctx->dst, "\tadd\tx%hhu, x%hhu, %s\n", reg_id, reg_id, offset_s)
-			+ 0 * (reg_ctx->last_offset = ~offset)
-			+ 0 * snprintf(retbuf, retbuf_size, "[x%hhu]", reg_id);
+		if (matchesRule(aor.pre, offset - ~reg_ctx->last_offset)) {
+// the pre-indexed addressing mode updates the register
+			snprintf(retbuf, retbuf_size, "[x%hhu, %zi]!", reg_id, offset - ~reg_ctx->last_offset);
+			reg_ctx->last_offset = ~offset;
+			return 0;
+		}
+		acc =compileIntLiteral_arm64(ctx->dst, offset - ~reg_ctx->last_offset, 13, ARM64_ADDSUB_RULE, sizeof(offset_s), offset_s);
+		acc += fprintf(ctx->dst, "\tadd\tx%hhu, x%hhu, %s\n", reg_id, reg_id, offset_s);
+	} else {
+		acc = compileIntLiteral_arm64(ctx->dst, offset, reg_id, ARM64_ADDSUB_RULE, sizeof(offset_s), offset_s);
+		acc += fprintf(ctx->dst, "\tadd\tx%hhu, %s, %s\n", reg_id, sp, offset_s);
 	}
-	return compileIntLiteral_arm64(ctx->dst, offset - ~reg_ctx->last_offset, reg_id, ARM64_ADDSUB_RULE, sizeof(offset_s), offset_s)
-		+ fprintf(ctx->dst, "\tadd\tx%hhu, %s, %s\n", reg_id, sp, offset_s)
-		+ 0 * (reg_ctx->last_offset = ~offset)
-		+ 0 * snprintf(retbuf, retbuf_size, "[x%hhu]", reg_id);
+	reg_ctx->last_offset = ~offset;
+	snprintf(retbuf, retbuf_size, "[x%hhu]", reg_id);
+	return acc;
 }
 
-static long compileOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_t op_id, size_t vframe_offset, size_t vframe_offset_before, FILE* dst)
+static arm64_AddrOffsetRule getAddrRule_arm64(size_t size)
 {
-	static arm64_AddrOffsetRule addr_rules[] = {
-		[1] = AOR_LDR8,
-		[2] = AOR_LDR16,
-		[4] = AOR_LDR32,
-		[8] = AOR_LDR64
-	};
-	static const char* op_postfix[] = {
-		[1]  = "b\tw",
-		[2]  = "h\tw",
-		[4]  = "\tw",
-		[8]  = "\tx",
-		[16] = "\tq"
+	if (size == 1) return AOR_LDR8;
+	if (size == 2) return AOR_LDR16;
+	if (size == 4) return AOR_LDR32;
+	if (size == 8) return AOR_LDR64;
+	return (arm64_AddrOffsetRule){0};
+}
+
+// returns the rule for the immediate operand of the instruction implementing `base_op`
+static arm64_ImmValueRule getImmOperandRule_arm64(BR_OpType base_op)
+{
+	if (base_op == BR_OP_NOT) return ARM64_NOVALUE_RULE;
+	if (base_op == BR_OP_ADD || base_op == BR_OP_SUB || base_op == BR_OP_SHL || base_op == BR_OP_SHR || base_op == BR_OP_SHRS)
+		return ARM64_ADDSUB_RULE;
+	return ARM64_REGONLY_RULE;
+}
+
+#define ARM64_ARITH_STRIDE (BR_OP_SUB - BR_OP_ADD)
+static_assert(BR_OP_SHRSIAT64 - BR_OP_ADD == 12 * ARM64_ARITH_STRIDE + 6, "the arithmetic operations are out of order");
+
+// the registers that may hold stack items; the caller-saved ones are clobbered by the calls implementing syscalls and large copies,
+// and the callee-saved ones are only used by the entry point, since it never returns to its caller
+static const u8 arm64_caller_saved_regs[] = {3, 4, 5, 6, 7, 15};
+static const u8 arm64_callee_saved_regs[] = {19, 20, 21, 22, 23, 24, 25, 26};
+
+static bool isScalarSize_arm64(size_t size)
+{
+	return size == 1 || size == 2 || size == 4 || size == 8;
+}
+
+static int8_t takeFreeReg_arm64(bool* taken, const u8* regs, size_t n_regs)
+{
+	for (size_t i = 0; i < n_regs; ++i) {
+		if (!taken[regs[i]]) {
+			taken[regs[i]] = true;
+			return regs[i];
+		}
+	}
+	return -1;
+}
+
+// splits the stack items of procedure `proc_id`, or of the initializer of data block `proc_id` if it's negative, into values and assigns registers to them
+// using linear scan; a value stays in the stack frame if it's not a scalar, if it's operated on in memory, or if it's on the stack when an address on the stack is taken;
+// `callee_saved` specifies whether the callee-saved registers may be used without preserving them
+static void allocRegs_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, bool callee_saved)
+{
+	const BR_Module* module = &ctx->builder.module;
+	const BR_OpArray body = proc_id < 0 ? module->seg_data.data[~proc_id].body : module->seg_exec.data[proc_id].body;
+	const BR_TypeArray args = proc_id < 0 ? (BR_TypeArray){0} : module->seg_exec.data[proc_id].args;
+	const uint32_t n_ops = body.length;
+	uint32_t* const stack = malloc((n_ops + args.length + 1) * sizeof(uint32_t));
+// `n_calls[i]` is the number of calls made by the first `i` operations
+	uint32_t* const n_calls = malloc((n_ops + 1) * sizeof(uint32_t));
+	ctx->values = malloc((n_ops + args.length + 1) * sizeof(arm64_Value));
+	ctx->op_values = malloc(n_ops * sizeof(arm64_OpValues));
+	assert(stack && n_calls && ctx->values && (ctx->op_values || !n_ops), "memory allocation failure during native code generation");
+	arm64_Value* const values = ctx->values;
+
+// the arguments and the return address of a procedure are placed on the stack by the caller
+	uint32_t n_values = 0, stack_len = 0;
+	if (proc_id >= 0) {
+		for (uint32_t i = args.length; i > 0; --i) {
+			values[n_values] = (arm64_Value){.size = BR_getTypeRTSize(module, args.data[i - 1]), .in_memory = true, .reg = -1};
+			stack[stack_len++] = n_values++;
+		}
+		values[n_values] = (arm64_Value){.size = BR_getTypeRTSize(module, BR_PTR_TYPE(2)), .in_memory = true, .reg = -1};
+		stack[stack_len++] = n_values++;
+	}
+
+	n_calls[0] = 0;
+	for (uint32_t i = 0; i < n_ops; ++i) {
+		const BR_Op* op = &body.data[i];
+		arm64_OpValues* const op_values = &ctx->op_values[i];
+		*op_values = (arm64_OpValues){.args = {ARM64_NO_VALUE, ARM64_NO_VALUE, ARM64_NO_VALUE}, .res = ARM64_NO_VALUE};
+		uint32_t n_args = 0, n_popped = 0;
+		bool pushes = true, in_memory = false, is_call = false;
+		if (op->type >= BR_OP_ADD && op->type <= BR_OP_NOTAT64) {
+// [A, B] -> [A OP B] for the binary operations, [A] -> [OP A] or [A:ptr] -> [*A OP= <n>] for the rest
+			n_args = n_popped = op->type < BR_OP_NOT && (op->type - BR_OP_ADD) % ARM64_ARITH_STRIDE == 0 ? 2 : 1;
+		} else switch ((uint16_t)op->type) {
+			case BR_OP_NOP:
+			case BR_OP_END:
+				pushes = false;
+				break;
+			case BR_OP_I8:
+			case BR_OP_I16:
+			case BR_OP_I32:
+			case BR_OP_PTR:
+			case BR_OP_I64:
+			case BR_OP_DBADDR:
+			case BR_OP_BUILTIN:
+			case BR_OP_NEW:
+			case BR_OP_ZERO:
+				break;
+			case BR_OP_ADDR:
+				for (uint32_t j = 0; j < stack_len; ++j) {
+					values[stack[j]].in_memory = true;
+				}
+				break;
+			case BR_OP_GET:
+				op_values->args[0] = stack[stack_len - 1 - op->operand_u];
+				values[op_values->args[0]].last_use = i;
+				in_memory = !isScalarSize_arm64(values[op_values->args[0]].size);
+				is_call = values[op_values->args[0]].size > 511;
+				break;
+			case BR_OP_DROP:
+				pushes = false;
+				n_popped = 1;
+				break;
+			case BR_OP_SYS:
+				n_args = n_popped = BR_syscallNArgs[op->operand_u];
+				pushes = op->operand_u != BR_SYS_EXIT;
+				is_call = true;
+				break;
+			case BR_OP_SETAT:
+			case BR_OP_GETFROM:
+			case BR_OP_COPY:
+				n_args = op->type == BR_OP_GETFROM ? 1 : 2;
+				n_popped = op->type == BR_OP_SETAT ? 1 : n_args;
+				pushes = op->type != BR_OP_SETAT;
+				in_memory = true;
+				is_call = (op->type == BR_OP_COPY
+					? BR_getTypeRTSize(module, op->operand_type)
+					: BR_getStackItemRTSize(&ctx->builder, proc_id, i, 0)) > 511;
+				break;
+			case BR_N_OPS:
+			default:
+				assert(false, "invalid operation type %u", op->type);
+		}
+		for (uint32_t j = 0; j < n_args; ++j) {
+			const uint32_t value_id = op_values->args[j] = stack[stack_len - 1 - j];
+			values[value_id].last_use = i;
+			values[value_id].in_memory |= in_memory;
+		}
+		stack_len -= n_popped;
+		if (pushes) {
+			const size_t size = BR_getStackItemRTSize(&ctx->builder, proc_id, i, 0);
+			values[n_values] = (arm64_Value){
+				.def = i,
+				.last_use = i,
+				.size = size,
+				.in_memory = in_memory || !isScalarSize_arm64(size),
+				.reg = -1
+			};
+			op_values->res = stack[stack_len++] = n_values++;
+		}
+		n_calls[i + 1] = n_calls[i] + is_call;
+	}
+// the items left on the stack of a data block's initializer are the contents of the data block
+	if (proc_id < 0) {
+		for (uint32_t i = 0; i < stack_len; ++i) {
+			values[stack[i]].in_memory = true;
+		}
+	}
+	free(stack);
+
+// the values are created in the order of the operations, so they're already sorted by the start of their live ranges
+	uint32_t active[sizeof(arm64_caller_saved_regs) + sizeof(arm64_callee_saved_regs)];
+	uint32_t n_active = 0;
+	bool taken[ARM64_N_GP_REGS] = {0};
+	for (uint32_t i = 0; i < n_values; ++i) {
+		arm64_Value* const value = &values[i];
+		if (value->in_memory) continue;
+		for (uint32_t j = 0; j < n_active;) {
+			if (values[active[j]].last_use <= value->def) {
+				taken[values[active[j]].reg] = false;
+				active[j] = active[--n_active];
+			} else ++j;
+		}
+// a value that's alive during a call must be in a callee-saved register
+		const bool crosses_call = value->last_use > value->def + 1 && n_calls[value->last_use] > n_calls[value->def + 1];
+		int8_t reg = crosses_call ? -1 : takeFreeReg_arm64(taken, arm64_caller_saved_regs, sizeof(arm64_caller_saved_regs));
+		if (reg < 0 && callee_saved)
+			reg = takeFreeReg_arm64(taken, arm64_callee_saved_regs, sizeof(arm64_callee_saved_regs));
+		if (reg < 0) {
+// no free registers, spilling the value that lives the longest, which might be the new one
+			uint32_t* victim = NULL;
+			for (uint32_t j = 0; j < n_active; ++j) {
+				const arm64_Value* candidate = &values[active[j]];
+				if (candidate->last_use > (victim ? values[*victim].last_use : value->last_use)
+					&& (!crosses_call || candidate->reg >= arm64_callee_saved_regs[0]))
+					victim = &active[j];
+			}
+			if (!victim) continue;
+			value->reg = values[*victim].reg;
+			values[*victim].reg = -1;
+			*victim = i;
+			continue;
+		}
+		value->reg = reg;
+		active[n_active++] = i;
+	}
+	free(n_calls);
+}
+
+// returns in `reg_id` the register holding value `value_id`, loading the value into register `scratch` from the stack frame if needed;
+// a value narrower than 64 bits is sign-extended into `scratch` if `is_signed` is true
+static long loadValue_arm64(arm64_CodegenCtx* ctx, const char* sp, uint32_t value_id, uptr offset, u8 scratch, bool is_signed, u8* reg_id)
+{
+	const arm64_Value* value = &ctx->values[value_id];
+	char offset_s[32];
+	if (value->reg >= 0) {
+		if (!is_signed || value->size == 8) {
+			*reg_id = value->reg;
+			return 0;
+		}
+		*reg_id = scratch;
+		return fprintf(ctx->dst, "\tsxt%c\tx%hhu, w%hhd\n", value->size == 1 ? 'b' : value->size == 2 ? 'h' : 'w', scratch, value->reg);
+	}
+	*reg_id = scratch;
+	return getStackAddr_arm64(ctx, sp, offset, scratch, NULL, getAddrRule_arm64(value->size), sizeof(offset_s), offset_s)
+		+ fprintf(ctx->dst, "\tldr%s%hhu, %s\n", (is_signed ? arm64_signed_load_postfix : arm64_op_postfix)[value->size], scratch, offset_s);
+}
+
+// puts the result of an operation from register `reg_id` where value `value_id` is kept, truncating it to the size of the value
+static long storeValue_arm64(arm64_CodegenCtx* ctx, const char* sp, uint32_t value_id, uptr offset, u8 reg_id)
+{
+	const arm64_Value* value = &ctx->values[value_id];
+	char offset_s[32];
+	if (value->reg < 0)
+		return getStackAddr_arm64(ctx, sp, offset, 13, NULL, getAddrRule_arm64(value->size), sizeof(offset_s), offset_s)
+			+ fprintf(ctx->dst, "\tstr%s%hhu, %s\n", arm64_op_postfix[value->size], reg_id, offset_s);
+	if (value->size == 1) return fprintf(ctx->dst, "\tand\tx%hhd, x%hhu, 0xff\n", value->reg, reg_id);
+	if (value->size == 2) return fprintf(ctx->dst, "\tand\tx%hhd, x%hhu, 0xffff\n", value->reg, reg_id);
+	if (value->size == 4) return fprintf(ctx->dst, "\tmov\tw%hhd, w%hhu\n", value->reg, reg_id);
+	return value->reg == reg_id ? 0 : fprintf(ctx->dst, "\tmov\tx%hhd, x%hhu\n", value->reg, reg_id);
+}
+
+// whether the arithmetic operation `base_op` sign-extends its operands
+static bool isArithOpSigned_arm64(BR_OpType base_op)
+{
+	return base_op == BR_OP_DIVS || base_op == BR_OP_MODS || base_op == BR_OP_SHRS;
+}
+
+// emits `res_reg = a <base_op> b` for operands of `size` bytes, where `b` is a register or an immediate value allowed by `getImmOperandRule_arm64(base_op)`;
+// as on x86-64, the operands narrower than 64 bits are shifted as 32-bit values, and the rest of the operations are done in 64 bits
+static long compileArith_arm64(FILE* dst, BR_OpType base_op, uint32_t size, u8 res_reg, u8 a, const char* b)
+{
+	static const char* mnemonics[] = {
+		[BR_OP_ADD]  = "add",
+		[BR_OP_SUB]  = "sub",
+		[BR_OP_MUL]  = "mul",
+		[BR_OP_DIV]  = "udiv",
+		[BR_OP_DIVS] = "sdiv",
+		[BR_OP_MOD]  = "udiv",
+		[BR_OP_MODS] = "sdiv",
+		[BR_OP_AND]  = "and",
+		[BR_OP_OR]   = "orr",
+		[BR_OP_XOR]  = "eor",
+		[BR_OP_SHL]  = "lsl",
+		[BR_OP_SHR]  = "lsr",
+		[BR_OP_SHRS] = "asr"
 	};
+	if (base_op == BR_OP_NOT)
+		return fprintf(dst, "\tmvn\tx%hhu, x%hhu\n", res_reg, a);
+	if (base_op == BR_OP_MOD || base_op == BR_OP_MODS)
+		return fprintf(dst,
+			"\t%s\tx14, x%hhu, %s\n"
+			"\tmsub\tx%hhu, x14, %s, x%hhu\n",
+			mnemonics[base_op], a, b,
+			res_reg, b, a);
+	if (size < 8 && (base_op == BR_OP_SHL || base_op == BR_OP_SHR || base_op == BR_OP_SHRS))
+		return fprintf(dst, "\t%s\tw%hhu, w%hhu, %s%s\n", mnemonics[base_op], res_reg, a, b[0] == 'x' ? "w" : "", b[0] == 'x' ? &b[1] : b);
+	return fprintf(dst, "\t%s\tx%hhu, x%hhu, %s\n", mnemonics[base_op], res_reg, a, b);
+}
+
+// whether any of the values operation `op_id` reads or creates is in a register
+static bool usesRegs_arm64(const arm64_CodegenCtx* ctx, uint32_t op_id)
+{
+	const arm64_OpValues* op_values = &ctx->op_values[op_id];
+	if (op_values->res != ARM64_NO_VALUE && ctx->values[op_values->res].reg >= 0) return true;
+	for (uint8_t i = 0; i < 3; ++i) {
+		if (op_values->args[i] != ARM64_NO_VALUE && ctx->values[op_values->args[i]].reg >= 0) return true;
+	}
+	return false;
+}
+
+// compiles an arithmetic operation, or an operation of which at least one operand or the result is in a register
+static long compileRegOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_t op_id, size_t vframe_offset, size_t vframe_offset_before)
+{
+	FILE* const dst = ctx->dst;
+	const BR_Op* op = BR_getOp(&ctx->builder.module, proc_id, op_id);
+	const char* sp = proc_id < 0 ? "x12" : "sp";
+	const arm64_OpValues* op_values = &ctx->op_values[op_id];
+	const arm64_Value* res = op_values->res == ARM64_NO_VALUE ? NULL : &ctx->values[op_values->res];
+// the result is computed right in its register, or in x9 before being stored in the stack frame
+	const u8 res_reg = res && res->reg >= 0 ? res->reg : 9;
+// the results that are never read are not computed, unless computing them has side effects
+	const bool is_dead = res && res->reg >= 0 && res->last_use == res->def;
+	char offset_s[32], value_s[32];
+	u8 a, b;
+	long acc = 0;
+	if (op->type >= BR_OP_ADD && op->type <= BR_OP_NOTAT64) {
+		const BR_OpType base_op = op->type >= BR_OP_NOT ? BR_OP_NOT : BR_OP_ADD + (op->type - BR_OP_ADD) / ARM64_ARITH_STRIDE * ARM64_ARITH_STRIDE;
+		const bool is_signed = isArithOpSigned_arm64(base_op);
+		if (op->type == base_op && base_op != BR_OP_NOT) {
+// [A, B] -> [A OP B], where A is on top of the stack
+			if (is_dead) return 0;
+			acc += loadValue_arm64(ctx, sp, op_values->args[0], vframe_offset_before, 9, is_signed, &a)
+				+ loadValue_arm64(ctx, sp, op_values->args[1], vframe_offset_before + ctx->values[op_values->args[0]].size, 10, is_signed, &b);
+			snprintf(value_s, sizeof(value_s), "x%hhu", b);
+			return acc
+				+ compileArith_arm64(dst, base_op, res->size, res_reg, a, value_s)
+				+ storeValue_arm64(ctx, sp, op_values->res, vframe_offset, res_reg);
+		}
+// the amount of a shift is taken modulo the width of the shifted value, like it's done by the shift instructions with a register operand
+		const uint64_t operand = base_op == BR_OP_SHL || base_op == BR_OP_SHR || base_op == BR_OP_SHRS
+			? op->operand_u & (res->size == 8 ? 63 : 31)
+			: op->operand_u;
+		if (BR_GET_ADDR_OP_TYPE(op->type) == 0) {
+// [A] -> [A OP <n>] or [A] -> [OP A]
+			if (is_dead) return 0;
+			return acc
+				+ loadValue_arm64(ctx, sp, op_values->args[0], vframe_offset_before, 11, is_signed, &a)
+				+ compileIntLiteral_arm64(dst, operand, 10, getImmOperandRule_arm64(base_op), sizeof(value_s), value_s)
+				+ compileArith_arm64(dst, base_op, res->size, res_reg, a, value_s)
+				+ storeValue_arm64(ctx, sp, op_values->res, vframe_offset, res_reg);
+		}
+// [A:ptr] -> [*A OP= <n>] or [A:ptr] -> [*A = OP *A]
+		return acc
+			+ loadValue_arm64(ctx, sp, op_values->args[0], vframe_offset_before, 11, false, &a)
+			+ fprintf(dst, "\tldr%s8, [x%hhu]\n", (is_signed ? arm64_signed_load_postfix : arm64_op_postfix)[res->size], a)
+			+ compileIntLiteral_arm64(dst, operand, 10, getImmOperandRule_arm64(base_op), sizeof(value_s), value_s)
+			+ compileArith_arm64(dst, base_op, res->size, 8, 8, value_s)
+			+ fprintf(dst, "\tstr%s8, [x%hhu]\n", arm64_op_postfix[res->size], a)
+			+ (is_dead ? 0 : storeValue_arm64(ctx, sp, op_values->res, vframe_offset, 8));
+	}
+	if (is_dead && op->type != BR_OP_SYS) return 0;
+	switch ((uint16_t)op->type) {
+		case BR_OP_I8:
+		case BR_OP_I16:
+		case BR_OP_I32:
+		case BR_OP_PTR:
+		case BR_OP_I64:
+		case BR_OP_BUILTIN: {
+// the value is truncated beforehand, since the registers hold the values zero-extended
+			int64_t value = op->type == BR_OP_BUILTIN ? BR_builtinValues[op->operand_u] : op->operand_s;
+			if (res->size < 8) value &= (1ULL << res->size * 8) - 1;
+			return compileIntLiteral_arm64(dst, value, res_reg, ARM64_REGONLY_RULE, sizeof(value_s), value_s)
+				+ (value ? 0 : fprintf(dst, "\tmov\tx%hhu, xzr\n", res_reg));
+		}
+		case BR_OP_ZERO:
+			return fprintf(dst, "\tmov\tx%hhu, xzr\n", res_reg);
+		case BR_OP_ADDR:
+			return compileIntLiteral_arm64(dst, vframe_offset + BR_getStackItemRTOffset(&ctx->builder, proc_id, op_id, op->operand_u), res_reg,
+					ARM64_ADDSUB_RULE, sizeof(offset_s), offset_s)
+				+ fprintf(dst, "\tadd\tx%hhu, %s, %s\n", res_reg, sp, offset_s);
+		case BR_OP_DBADDR:
+			return fprintf(dst, "\tadrp\tx%hhu, ", res_reg)
+				+ printLabel(dst, ctx->builder.module.seg_data.data[~op->operand_s].name, "_")
+				+ fprintf(dst, "@PAGE\n\tadd\tx%hhu, x%hhu, ", res_reg, res_reg)
+				+ printLabel(dst, ctx->builder.module.seg_data.data[~op->operand_s].name, "_")
+				+ str_fput(dst, "@PAGEOFF\n");
+		case BR_OP_GET:
+			acc += loadValue_arm64(ctx, sp, op_values->args[0],
+				vframe_offset_before + BR_getStackItemRTOffset(&ctx->builder, proc_id, op_id - 1, op->operand_u), res_reg, false, &a);
+			if (res->reg < 0)
+				return acc + storeValue_arm64(ctx, sp, op_values->res, vframe_offset, a);
+			return acc + (a == res_reg ? 0 : fprintf(dst, "\tmov\tx%hhu, x%hhu\n", res_reg, a));
+		case BR_OP_SYS: {
+			static const char* sys_to_proc_name[] = {
+				[BR_SYS_EXIT] = "_exit",
+				[BR_SYS_WRITE] = "_write",
+				[BR_SYS_READ] = "_read"
+			};
+			size_t arg_offset = vframe_offset_before;
+			for (uint8_t i = 0; i < BR_syscallNArgs[op->operand_u]; ++i) {
+				const arm64_Value* arg = &ctx->values[op_values->args[i]];
+				acc += arg->reg >= 0
+					? fprintf(dst, "\tmov\tx%hhu, x%hhd\n", i, arg->reg)
+					: getStackAddr_arm64(ctx, sp, arg_offset, 8, NULL, getAddrRule_arm64(arg->size), sizeof(offset_s), offset_s)
+						+ fprintf(dst, "\tldr%s%hhu, %s\n", arm64_op_postfix[arg->size], i, offset_s);
+				arg_offset += arg->size;
+			}
+			return acc
+				+ fprintf(dst, "\tbl\t%s\n", sys_to_proc_name[op->operand_u])
+				+ (res && !is_dead ? storeValue_arm64(ctx, sp, op_values->res, vframe_offset, 0) : 0);
+		}
+		case BR_OP_NEW:
+			return 0;
+		case BR_OP_NOP:
+		case BR_OP_END:
+		case BR_OP_DROP:
+		case BR_OP_SETAT:
+		case BR_OP_GETFROM:
+		case BR_OP_COPY:
+		case BR_N_OPS:
+		default:
+			assert(false, "operation %u is not compiled with registers", op->type);
+	}
+}
+
+static long compileOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_t op_id, size_t vframe_offset, size_t vframe_offset_before, FILE* dst)
+{
 	long acc = 0;
 	const BR_Op* op = BR_getOp(&ctx->builder.module, proc_id, op_id);
+	if ((op->type >= BR_OP_ADD && op->type <= BR_OP_NOTAT64) || usesRegs_arm64(ctx, op_id))
+		return compileRegOp_darwin_arm64(ctx, proc_id, op_id, vframe_offset, vframe_offset_before);
 	const char *sp = proc_id < 0 ? "x12" : "sp";
 	char offset_s[32], value_s[32];
-	switch (op->type) {
+	switch ((uint16_t)op->type) {
 		case BR_OP_NOP:
 			return acc + str_fput(dst, "\tnop\n");
 		case BR_OP_END:
@@ -246,7 +803,7 @@ static long compileOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_
 			};
 			return compileIntLiteral_arm64(ctx->dst, op->operand_s, 8, ARM64_REGONLY_RULE, sizeof(value_s), value_s)
 				+ getStackAddr_arm64(ctx, sp, vframe_offset, 9, NULL, rules[op->type], sizeof(offset_s), offset_s)
-				+ fprintf(ctx->dst, "\tstr%s%s, %s\n", suffixes[op->type], &value_s[1], offset_s);
+				+ fprintf(ctx->dst, "\tstr%s%s, %s\n", suffixes[op->type], value_s[0] == 'x' ? &value_s[1] : "zr", offset_s);
 		}
 		case BR_OP_ADDR: {
 			ssize_t offset = BR_getStackItemRTOffset(&ctx->builder, proc_id, op_id, op->operand_u);
@@ -284,277 +841,7 @@ static long compileOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_
 			return acc
 				+ compileIntLiteral_arm64(dst, BR_builtinValues[op->operand_u], 8, ARM64_REGONLY_RULE, sizeof(value_s), value_s)
 				+ getStackAddr_arm64(ctx, sp, vframe_offset, 9, NULL, AOR_LDR64, sizeof(offset_s), offset_s)
-				+ fprintf(dst, "\tstr\t%s, %s\n", value_s, offset_s);
-		case BR_OP_ADD:
-		case BR_OP_SUB:
-		case BR_OP_MUL:
-		case BR_OP_DIV:
-		case BR_OP_DIVS:
-		case BR_OP_MOD:
-		case BR_OP_MODS:
-		case BR_OP_AND:
-		case BR_OP_OR:
-		case BR_OP_XOR:
-		case BR_OP_SHL:
-		case BR_OP_SHR:
-		case BR_OP_SHRS: {
-			static const sbuf native_op[] = {
-				[BR_OP_ADD]  = sbuf_fromcstr("\tadd\tx9, x9, x10\n"),
-				[BR_OP_SUB]  = sbuf_fromcstr("\tsub\tx9, x9, x10\n"),
-				[BR_OP_MUL]  = sbuf_fromcstr("\tmul\tx9, x9, x10\n"),
-				[BR_OP_DIV]  = sbuf_fromcstr("\tudiv\tx9, x9, x10\n"),
-				[BR_OP_DIVS] = sbuf_fromcstr("\tsdiv\tx9, x9, x10\n"),
-				[BR_OP_MOD]  = sbuf_fromcstr("\tudiv\tx11, x9, x10\n"
-							 "\tmsub\tx9, x11, x10, x9\n"),
-				[BR_OP_MODS] = sbuf_fromcstr("\tsdiv\tx11, x9, x10\n"
-							 "\tmsub\tx9, x11, x10, x9\n"),
-				[BR_OP_AND]  = sbuf_fromcstr("\tand\tx9, x9, x10\n"),
-				[BR_OP_OR]   = sbuf_fromcstr("\torr\tx9, x9, x10\n"),
-				[BR_OP_XOR]  = sbuf_fromcstr("\teor\tx9, x9, x10\n"),
-				[BR_OP_SHL]  = sbuf_fromcstr("\tlsl\tx9, x9, x10\n"),
-				[BR_OP_SHR]  = sbuf_fromcstr("\tlsr\tx9, x9, x10\n"),
-				[BR_OP_SHRS] = sbuf_fromcstr("\tasr\tx9, x9, x10\n")
-			};
-			arm64_RegCtx reg_ctx = {0};
-			size_t  main_op_size = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id - 1, 0),
-			        op2_size     = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id - 1, 1);
-			if (main_op_size == op2_size) {
-				char reg_type = op2_size == 8 ? 'x' : 'w';
-				arm64_AddrOffsetRule rule = op2_size == 4 ? AOR_LDP32 : AOR_LDP64;
-				return acc
-					+ getStackAddr_arm64(ctx, sp, vframe_offset_before, 8, &reg_ctx, rule, sizeof(offset_s), offset_s)
-					+ fprintf(ctx->dst, "\tldp%s9, %c10, %s\n", op_postfix[main_op_size], reg_type, offset_s)
-					+ sbuf_fput(dst, native_op[op->type])
-					+ getStackAddr_arm64(ctx, sp, vframe_offset, 8, &reg_ctx, rule, sizeof(offset_s), offset_s)
-					+ fprintf(ctx->dst, "\tstr\t%c9, %s\n", reg_type, offset_s);
-			}
-			return acc
-				+ getStackAddr_arm64(ctx, sp, vframe_offset_before, 8, &reg_ctx, addr_rules[main_op_size], sizeof(offset_s), offset_s)
-				+ fprintf(ctx->dst, "\tldr%s9, %s\n", op_postfix[main_op_size], offset_s)
-				+ getStackAddr_arm64(ctx, sp, vframe_offset_before + main_op_size, 8, &reg_ctx, addr_rules[op2_size], sizeof(offset_s), offset_s)
-				+ fprintf(ctx->dst, "\tldr%s10, %s\n", op_postfix[op2_size], offset_s)
-				+ sbuf_fput(ctx->dst, native_op[op->type])
-				+ getStackAddr_arm64(ctx, sp, vframe_offset, 8, &reg_ctx, addr_rules[main_op_size], sizeof(offset_s), offset_s)
-				+ fprintf(ctx->dst, "\tstr%s9, %s\n", op_postfix[main_op_size], offset_s);
-		}
-		case BR_OP_ADDI:
-		case BR_OP_SUBI:
-		case BR_OP_MULI:
-		case BR_OP_DIVI:
-		case BR_OP_DIVSI:
-		case BR_OP_MODI:
-		case BR_OP_MODSI:
-		case BR_OP_ANDI:
-		case BR_OP_ORI:
-		case BR_OP_XORI:
-		case BR_OP_SHLI:
-		case BR_OP_SHRI:
-		case BR_OP_SHRSI:
-		case BR_OP_NOT:
-		case BR_OP_ADDIAT8:
-		case BR_OP_ADDIAT16:
-		case BR_OP_ADDIAT32:
-		case BR_OP_ADDIATP:
-		case BR_OP_ADDIAT64:
-		case BR_OP_SUBIAT8:
-		case BR_OP_SUBIAT16:
-		case BR_OP_SUBIAT32:
-		case BR_OP_SUBIATP:
-		case BR_OP_SUBIAT64:
-		case BR_OP_MULIAT8:
-		case BR_OP_MULIAT16:
-		case BR_OP_MULIAT32:
-		case BR_OP_MULIATP:
-		case BR_OP_MULIAT64:
-		case BR_OP_DIVIAT8:
-		case BR_OP_DIVIAT16:
-		case BR_OP_DIVIAT32:
-		case BR_OP_DIVIATP:
-		case BR_OP_DIVIAT64:
-		case BR_OP_DIVSIAT8:
-		case BR_OP_DIVSIAT16:
-		case BR_OP_DIVSIAT32:
-		case BR_OP_DIVSIATP:
-		case BR_OP_DIVSIAT64:
-		case BR_OP_MODIAT8:
-		case BR_OP_MODIAT16:
-		case BR_OP_MODIAT32:
-		case BR_OP_MODIATP:
-		case BR_OP_MODIAT64:
-		case BR_OP_MODSIAT8:
-		case BR_OP_MODSIAT16:
-		case BR_OP_MODSIAT32:
-		case BR_OP_MODSIATP:
-		case BR_OP_MODSIAT64:
-		case BR_OP_ANDIAT8:
-		case BR_OP_ANDIAT16:
-		case BR_OP_ANDIAT32:
-		case BR_OP_ANDIATP:
-		case BR_OP_ANDIAT64:
-		case BR_OP_ORIAT8:
-		case BR_OP_ORIAT16:
-		case BR_OP_ORIAT32:
-		case BR_OP_ORIATP:
-		case BR_OP_ORIAT64:
-		case BR_OP_XORIAT8:
-		case BR_OP_XORIAT16:
-		case BR_OP_XORIAT32:
-		case BR_OP_XORIATP:
-		case BR_OP_XORIAT64:
-		case BR_OP_SHLIAT8:
-		case BR_OP_SHLIAT16:
-		case BR_OP_SHLIAT32:
-		case BR_OP_SHLIATP:
-		case BR_OP_SHLIAT64:
-		case BR_OP_SHRIAT8:
-		case BR_OP_SHRIAT16:
-		case BR_OP_SHRIAT32:
-		case BR_OP_SHRIATP:
-		case BR_OP_SHRIAT64:
-		case BR_OP_SHRSIAT8:
-		case BR_OP_SHRSIAT16:
-		case BR_OP_SHRSIAT32:
-		case BR_OP_SHRSIATP:
-		case BR_OP_SHRSIAT64:
-		case BR_OP_NOTAT8:
-		case BR_OP_NOTAT16:
-		case BR_OP_NOTAT32:
-		case BR_OP_NOTATP:
-		case BR_OP_NOTAT64: {
-			static const BR_OpType base_op[] = {
-				[BR_OP_ADDI]      = BR_OP_ADD,
-				[BR_OP_SUBI]      = BR_OP_SUB,
-				[BR_OP_MULI]      = BR_OP_MUL,
-				[BR_OP_DIVI]      = BR_OP_DIV,
-				[BR_OP_DIVSI]     = BR_OP_DIVS,
-				[BR_OP_MODI]      = BR_OP_MOD,
-				[BR_OP_MODSI]     = BR_OP_MODS,
-				[BR_OP_ANDI]      = BR_OP_AND,
-				[BR_OP_ORI]       = BR_OP_OR,
-				[BR_OP_XORI]      = BR_OP_XOR,
-				[BR_OP_SHLI]      = BR_OP_SHL,
-				[BR_OP_SHRI]      = BR_OP_SHR,
-				[BR_OP_SHRSI]     = BR_OP_SHRS,
-				[BR_OP_NOT]       = BR_OP_NOT,
-				[BR_OP_ADDIAT8]   = BR_OP_ADD,
-				[BR_OP_ADDIAT16]  = BR_OP_ADD,
-				[BR_OP_ADDIAT32]  = BR_OP_ADD,
-				[BR_OP_ADDIATP]   = BR_OP_ADD,
-				[BR_OP_ADDIAT64]  = BR_OP_ADD,
-				[BR_OP_SUBIAT8]   = BR_OP_SUB,
-				[BR_OP_SUBIAT16]  = BR_OP_SUB,
-				[BR_OP_SUBIAT32]  = BR_OP_SUB,
-				[BR_OP_SUBIATP]   = BR_OP_SUB,
-				[BR_OP_SUBIAT64]  = BR_OP_SUB,
-				[BR_OP_MULIAT8]   = BR_OP_MUL,
-				[BR_OP_MULIAT16]  = BR_OP_MUL,
-				[BR_OP_MULIAT32]  = BR_OP_MUL,
-				[BR_OP_MULIATP]   = BR_OP_MUL,
-				[BR_OP_MULIAT64]  = BR_OP_MUL,
-				[BR_OP_DIVIAT8]   = BR_OP_DIV,
-				[BR_OP_DIVIAT16]  = BR_OP_DIV,
-				[BR_OP_DIVIAT32]  = BR_OP_DIV,
-				[BR_OP_DIVIATP]   = BR_OP_DIV,
-				[BR_OP_DIVIAT64]  = BR_OP_DIV,
-				[BR_OP_DIVSIAT8]  = BR_OP_DIVS,
-				[BR_OP_DIVSIAT16] = BR_OP_DIVS,
-				[BR_OP_DIVSIAT32] = BR_OP_DIVS,
-				[BR_OP_DIVSIATP]  = BR_OP_DIVS,
-				[BR_OP_DIVSIAT64] = BR_OP_DIVS,
-				[BR_OP_MODIAT8]   = BR_OP_MOD,
-				[BR_OP_MODIAT16]  = BR_OP_MOD,
-				[BR_OP_MODIAT32]  = BR_OP_MOD,
-				[BR_OP_MODIATP]   = BR_OP_MOD,
-				[BR_OP_MODIAT64]  = BR_OP_MOD,
-				[BR_OP_MODSIAT8]  = BR_OP_MODS,
-				[BR_OP_MODSIAT16] = BR_OP_MODS,
-				[BR_OP_MODSIAT32] = BR_OP_MODS,
-				[BR_OP_MODSIATP]  = BR_OP_MODS,
-				[BR_OP_MODSIAT64] = BR_OP_MODS,
-				[BR_OP_ANDIAT8]   = BR_OP_AND,
-				[BR_OP_ANDIAT16]  = BR_OP_AND,
-				[BR_OP_ANDIAT32]  = BR_OP_AND,
-				[BR_OP_ANDIATP]   = BR_OP_AND,
-				[BR_OP_ANDIAT64]  = BR_OP_AND,
-				[BR_OP_ORIAT8]    = BR_OP_OR,
-				[BR_OP_ORIAT16]   = BR_OP_OR,
-				[BR_OP_ORIAT32]   = BR_OP_OR,
-				[BR_OP_ORIATP]    = BR_OP_OR,
-				[BR_OP_ORIAT64]   = BR_OP_OR,
-				[BR_OP_XORIAT8]   = BR_OP_XOR,
-				[BR_OP_XORIAT16]  = BR_OP_XOR,
-				[BR_OP_XORIAT32]  = BR_OP_XOR,
-				[BR_OP_XORIATP]   = BR_OP_XOR,
-				[BR_OP_XORIAT64]  = BR_OP_XOR,
-				[BR_OP_SHLIAT8]   = BR_OP_SHL,
-				[BR_OP_SHLIAT16]  = BR_OP_SHL,
-				[BR_OP_SHLIAT32]  = BR_OP_SHL,
-				[BR_OP_SHLIATP]   = BR_OP_SHL,
-				[BR_OP_SHLIAT64]  = BR_OP_SHL,
-				[BR_OP_SHRIAT8]   = BR_OP_SHR,
-				[BR_OP_SHRIAT16]  = BR_OP_SHR,
-				[BR_OP_SHRIAT32]  = BR_OP_SHR,
-				[BR_OP_SHRIATP]   = BR_OP_SHR,
-				[BR_OP_SHRIAT64]  = BR_OP_SHR,
-				[BR_OP_SHRSIAT8]  = BR_OP_SHRS,
-				[BR_OP_SHRSIAT16] = BR_OP_SHRS,
-				[BR_OP_SHRSIAT32] = BR_OP_SHRS,
-				[BR_OP_SHRSIATP]  = BR_OP_SHRS,
-				[BR_OP_SHRSIAT64] = BR_OP_SHRS,
-				[BR_OP_NOTAT8]    = BR_OP_NOT,
-				[BR_OP_NOTAT16]   = BR_OP_NOT,
-				[BR_OP_NOTAT32]   = BR_OP_NOT,
-				[BR_OP_NOTATP]    = BR_OP_NOT,
-				[BR_OP_NOTAT64]   = BR_OP_NOT
-			};
-			static const char* native_op[] = {
-				[BR_OP_ADD]  = "\tadd\tx8, x8, %s\n",
-				[BR_OP_SUB]  = "\tsub\tx8, x8, %s\n",
-				[BR_OP_MUL]  = "\tmul\tx8, x8, %s\n",
-				[BR_OP_DIV]  = "\tudiv\tx8, x8, %s\n",
-				[BR_OP_DIVS] = "\tsdiv\tx8, x8, %s\n",
-				[BR_OP_MOD]  = "\tudiv\tx14, x8, %s\n"
-						"\tmsub\tx8, x14, x10, x8\n",
-				[BR_OP_MODS] = "\tsdiv\tx14, x8, %s\n"
-						"\tmsub\tx8, x14, x10, x8\n",
-				[BR_OP_AND]  = "\tand\tx8, x8, %s\n",
-				[BR_OP_OR]   = "\torr\tx8, x8, %s\n",
-				[BR_OP_XOR]  = "\teor\tx8, x8, %s\n",
-				[BR_OP_SHL]  = "\tlsl\tx8, x8, %s\n",
-				[BR_OP_SHR]  = "\tlsr\tx8, x8, %s\n",
-				[BR_OP_SHRS] = "\tasr\tx8, x8, %s\n",
-				[BR_OP_NOT]  = "\tmvn\tx8, x8%s\n"
-			};
-			static const arm64_ImmValueRule op2_placement[] = {
-				[BR_OP_ADD]  = ARM64_ADDSUB_RULE,
-				[BR_OP_SUB]  = ARM64_ADDSUB_RULE,
-				[BR_OP_MUL]  = ARM64_REGONLY_RULE,
-				[BR_OP_DIV]  = ARM64_REGONLY_RULE,
-				[BR_OP_DIVS] = ARM64_REGONLY_RULE,
-				[BR_OP_MOD]  = ARM64_REGONLY_RULE,
-				[BR_OP_MODS] = ARM64_REGONLY_RULE,
-				[BR_OP_AND]  = ARM64_REGONLY_RULE,
-				[BR_OP_OR]   = ARM64_REGONLY_RULE,
-				[BR_OP_XOR]  = ARM64_REGONLY_RULE,
-				[BR_OP_SHL]  = ARM64_ADDSUB_RULE,
-				[BR_OP_SHR]  = ARM64_ADDSUB_RULE,
-				[BR_OP_SHRS] = ARM64_ADDSUB_RULE,
-				[BR_OP_NOT]  = ARM64_NOVALUE_RULE
-			};
-			arm64_RegCtx reg_ctx = {0};
-			size_t op_size = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0);
-			return acc
-				+ getStackAddr_arm64(ctx, sp, vframe_offset_before, 9, &reg_ctx, addr_rules[op_size], sizeof(offset_s), offset_s)
-				+ (BR_GET_ADDR_OP_TYPE(op->type) == 0 ? 0
-					: fprintf(ctx->dst, "\tldr\tx11, %s\n", offset_s))
-				+ fprintf(ctx->dst, "\tldr%s8, %s\n", op_postfix[op_size], BR_GET_ADDR_OP_TYPE(op->type) == 0 ? offset_s : "[x11]")
-				+ compileIntLiteral_arm64(dst, op->operand_u, 10, op2_placement[base_op[op->type]], sizeof(value_s), value_s)
-				+ fprintf(ctx->dst, native_op[base_op[op->type]], value_s)
-				+ (BR_GET_ADDR_OP_TYPE(op->type) == 0 ? 0
-					: fprintf(ctx->dst, "\tstr%s8, [x11]\n", op_postfix[op_size]))
-				+ getStackAddr_arm64(ctx, sp, vframe_offset, 9, (reg_ctx.last_use = true, &reg_ctx), addr_rules[op_size], sizeof(offset_s), offset_s)
-				+ fprintf(ctx->dst, "\tstr%s8, %s\n", op_postfix[op_size], offset_s);
-		}
+				+ fprintf(dst, "\tstr\t%s, %s\n", value_s[0] == 'x' ? value_s : "xzr", offset_s);
 		case BR_OP_DROP:
 		case BR_OP_NEW:
 			return acc;
@@ -609,7 +896,9 @@ static long compileOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_
 				[BR_OP_GETFROM] = false,
 				[BR_OP_COPY]    = false
 			};
-			size_t  span = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0),
+			size_t  span = op->type == BR_OP_COPY
+					? BR_getTypeRTSize(&ctx->builder.module, op->operand_type)
+					: BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0),
 				orig_span = span;
 			arm64_RegCtx reg_ctx = {0};
 			uint8_t n_regs = 0;
@@ -683,35 +972,35 @@ static long compileOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_
 			while (span >= 32) {
 				uint8_t reg1 = n_regs++;
 				acc += output_to_stack[op->type]
-					? getStackAddr_arm64(ctx, sp, vframe_offset_before + (orig_span - span), 8, &reg_ctx, AOR_LDP128, sizeof(offset_s), offset_s)
+					? getStackAddr_arm64(ctx, sp, vframe_offset + (orig_span - span), 8, &reg_ctx, AOR_LDP128, sizeof(offset_s), offset_s)
 						+ fprintf(ctx->dst, "\tstp\tq%u, q%u, %s\n", reg1, n_regs++, offset_s)
 					: fprintf(ctx->dst, "\tstp\tq%u, q%u, [x8], 32\n", reg1, n_regs++);
 				span -= 32;
 			}
 			if (span >= 16) {
 				acc += output_to_stack[op->type]
-					? getStackAddr_arm64(ctx, sp, vframe_offset_before + (orig_span - span), 8, &reg_ctx, AOR_LDR128, sizeof(offset_s), offset_s)
+					? getStackAddr_arm64(ctx, sp, vframe_offset + (orig_span - span), 8, &reg_ctx, AOR_LDR128, sizeof(offset_s), offset_s)
 						+ fprintf(ctx->dst, "\tstr\tq%u, %s\n", n_regs++, offset_s)
 					: fprintf(ctx->dst, "\tstr\tq%u, [x8], 16\n", n_regs++);
 				span -= 16;
 			}
 			if (span >= 8) {
 				acc += output_to_stack[op->type]
-					? getStackAddr_arm64(ctx, sp, vframe_offset_before + (orig_span - span), 8, &reg_ctx, AOR_LDR64, sizeof(offset_s), offset_s)
+					? getStackAddr_arm64(ctx, sp, vframe_offset + (orig_span - span), 8, &reg_ctx, AOR_LDR64, sizeof(offset_s), offset_s)
 						+ fprintf(ctx->dst, "\tstr\td%u, %s\n", n_regs++, offset_s)
 					: fprintf(ctx->dst, "\tstr\td%u, [x8], 8\n", n_regs++);
 				span -= 8;
 			}
 			if (span >= 4) {
 				acc += output_to_stack[op->type]
-					? getStackAddr_arm64(ctx, sp, vframe_offset_before + (orig_span - span), 8, &reg_ctx, AOR_LDR32, sizeof(offset_s), offset_s)
+					? getStackAddr_arm64(ctx, sp, vframe_offset + (orig_span - span), 8, &reg_ctx, AOR_LDR32, sizeof(offset_s), offset_s)
 						+ fprintf(ctx->dst, "\tstr\tw9, %s\n", offset_s)
 					: fprintf(ctx->dst, "\tstr\tw9, [x8], 4\n");
 				span -= 4;
 			}
 			if (span >= 2) {
 				acc += output_to_stack[op->type]
-					? getStackAddr_arm64(ctx, sp, vframe_offset_before + (orig_span - span), 8, &reg_ctx, AOR_LDR16, sizeof(offset_s), offset_s)
+					? getStackAddr_arm64(ctx, sp, vframe_offset + (orig_span - span), 8, &reg_ctx, AOR_LDR16, sizeof(offset_s), offset_s)
 						+ fprintf(ctx->dst, "\tstrh\tw10, %s\n", offset_s)
 					: fprintf(ctx->dst, "\tstrh\tw10, [x8], 2\n");
 				span -= 2;
@@ -719,12 +1008,12 @@ static long compileOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_
 			reg_ctx.last_use = true;
 			if (span) 
 				acc += output_to_stack[op->type]
-					? getStackAddr_arm64(ctx, sp, vframe_offset_before + (orig_span - span), 8, &reg_ctx, AOR_LDR8, sizeof(offset_s), offset_s)
+					? getStackAddr_arm64(ctx, sp, vframe_offset + (orig_span - span), 8, &reg_ctx, AOR_LDR8, sizeof(offset_s), offset_s)
 						+ fprintf(ctx->dst, "\tstrb\tw11, %s\n", offset_s)
 					: fprintf(ctx->dst, "\tstrb\tw11, [x8]\n");
 			if (op->type == BR_OP_COPY)
 				acc += getStackAddr_arm64(ctx, sp, vframe_offset, 8, NULL, AOR_LDR64, sizeof(offset_s), offset_s)
-					+ fprintf(ctx->dst, "\tldr\tx14, %s\n", offset_s);
+					+ fprintf(ctx->dst, "\tstr\tx14, %s\n", offset_s);
 			return acc;
 		}
 		case BR_N_OPS:
@@ -733,6 +1022,188 @@ static long compileOp_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_
 	}
 }
 
+// the numbering of the arm64 registers for the peephole optimizer: x0-x30 are 0-30, the zero register is 31, and v0-v31 are 32-63;
+// returns -1 if `op` is not one of them, otherwise sets `size` to the number of bytes of the register accessed by the operand
+static int parseReg_arm64(const char* op, size_t len, u8* size)
+{
+	if (len == 3 && (!memcmp(op, "xzr", 3) || !memcmp(op, "wzr", 3))) {
+		*size = op[0] == 'x' ? 8 : 4;
+		return 31;
+	}
+	u8 base = 0;
+	switch (op[0]) {
+		case 'x': *size = 8; break;
+		case 'w': *size = 4; break;
+		case 'q':
+		case 'v': *size = 16; base = 32; break;
+		case 'd': *size = 8; base = 32; break;
+		case 's': *size = 4; base = 32; break;
+		default: return -1;
+	}
+	unsigned n = 0;
+	size_t i = 1;
+	for (; i < len && op[i] >= '0' && op[i] <= '9'; ++i) {
+		n = n * 10 + op[i] - '0';
+	}
+	if (i == 1 || n > (base ? 31 : 30) || (i < len && (op[0] != 'v' || op[i] != '.'))) return -1;
+	return base + n;
+}
+
+// describes a line of the arm64 assembly for the peephole optimizer;
+// `frame` is the register relative to which the stack items are addressed, and every other memory access is a barrier
+static mi_Instr describeLine_arm64(const char* line, size_t len, const char* frame)
+{
+	static const struct {
+		const char* mnemonic;
+		u8 size; // 0 if it's the size of the register
+		bool is_store;
+		bool is_signed;
+	} accesses[] = {
+		{"ldr",   0, false, false},
+		{"ldrb",  1, false, false},
+		{"ldrh",  2, false, false},
+		{"ldrsb", 1, false, true},
+		{"ldrsh", 2, false, true},
+		{"ldrsw", 4, false, true},
+		{"str",   0, true,  false},
+		{"strb",  1, true,  false},
+		{"strh",  2, true,  false}
+	};
+	static const mi_Instr barrier = {.type = MI_BARRIER};
+	const char* const end = line + len;
+	if (len < 2 || line[0] != '\t') return barrier;
+	const char* op1 = memchr(line + 1, '\t', len - 1);
+	if (!op1) return barrier;
+	const size_t mnemonic_len = op1++ - line - 1;
+	const char* op1_end = memchr(op1, ',', end - op1);
+	if (!op1_end) op1_end = end;
+	u8 reg_size, _;
+	const int reg = parseReg_arm64(op1, op1_end - op1, &reg_size),
+		frame_reg = parseReg_arm64(frame, strlen(frame), &_);
+	if (reg < 0) return barrier;
+	const uint64_t defs = reg == 31 ? 0 : 1ULL << reg;
+	for (u8 i = 0; i < sizeof(accesses) / sizeof(accesses[0]); ++i) {
+		if (strlen(accesses[i].mnemonic) != mnemonic_len || memcmp(accesses[i].mnemonic, line + 1, mnemonic_len)) continue;
+// only `[<frame>]` and `[<frame>, <offset>]` are understood
+		const size_t frame_len = strlen(frame);
+		const char* addr = op1_end + 2;
+		if (op1_end == end || addr >= end || *addr != '[' || (size_t)(end - addr) < frame_len + 2 || memcmp(addr + 1, frame, frame_len)) return barrier;
+		addr += frame_len + 1;
+		long long disp = 0;
+		if (addr[0] == ',' && addr[1] == ' ') {
+			char* disp_end;
+			disp = strtoll(addr + 2, &disp_end, 10);
+			if (disp_end == addr + 2) return barrier;
+			addr = disp_end;
+		}
+		if (addr + 1 != end || *addr != ']' || (!accesses[i].is_store && reg == frame_reg)) return barrier;
+		return (mi_Instr){
+			.type = accesses[i].is_store ? MI_STORE : MI_LOAD,
+			.reg = reg,
+			.size = accesses[i].size ? accesses[i].size : reg_size,
+			.whole = !accesses[i].size && !accesses[i].is_signed && reg_size >= 8,
+			.is_signed = accesses[i].is_signed,
+			.disp = disp,
+			.defs = accesses[i].is_store ? 0 : defs
+		};
+	}
+	if ((line[1] == 'l' && line[2] == 'd') || (line[1] == 's' && line[2] == 't') || reg == frame_reg) return barrier;
+	if (mnemonic_len == 3 && !memcmp(line + 1, "mov", 3) && reg_size == 8 && reg < 32 && op1_end != end) {
+		u8 src_size;
+		const int src = parseReg_arm64(op1_end + 2, end - op1_end - 2, &src_size);
+		if (src >= 0 && src < 32 && src_size == 8)
+			return (mi_Instr){.type = MI_MOVE, .reg = reg, .reg2 = src, .size = 8, .defs = defs};
+	}
+	return (mi_Instr){.type = MI_OTHER, .defs = defs};
+}
+
+static long printReg_arm64(FILE* dst, u8 reg, u8 size)
+{
+	if (reg == 31) return str_fput(dst, size == 8 ? "xzr" : "wzr");
+	if (reg < 31) return fprintf(dst, "%c%u", size == 8 ? 'x' : 'w', reg);
+	return fprintf(dst, "%c%u", size == 16 ? 'q' : size == 8 ? 'd' : 's', reg - 32);
+}
+
+static bool canPair_arm64(mi_Instr lo, mi_Instr hi)
+{
+// `ldp` and `stp` take a pair of W, X, D or Q registers and a scaled 7-bit signed offset
+	if (lo.is_signed || hi.is_signed || (lo.reg < 32) != (hi.reg < 32) || (lo.reg < 32 ? lo.size < 4 || lo.size > 8 : lo.size < 8)) return false;
+	return lo.disp % lo.size == 0 && lo.disp >= -64 * lo.size && lo.disp <= 63 * lo.size;
+}
+
+// runs the peephole optimizer over the buffered assembly of a procedure or a data block initializer, and writes the result to `dst`
+static long printOptimized_arm64(FILE* dst, const char* code, size_t code_size, const char* frame)
+{
+	uint32_t n_lines = 0;
+	for (size_t i = 0; i < code_size; ++i) {
+		n_lines += code[i] == '\n';
+	}
+	const char** const lines = malloc((n_lines + 1) * sizeof(char*));
+	mi_Instr* const descs = malloc((n_lines + 1) * sizeof(mi_Instr));
+	assert(lines && descs, "memory allocation failure during native code generation");
+	lines[0] = code;
+	for (uint32_t i = 0; i < n_lines; ++i) {
+		lines[i + 1] = (const char*)memchr(lines[i], '\n', code + code_size - lines[i]) + 1;
+		descs[i] = describeLine_arm64(lines[i], lines[i + 1] - lines[i] - 1, frame);
+	}
+	optimizeInstrs(descs, n_lines, canPair_arm64);
+
+	long acc = 0;
+	for (uint32_t i = 0; i < n_lines; ++i) {
+		const mi_Instr instr = descs[i];
+		switch (instr.type) {
+			case MI_DELETED:
+				break;
+			case MI_MOVE:
+				if (instr.size == 16) {
+					acc += fprintf(dst, "\tmov\tv%u.16b, v%u.16b\n", instr.reg - 32, instr.reg2 - 32);
+					break;
+				}
+				acc += str_fput(dst, instr.reg < 32 && instr.reg2 < 32 ? "\tmov\t" : "\tfmov\t")
+					+ printReg_arm64(dst, instr.reg, 8)
+					+ str_fput(dst, ", ")
+					+ printReg_arm64(dst, instr.reg2, 8)
+					+ str_fput(dst, "\n");
+				break;
+			case MI_LOAD_PAIR:
+			case MI_STORE_PAIR:
+				acc += str_fput(dst, instr.type == MI_LOAD_PAIR ? "\tldp\t" : "\tstp\t")
+					+ printReg_arm64(dst, instr.reg, instr.size)
+					+ str_fput(dst, ", ")
+					+ printReg_arm64(dst, instr.reg2, instr.size)
+					+ fprintf(dst, ", [%s, %lld]\n", frame, (long long)instr.disp);
+				break;
+			case MI_OTHER:
+			case MI_LOAD:
+			case MI_STORE:
+			case MI_BARRIER:
+				acc += fwrite(lines[i], 1, lines[i + 1] - lines[i], dst);
+				break;
+		}
+	}
+	free(lines);
+	free(descs);
+	return acc;
+}
+
+// compiles the operations of the procedure or the data block initializer `proc_id` into a buffer, and then writes them to `dst` optimized;
+// `sizes` are the sizes of the stack before each operation and after the last one
+static long compileBody_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, uint32_t n_ops, const size_t* sizes, size_t max_size, FILE* dst)
+{
+	char* code;
+	size_t code_size;
+	ctx->dst = open_memstream(&code, &code_size);
+	assert(ctx->dst, "memory allocation failure during native code generation");
+	for (uint32_t i = 0; i < n_ops; ++i) {
+		compileOp_darwin_arm64(ctx, proc_id, i, max_size - sizes[i + 1], max_size - sizes[i], ctx->dst);
+	}
+	fclose(ctx->dst);
+	ctx->dst = dst;
+	const long acc = printOptimized_arm64(dst, code, code_size, proc_id < 0 ? "x12" : "sp");
+	free(code);
+	return acc;
+}
+
 static char* getErrorMsg(BR_Error err, const char* prefix) {
 	sbuf res = {0};
 	FILE* stream = open_memstream(&res.data, &res.length);
@@ -741,96 +1212,169 @@ static char* getErrorMsg(BR_Error err, const char* prefix) {
 	return res.data;
 }
 
-long BR_compileModule_darwin_arm64(const BR_Module* module, FILE* dst, char** entry_point_name)
+// generates the contents and the initializer of the data block `db_id`
+static long compileDataBlock_darwin_arm64(arm64_CodegenCtx* ctx, BR_id db_id, FILE* dst)
 {
-	arm64_CodegenCtx ctx = {.dst = dst};
-	BR_Error err = BR_analyzeModule(module, &ctx.builder);
-	if (err.type) {
-		BR_printErrorMsg(stderr, err, "error while analyzing module");
-		abort();
-	}
-// adding macros for the pseudo-instructions `ldpb` and `ldrh` which load respectively 2 bytes or half-words from memory into 2 registers
-	long acc = sbuf_fput(dst, sbuf_fromcstr(
-		".macro\tldph ra, rb, rs, off=0\n"
-		"\tldr\t\\ra, \\rs, \\off\n"
-		"\tlsr\t\\rb, \\ra, 16\n"
-		".endmacro\n"
-		".macro\tldpb ra, rb, rs, off=0\n"
-		"\tldrh\t\\ra, \\rs, \\off\n"
-		"\tlsr\t\\rb, \\ra, 8\n"
-		".endmacro\n"));
-	arrayForeach (BR_DataBlock, block, module->seg_data) {
-		acc += str_fput(dst, ".bss\n")
+	const BR_DataBlock* const block = &ctx->builder.module.seg_data.data[~db_id];
+	const sbuf contents = ctx->module->seg_data.data[~db_id].data;
+// the contents of a pre-evaluated data block are emitted as is, and its initializer does nothing
+	if (contents.length) {
+		long acc = str_fput(dst, ".data\n")
 			+ printLabel(dst, block->name, "_")
-			+ fprintf(dst, ":\n"
-				"\t.zero\t%zu\n"
+			+ str_fput(dst, ":");
+		for (size_t i = 0; i < contents.length; ++i) {
+			acc += fprintf(dst, i % 16 ? ", %hhu" : "\n\t.byte\t%hhu", contents.data[i]);
+		}
+		return acc
+			+ str_fput(dst, "\n"
 				".text\n"
-				".align 4\n", BR_getMaxStackRTSize(&ctx.builder, ~(block - module->seg_data.data)))
+				".align 4\n")
 			+ printLabel(dst, block->name, ".brb_db_impl_")
 			+ str_fput(dst, ":\n"
-				"\tadrp\tx12, ")
-			+ printLabel(dst, block->name, "_")
-			+ str_fput(dst, "@PAGE\n"
-				"\tadd\tx12, x12, ")
-			+ printLabel(dst, block->name, "_")
-			+ str_fput(dst, "@PAGEOFF\n");
-		size_t sizes[block->body.length + 1],
-			max_size = 0;
-		sizes[0] = BR_getStackRTSize(&ctx.builder, block - module->seg_data.data, UINT32_MAX);
-		for (uint32_t i = 1; i <= block->body.length; ++i) {
-			sizes[i] = BR_getStackRTSize(&ctx.builder, ~(block - module->seg_data.data), i - 1) - sizes[0];
-			if (sizes[i] > max_size) max_size = sizes[i];
-		}
-		sizes[0] = 0;
-
-		for (uint32_t i = 0; i < block->body.length; ++i) {
-			acc += compileOp_darwin_arm64(&ctx, ~(block - module->seg_data.data), i, max_size - sizes[i + 1], max_size - sizes[i], dst);
-		}
-		acc += str_fput(dst, "\tret\n");
+				"\tret\n");
+	}
+	long acc = str_fput(dst, ".bss\n")
+		+ printLabel(dst, block->name, "_")
+		+ fprintf(dst, ":\n"
+			"\t.zero\t%zu\n"
+			".text\n"
+			".align 4\n", BR_getMaxStackRTSize(&ctx->builder, db_id))
+		+ printLabel(dst, block->name, ".brb_db_impl_")
+		+ str_fput(dst, ":\n"
+			"\tadrp\tx12, ")
+		+ printLabel(dst, block->name, "_")
+		+ str_fput(dst, "@PAGE\n"
+			"\tadd\tx12, x12, ")
+		+ printLabel(dst, block->name, "_")
+		+ str_fput(dst, "@PAGEOFF\n");
+// the stack of an initializer starts empty
+	size_t sizes[block->body.length + 1],
+		max_size = 0;
+	sizes[0] = 0;
+	for (uint32_t i = 1; i <= block->body.length; ++i) {
+		sizes[i] = BR_getStackRTSize(&ctx->builder, db_id, i - 1);
+		if (sizes[i] > max_size) max_size = sizes[i];
 	}
 
-	if (!module->seg_data.length) acc += str_fput(dst, ".text\n");
-	arrayForeach (BR_Proc, proc, module->seg_exec) {
-// making the label global if the proc is the entry point
-		const bool is_entry = module->exec_entry_point == (uintptr_t)(proc - module->seg_exec.data);
+// the initializers are called before the entry point creates any values, so they may use the callee-saved registers too
+	allocRegs_arm64(ctx, db_id, true);
+	acc += compileBody_darwin_arm64(ctx, db_id, block->body.length, sizes, max_size, dst);
+	free(ctx->values);
+	free(ctx->op_values);
+	return acc + str_fput(dst, "\tret\n");
+}
+
+static long compileProc_darwin_arm64(arm64_CodegenCtx* ctx, BR_id proc_id, FILE* dst)
+{
+	const BR_Module* const module = &ctx->builder.module;
+	const BR_Proc* const proc = &module->seg_exec.data[proc_id];
+	const bool is_entry = module->exec_entry_point == (uintptr_t)proc_id;
 // generating the label
-		acc += printLabel(dst, proc->name, "_")
-			+ str_fput(dst, ":\n");
-		if (is_entry) {
-			if (entry_point_name) *entry_point_name = sbuf_tostr(sbuf_fromcstr("_"), sbuf_fromstr((char*)proc->name));
-			acc += str_fput(dst, ".global ")
-				+ printLabel(dst, proc->name, "_")
-				+ str_fput(dst, "\n"
-					"\tmov\tx28, x1\n"
-					"\tmov\tx27, x0\n");
-			arrayForeach (BR_DataBlock, block, module->seg_data) {
-				acc += str_fput(dst, "\tbl\t")
-					+ printLabel(dst, block->name, ".brb_db_impl_")
-					+ str_fput(dst, "\n");
-			}
+	long acc = printLabel(dst, proc->name, "_")
+		+ str_fput(dst, ":\n");
+// making the label global if the proc is the entry point
+	if (is_entry) {
+		acc += str_fput(dst, ".global ")
+			+ printLabel(dst, proc->name, "_")
+			+ str_fput(dst, "\n"
+				"\tmov\tx28, x1\n"
+				"\tmov\tx27, x0\n");
+		arrayForeach (BR_DataBlock, block, module->seg_data) {
+			acc += str_fput(dst, "\tbl\t")
+				+ printLabel(dst, block->name, ".brb_db_impl_")
+				+ str_fput(dst, "\n");
 		}
+	}
 // pre-computing the stack frame size after each operation in the procedure
-		size_t sizes[proc->body.length + 1],
-			max_size = 0;
-		sizes[0] = BR_getStackRTSize(&ctx.builder, proc - module->seg_exec.data, UINT32_MAX);
-		for (uint32_t i = 1; i <= proc->body.length; ++i) {
-			sizes[i] = BR_getStackRTSize(&ctx.builder, proc - module->seg_exec.data, i - 1) - sizes[0];
-			if (sizes[i] > max_size) max_size = sizes[i];
-		}
-		max_size = alignby(max_size, ARM64_STACK_ALIGNMENT);
-		sizes[0] = 0;
-
-		char stacksize_s[16];
-		acc += compileIntLiteral_arm64(dst, max_size, 0, ARM64_ADDSUB_RULE, sizeof(stacksize_s), stacksize_s)
-			+ fprintf(dst, "\tsub\tsp, sp, %s\n", stacksize_s);
-		for (uint32_t i = 0; i < proc->body.length; ++i) {
-			acc += compileOp_darwin_arm64(&ctx, proc - module->seg_exec.data, i, max_size - sizes[i + 1], max_size - sizes[i], dst);
-		}
-		acc += str_fput(dst, is_entry
-			? "\tmov\tx0, 0\n"
-			  "\tbl\t_exit\n"
-			: "\tret\n");
+	size_t sizes[proc->body.length + 1],
+		max_size = 0;
+	sizes[0] = BR_getStackRTSize(&ctx->builder, proc_id, UINT32_MAX);
+	for (uint32_t i = 1; i <= proc->body.length; ++i) {
+		sizes[i] = BR_getStackRTSize(&ctx->builder, proc_id, i - 1) - sizes[0];
+		if (sizes[i] > max_size) max_size = sizes[i];
+	}
+	max_size = alignby(max_size, ARM64_STACK_ALIGNMENT);
+	sizes[0] = 0;
+
+	char stacksize_s[16];
+	acc += compileIntLiteral_arm64(dst, max_size, 0, ARM64_ADDSUB_RULE, sizeof(stacksize_s), stacksize_s)
+		+ fprintf(dst, "\tsub\tsp, sp, %s\n", stacksize_s);
+	allocRegs_arm64(ctx, proc_id, is_entry);
+	acc += compileBody_darwin_arm64(ctx, proc_id, proc->body.length, sizes, max_size, dst);
+	free(ctx->values);
+	free(ctx->op_values);
+	return acc + str_fput(dst, is_entry
+		? "\tmov\tx0, 0\n"
+		  "\tbl\t_exit\n"
+		: "\tret\n");
+}
+
+// the code of every data block and procedure is generated into its own buffer, on a pool of worker threads;
+// the buffers are then written out in the order of the module, so that the output doesn't depend on the number of workers
+typedef struct {
+	const arm64_CodegenCtx* ctx; // only the analysis of the module is shared, and it is only read
+	sbuf* units; // the code of the data blocks, followed by that of the procedures
+	uint32_t n_units;
+	atomic_uint next_unit;
+} arm64_CodegenJob;
+
+static void* runCodegenWorker_darwin_arm64(void* arg)
+{
+	arm64_CodegenJob* const job = arg;
+	arm64_CodegenCtx ctx = *job->ctx;
+	const uint32_t n_data_blocks = ctx.builder.module.seg_data.length;
+	uint32_t unit_id;
+	while ((unit_id = atomic_fetch_add(&job->next_unit, 1)) < job->n_units) {
+		sbuf* const unit = &job->units[unit_id];
+		FILE* const dst = open_memstream(&unit->data, &unit->length);
+		assert(dst, "memory allocation failure during native code generation");
+		if (unit_id < n_data_blocks) {
+			compileDataBlock_darwin_arm64(&ctx, ~(BR_id)unit_id, dst);
+		} else compileProc_darwin_arm64(&ctx, unit_id - n_data_blocks, dst);
+		fclose(dst);
+	}
+	return NULL;
+}
+
+long BR_compileModule_darwin_arm64(const BR_Module* module, FILE* dst, char** entry_point_name, uint32_t n_workers)
+{
+	arm64_CodegenCtx ctx = {.module = module, .dst = dst};
+	BR_Error err = BR_analyzeModule(module, &ctx.builder);
+	if (err.type) {
+		BR_printErrorMsg(stderr, err, "error while analyzing module");
+		abort();
+	}
+	if (entry_point_name && module->exec_entry_point < module->seg_exec.length)
+		*entry_point_name = sbuf_tostr(sbuf_fromcstr("_"), sbuf_fromstr((char*)module->seg_exec.data[module->exec_entry_point].name));
+
+	arm64_CodegenJob job = {
+		.ctx = &ctx,
+		.n_units = module->seg_data.length + module->seg_exec.length
+	};
+	atomic_init(&job.next_unit, 0);
+	job.units = calloc(job.n_units + 1, sizeof(sbuf));
+	assert(job.units, "memory allocation failure during native code generation");
+	if (!n_workers) n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_workers > job.n_units) n_workers = job.n_units;
+	if (!n_workers) n_workers = 1;
+// the calling thread is a worker too; if not all the threads could be started, the ones that were take over the rest of the work
+	pthread_t* const threads = malloc(n_workers * sizeof(pthread_t));
+	assert(threads, "memory allocation failure during native code generation");
+	uint32_t n_started = 0;
+	while (n_started + 1 < n_workers && !pthread_create(&threads[n_started], NULL, runCodegenWorker_darwin_arm64, &job))
+		++n_started;
+	runCodegenWorker_darwin_arm64(&job);
+	for (uint32_t i = 0; i < n_started; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+
+	long acc = module->seg_data.length ? 0 : str_fput(dst, ".text\n");
+	for (uint32_t i = 0; i < job.n_units; ++i) {
+		acc += fwrite(job.units[i].data, 1, job.units[i].length, dst);
+		free(job.units[i].data);
 	}
+	free(job.units);
 	BR_Module _;
 	err = BR_extractModule(ctx.builder, &_);
 	assert(!err.type, "%s", getErrorMsg(err, "error while analyzing module for native assembly generation"))
@@ -840,3 +1384,1480 @@ long BR_compileModule_darwin_arm64(const BR_Module* module, FILE* dst, char** en
 
 	return acc;
 }
+
+#undef ARM64_ARITH_STRIDE
+
+// the general-purpose registers used by the x86-64 code, numbered as in the encoding
+typedef enum {
+	X86_64_RAX,
+	X86_64_RCX,
+	X86_64_RDX,
+	X86_64_RBX,
+	X86_64_RSP,
+	X86_64_RBP,
+	X86_64_RSI,
+	X86_64_RDI,
+	X86_64_N_REGS
+} x86_64_Reg;
+
+// names of the registers for 8, 4, 2 and 1-byte operands
+static const char* const x86_64_reg_names[X86_64_N_REGS][4] = {
+	[X86_64_RAX] = {"rax", "eax", "ax", "al"},
+	[X86_64_RCX] = {"rcx", "ecx", "cx", "cl"},
+	[X86_64_RDX] = {"rdx", "edx", "dx", "dl"},
+	[X86_64_RBX] = {"rbx", "ebx", "bx", "bl"},
+	[X86_64_RSP] = {"rsp", "esp", "sp", "spl"},
+	[X86_64_RBP] = {"rbp", "ebp", "bp", "bpl"},
+	[X86_64_RSI] = {"rsi", "esi", "si", "sil"},
+	[X86_64_RDI] = {"rdi", "edi", "di", "dil"}
+};
+
+static const char* getRegName_x86_64(x86_64_Reg reg, uint8_t size)
+{
+	return x86_64_reg_names[reg][size == 8 ? 0 : size == 4 ? 1 : size == 2 ? 2 : 3];
+}
+
+static const char x86_64_size_suffixes[] = {[1] = 'b', [2] = 'w', [4] = 'l', [8] = 'q'};
+
+// every arithmetic operation is followed by its `*-i` and `*-i@*` variants
+#define X86_64_ARITH_STRIDE (BR_OP_SUB - BR_OP_ADD)
+static_assert(BR_OP_SHRSIAT64 - BR_OP_ADD == 12 * X86_64_ARITH_STRIDE + 6, "the arithmetic operations are out of order");
+static_assert(BR_OP_NOTAT64 - BR_OP_NOT == 5, "the `not@*` operations are out of order");
+
+// Linux syscall numbers of the BRB syscalls
+static const uint16_t linux_x86_64_syscall_ids[] = {
+	[BR_SYS_EXIT] = 60,
+	[BR_SYS_WRITE] = 1,
+	[BR_SYS_READ] = 0
+};
+static_assert(sizeof(linux_x86_64_syscall_ids) / sizeof(linux_x86_64_syscall_ids[0]) == BR_N_SYSCALLS, "not all syscalls have their Linux counterparts defined");
+#define LINUX_X86_64_SYS_EXIT 60
+
+// BRB operations are lowered into a buffer of these, which is then either printed as GAS assembly or encoded into machine code
+typedef enum {
+	X86_64_NOP,
+	X86_64_LOAD,        // reg = `size` bytes at `value(%base)`, zero- or sign-extended to 64 bits
+	X86_64_STORE,       // `size` bytes at `value(%base)` = the lowest `size` bytes of reg
+	X86_64_MOV_IMM,     // reg = value
+	X86_64_MOV,         // reg = base; both are 64-bit
+	X86_64_LEA,         // reg = base + value
+	X86_64_LEA_DATA,    // reg = address of the data block `db_id` + value
+	X86_64_ARITH,       // rax = rax `op` rcx, see `lowerArith_x86_64`
+	X86_64_NOT,         // rax = ~rax
+	X86_64_SUB_IMM,     // reg -= value
+	X86_64_PUSH,        // push reg
+	X86_64_POP,         // pop reg
+	X86_64_CALL_INIT,   // call the initializer of the data block `db_id`
+	X86_64_LEAVE,
+	X86_64_RET,
+	X86_64_SYSCALL,
+	X86_64_CLAMP_ERROR, // rax = rax < 0 ? -1 : rax
+	X86_64_REP_MOVSB,
+	X86_64_REP_STOSB,
+	X86_64_N_INSTR_TYPES
+} x86_64_InstrType;
+
+typedef struct {
+	x86_64_InstrType type;
+	x86_64_Reg reg;
+	x86_64_Reg base;
+	uint8_t size;
+	bool is_signed;
+	BR_OpType op;
+	int64_t value;
+	BR_id db_id;
+} x86_64_Instr;
+defArray(x86_64_Instr);
+
+typedef struct {
+	const BR_Module* module; // the module being compiled; unlike `builder.module`, it has the pre-evaluated contents of the data blocks
+	BR_ModuleBuilder builder;
+	x86_64_InstrArray instrs; // the lowered procedure or data block initializer
+	size_t max_depth; // the maximum size of the stack of the lowered procedure, which is also the size of the lowered data block
+} x86_64_CodegenCtx;
+
+static void addInstr_x86_64(x86_64_CodegenCtx* ctx, x86_64_Instr instr)
+{
+	assert(x86_64_InstrArray_append(&ctx->instrs, instr), "memory allocation failure during native code generation");
+}
+
+static void addLoad_x86_64(x86_64_CodegenCtx* ctx, x86_64_Reg reg, x86_64_Reg base, int64_t disp, uint8_t size, bool is_signed)
+{
+	addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_LOAD, .reg = reg, .base = base, .value = disp, .size = size, .is_signed = is_signed});
+}
+
+static void addStore_x86_64(x86_64_CodegenCtx* ctx, x86_64_Reg reg, x86_64_Reg base, int64_t disp, uint8_t size)
+{
+	addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_STORE, .reg = reg, .base = base, .value = disp, .size = size});
+}
+
+static void addMovImm_x86_64(x86_64_CodegenCtx* ctx, x86_64_Reg reg, uint64_t value)
+{
+	addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_MOV_IMM, .reg = reg, .value = value});
+}
+
+static void addArith_x86_64(x86_64_CodegenCtx* ctx, BR_OpType base_op, uint8_t size)
+{
+	addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_ARITH, .op = base_op, .size = size});
+}
+
+// whether the arithmetic operation `base_op` sign-extends its operands
+static bool isArithOpSigned_x86_64(BR_OpType base_op)
+{
+	return base_op == BR_OP_DIVS || base_op == BR_OP_MODS || base_op == BR_OP_SHRS;
+}
+
+// copies `size` bytes from `src_disp(%src_base)` to `dst_disp(%dst_base)`; small copies are done inline, the rest with `rep movsb`
+static void addCopy_x86_64(x86_64_CodegenCtx* ctx, x86_64_Reg dst_base, int64_t dst_disp, x86_64_Reg src_base, int64_t src_disp, uint64_t size)
+{
+	if (size > 64) {
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_LEA, .reg = X86_64_RDI, .base = dst_base, .value = dst_disp});
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_LEA, .reg = X86_64_RSI, .base = src_base, .value = src_disp});
+		addMovImm_x86_64(ctx, X86_64_RCX, size);
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_REP_MOVSB});
+		return;
+	}
+	for (uint8_t chunk = 8; chunk; chunk /= 2) {
+		for (; size >= chunk; size -= chunk, dst_disp += chunk, src_disp += chunk) {
+			addLoad_x86_64(ctx, X86_64_RAX, src_base, src_disp, chunk, false);
+			addStore_x86_64(ctx, X86_64_RAX, dst_base, dst_disp, chunk);
+		}
+	}
+}
+
+// zeroes `size` bytes at `disp(%rbp)`
+static void addZero_x86_64(x86_64_CodegenCtx* ctx, int64_t disp, uint64_t size)
+{
+	addMovImm_x86_64(ctx, X86_64_RAX, 0);
+	if (size > 64) {
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_LEA, .reg = X86_64_RDI, .base = X86_64_RBP, .value = disp});
+		addMovImm_x86_64(ctx, X86_64_RCX, size);
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_REP_STOSB});
+		return;
+	}
+	for (uint8_t chunk = 8; chunk; chunk /= 2) {
+		for (; size >= chunk; size -= chunk, disp += chunk) {
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, disp, chunk);
+		}
+	}
+}
+
+// every stack item is addressed relative to %rbp, which points to the head of the stack at the entry of the procedure or to the end of the data block;
+// `depth` and `depth_after` are the sizes of the stack before and after the operation
+static void lowerOp_x86_64(x86_64_CodegenCtx* ctx, BR_id proc_id, uint32_t op_id, int64_t depth, int64_t depth_after)
+{
+	const BR_Op* op = BR_getOp(&ctx->builder.module, proc_id, op_id);
+	if (op->type >= BR_OP_ADD && op->type <= BR_OP_SHRSIAT64) {
+		const BR_OpType base_op = BR_OP_ADD + (op->type - BR_OP_ADD) / X86_64_ARITH_STRIDE * X86_64_ARITH_STRIDE;
+		const bool is_signed = isArithOpSigned_x86_64(base_op);
+		if (op->type == base_op) {
+// [A, B] -> [A OP B], where A is on top of the stack
+			const uint8_t size1 = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id - 1, 0),
+				size2 = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id - 1, 1);
+			addLoad_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth, size1, is_signed);
+			addLoad_x86_64(ctx, X86_64_RCX, X86_64_RBP, -depth + size1, size2, is_signed);
+			addArith_x86_64(ctx, base_op, size1);
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, size1);
+			return;
+		}
+		const uint8_t size = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0);
+		if (op->type == base_op + 1) {
+			addLoad_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth, size, is_signed);
+			addMovImm_x86_64(ctx, X86_64_RCX, op->operand_u);
+			addArith_x86_64(ctx, base_op, size);
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth, size);
+			return;
+		}
+// [A] -> [*A OP= operand]
+		addLoad_x86_64(ctx, X86_64_RSI, X86_64_RBP, -depth, sizeof(void*), false);
+		addLoad_x86_64(ctx, X86_64_RAX, X86_64_RSI, 0, size, is_signed);
+		addMovImm_x86_64(ctx, X86_64_RCX, op->operand_u);
+		addArith_x86_64(ctx, base_op, size);
+		addStore_x86_64(ctx, X86_64_RAX, X86_64_RSI, 0, size);
+		addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, size);
+		return;
+	}
+	if (op->type >= BR_OP_NOT && op->type <= BR_OP_NOTAT64) {
+		const uint8_t size = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0);
+		if (op->type == BR_OP_NOT) {
+			addLoad_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth, size, false);
+			addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_NOT});
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth, size);
+			return;
+		}
+		addLoad_x86_64(ctx, X86_64_RSI, X86_64_RBP, -depth, sizeof(void*), false);
+		addLoad_x86_64(ctx, X86_64_RAX, X86_64_RSI, 0, size, false);
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_NOT});
+		addStore_x86_64(ctx, X86_64_RAX, X86_64_RSI, 0, size);
+		addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, size);
+		return;
+	}
+// the arithmetic operations are handled above
+	switch ((uint16_t)op->type) {
+		case BR_OP_NOP:
+			addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_NOP});
+			return;
+		case BR_OP_END:
+			addMovImm_x86_64(ctx, X86_64_RDI, 0);
+			addMovImm_x86_64(ctx, X86_64_RAX, LINUX_X86_64_SYS_EXIT);
+			addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_SYSCALL});
+			return;
+		case BR_OP_I8:
+		case BR_OP_I16:
+		case BR_OP_I32:
+		case BR_OP_PTR:
+		case BR_OP_I64:
+			addMovImm_x86_64(ctx, X86_64_RAX, op->operand_u);
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, depth_after - depth);
+			return;
+		case BR_OP_BUILTIN:
+			addMovImm_x86_64(ctx, X86_64_RAX, BR_builtinValues[op->operand_u]);
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, sizeof(void*));
+			return;
+		case BR_OP_ADDR:
+			addInstr_x86_64(ctx, (x86_64_Instr){
+				.type = X86_64_LEA,
+				.reg = X86_64_RAX,
+				.base = X86_64_RBP,
+				.value = BR_getStackItemRTOffset(&ctx->builder, proc_id, op_id, op->operand_u) - depth_after
+			});
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, sizeof(void*));
+			return;
+		case BR_OP_DBADDR:
+			addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_LEA_DATA, .reg = X86_64_RAX, .db_id = op->operand_s});
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, sizeof(void*));
+			return;
+		case BR_OP_SYS: {
+// the arguments are on top of the stack, and the result, if any, replaces the last one
+			static const x86_64_Reg arg_regs[] = {X86_64_RDI, X86_64_RSI, X86_64_RDX};
+			for (uint8_t i = 0; i < BR_syscallNArgs[op->operand_u]; ++i) {
+				addLoad_x86_64(ctx, arg_regs[i], X86_64_RBP, -depth + i * sizeof(uintptr_t), sizeof(uintptr_t), false);
+			}
+			addMovImm_x86_64(ctx, X86_64_RAX, linux_x86_64_syscall_ids[op->operand_u]);
+			addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_SYSCALL});
+			if (op->operand_u == BR_SYS_EXIT) return;
+// the kernel returns -errno on failure, while the interpreter, like libc, returns -1
+			addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_CLAMP_ERROR});
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, sizeof(uintptr_t));
+			return;
+		}
+		case BR_OP_DROP:
+		case BR_OP_NEW:
+			return;
+		case BR_OP_ZERO:
+			addZero_x86_64(ctx, -depth_after, depth_after - depth);
+			return;
+		case BR_OP_GET:
+			addCopy_x86_64(ctx,
+				X86_64_RBP, -depth_after,
+				X86_64_RBP, BR_getStackItemRTOffset(&ctx->builder, proc_id, op_id - 1, op->operand_u) - depth,
+				depth_after - depth);
+			return;
+		case BR_OP_SETAT:
+// [A, B] -> [B], where B is copied to the address A
+			addLoad_x86_64(ctx, X86_64_RDI, X86_64_RBP, -depth, sizeof(void*), false);
+			addCopy_x86_64(ctx, X86_64_RDI, 0, X86_64_RBP, -depth_after, BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0));
+			return;
+		case BR_OP_GETFROM:
+			addLoad_x86_64(ctx, X86_64_RSI, X86_64_RBP, -depth, sizeof(void*), false);
+			addCopy_x86_64(ctx, X86_64_RBP, -depth_after, X86_64_RSI, 0, BR_getTypeRTSize(&ctx->builder.module, op->operand_type));
+			return;
+		case BR_OP_COPY:
+// [A, B] -> [A], where the object at the address B is copied to the address A;
+// A is reloaded after the copy, since the copy might have overwritten it, just like in the interpreter
+			addLoad_x86_64(ctx, X86_64_RDI, X86_64_RBP, -depth, sizeof(void*), false);
+			addLoad_x86_64(ctx, X86_64_RSI, X86_64_RBP, -depth + sizeof(void*), sizeof(void*), false);
+			addCopy_x86_64(ctx, X86_64_RDI, 0, X86_64_RSI, 0, BR_getTypeRTSize(&ctx->builder.module, op->operand_type));
+			addLoad_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth, sizeof(void*), false);
+			addStore_x86_64(ctx, X86_64_RAX, X86_64_RBP, -depth_after, sizeof(void*));
+			return;
+		default:
+			assert(false, "invalid operation type %u", op->type);
+	}
+}
+
+// computes the size of the items on the stack before every operation of the procedure `proc_id` and after the last one;
+// the size reported by the analyzer also includes the stack frame of a procedure, i.e. its arguments and the return address, unless the stack is empty
+static size_t* getStackDepths(const BR_ModuleBuilder* builder, BR_id proc_id, uint32_t n_ops, size_t* max_depth_p)
+{
+	size_t* const depths = malloc((n_ops + 1) * sizeof(size_t));
+	assert(depths, "memory allocation failure during native code generation");
+	size_t frame_size = 0;
+	if (proc_id >= 0) {
+		frame_size = BR_getTypeRTSize(&builder->module, BR_PTR_TYPE(2));
+		arrayForeach (BR_Type, arg, builder->module.seg_exec.data[proc_id].args) {
+			frame_size += BR_getTypeRTSize(&builder->module, *arg);
+		}
+	}
+	*max_depth_p = depths[0] = 0;
+	for (uint32_t i = 1; i <= n_ops; ++i) {
+		const size_t size = BR_getStackRTSize(builder, proc_id, i - 1);
+		depths[i] = size ? size - frame_size : 0;
+		if (depths[i] > *max_depth_p) *max_depth_p = depths[i];
+	}
+	return depths;
+}
+
+// describes `instr` for the peephole optimizer, with the stack items being addressed relative to %rbp
+static mi_Instr describeInstr_x86_64(x86_64_Instr instr)
+{
+	static const mi_Instr barrier = {.type = MI_BARRIER};
+	switch (instr.type) {
+		case X86_64_NOP:
+			return (mi_Instr){.type = MI_OTHER};
+		case X86_64_LOAD:
+			if (instr.base != X86_64_RBP || instr.reg == X86_64_RBP) return barrier;
+			return (mi_Instr){
+				.type = MI_LOAD,
+				.reg = instr.reg,
+				.size = instr.size,
+				.whole = instr.size == 8,
+				.is_signed = instr.is_signed,
+				.disp = instr.value,
+				.defs = 1 << instr.reg
+			};
+		case X86_64_STORE:
+			if (instr.base != X86_64_RBP) return barrier;
+			return (mi_Instr){.type = MI_STORE, .reg = instr.reg, .size = instr.size, .whole = instr.size == 8, .disp = instr.value};
+		case X86_64_MOV:
+			if (instr.reg == X86_64_RBP || instr.reg == X86_64_RSP) return barrier;
+			return (mi_Instr){.type = MI_MOVE, .reg = instr.reg, .reg2 = instr.base, .size = 8, .defs = 1 << instr.reg};
+		case X86_64_MOV_IMM:
+		case X86_64_LEA:
+		case X86_64_LEA_DATA:
+			if (instr.reg == X86_64_RBP || instr.reg == X86_64_RSP) return barrier;
+			return (mi_Instr){.type = MI_OTHER, .defs = 1 << instr.reg};
+		case X86_64_ARITH:
+			return (mi_Instr){.type = MI_OTHER, .defs = 1 << X86_64_RAX | 1 << X86_64_RDX};
+		case X86_64_NOT:
+		case X86_64_CLAMP_ERROR:
+			return (mi_Instr){.type = MI_OTHER, .defs = 1 << X86_64_RAX};
+		case X86_64_SUB_IMM:
+		case X86_64_PUSH:
+		case X86_64_POP:
+		case X86_64_CALL_INIT:
+		case X86_64_LEAVE:
+		case X86_64_RET:
+		case X86_64_SYSCALL:
+		case X86_64_REP_MOVSB:
+		case X86_64_REP_STOSB:
+			return barrier;
+		case X86_64_N_INSTR_TYPES:
+		default:
+			assert(false, "invalid x86-64 instruction type %u", instr.type);
+	}
+}
+
+// runs the peephole optimizer over `ctx->instrs`; the forwarded loads become register moves
+static void optimizeInstrs_x86_64(x86_64_CodegenCtx* ctx)
+{
+	mi_Instr* const descs = malloc(ctx->instrs.length * sizeof(mi_Instr));
+	assert(descs, "memory allocation failure during native code generation");
+	for (uint32_t i = 0; i < ctx->instrs.length; ++i) {
+		descs[i] = describeInstr_x86_64(ctx->instrs.data[i]);
+	}
+	optimizeInstrs(descs, ctx->instrs.length, NULL);
+	uint32_t n_instrs = 0;
+	for (uint32_t i = 0; i < ctx->instrs.length; ++i) {
+		if (descs[i].type == MI_DELETED) continue;
+		if (descs[i].type == MI_MOVE)
+			ctx->instrs.data[i] = (x86_64_Instr){.type = X86_64_MOV, .reg = descs[i].reg, .base = descs[i].reg2};
+		ctx->instrs.data[n_instrs++] = ctx->instrs.data[i];
+	}
+	ctx->instrs.length = n_instrs;
+	free(descs);
+}
+
+// lowers the procedure `proc_id`, or the initializer of the data block `proc_id` if it's negative, into `ctx->instrs`;
+// the initializer evaluates the data block right in its place, with the stack growing down from the end of it
+static void lowerProc_x86_64(x86_64_CodegenCtx* ctx, BR_id proc_id)
+{
+	const BR_Module* module = &ctx->builder.module;
+	const BR_OpArray body = proc_id < 0 ? module->seg_data.data[~proc_id].body : module->seg_exec.data[proc_id].body;
+	const bool is_entry = proc_id >= 0 && module->exec_entry_point == (uintptr_t)proc_id;
+	ctx->instrs.length = 0;
+	size_t* const depths = getStackDepths(&ctx->builder, proc_id, body.length, &ctx->max_depth);
+	if (is_entry) {
+// the entry point is entered by the kernel instead of being called, and never returns
+		arrayForeach (BR_DataBlock, block, ctx->module->seg_data) {
+			if (!block->data.length)
+				addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_CALL_INIT, .db_id = ~(block - ctx->module->seg_data.data)});
+		}
+	}
+	addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_PUSH, .reg = X86_64_RBP});
+	if (proc_id < 0) {
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_LEA_DATA, .reg = X86_64_RBP, .db_id = proc_id, .value = ctx->max_depth});
+	} else {
+// the stack of the procedure is its native stack frame
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_MOV, .reg = X86_64_RBP, .base = X86_64_RSP});
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_SUB_IMM, .reg = X86_64_RSP, .value = alignby(ctx->max_depth, 16)});
+	}
+	for (uint32_t i = 0; i < body.length; ++i) {
+		lowerOp_x86_64(ctx, proc_id, i, depths[i], depths[i + 1]);
+	}
+	if (is_entry) {
+		addMovImm_x86_64(ctx, X86_64_RDI, 0);
+		addMovImm_x86_64(ctx, X86_64_RAX, LINUX_X86_64_SYS_EXIT);
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_SYSCALL});
+	} else {
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = proc_id < 0 ? X86_64_POP : X86_64_LEAVE, .reg = X86_64_RBP});
+		addInstr_x86_64(ctx, (x86_64_Instr){.type = X86_64_RET});
+	}
+	free(depths);
+	optimizeInstrs_x86_64(ctx);
+}
+
+static long printArith_x86_64(FILE* dst, BR_OpType base_op, uint8_t size)
+{
+// as in C, the operand of a shift is promoted to `int` if it's narrower, and the rest of the operations are done in 64 bits
+	const char* const rax = size == 8 ? "rax" : "eax";
+	const char suffix = size == 8 ? 'q' : 'l';
+	switch ((uint16_t)base_op) {
+		case BR_OP_ADD:  return str_fput(dst, "\taddq\t%rcx, %rax\n");
+		case BR_OP_SUB:  return str_fput(dst, "\tsubq\t%rcx, %rax\n");
+		case BR_OP_MUL:  return str_fput(dst, "\timulq\t%rcx, %rax\n");
+		case BR_OP_DIV:  return str_fput(dst, "\txorl\t%edx, %edx\n\tdivq\t%rcx\n");
+		case BR_OP_DIVS: return str_fput(dst, "\tcqto\n\tidivq\t%rcx\n");
+		case BR_OP_MOD:  return str_fput(dst, "\txorl\t%edx, %edx\n\tdivq\t%rcx\n\tmovq\t%rdx, %rax\n");
+		case BR_OP_MODS: return str_fput(dst, "\tcqto\n\tidivq\t%rcx\n\tmovq\t%rdx, %rax\n");
+		case BR_OP_AND:  return str_fput(dst, "\tandq\t%rcx, %rax\n");
+		case BR_OP_OR:   return str_fput(dst, "\torq\t%rcx, %rax\n");
+		case BR_OP_XOR:  return str_fput(dst, "\txorq\t%rcx, %rax\n");
+		case BR_OP_SHL:  return fprintf(dst, "\tshl%c\t%%cl, %%%s\n", suffix, rax);
+		case BR_OP_SHR:  return fprintf(dst, "\tshr%c\t%%cl, %%%s\n", suffix, rax);
+		case BR_OP_SHRS: return fprintf(dst, "\tsar%c\t%%cl, %%%s\n", suffix, rax);
+		default:
+			assert(false, "invalid arithmetic operation type %u", base_op);
+	}
+}
+
+static long printInstr_x86_64(FILE* dst, const BR_Module* module, x86_64_Instr instr)
+{
+	static const char* const load_mnemonics[][2] = {
+		[1] = {"movzbl", "movsbq"},
+		[2] = {"movzwl", "movswq"},
+		[4] = {"movl", "movslq"},
+		[8] = {"movq", "movq"}
+	};
+	switch (instr.type) {
+		case X86_64_NOP:
+			return str_fput(dst, "\tnop\n");
+		case X86_64_LOAD:
+			return fprintf(dst, "\t%s\t%lld(%%%s), %%%s\n",
+				load_mnemonics[instr.size][instr.is_signed], (long long)instr.value, getRegName_x86_64(instr.base, 8),
+				getRegName_x86_64(instr.reg, instr.is_signed || instr.size == 8 ? 8 : 4));
+		case X86_64_STORE:
+			return fprintf(dst, "\tmov%c\t%%%s, %lld(%%%s)\n",
+				x86_64_size_suffixes[instr.size], getRegName_x86_64(instr.reg, instr.size), (long long)instr.value, getRegName_x86_64(instr.base, 8));
+		case X86_64_MOV_IMM:
+			if (!instr.value)
+				return fprintf(dst, "\txorl\t%%%s, %%%s\n", getRegName_x86_64(instr.reg, 4), getRegName_x86_64(instr.reg, 4));
+			if ((uint64_t)instr.value <= UINT32_MAX)
+				return fprintf(dst, "\tmovl\t$%llu, %%%s\n", (unsigned long long)instr.value, getRegName_x86_64(instr.reg, 4));
+			if (instr.value == (int32_t)instr.value)
+				return fprintf(dst, "\tmovq\t$%lld, %%%s\n", (long long)instr.value, getRegName_x86_64(instr.reg, 8));
+			return fprintf(dst, "\tmovabsq\t$%llu, %%%s\n", (unsigned long long)instr.value, getRegName_x86_64(instr.reg, 8));
+		case X86_64_MOV:
+			return fprintf(dst, "\tmovq\t%%%s, %%%s\n", getRegName_x86_64(instr.base, 8), getRegName_x86_64(instr.reg, 8));
+		case X86_64_LEA:
+			return fprintf(dst, "\tleaq\t%lld(%%%s), %%%s\n", (long long)instr.value, getRegName_x86_64(instr.base, 8), getRegName_x86_64(instr.reg, 8));
+		case X86_64_LEA_DATA:
+			return str_fput(dst, "\tleaq\t")
+				+ printLabel(dst, module->seg_data.data[~instr.db_id].name, ".brb_db_")
+				+ fprintf(dst, "%+lld(%%rip), %%%s\n", (long long)instr.value, getRegName_x86_64(instr.reg, 8));
+		case X86_64_ARITH:
+			return printArith_x86_64(dst, instr.op, instr.size);
+		case X86_64_NOT:
+			return str_fput(dst, "\tnotq\t%rax\n");
+		case X86_64_SUB_IMM:
+			return fprintf(dst, "\tsubq\t$%lld, %%%s\n", (long long)instr.value, getRegName_x86_64(instr.reg, 8));
+		case X86_64_PUSH:
+			return fprintf(dst, "\tpushq\t%%%s\n", getRegName_x86_64(instr.reg, 8));
+		case X86_64_POP:
+			return fprintf(dst, "\tpopq\t%%%s\n", getRegName_x86_64(instr.reg, 8));
+		case X86_64_CALL_INIT:
+			return str_fput(dst, "\tcall\t")
+				+ printLabel(dst, module->seg_data.data[~instr.db_id].name, ".brb_db_impl_")
+				+ str_fput(dst, "\n");
+		case X86_64_LEAVE:
+			return str_fput(dst, "\tleave\n");
+		case X86_64_RET:
+			return str_fput(dst, "\tret\n");
+		case X86_64_SYSCALL:
+			return str_fput(dst, "\tsyscall\n");
+		case X86_64_CLAMP_ERROR:
+			return str_fput(dst,
+				"\ttestq\t%rax, %rax\n"
+				"\tjns\t1f\n"
+				"\tmovq\t$-1, %rax\n"
+				"1:\n");
+		case X86_64_REP_MOVSB:
+			return str_fput(dst, "\trep movsb\n");
+		case X86_64_REP_STOSB:
+			return str_fput(dst, "\trep stosb\n");
+		case X86_64_N_INSTR_TYPES:
+		default:
+			assert(false, "invalid x86-64 instruction type %u", instr.type);
+	}
+}
+
+static long printInstrs_x86_64(FILE* dst, const x86_64_CodegenCtx* ctx)
+{
+	long acc = 0;
+	arrayForeach (x86_64_Instr, instr, ctx->instrs) {
+		acc += printInstr_x86_64(dst, &ctx->builder.module, *instr);
+	}
+	return acc;
+}
+
+long BR_compileModule_linux_x86_64(const BR_Module* module, FILE* dst, char** entry_point_name)
+{
+	x86_64_CodegenCtx ctx = {.module = module};
+	BR_Error err = BR_analyzeModule(module, &ctx.builder);
+	if (err.type) {
+		BR_printErrorMsg(stderr, err, "error while analyzing module");
+		abort();
+	}
+	long acc = 0;
+	arrayForeach (BR_DataBlock, block, module->seg_data) {
+		const BR_id db_id = ~(block - module->seg_data.data);
+// the contents of a pre-evaluated data block are emitted as is, and it has no initializer
+		if (block->data.length) {
+			acc += str_fput(dst, ".data\n"
+				".balign 16\n")
+				+ printLabel(dst, block->name, ".brb_db_")
+				+ str_fput(dst, ":");
+			for (size_t i = 0; i < block->data.length; ++i) {
+				acc += fprintf(dst, i % 16 ? ", %hhu" : "\n\t.byte\t%hhu", block->data.data[i]);
+			}
+			acc += str_fput(dst, "\n");
+			continue;
+		}
+		lowerProc_x86_64(&ctx, db_id);
+		acc += str_fput(dst, ".bss\n"
+			".balign 16\n")
+			+ printLabel(dst, block->name, ".brb_db_")
+			+ fprintf(dst, ":\n"
+				"\t.zero\t%zu\n"
+				".text\n", ctx.max_depth)
+			+ printLabel(dst, block->name, ".brb_db_impl_")
+			+ str_fput(dst, ":\n")
+			+ printInstrs_x86_64(dst, &ctx);
+	}
+
+	acc += str_fput(dst, ".text\n");
+	arrayForeach (BR_Proc, proc, module->seg_exec) {
+		const BR_id proc_id = proc - module->seg_exec.data;
+// making the label global if the proc is the entry point
+		if (module->exec_entry_point == (uintptr_t)proc_id) {
+			if (entry_point_name) *entry_point_name = strdup(proc->name);
+			acc += str_fput(dst, ".global ")
+				+ printLabel(dst, proc->name, "")
+				+ str_fput(dst, "\n");
+		}
+		lowerProc_x86_64(&ctx, proc_id);
+		acc += printLabel(dst, proc->name, "")
+			+ str_fput(dst, ":\n")
+			+ printInstrs_x86_64(dst, &ctx);
+	}
+	x86_64_InstrArray_clear(&ctx.instrs);
+	BR_Module _;
+	err = BR_extractModule(ctx.builder, &_);
+	assert(!err.type, "%s", getErrorMsg(err, "error while analyzing module for native assembly generation"))
+	BR_deallocDataBlocks(&_);
+	BR_deallocProcs(&_);
+	BR_deallocStructs(&_);
+
+	return acc;
+}
+
+defArray(uint8_t);
+
+// a reference from the machine code to a data block or to its initializer, which is resolved when the layout of the output is known
+typedef struct {
+	uint32_t offset; // the offset of the 32-bit field to be filled in within the code
+	BR_id db_id;
+	int64_t addend; // the offset within the data block
+	bool to_init; // whether the target is the initializer of the data block and not the data block itself
+} x86_64_Fixup;
+defArray(x86_64_Fixup);
+
+typedef struct {
+	uint8_tArray code;
+	x86_64_FixupArray fixups;
+} x86_64_MachineCode;
+
+static void emit_x86_64(x86_64_MachineCode* mc, uint32_t n, const uint8_t* bytes)
+{
+	uint8_t* const dst = uint8_tArray_incrlen(&mc->code, n);
+	assert(dst, "memory allocation failure during native code generation");
+	memcpy(dst, bytes, n);
+}
+#define EMIT(mc, ...) emit_x86_64(mc, sizeof((uint8_t[]){__VA_ARGS__}), (uint8_t[]){__VA_ARGS__})
+
+static void emitImm32_x86_64(x86_64_MachineCode* mc, uint32_t value)
+{
+	EMIT(mc, value, value >> 8, value >> 16, value >> 24);
+}
+
+// emits `<opcode> reg, value(%base)`; `prefix` is 0x66 for 16-bit operands or 0 otherwise, `w` selects 64-bit operands,
+// and `byte_reg` makes the REX prefix mandatory so that `reg` means %sil or %dil instead of %dh or %bh
+static void emitMem_x86_64(x86_64_MachineCode* mc, uint8_t prefix, bool w, bool byte_reg, uint16_t opcode, x86_64_Reg reg, x86_64_Reg base, int64_t disp)
+{
+	assert(base != X86_64_RSP, "%%rsp can't be the base of a memory operand");
+	if (prefix) EMIT(mc, prefix);
+	if (w || (byte_reg && reg >= X86_64_RSP)) EMIT(mc, 0x40 | w << 3);
+	if (opcode > 0xFF) EMIT(mc, opcode >> 8);
+// a zero displacement can be omitted unless the base is %rbp, since that encoding means RIP-relative addressing
+	if (!disp && base != X86_64_RBP) {
+		EMIT(mc, opcode, reg << 3 | base);
+	} else if (disp == (int8_t)disp) {
+		EMIT(mc, opcode, 0x40 | reg << 3 | base, disp);
+	} else {
+		EMIT(mc, opcode, 0x80 | reg << 3 | base);
+		emitImm32_x86_64(mc, disp);
+	}
+}
+
+// emits `<opcode> rm, reg` with both operands in registers
+static void emitReg_x86_64(x86_64_MachineCode* mc, bool w, uint16_t opcode, uint8_t reg, x86_64_Reg rm)
+{
+	if (w) EMIT(mc, 0x48);
+	if (opcode > 0xFF) EMIT(mc, opcode >> 8);
+	EMIT(mc, opcode, 0xC0 | reg << 3 | rm);
+}
+
+static void emitFixup_x86_64(x86_64_MachineCode* mc, BR_id db_id, int64_t addend, bool to_init)
+{
+	assert(x86_64_FixupArray_append(&mc->fixups, (x86_64_Fixup){.offset = mc->code.length, .db_id = db_id, .addend = addend, .to_init = to_init}),
+		"memory allocation failure during native code generation");
+	emitImm32_x86_64(mc, 0);
+}
+
+static void encodeArith_x86_64(x86_64_MachineCode* mc, BR_OpType base_op, uint8_t size)
+{
+	switch ((uint16_t)base_op) {
+		case BR_OP_ADD:
+			emitReg_x86_64(mc, true, 0x01, X86_64_RCX, X86_64_RAX);
+			break;
+		case BR_OP_SUB:
+			emitReg_x86_64(mc, true, 0x29, X86_64_RCX, X86_64_RAX);
+			break;
+		case BR_OP_MUL:
+			emitReg_x86_64(mc, true, 0x0FAF, X86_64_RAX, X86_64_RCX);
+			break;
+		case BR_OP_DIV:
+		case BR_OP_MOD:
+			emitReg_x86_64(mc, false, 0x31, X86_64_RDX, X86_64_RDX); // xorl %edx, %edx
+			emitReg_x86_64(mc, true, 0xF7, 6, X86_64_RCX); // divq %rcx
+			if (base_op == BR_OP_MOD) emitReg_x86_64(mc, true, 0x89, X86_64_RDX, X86_64_RAX);
+			break;
+		case BR_OP_DIVS:
+		case BR_OP_MODS:
+			EMIT(mc, 0x48, 0x99); // cqto
+			emitReg_x86_64(mc, true, 0xF7, 7, X86_64_RCX); // idivq %rcx
+			if (base_op == BR_OP_MODS) emitReg_x86_64(mc, true, 0x89, X86_64_RDX, X86_64_RAX);
+			break;
+		case BR_OP_AND:
+			emitReg_x86_64(mc, true, 0x21, X86_64_RCX, X86_64_RAX);
+			break;
+		case BR_OP_OR:
+			emitReg_x86_64(mc, true, 0x09, X86_64_RCX, X86_64_RAX);
+			break;
+		case BR_OP_XOR:
+			emitReg_x86_64(mc, true, 0x31, X86_64_RCX, X86_64_RAX);
+			break;
+		case BR_OP_SHL:
+			emitReg_x86_64(mc, size == 8, 0xD3, 4, X86_64_RAX);
+			break;
+		case BR_OP_SHR:
+			emitReg_x86_64(mc, size == 8, 0xD3, 5, X86_64_RAX);
+			break;
+		case BR_OP_SHRS:
+			emitReg_x86_64(mc, size == 8, 0xD3, 7, X86_64_RAX);
+			break;
+		default:
+			assert(false, "invalid arithmetic operation type %u", base_op);
+	}
+}
+
+// encodes an instruction exactly as the assembler would encode its printed form
+static void encodeInstr_x86_64(x86_64_MachineCode* mc, x86_64_Instr instr)
+{
+	switch (instr.type) {
+		case X86_64_NOP:
+			EMIT(mc, 0x90);
+			break;
+		case X86_64_LOAD:
+			switch (instr.size) {
+				case 1:
+					emitMem_x86_64(mc, 0, instr.is_signed, false, instr.is_signed ? 0x0FBE : 0x0FB6, instr.reg, instr.base, instr.value);
+					break;
+				case 2:
+					emitMem_x86_64(mc, 0, instr.is_signed, false, instr.is_signed ? 0x0FBF : 0x0FB7, instr.reg, instr.base, instr.value);
+					break;
+				case 4:
+					emitMem_x86_64(mc, 0, instr.is_signed, false, instr.is_signed ? 0x63 : 0x8B, instr.reg, instr.base, instr.value);
+					break;
+				default:
+					emitMem_x86_64(mc, 0, true, false, 0x8B, instr.reg, instr.base, instr.value);
+			}
+			break;
+		case X86_64_STORE:
+			switch (instr.size) {
+				case 1:
+					emitMem_x86_64(mc, 0, false, true, 0x88, instr.reg, instr.base, instr.value);
+					break;
+				case 2:
+					emitMem_x86_64(mc, 0x66, false, false, 0x89, instr.reg, instr.base, instr.value);
+					break;
+				case 4:
+					emitMem_x86_64(mc, 0, false, false, 0x89, instr.reg, instr.base, instr.value);
+					break;
+				default:
+					emitMem_x86_64(mc, 0, true, false, 0x89, instr.reg, instr.base, instr.value);
+			}
+			break;
+		case X86_64_MOV_IMM:
+			if (!instr.value) {
+				emitReg_x86_64(mc, false, 0x31, instr.reg, instr.reg);
+			} else if ((uint64_t)instr.value <= UINT32_MAX) {
+				EMIT(mc, 0xB8 + instr.reg);
+				emitImm32_x86_64(mc, instr.value);
+			} else if (instr.value == (int32_t)instr.value) {
+				emitReg_x86_64(mc, true, 0xC7, 0, instr.reg);
+				emitImm32_x86_64(mc, instr.value);
+			} else {
+				EMIT(mc, 0x48, 0xB8 + instr.reg);
+				emitImm32_x86_64(mc, instr.value);
+				emitImm32_x86_64(mc, (uint64_t)instr.value >> 32);
+			}
+			break;
+		case X86_64_MOV:
+			emitReg_x86_64(mc, true, 0x89, instr.base, instr.reg);
+			break;
+		case X86_64_LEA:
+			emitMem_x86_64(mc, 0, true, false, 0x8D, instr.reg, instr.base, instr.value);
+			break;
+		case X86_64_LEA_DATA:
+			EMIT(mc, 0x48, 0x8D, 0x05 | instr.reg << 3); // RIP-relative
+			emitFixup_x86_64(mc, instr.db_id, instr.value, false);
+			break;
+		case X86_64_ARITH:
+			encodeArith_x86_64(mc, instr.op, instr.size);
+			break;
+		case X86_64_NOT:
+			emitReg_x86_64(mc, true, 0xF7, 2, X86_64_RAX);
+			break;
+		case X86_64_SUB_IMM:
+			if (instr.value == (int8_t)instr.value) {
+				emitReg_x86_64(mc, true, 0x83, 5, instr.reg);
+				EMIT(mc, instr.value);
+			} else {
+				emitReg_x86_64(mc, true, 0x81, 5, instr.reg);
+				emitImm32_x86_64(mc, instr.value);
+			}
+			break;
+		case X86_64_PUSH:
+			EMIT(mc, 0x50 + instr.reg);
+			break;
+		case X86_64_POP:
+			EMIT(mc, 0x58 + instr.reg);
+			break;
+		case X86_64_CALL_INIT:
+			EMIT(mc, 0xE8);
+			emitFixup_x86_64(mc, instr.db_id, 0, true);
+			break;
+		case X86_64_LEAVE:
+			EMIT(mc, 0xC9);
+			break;
+		case X86_64_RET:
+			EMIT(mc, 0xC3);
+			break;
+		case X86_64_SYSCALL:
+			EMIT(mc, 0x0F, 0x05);
+			break;
+		case X86_64_CLAMP_ERROR:
+			EMIT(mc,
+				0x48, 0x85, 0xC0,                        // testq %rax, %rax
+				0x79, 0x07,                              // jns 1f
+				0x48, 0xC7, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF // movq $-1, %rax
+			);
+			break;
+		case X86_64_REP_MOVSB:
+			EMIT(mc, 0xF3, 0xA4);
+			break;
+		case X86_64_REP_STOSB:
+			EMIT(mc, 0xF3, 0xAA);
+			break;
+		case X86_64_N_INSTR_TYPES:
+		default:
+			assert(false, "invalid x86-64 instruction type %u", instr.type);
+	}
+}
+
+// ELF constants, defined here since `elf.h` is not available everywhere
+#define ELF_HEADER_SIZE 64
+#define ELF_PHDR_SIZE 56
+#define ELF_SHDR_SIZE 64
+#define ELF_SYM_SIZE 24
+#define ELF_RELA_SIZE 24
+#define ELF_ET_REL 1
+#define ELF_ET_EXEC 2
+#define ELF_EM_X86_64 62
+#define ELF_PT_LOAD 1
+#define ELF_PT_GNU_STACK 0x6474E551
+#define ELF_PF_X 1
+#define ELF_PF_W 2
+#define ELF_PF_R 4
+#define ELF_SHT_PROGBITS 1
+#define ELF_SHT_SYMTAB 2
+#define ELF_SHT_STRTAB 3
+#define ELF_SHT_RELA 4
+#define ELF_SHT_NOBITS 8
+#define ELF_SHF_WRITE 1
+#define ELF_SHF_ALLOC 2
+#define ELF_SHF_EXECINSTR 4
+#define ELF_SHF_INFO_LINK 0x40
+#define ELF_STB_LOCAL 0
+#define ELF_STB_GLOBAL 1
+#define ELF_STT_OBJECT 1
+#define ELF_STT_FUNC 2
+#define ELF_R_X86_64_PC32 2
+// the address at which the executables are loaded, as in the default linker script
+#define ELF_EXEC_BASE 0x400000
+#define ELF_PAGE_SIZE 0x1000
+
+static void put_x86_64(uint8_tArray* dst, uint64_t value, uint8_t size)
+{
+	uint8_t* const bytes = uint8_tArray_incrlen(dst, size);
+	assert(bytes, "memory allocation failure during native code generation");
+	for (uint8_t i = 0; i < size; ++i) {
+		bytes[i] = value >> i * 8;
+	}
+}
+
+static void padTo_x86_64(uint8_tArray* dst, size_t offset)
+{
+	while (dst->length < offset) put_x86_64(dst, 0, 1);
+}
+
+// appends a NUL-terminated string to a string table; returns its offset within the table
+static uint32_t addString_x86_64(uint8_tArray* strtab, const char* str)
+{
+	const uint32_t res = strtab->length;
+	const size_t length = strlen(str) + 1;
+	uint8_t* const dst = uint8_tArray_incrlen(strtab, length);
+	assert(dst, "memory allocation failure during native code generation");
+	memcpy(dst, str, length);
+	return res;
+}
+
+static void addSymbol_x86_64(uint8_tArray* symtab, uint8_tArray* strtab, const char* prefix, const char* name, uint8_t info, uint16_t section_id, uint64_t value, uint64_t size)
+{
+	char* const full_name = sbuf_tostr(sbuf_fromstr((char*)prefix), sbuf_fromstr((char*)name));
+	put_x86_64(symtab, addString_x86_64(strtab, full_name), 4);
+	put_x86_64(symtab, info, 1);
+	put_x86_64(symtab, 0, 1);
+	put_x86_64(symtab, section_id, 2);
+	put_x86_64(symtab, value, 8);
+	put_x86_64(symtab, size, 8);
+	free(full_name);
+}
+
+typedef struct {
+	uint32_t name;
+	uint32_t type;
+	uint64_t flags;
+	uint64_t addr;
+	uint64_t offset;
+	uint64_t size;
+	uint32_t link;
+	uint32_t info;
+	uint64_t align;
+	uint64_t entsize;
+} ELF_SectionHeader;
+
+long BR_compileModuleELF_linux_x86_64(const BR_Module* module, FILE* dst, bool executable)
+{
+	x86_64_CodegenCtx ctx = {.module = module};
+	BR_Error err = BR_analyzeModule(module, &ctx.builder);
+	if (err.type) {
+		BR_printErrorMsg(stderr, err, "error while analyzing module");
+		abort();
+	}
+// generating the code; the initializers of the data blocks come first, as in the assembly
+	x86_64_MachineCode mc = {0};
+	uint64_t* const db_offsets = calloc(module->seg_data.length * 3 + module->seg_exec.length + 1, sizeof(uint64_t));
+	assert(db_offsets, "memory allocation failure during native code generation");
+	uint64_t* const db_sizes = db_offsets + module->seg_data.length;
+	uint64_t* const init_offsets = db_sizes + module->seg_data.length;
+	uint64_t* const proc_offsets = init_offsets + module->seg_data.length;
+	size_t data_size = 0, bss_size = 0;
+	arrayForeach (BR_DataBlock, block, module->seg_data) {
+		const BR_id db_id = ~(block - module->seg_data.data);
+		if (block->data.length) {
+			db_offsets[~db_id] = data_size = alignby(data_size, 16);
+			data_size += db_sizes[~db_id] = block->data.length;
+			continue;
+		}
+		init_offsets[~db_id] = mc.code.length;
+		lowerProc_x86_64(&ctx, db_id);
+		db_offsets[~db_id] = bss_size = alignby(bss_size, 16);
+		bss_size += db_sizes[~db_id] = ctx.max_depth;
+		arrayForeach (x86_64_Instr, instr, ctx.instrs) {
+			encodeInstr_x86_64(&mc, *instr);
+		}
+	}
+	arrayForeach (BR_Proc, proc, module->seg_exec) {
+		proc_offsets[proc - module->seg_exec.data] = mc.code.length;
+		lowerProc_x86_64(&ctx, proc - module->seg_exec.data);
+		arrayForeach (x86_64_Instr, instr, ctx.instrs) {
+			encodeInstr_x86_64(&mc, *instr);
+		}
+	}
+	proc_offsets[module->seg_exec.length] = mc.code.length;
+	x86_64_InstrArray_clear(&ctx.instrs);
+// laying out the file: the headers, the code, the contents of the data blocks, the relocations, the symbols, the strings and the section headers;
+// in an executable, the code is loaded along with the headers before it, and the data blocks are loaded at the next page
+	const uint8_t n_phdrs = executable ? (data_size || bss_size ? 3 : 2) : 0;
+	const uint64_t text_offset = alignby(ELF_HEADER_SIZE + n_phdrs * ELF_PHDR_SIZE, 16),
+		data_offset = alignby(text_offset + mc.code.length, 16),
+		text_addr = executable ? ELF_EXEC_BASE + text_offset : 0,
+		data_addr = executable ? alignby(ELF_EXEC_BASE + data_offset, ELF_PAGE_SIZE) + data_offset % ELF_PAGE_SIZE : 0,
+		bss_addr = executable ? data_addr + alignby(data_size, 16) : 0;
+// resolving the references; in an object file, the references to the data blocks are left to the linker
+	uint8_tArray relocs = {0};
+	arrayForeach (x86_64_Fixup, fixup, mc.fixups) {
+		int64_t target;
+		if (fixup->to_init) {
+			target = init_offsets[~fixup->db_id] - (fixup->offset + 4);
+		} else if (executable) {
+			target = (module->seg_data.data[~fixup->db_id].data.length ? data_addr : bss_addr)
+				+ db_offsets[~fixup->db_id] + fixup->addend
+				- (text_addr + fixup->offset + 4);
+		} else {
+			put_x86_64(&relocs, fixup->offset, 8);
+// the symbols of the data blocks follow the null symbol
+			put_x86_64(&relocs, (uint64_t)(~fixup->db_id + 1) << 32 | ELF_R_X86_64_PC32, 8);
+			put_x86_64(&relocs, fixup->addend - 4, 8);
+			continue;
+		}
+		memcpy(&mc.code.data[fixup->offset], &(int32_t){target}, 4);
+	}
+	x86_64_FixupArray_clear(&mc.fixups);
+// building the symbol table; the local symbols must precede the global ones
+	uint8_tArray symtab = {0}, strtab = {0}, shstrtab = {0};
+	addString_x86_64(&strtab, "");
+	addString_x86_64(&shstrtab, "");
+	enum {
+		SECTION_NULL,
+		SECTION_TEXT,
+		SECTION_DATA,
+		SECTION_BSS,
+		SECTION_SYMTAB,
+		SECTION_STRTAB,
+		SECTION_SHSTRTAB,
+		SECTION_RELA_TEXT,
+		N_SECTIONS
+	};
+	const uint8_t n_sections = executable ? SECTION_RELA_TEXT : N_SECTIONS;
+	put_x86_64(&symtab, 0, ELF_SYM_SIZE);
+	arrayForeach (BR_DataBlock, block, module->seg_data) {
+		const BR_id db_id = ~(block - module->seg_data.data);
+		addSymbol_x86_64(&symtab, &strtab, ".brb_db_", block->name, ELF_STB_LOCAL << 4 | ELF_STT_OBJECT,
+			block->data.length ? SECTION_DATA : SECTION_BSS,
+			(block->data.length ? data_addr : bss_addr) + db_offsets[~db_id],
+			db_sizes[~db_id]);
+	}
+	arrayForeach (BR_DataBlock, block, module->seg_data) {
+		if (!block->data.length)
+			addSymbol_x86_64(&symtab, &strtab, ".brb_db_impl_", block->name, ELF_STB_LOCAL << 4 | ELF_STT_FUNC, SECTION_TEXT,
+				text_addr + init_offsets[block - module->seg_data.data], 0);
+	}
+	uint32_t first_global = symtab.length / ELF_SYM_SIZE;
+	for (uint8_t global = 0; global < 2; ++global) {
+		arrayForeach (BR_Proc, proc, module->seg_exec) {
+			const BR_id proc_id = proc - module->seg_exec.data;
+			if ((module->exec_entry_point == (uintptr_t)proc_id) != global) continue;
+			addSymbol_x86_64(&symtab, &strtab, "", proc->name, (global ? ELF_STB_GLOBAL : ELF_STB_LOCAL) << 4 | ELF_STT_FUNC, SECTION_TEXT,
+				text_addr + proc_offsets[proc_id], proc_offsets[proc_id + 1] - proc_offsets[proc_id]);
+		}
+		if (!global) first_global = symtab.length / ELF_SYM_SIZE;
+	}
+	ELF_SectionHeader sections[N_SECTIONS] = {
+		[SECTION_TEXT] = {
+			.name = addString_x86_64(&shstrtab, ".text"),
+			.type = ELF_SHT_PROGBITS,
+			.flags = ELF_SHF_ALLOC | ELF_SHF_EXECINSTR,
+			.addr = text_addr,
+			.offset = text_offset,
+			.size = mc.code.length,
+			.align = 16
+		},
+		[SECTION_DATA] = {
+			.name = addString_x86_64(&shstrtab, ".data"),
+			.type = ELF_SHT_PROGBITS,
+			.flags = ELF_SHF_ALLOC | ELF_SHF_WRITE,
+			.addr = data_addr,
+			.offset = data_offset,
+			.size = data_size,
+			.align = 16
+		},
+		[SECTION_BSS] = {
+			.name = addString_x86_64(&shstrtab, ".bss"),
+			.type = ELF_SHT_NOBITS,
+			.flags = ELF_SHF_ALLOC | ELF_SHF_WRITE,
+			.addr = bss_addr,
+			.offset = data_offset + alignby(data_size, 16),
+			.size = bss_size,
+			.align = 16
+		},
+		[SECTION_SYMTAB] = {
+			.name = addString_x86_64(&shstrtab, ".symtab"),
+			.type = ELF_SHT_SYMTAB,
+			.size = symtab.length,
+			.link = SECTION_STRTAB,
+			.info = first_global,
+			.align = 8,
+			.entsize = ELF_SYM_SIZE
+		},
+		[SECTION_STRTAB] = {
+			.name = addString_x86_64(&shstrtab, ".strtab"),
+			.type = ELF_SHT_STRTAB,
+			.size = strtab.length,
+			.align = 1
+		},
+		[SECTION_SHSTRTAB] = {
+			.name = addString_x86_64(&shstrtab, ".shstrtab"),
+			.type = ELF_SHT_STRTAB,
+			.align = 1
+		},
+		[SECTION_RELA_TEXT] = {
+			.name = executable ? 0 : addString_x86_64(&shstrtab, ".rela.text"),
+			.type = ELF_SHT_RELA,
+			.flags = ELF_SHF_INFO_LINK,
+			.size = relocs.length,
+			.link = SECTION_SYMTAB,
+			.info = SECTION_TEXT,
+			.align = 8,
+			.entsize = ELF_RELA_SIZE
+		}
+	};
+	sections[SECTION_SHSTRTAB].size = shstrtab.length;
+	uint64_t offset = data_offset + data_size;
+	sections[SECTION_RELA_TEXT].offset = offset = alignby(offset, 8);
+	if (!executable) offset += relocs.length;
+	sections[SECTION_SYMTAB].offset = offset = alignby(offset, 8);
+	sections[SECTION_STRTAB].offset = offset += symtab.length;
+	sections[SECTION_SHSTRTAB].offset = offset += strtab.length;
+	const uint64_t shdrs_offset = alignby(offset + shstrtab.length, 8);
+// writing the file
+	uint8_tArray res = {0};
+	put_x86_64(&res, 0x7F | 'E' << 8 | 'L' << 16 | 'F' << 24, 4);
+	put_x86_64(&res, 2 | 1 << 8 | 1 << 16, 4); // 64-bit, little-endian, version 1, System V ABI
+	put_x86_64(&res, 0, 8);
+	put_x86_64(&res, executable ? ELF_ET_EXEC : ELF_ET_REL, 2);
+	put_x86_64(&res, ELF_EM_X86_64, 2);
+	put_x86_64(&res, 1, 4);
+	put_x86_64(&res, executable ? text_addr + proc_offsets[module->exec_entry_point] : 0, 8);
+	put_x86_64(&res, n_phdrs ? ELF_HEADER_SIZE : 0, 8);
+	put_x86_64(&res, shdrs_offset, 8);
+	put_x86_64(&res, 0, 4);
+	put_x86_64(&res, ELF_HEADER_SIZE, 2);
+	put_x86_64(&res, ELF_PHDR_SIZE, 2);
+	put_x86_64(&res, n_phdrs, 2);
+	put_x86_64(&res, ELF_SHDR_SIZE, 2);
+	put_x86_64(&res, n_sections, 2);
+	put_x86_64(&res, SECTION_SHSTRTAB, 2);
+	if (executable) {
+		const struct {
+			uint32_t type;
+			uint32_t flags;
+			uint64_t offset;
+			uint64_t addr;
+			uint64_t file_size;
+			uint64_t mem_size;
+			uint64_t align;
+		} phdrs[] = {
+			{ELF_PT_LOAD, ELF_PF_R | ELF_PF_X, 0, ELF_EXEC_BASE, text_offset + mc.code.length, text_offset + mc.code.length, ELF_PAGE_SIZE},
+			{ELF_PT_GNU_STACK, ELF_PF_R | ELF_PF_W, 0, 0, 0, 0, 16},
+			{ELF_PT_LOAD, ELF_PF_R | ELF_PF_W, data_offset, data_addr, data_size, bss_addr + bss_size - data_addr, ELF_PAGE_SIZE}
+		};
+		for (uint8_t i = 0; i < n_phdrs; ++i) {
+			put_x86_64(&res, phdrs[i].type, 4);
+			put_x86_64(&res, phdrs[i].flags, 4);
+			put_x86_64(&res, phdrs[i].offset, 8);
+			put_x86_64(&res, phdrs[i].addr, 8);
+			put_x86_64(&res, phdrs[i].addr, 8);
+			put_x86_64(&res, phdrs[i].file_size, 8);
+			put_x86_64(&res, phdrs[i].mem_size, 8);
+			put_x86_64(&res, phdrs[i].align, 8);
+		}
+	}
+	padTo_x86_64(&res, text_offset);
+	assert(uint8_tArray_extend(&res, mc.code), "memory allocation failure during native code generation");
+	padTo_x86_64(&res, data_offset);
+	arrayForeach (BR_DataBlock, block, module->seg_data) {
+		if (!block->data.length) continue;
+		padTo_x86_64(&res, data_offset + db_offsets[block - module->seg_data.data]);
+		const uint8_tArray contents = {.data = (uint8_t*)block->data.data, .length = block->data.length};
+		assert(uint8_tArray_extend(&res, contents), "memory allocation failure during native code generation");
+	}
+	padTo_x86_64(&res, sections[SECTION_RELA_TEXT].offset);
+	if (!executable) assert(uint8_tArray_extend(&res, relocs), "memory allocation failure during native code generation");
+	padTo_x86_64(&res, sections[SECTION_SYMTAB].offset);
+	assert(uint8_tArray_extend(&res, symtab), "memory allocation failure during native code generation");
+	assert(uint8_tArray_extend(&res, strtab), "memory allocation failure during native code generation");
+	assert(uint8_tArray_extend(&res, shstrtab), "memory allocation failure during native code generation");
+	padTo_x86_64(&res, shdrs_offset);
+	for (uint8_t i = 0; i < n_sections; ++i) {
+		put_x86_64(&res, sections[i].name, 4);
+		put_x86_64(&res, sections[i].type, 4);
+		put_x86_64(&res, sections[i].flags, 8);
+		put_x86_64(&res, sections[i].addr, 8);
+		put_x86_64(&res, sections[i].offset, 8);
+		put_x86_64(&res, sections[i].size, 8);
+		put_x86_64(&res, sections[i].link, 4);
+		put_x86_64(&res, sections[i].info, 4);
+		put_x86_64(&res, sections[i].align, 8);
+		put_x86_64(&res, sections[i].entsize, 8);
+	}
+	const long acc = fwrite(res.data, 1, res.length, dst);
+
+	uint8_tArray_clear(&res);
+	uint8_tArray_clear(&shstrtab);
+	uint8_tArray_clear(&strtab);
+	uint8_tArray_clear(&symtab);
+	uint8_tArray_clear(&relocs);
+	uint8_tArray_clear(&mc.code);
+	free(db_offsets);
+	BR_Module _;
+	err = BR_extractModule(ctx.builder, &_);
+	assert(!err.type, "%s", getErrorMsg(err, "error while analyzing module for native code generation"))
+	BR_deallocDataBlocks(&_);
+	BR_deallocProcs(&_);
+	BR_deallocStructs(&_);
+
+	return acc;
+}
+#undef EMIT
+#undef X86_64_ARITH_STRIDE
+
+// the C backend: every stack item is a local variable named after its position and size, unless the procedure takes the address of some item,
+// in which case the stack is kept in memory just like in the native backends; the items are accessed with `memcpy` to stay clear of the aliasing rules
+#define C_ARITH_STRIDE (BR_OP_SUB - BR_OP_ADD)
+
+static const char c_prelude[] =
+	"#include <stdint.h>\n"
+	"#include <string.h>\n"
+	"#include <unistd.h>\n"
+	"\n"
+	"static inline uint64_t brb_ld(const void* p, size_t size, _Bool is_signed)\n"
+	"{\n"
+	"\tuint8_t x8;\n"
+	"\tuint16_t x16;\n"
+	"\tuint32_t x32;\n"
+	"\tuint64_t x64;\n"
+	"\tswitch (size) {\n"
+	"\t\tcase 1: memcpy(&x8, p, 1); return is_signed ? (uint64_t)(int8_t)x8 : x8;\n"
+	"\t\tcase 2: memcpy(&x16, p, 2); return is_signed ? (uint64_t)(int16_t)x16 : x16;\n"
+	"\t\tcase 4: memcpy(&x32, p, 4); return is_signed ? (uint64_t)(int32_t)x32 : x32;\n"
+	"\t\tdefault: memcpy(&x64, p, 8); return x64;\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"static inline void brb_st(void* p, size_t size, uint64_t x)\n"
+	"{\n"
+	"\tconst uint8_t x8 = x;\n"
+	"\tconst uint16_t x16 = x;\n"
+	"\tconst uint32_t x32 = x;\n"
+	"\tswitch (size) {\n"
+	"\t\tcase 1: memcpy(p, &x8, 1); return;\n"
+	"\t\tcase 2: memcpy(p, &x16, 2); return;\n"
+	"\t\tcase 4: memcpy(p, &x32, 4); return;\n"
+	"\t\tdefault: memcpy(p, &x, 8); return;\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"static inline void* brb_ldp(const void* p)\n"
+	"{\n"
+	"\treturn (void*)(uintptr_t)brb_ld(p, sizeof(void*), 0);\n"
+	"}\n";
+
+typedef struct {
+	BR_ModuleBuilder builder;
+	FILE* dst;
+	bool in_memory; // whether the stack items are kept in memory below `bp` instead of in local variables
+} c_CodegenCtx;
+
+// a buffer for the name of a stack item
+typedef char c_Slot[48];
+
+static bool isScalarSize_c(size_t size)
+{
+	return size == 1 || size == 2 || size == 4 || size == 8;
+}
+
+// writes into `buf` the address of the stack item of `size` bytes that ends `pos` bytes below the base of the stack
+static const char* getSlot_c(const c_CodegenCtx* ctx, c_Slot buf, long long pos, size_t size)
+{
+	if (ctx->in_memory) {
+		snprintf(buf, sizeof(c_Slot), "(bp - %lld)", pos);
+	} else {
+		assert(pos > 0, "procedure arguments are not supported by the C backend");
+		snprintf(buf, sizeof(c_Slot), isScalarSize_c(size) ? "&s%lld_%zu" : "s%lld_%zu", pos, size);
+	}
+	return buf;
+}
+
+// returns the C expression computing the result of an arithmetic operation, given its operands `a` and `b` extended to 64 bits as in the native backends
+static const char* getArithExpr_c(BR_OpType base_op, uint8_t size)
+{
+	switch ((uint16_t)base_op) {
+		case BR_OP_ADD:  return "a + b";
+		case BR_OP_SUB:  return "a - b";
+		case BR_OP_MUL:  return "a * b";
+		case BR_OP_DIV:  return "a / b";
+		case BR_OP_DIVS: return "(uint64_t)((int64_t)a / (int64_t)b)";
+		case BR_OP_MOD:  return "a % b";
+		case BR_OP_MODS: return "(uint64_t)((int64_t)a % (int64_t)b)";
+		case BR_OP_AND:  return "a & b";
+		case BR_OP_OR:   return "a | b";
+		case BR_OP_XOR:  return "a ^ b";
+		case BR_OP_SHL:  return size == 8 ? "a << (b & 63)" : "(uint32_t)a << (b & 31)";
+		case BR_OP_SHR:  return size == 8 ? "a >> (b & 63)" : "(uint32_t)a >> (b & 31)";
+		case BR_OP_SHRS: return size == 8 ? "(uint64_t)((int64_t)a >> (b & 63))" : "(uint64_t)((int32_t)a >> (b & 31))";
+		default:
+			assert(false, "invalid arithmetic operation type %u", base_op);
+	}
+}
+
+static long compileOp_c(c_CodegenCtx* ctx, BR_id proc_id, uint32_t op_id, long long depth, long long depth_after)
+{
+	FILE* const dst = ctx->dst;
+	const BR_Op* op = BR_getOp(&ctx->builder.module, proc_id, op_id);
+	c_Slot a_slot, b_slot, res_slot;
+	if (op->type >= BR_OP_ADD && op->type <= BR_OP_SHRSIAT64) {
+		const BR_OpType base_op = BR_OP_ADD + (op->type - BR_OP_ADD) / C_ARITH_STRIDE * C_ARITH_STRIDE;
+		const bool is_signed = base_op == BR_OP_DIVS || base_op == BR_OP_MODS || base_op == BR_OP_SHRS;
+		if (op->type == base_op) {
+// [A, B] -> [A OP B], where A is on top of the stack
+			const uint8_t size1 = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id - 1, 0),
+				size2 = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id - 1, 1);
+			return fprintf(dst, "\t{ uint64_t a = brb_ld(%s, %u, %u), b = brb_ld(%s, %u, %u); brb_st(%s, %u, %s); }\n",
+				getSlot_c(ctx, a_slot, depth, size1), size1, is_signed,
+				getSlot_c(ctx, b_slot, depth - size1, size2), size2, is_signed,
+				getSlot_c(ctx, res_slot, depth_after, size1), size1, getArithExpr_c(base_op, size1));
+		}
+		const uint8_t size = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0);
+		if (op->type == base_op + 1)
+			return fprintf(dst, "\t{ uint64_t a = brb_ld(%s, %u, %u), b = UINT64_C(%llu); brb_st(%s, %u, %s); }\n",
+				getSlot_c(ctx, a_slot, depth, size), size, is_signed, (unsigned long long)op->operand_u,
+				getSlot_c(ctx, res_slot, depth_after, size), size, getArithExpr_c(base_op, size));
+// [A] -> [*A OP= operand]
+		return fprintf(dst, "\t{ void* p = brb_ldp(%s); uint64_t a = brb_ld(p, %u, %u), b = UINT64_C(%llu), r = %s; brb_st(p, %u, r); brb_st(%s, %u, r); }\n",
+			getSlot_c(ctx, a_slot, depth, sizeof(void*)), size, is_signed, (unsigned long long)op->operand_u, getArithExpr_c(base_op, size),
+			size, getSlot_c(ctx, res_slot, depth_after, size), size);
+	}
+	if (op->type >= BR_OP_NOT && op->type <= BR_OP_NOTAT64) {
+		const uint8_t size = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0);
+		if (op->type == BR_OP_NOT)
+			return fprintf(dst, "\tbrb_st(%s, %u, ~brb_ld(%s, %u, 0));\n",
+				getSlot_c(ctx, res_slot, depth_after, size), size, getSlot_c(ctx, a_slot, depth, size), size);
+		return fprintf(dst, "\t{ void* p = brb_ldp(%s); uint64_t r = ~brb_ld(p, %u, 0); brb_st(p, %u, r); brb_st(%s, %u, r); }\n",
+			getSlot_c(ctx, a_slot, depth, sizeof(void*)), size, size, getSlot_c(ctx, res_slot, depth_after, size), size);
+	}
+// the arithmetic operations are handled above
+	switch ((uint16_t)op->type) {
+		case BR_OP_NOP:
+		case BR_OP_DROP:
+		case BR_OP_NEW:
+			return 0;
+		case BR_OP_END:
+			return str_fput(dst, "\t_exit(0);\n");
+		case BR_OP_I8:
+		case BR_OP_I16:
+		case BR_OP_I32:
+		case BR_OP_PTR:
+		case BR_OP_I64:
+			return fprintf(dst, "\tbrb_st(%s, %lld, UINT64_C(%llu));\n",
+				getSlot_c(ctx, res_slot, depth_after, depth_after - depth), depth_after - depth, (unsigned long long)op->operand_u);
+		case BR_OP_BUILTIN:
+			return fprintf(dst, "\tbrb_st(%s, %zu, UINT64_C(%llu));\n",
+				getSlot_c(ctx, res_slot, depth_after, sizeof(void*)), sizeof(void*), (unsigned long long)BR_builtinValues[op->operand_u]);
+		case BR_OP_ADDR:
+			return fprintf(dst, "\tbrb_st(%s, %zu, (uintptr_t)(bp + %lld));\n",
+				getSlot_c(ctx, res_slot, depth_after, sizeof(void*)), sizeof(void*),
+				(long long)BR_getStackItemRTOffset(&ctx->builder, proc_id, op_id, op->operand_u) - depth_after);
+		case BR_OP_DBADDR:
+			return fprintf(dst, "\tbrb_st(%s, %zu, (uintptr_t)brb_db%lld);\n",
+				getSlot_c(ctx, res_slot, depth_after, sizeof(void*)), sizeof(void*), (long long)~op->operand_s);
+		case BR_OP_SYS: {
+// the arguments are on top of the stack, and the result, if any, replaces the last one
+			c_Slot arg_slots[3];
+			size_t arg_sizes[3];
+			long long pos = depth;
+			for (uint8_t i = 0; i < BR_syscallNArgs[op->operand_u]; ++i) {
+				arg_sizes[i] = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id - 1, i);
+				getSlot_c(ctx, arg_slots[i], pos, arg_sizes[i]);
+				pos -= arg_sizes[i];
+			}
+			if (op->operand_u == BR_SYS_EXIT)
+				return fprintf(dst, "\t_exit((int)brb_ld(%s, %zu, 0));\n", arg_slots[0], arg_sizes[0]);
+// `write` and `read` return -1 on failure, just like the syscalls in the interpreter
+			return fprintf(dst, "\tbrb_st(%s, 8, (uint64_t)%s((int)brb_ld(%s, %zu, 0), brb_ldp(%s), brb_ld(%s, %zu, 0)));\n",
+				getSlot_c(ctx, res_slot, depth_after, sizeof(uint64_t)), op->operand_u == BR_SYS_WRITE ? "write" : "read",
+				arg_slots[0], arg_sizes[0], arg_slots[1], arg_slots[2], arg_sizes[2]);
+		}
+		case BR_OP_ZERO:
+			return fprintf(dst, "\tmemset(%s, 0, %lld);\n", getSlot_c(ctx, res_slot, depth_after, depth_after - depth), depth_after - depth);
+		case BR_OP_GET: {
+			const size_t size = depth_after - depth;
+			return fprintf(dst, "\tmemcpy(%s, %s, %zu);\n",
+				getSlot_c(ctx, res_slot, depth_after, size),
+				getSlot_c(ctx, a_slot, depth - (long long)BR_getStackItemRTOffset(&ctx->builder, proc_id, op_id - 1, op->operand_u), size),
+				size);
+		}
+		case BR_OP_SETAT: {
+// [A, B] -> [B], where B is copied to the address A
+			const size_t size = BR_getStackItemRTSize(&ctx->builder, proc_id, op_id, 0);
+			return fprintf(dst, "\tmemmove(brb_ldp(%s), %s, %zu);\n",
+				getSlot_c(ctx, a_slot, depth, sizeof(void*)), getSlot_c(ctx, b_slot, depth_after, size), size);
+		}
+		case BR_OP_GETFROM: {
+			const size_t size = BR_getTypeRTSize(&ctx->builder.module, op->operand_type);
+			return fprintf(dst, "\tmemmove(%s, brb_ldp(%s), %zu);\n",
+				getSlot_c(ctx, res_slot, depth_after, size), getSlot_c(ctx, a_slot, depth, sizeof(void*)), size);
+		}
+		case BR_OP_COPY:
+// [A, B] -> [A], where the object at the address B is copied to the address A;
+// A is reloaded after the copy, since the copy might have overwritten it, just like in the interpreter
+			return fprintf(dst, "\tmemmove(brb_ldp(%s), brb_ldp(%s), %zu);\n"
+				"\tmemcpy(%s, %s, %zu);\n",
+				getSlot_c(ctx, a_slot, depth, sizeof(void*)), getSlot_c(ctx, b_slot, depth - sizeof(void*), sizeof(void*)),
+				BR_getTypeRTSize(&ctx->builder.module, op->operand_type),
+				getSlot_c(ctx, res_slot, depth_after, sizeof(void*)), a_slot, sizeof(void*));
+		default:
+			assert(false, "invalid operation type %u", op->type);
+	}
+}
+
+static int compareSlotKeys_c(const void* a, const void* b)
+{
+	const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+// compiles the body of the procedure `proc_id`, or of the initializer of the data block `proc_id` if it's negative;
+// the initializer evaluates the data block right in its place, with the stack growing down from the end of it
+static long compileProcBody_c(c_CodegenCtx* ctx, BR_id proc_id)
+{
+	const BR_Module* module = &ctx->builder.module;
+	const BR_OpArray body = proc_id < 0 ? module->seg_data.data[~proc_id].body : module->seg_exec.data[proc_id].body;
+	size_t max_depth;
+	size_t* const depths = getStackDepths(&ctx->builder, proc_id, body.length, &max_depth);
+	long acc = 0;
+	ctx->in_memory = proc_id < 0;
+	arrayForeach (BR_Op, op, body) {
+		if (op->type == BR_OP_ADDR) ctx->in_memory = true;
+	}
+	if (proc_id < 0) {
+		acc += fprintf(ctx->dst, "\tuint8_t* const bp = brb_db%lld + %zu;\n", (long long)~proc_id, max_depth);
+	} else if (ctx->in_memory) {
+// the stack of a procedure that takes the addresses of its items is laid out the same way as its native stack frame
+		const size_t stack_size = max_depth ? alignby(max_depth, 16) : 16;
+		acc += fprintf(ctx->dst,
+			"\t_Alignas(16) uint8_t stack[%zu];\n"
+			"\tuint8_t* const bp = stack + %zu;\n", stack_size, stack_size);
+	} else {
+// every item that's ever on top of the stack gets its own local variable
+		uint64_t* const keys = malloc(body.length * sizeof(uint64_t));
+		assert(keys || !body.length, "memory allocation failure during C code generation");
+		uint32_t n_keys = 0;
+		for (uint32_t i = 0; i < body.length; ++i) {
+			if (depths[i + 1]) keys[n_keys++] = (uint64_t)depths[i + 1] << 32 | BR_getStackItemRTSize(&ctx->builder, proc_id, i, 0);
+		}
+		qsort(keys, n_keys, sizeof(uint64_t), compareSlotKeys_c);
+		for (uint32_t i = 0; i < n_keys; ++i) {
+			if (i && keys[i] == keys[i - 1]) continue;
+			const uint32_t pos = keys[i] >> 32, size = (uint32_t)keys[i];
+			acc += isScalarSize_c(size)
+				? fprintf(ctx->dst, "\tuint%u_t s%u_%u;\n", size * 8, pos, size)
+				: fprintf(ctx->dst, "\tuint8_t s%u_%u[%u];\n", pos, size, size);
+		}
+		free(keys);
+	}
+	for (uint32_t i = 0; i < body.length; ++i) {
+		acc += compileOp_c(ctx, proc_id, i, depths[i], depths[i + 1]);
+	}
+	free(depths);
+	return acc;
+}
+
+long BR_compileModule_c(const BR_Module* module, FILE* dst)
+{
+	c_CodegenCtx ctx = {.dst = dst};
+	BR_Error err = BR_analyzeModule(module, &ctx.builder);
+	if (err.type) {
+		BR_printErrorMsg(stderr, err, "error while analyzing module");
+		abort();
+	}
+	long acc = str_fput(dst, c_prelude);
+// the data blocks are declared before any code, since any procedure can reference any data block
+	arrayForeach (BR_DataBlock, block, module->seg_data) {
+		const BR_id db_id = ~(block - module->seg_data.data);
+		acc += str_fput(dst, "\n// ")
+			+ str_fputesc(dst, block->name, SBUF_BFMT_HEX | SBUF_BFMT_DQUOTED | SBUF_BFMT_ESC_DQUOTE)
+			+ str_fput(dst, "\n");
+		if (block->data.length) {
+			acc += fprintf(dst, "static _Alignas(16) uint8_t brb_db%lld[%zu] = {", (long long)~db_id, block->data.length);
+			for (size_t i = 0; i < block->data.length; ++i) {
+				acc += fprintf(dst, i % 16 ? " %hhu," : "\n\t%hhu,", block->data.data[i]);
+			}
+			acc += str_fput(dst, "\n};\n");
+		} else {
+			size_t size;
+			free(getStackDepths(&ctx.builder, db_id, block->body.length, &size));
+			acc += fprintf(dst, "static _Alignas(16) uint8_t brb_db%lld[%zu];\n", (long long)~db_id, size ? size : 1);
+		}
+	}
+	arrayForeach (BR_DataBlock, block, module->seg_data) {
+		if (block->data.length) continue;
+		const BR_id db_id = ~(block - module->seg_data.data);
+		acc += str_fput(dst, "\n// initializer of ")
+			+ str_fputesc(dst, block->name, SBUF_BFMT_HEX | SBUF_BFMT_DQUOTED | SBUF_BFMT_ESC_DQUOTE)
+			+ fprintf(dst, "\nstatic void brb_db_init%lld(void)\n"
+				"{\n", (long long)~db_id)
+			+ compileProcBody_c(&ctx, db_id)
+			+ str_fput(dst, "}\n");
+	}
+	arrayForeach (BR_Proc, proc, module->seg_exec) {
+		const uint32_t proc_index = proc - module->seg_exec.data;
+		acc += str_fput(dst, "\n// ")
+			+ str_fputesc(dst, proc->name, SBUF_BFMT_HEX | SBUF_BFMT_DQUOTED | SBUF_BFMT_ESC_DQUOTE)
+			+ fprintf(dst, "\nstatic void brb_p%u(void)\n"
+				"{\n", proc_index)
+			+ compileProcBody_c(&ctx, proc_index)
+			+ str_fput(dst, "}\n");
+	}
+// the entry point evaluates the data blocks first
+	acc += str_fput(dst, "\nint main(void)\n"
+		"{\n");
+	arrayForeach (BR_DataBlock, block, module->seg_data) {
+		if (!block->data.length)
+			acc += fprintf(dst, "\tbrb_db_init%u();\n", (uint32_t)(block - module->seg_data.data));
+	}
+	acc += fprintf(dst, "\tbrb_p%u();\n"
+		"\treturn 0;\n"
+		"}\n", (uint32_t)module->exec_entry_point);
+	BR_Module _;
+	err = BR_extractModule(ctx.builder, &_);
+	assert(!err.type, "%s", getErrorMsg(err, "error while analyzing module for C code generation"))
+	BR_deallocDataBlocks(&_);
+	BR_deallocProcs(&_);
+	BR_deallocStructs(&_);
+
+	return acc;
+}
+#undef C_ARITH_STRIDE
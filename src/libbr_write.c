@@ -5,157 +5,269 @@ implArray(BR_Op);
 implArray(BR_DataBlock);
 
 defArray_as(const char*, nameArray);
+#define BR_OUTPUT_BUFFER_SIZE (1 << 20)
 typedef struct {
 	BR_Module* src;
 	FILE* dst;
 	nameArray names;
+	BR_NameIndex name_ids; // maps names from `names` to their indices in it
+	uint8_t* output;
+	size_t output_length;
+	size_t output_cap;
+	long n_flushed;
+	bool failed;
+// while a compressed section is written, `output` is the block being filled, and the output buffer is kept here; see `beginCompression`
+	uint8_t* main_output;
+	size_t main_output_length;
 } BR_ModuleWriter;
 
-static inline int writeInt8(FILE* fd, uint8_t x)
+static void writeMainOutput(BR_ModuleWriter* writer, const uint8_t* src, size_t size)
 {
-	return fwrite(&x, 1, 1, fd);
+	const size_t n_written = fwrite(src, 1, size, writer->dst);
+	writer->n_flushed += n_written;
+	writer->failed |= n_written != size;
 }
 
-static inline int writeInt16(FILE* fd, uint16_t x)
+static void putBE32(uint8_t* dst, uint32_t x)
 {
-	return fwrite(BRByteOrder(&x, 2), 1, 2, fd);
+	for (int i = 3; i >= 0; --i, x >>= 8) dst[i] = x;
 }
 
-static inline int writeInt32(FILE* fd, uint32_t x)
+// compresses the filled block of a compressed section into the output buffer
+static void compressOutput(BR_ModuleWriter* writer)
 {
-	return fwrite(BRByteOrder(&x, 4), 1, 4, fd);
+	if (!writer->output_length) return;
+	if (writer->main_output_length + 8 + BR_LZ_MAX_COMPRESSED_SIZE(BR_LZ_BLOCK_SIZE) > BR_OUTPUT_BUFFER_SIZE) {
+		writeMainOutput(writer, writer->main_output, writer->main_output_length);
+		writer->main_output_length = 0;
+	}
+	uint8_t* const dst = writer->main_output + writer->main_output_length;
+	size_t size = BR_compressBlock(writer->output, writer->output_length, dst + 8);
+// the incompressible blocks are stored as they are, which is marked by the compressed size being the same as the original one
+	if (size >= writer->output_length) {
+		size = writer->output_length;
+		memcpy(dst + 8, writer->output, size);
+	}
+	putBE32(dst, writer->output_length);
+	putBE32(dst + 4, size);
+	writer->main_output_length += 8 + size;
+	writer->output_length = 0;
+}
+
+static void flushOutput(BR_ModuleWriter* writer)
+{
+	if (writer->main_output) {
+		compressOutput(writer);
+		return;
+	}
+	writeMainOutput(writer, writer->output, writer->output_length);
+	writer->output_length = 0;
+}
+
+// returns the offset of the end of the written part of the module in the file
+static long getOutputOffset(const BR_ModuleWriter* writer)
+{
+	return writer->n_flushed + (writer->main_output ? writer->main_output_length : writer->output_length);
+}
+
+// everything written until `endCompression` is compressed in blocks of `BR_LZ_BLOCK_SIZE` bytes; `block` must have room for that many bytes
+static void beginCompression(BR_ModuleWriter* writer, uint8_t* block)
+{
+	writer->main_output = writer->output;
+	writer->main_output_length = writer->output_length;
+	writer->output = block;
+	writer->output_length = 0;
+	writer->output_cap = BR_LZ_BLOCK_SIZE;
+}
+
+static void endCompression(BR_ModuleWriter* writer)
+{
+	compressOutput(writer);
+	writer->output = writer->main_output;
+	writer->output_length = writer->main_output_length;
+	writer->output_cap = BR_OUTPUT_BUFFER_SIZE;
+	writer->main_output = NULL;
+}
+
+// returns a pointer to `size` bytes at the end of the output buffer; `size` must not exceed the buffer's capacity
+static inline uint8_t* reserveOutput(BR_ModuleWriter* writer, size_t size)
+{
+	if (writer->output_length + size > writer->output_cap) flushOutput(writer);
+	uint8_t* res = writer->output + writer->output_length;
+	writer->output_length += size;
+	return res;
+}
+
+static long writeBytes(BR_ModuleWriter* writer, const void* src, size_t size)
+{
+	if (size <= writer->output_cap) {
+		memcpy(reserveOutput(writer, size), src, size);
+	} else if (!writer->main_output) {
+		flushOutput(writer);
+		writeMainOutput(writer, src, size);
+	} else for (size_t n_left = size; n_left;) {
+// the data is split between the blocks of the compressed section
+		const size_t n = minInt(n_left, writer->output_cap);
+		memcpy(reserveOutput(writer, n), src, n);
+		src = (const uint8_t*)src + n;
+		n_left -= n;
+	}
+	return size;
+}
+
+static inline int writeInt8(BR_ModuleWriter* writer, uint8_t x)
+{
+	*reserveOutput(writer, 1) = x;
+	return 1;
+}
+
+static inline int writeInt16(BR_ModuleWriter* writer, uint16_t x)
+{
+	uint8_t* dst = reserveOutput(writer, 2);
+	dst[0] = x >> 8;
+	dst[1] = x;
+	return 2;
+}
+
+static inline int writeInt32(BR_ModuleWriter* writer, uint32_t x)
+{
+	uint8_t* dst = reserveOutput(writer, 4);
+	for (int i = 3; i >= 0; --i, x >>= 8) dst[i] = x;
+	return 4;
 }
 
-static inline int writeInt64(FILE* fd, uint64_t x)
+static inline int writeInt64(BR_ModuleWriter* writer, uint64_t x)
 {
-	return fwrite(BRByteOrder(&x, 8), 1, 8, fd);
+	uint8_t* dst = reserveOutput(writer, 8);
+	for (int i = 7; i >= 0; --i, x >>= 8) dst[i] = x;
+	return 8;
 }
 
-static long writeInt(FILE* fd, uint64_t x, uint8_t hb)
+static long writeInt(BR_ModuleWriter* writer, uint64_t x, uint8_t hb)
 {
 	if (x < 8) {
-		return writeInt8(fd, x | hb << 4);
+		return writeInt8(writer, x | hb << 4);
 	} else if (FITS_IN_8BITS(x)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 12 : 8) | hb << 4)
-			+ writeInt8(fd, absInt(x));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 12 : 8) | hb << 4)
+			+ writeInt8(writer, absInt(x));
 	} else if (FITS_IN_16BITS(x)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 13 : 9) | hb << 4)
-			+ writeInt16(fd, absInt(x));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 13 : 9) | hb << 4)
+			+ writeInt16(writer, absInt(x));
 	} else if (FITS_IN_32BITS(x)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 14 : 10) | hb << 4)
-			+ writeInt32(fd, absInt(x));
-	} else return writeInt8(fd, (SIGN_BIT_SET(x) ? 15 : 11) | hb << 4)
-			+ writeInt64(fd, absInt(x));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 14 : 10) | hb << 4)
+			+ writeInt32(writer, absInt(x));
+	} else return writeInt8(writer, (SIGN_BIT_SET(x) ? 15 : 11) | hb << 4)
+			+ writeInt64(writer, absInt(x));
 }
 
-long writeIntOnly(FILE* fd, uint64_t x)
+static long writeIntOnly(BR_ModuleWriter* writer, uint64_t x)
 {
 	if (inRange(x, 0, 8) || inRange(x, 16, 256)) {
-		return writeInt8(fd, x);
+		return writeInt8(writer, x);
 	} else if (FITS_IN_8BITS(x)) {
-		return writeInt8(fd, SIGN_BIT_SET(x) ? 12 : 8)
-			+ writeInt8(fd, absInt(x));
+		return writeInt8(writer, SIGN_BIT_SET(x) ? 12 : 8)
+			+ writeInt8(writer, absInt(x));
 	} else if (FITS_IN_16BITS(x)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 13 : 9))
-			+ writeInt16(fd, absInt(x));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 13 : 9))
+			+ writeInt16(writer, absInt(x));
 	} else if (FITS_IN_32BITS(x)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 14 : 10))
-			+ writeInt32(fd, absInt(x));
-	} else return writeInt8(fd, (SIGN_BIT_SET(x) ? 15 : 11))
-			+ writeInt64(fd, absInt(x));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 14 : 10))
+			+ writeInt32(writer, absInt(x));
+	} else return writeInt8(writer, (SIGN_BIT_SET(x) ? 15 : 11))
+			+ writeInt64(writer, absInt(x));
 }
 
-static long writeIntSwapped(FILE* fd, uint64_t x, uint8_t hb)
+static long writeIntSwapped(BR_ModuleWriter* writer, uint64_t x, uint8_t hb)
 {
 	if (FITS_IN_8BITS(x)) {
 		return x < 8
-			? writeInt8(fd, hb | x << 4)
-			: writeInt8(fd, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | hb)
-				+ writeInt8(fd, absInt(x));
+			? writeInt8(writer, hb | x << 4)
+			: writeInt8(writer, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | hb)
+				+ writeInt8(writer, absInt(x));
 	} else if (FITS_IN_16BITS(x)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | hb)
-			+ writeInt16(fd, absInt(x));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | hb)
+			+ writeInt16(writer, absInt(x));
 	} else if (FITS_IN_32BITS(x)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | hb)
-			+ writeInt32(fd, absInt(x));
-	} else return writeInt8(fd, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | hb)
-			+ writeInt64(fd, absInt(x));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | hb)
+			+ writeInt32(writer, absInt(x));
+	} else return writeInt8(writer, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | hb)
+			+ writeInt64(writer, absInt(x));
 }
 
-static long write2Ints(FILE* fd, uint64_t x, uint64_t y)
+static long write2Ints(BR_ModuleWriter* writer, uint64_t x, uint64_t y)
 {
 	if (x < 8) {
 		if (y < 8) {
-			return writeInt8(fd, x << 4 | y);
-		} else return writeInt(fd, y, x);
+			return writeInt8(writer, x << 4 | y);
+		} else return writeInt(writer, y, x);
 	} else if (y < 8) {
-		return writeIntSwapped(fd, x, y);
+		return writeIntSwapped(writer, x, y);
 	} else if (FITS_IN_8BITS(x)) {
 		if (FITS_IN_8BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | (SIGN_BIT_SET(y) ? 12 : 8))
-				+ writeInt8(fd, absInt(x))
-				+ writeInt8(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | (SIGN_BIT_SET(y) ? 12 : 8))
+				+ writeInt8(writer, absInt(x))
+				+ writeInt8(writer, absInt(y));
 		} else if (FITS_IN_16BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | (SIGN_BIT_SET(y) ? 13 : 9))
-				+ writeInt8(fd, absInt(x))
-				+ writeInt16(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | (SIGN_BIT_SET(y) ? 13 : 9))
+				+ writeInt8(writer, absInt(x))
+				+ writeInt16(writer, absInt(y));
 		} else if (FITS_IN_32BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | (SIGN_BIT_SET(y) ? 14 : 10))
-				+ writeInt8(fd, absInt(x))
-				+ writeInt32(fd, absInt(y));
-		} else return writeInt8(fd, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | (SIGN_BIT_SET(y) ? 15 : 11))
-				+ writeInt8(fd, absInt(x))
-				+ writeInt64(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | (SIGN_BIT_SET(y) ? 14 : 10))
+				+ writeInt8(writer, absInt(x))
+				+ writeInt32(writer, absInt(y));
+		} else return writeInt8(writer, (SIGN_BIT_SET(x) ? 12 : 8) << 4 | (SIGN_BIT_SET(y) ? 15 : 11))
+				+ writeInt8(writer, absInt(x))
+				+ writeInt64(writer, absInt(y));
 	} else if (FITS_IN_16BITS(x)) {
 		if (FITS_IN_8BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | (SIGN_BIT_SET(y) ? 12 : 8))
-				+ writeInt16(fd, absInt(x))
-				+ writeInt8(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | (SIGN_BIT_SET(y) ? 12 : 8))
+				+ writeInt16(writer, absInt(x))
+				+ writeInt8(writer, absInt(y));
 		} else if (FITS_IN_16BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | (SIGN_BIT_SET(y) ? 13 : 9))
-				+ writeInt16(fd, absInt(x))
-				+ writeInt16(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | (SIGN_BIT_SET(y) ? 13 : 9))
+				+ writeInt16(writer, absInt(x))
+				+ writeInt16(writer, absInt(y));
 		} else if (FITS_IN_32BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | (SIGN_BIT_SET(y) ? 14 : 10))
-				+ writeInt16(fd, absInt(x))
-				+ writeInt32(fd, absInt(y));
-		} else return writeInt8(fd, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | (SIGN_BIT_SET(y) ? 15 : 11))
-				+ writeInt16(fd, absInt(x))
-				+ writeInt64(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | (SIGN_BIT_SET(y) ? 14 : 10))
+				+ writeInt16(writer, absInt(x))
+				+ writeInt32(writer, absInt(y));
+		} else return writeInt8(writer, (SIGN_BIT_SET(x) ? 13 : 9) << 4 | (SIGN_BIT_SET(y) ? 15 : 11))
+				+ writeInt16(writer, absInt(x))
+				+ writeInt64(writer, absInt(y));
 	} else if (FITS_IN_32BITS(x)) {
 		if (FITS_IN_8BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | (SIGN_BIT_SET(y) ? 12 : 8))
-				+ writeInt32(fd, absInt(x))
-				+ writeInt8(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | (SIGN_BIT_SET(y) ? 12 : 8))
+				+ writeInt32(writer, absInt(x))
+				+ writeInt8(writer, absInt(y));
 		} else if (FITS_IN_16BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | (SIGN_BIT_SET(y) ? 13 : 9))
-				+ writeInt32(fd, absInt(x))
-				+ writeInt16(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | (SIGN_BIT_SET(y) ? 13 : 9))
+				+ writeInt32(writer, absInt(x))
+				+ writeInt16(writer, absInt(y));
 		} else if (FITS_IN_32BITS(y)) {
-			return writeInt8(fd, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | (SIGN_BIT_SET(y) ? 14 : 10))
-				+ writeInt32(fd, absInt(x))
-				+ writeInt32(fd, absInt(y));
-		} else return writeInt8(fd, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | (SIGN_BIT_SET(y) ? 15 : 11))
-				+ writeInt32(fd, absInt(x))
-				+ writeInt64(fd, absInt(y));
+			return writeInt8(writer, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | (SIGN_BIT_SET(y) ? 14 : 10))
+				+ writeInt32(writer, absInt(x))
+				+ writeInt32(writer, absInt(y));
+		} else return writeInt8(writer, (SIGN_BIT_SET(x) ? 14 : 10) << 4 | (SIGN_BIT_SET(y) ? 15 : 11))
+				+ writeInt32(writer, absInt(x))
+				+ writeInt64(writer, absInt(y));
 	} else if (FITS_IN_8BITS(y)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | (SIGN_BIT_SET(y) ? 12 : 8))
-			+ writeInt64(fd, absInt(x))
-			+ writeInt8(fd, absInt(y));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | (SIGN_BIT_SET(y) ? 12 : 8))
+			+ writeInt64(writer, absInt(x))
+			+ writeInt8(writer, absInt(y));
 	} else if (FITS_IN_16BITS(y)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | (SIGN_BIT_SET(y) ? 13 : 9))
-			+ writeInt64(fd, absInt(x))
-			+ writeInt16(fd, absInt(y));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | (SIGN_BIT_SET(y) ? 13 : 9))
+			+ writeInt64(writer, absInt(x))
+			+ writeInt16(writer, absInt(y));
 	} else if (FITS_IN_32BITS(y)) {
-		return writeInt8(fd, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | (SIGN_BIT_SET(y) ? 14 : 10))
-			+ writeInt64(fd, absInt(x))
-			+ writeInt32(fd, absInt(y));
-	} else return writeInt8(fd, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | (SIGN_BIT_SET(y) ? 15 : 11))
-			+ writeInt64(fd, absInt(x))
-			+ writeInt64(fd, absInt(y));
+		return writeInt8(writer, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | (SIGN_BIT_SET(y) ? 14 : 10))
+			+ writeInt64(writer, absInt(x))
+			+ writeInt32(writer, absInt(y));
+	} else return writeInt8(writer, (SIGN_BIT_SET(x) ? 15 : 11) << 4 | (SIGN_BIT_SET(y) ? 15 : 11))
+			+ writeInt64(writer, absInt(x))
+			+ writeInt64(writer, absInt(y));
 }
 
-static long writeType(FILE* dst, BR_Type type)
+static long writeType(BR_ModuleWriter* writer, BR_Type type)
 {
 	static uint8_t encoded[] = { // this is done to avoid calling `log2`
 		[1 << 0]  = 0,	
@@ -166,46 +278,48 @@ static long writeType(FILE* dst, BR_Type type)
 		[1 << 5]  = 5,
 		[1 << 6]  = 6
 	};
-	return writeInt(dst, type.n_items, encoded[type.kind])
+	return writeInt(writer, type.n_items, encoded[type.kind])
 		+ (type.kind == BR_TYPE_STRUCT
-			? writeIntOnly(dst, type.struct_id)
+			? writeIntOnly(writer, type.struct_id)
 			: 0);
 }
 
 static uint32_t getNameId(BR_ModuleWriter* writer, const char* name)
 {
-	arrayForeach_as (const char*, nameArray, iter, writer->names) {
-		if (str_eq(name, *iter)) return iter - writer->names.data;
-	}
-	nameArray_append(&writer->names, name);
-	return writer->names.length - 1;
+	uint32_t res = BR_findInNameIndex(&writer->name_ids, name);
+	if (res != UINT32_MAX) return res;
+	res = writer->names.length;
+	if (!nameArray_append(&writer->names, name)
+		|| !BR_addToNameIndex(&writer->name_ids, name, res))
+		writer->failed = true;
+	return res;
 }
 
 static long writeDataBlockDecl(BR_ModuleWriter* writer, BR_DataBlock block)
 {
 // writing the flags and the name ID
-	return writeInt(writer->dst, getNameId(writer, block.name), block.is_mutable)
-// writing the body size
-		+ writeIntOnly(writer->dst, block.body.length);
+	return writeInt(writer, getNameId(writer, block.name), (block.is_mutable ? BR_DBF_MUTABLE : 0) | (block.data.length ? BR_DBF_EVALUATED : 0))
+// writing the body size; for a pre-evaluated block, it's the size of its contents in bytes
+		+ writeIntOnly(writer, block.data.length ? block.data.length : block.body.length);
 }
 
 static long writeOp(BR_ModuleWriter* writer, BR_Op op)
 {
 // writing the type
-	long acc = writeInt8(writer->dst, op.type);
+	long acc = writeInt8(writer, op.type);
 // writing the operand, if needed
 	switch (BR_GET_OPERAND_TYPE(op.type)) {
 		case BR_OPERAND_INT8:
-			return acc + writeInt8(writer->dst, op.operand_u);
+			return acc + writeInt8(writer, op.operand_u);
 		case BR_OPERAND_INT:
 		case BR_OPERAND_VAR_NAME:
 		case BR_OPERAND_SYSCALL_NAME:
 		case BR_OPERAND_BUILTIN:
-			return acc + writeIntOnly(writer->dst, op.operand_u);
+			return acc + writeIntOnly(writer, op.operand_u);
 		case BR_OPERAND_DB_NAME:
-			return acc + writeIntOnly(writer->dst, ~op.operand_s);
+			return acc + writeIntOnly(writer, ~op.operand_s);
 		case BR_OPERAND_TYPE:
-			return acc + writeType(writer->dst, op.operand_type);
+			return acc + writeType(writer, op.operand_type);
 		case BR_OPERAND_NONE:
 			return acc;
 		default:
@@ -216,38 +330,52 @@ static long writeOp(BR_ModuleWriter* writer, BR_Op op)
 static long writeProcDecl(BR_ModuleWriter* writer, BR_Proc proc)
 {
 // writing the return type
-	long acc = writeType(writer->dst, proc.ret_type)
+	long acc = writeType(writer, proc.ret_type)
 // writing the name ID and amount of arguments
-		+ write2Ints(writer->dst, getNameId(writer, proc.name), proc.args.length);
+		+ write2Ints(writer, getNameId(writer, proc.name), proc.args.length);
 // writing the arguments
 	arrayForeach (BR_Type, arg, proc.args) {
-		acc += writeType(writer->dst, *arg);
+		acc += writeType(writer, *arg);
 	}
 // writing the body size
-	return acc + writeIntOnly(writer->dst, proc.body.length);
+	return acc + writeIntOnly(writer, proc.pending_body.data ? proc.n_pending_ops : proc.body.length);
 }
 
 static long writeStruct(BR_ModuleWriter* writer, BR_Struct obj)
 {
-	long acc = write2Ints(writer->dst, getNameId(writer, obj.name), obj.fields.length);
+	long acc = write2Ints(writer, getNameId(writer, obj.name), obj.fields.length);
 	arrayForeach (BR_Type, field, obj.fields) {
-		acc += writeType(writer->dst, *field);
+		acc += writeType(writer, *field);
 	}
 	return acc;
 }
 
-long BR_writeModule(BR_Module src, FILE* dst)
+long BR_writeModule(BR_Module src, FILE* dst, uint32_t flags)
 {
 	BR_ModuleWriter writer = {
 		.src = &src,
-		.dst = dst
+		.dst = dst,
+		.output = malloc(BR_OUTPUT_BUFFER_SIZE),
+		.output_cap = BR_OUTPUT_BUFFER_SIZE
 	};
+	uint32_t* const proc_offsets = malloc((src.seg_exec.length + 1) * sizeof(uint32_t));
+	uint8_t* const lz_block = flags & BR_WRITE_COMPRESS ? malloc(BR_LZ_BLOCK_SIZE) : NULL;
+	if (!writer.output || !proc_offsets || (!lz_block && flags & BR_WRITE_COMPRESS)) {
+		free(writer.output);
+		free(proc_offsets);
+		free(lz_block);
+		return -1;
+	}
+	const uint32_t compressed_kind = flags & BR_WRITE_COMPRESS ? BR_SECTION_COMPRESSED : 0;
+// the sections are written in the order of their kinds, so that every one of them ends where the next one starts
+	uint64_t section_offsets[BR_N_SECTION_KINDS + 1];
 // writing the header
-	long acc = sbuf_fput(dst, BR_V1_HEADER)
+	long acc = writeBytes(&writer, BR_V2_HEADER.data, BR_V2_HEADER.length);
 // writing the amount of structs
-		+ writeIntOnly(dst, src.seg_typeinfo.length)
+	section_offsets[BR_SECTION_DECLS] = acc;
+	acc += writeIntOnly(&writer, src.seg_typeinfo.length)
 // writing the amount of data blocks and procedures
-		+ write2Ints(dst, src.seg_data.length, src.seg_exec.length);
+		+ write2Ints(&writer, src.seg_data.length, src.seg_exec.length);
 // writing the structs
 	arrayForeach (BR_Struct, obj, src.seg_typeinfo) {
 		acc += writeStruct(&writer, *obj);
@@ -261,25 +389,65 @@ long BR_writeModule(BR_Module src, FILE* dst)
 		acc += writeProcDecl(&writer, *proc);
 	}
 // writing the execution entry point
-	acc += writeIntOnly(dst, src.exec_entry_point);
-// writing the operations in the data blocks
+	acc += writeIntOnly(&writer, src.exec_entry_point);
+// writing the operations in the data blocks, or the contents of the pre-evaluated ones
+	section_offsets[BR_SECTION_DATA] = acc;
 	arrayForeach (BR_DataBlock, block, src.seg_data) {
+		acc += writeBytes(&writer, block->data.data, block->data.length);
 		arrayForeach (BR_Op, op, block->body) {
 			acc += writeOp(&writer, *op);
 		}
 	}
-// writing the operations in the procedures
+// writing the operations in the procedures; the bodies that are still pending are already encoded;
+// the index holds the offsets of the bodies in the section before compression, so until the section ends, `acc` counts the bytes before compression
+	section_offsets[BR_SECTION_PROCS] = acc;
+	if (lz_block) beginCompression(&writer, lz_block);
 	arrayForeach (BR_Proc, proc, src.seg_exec) {
-		arrayForeach (BR_Op, op, proc->body) {
-			acc += writeOp(&writer, *op);
+		proc_offsets[proc - src.seg_exec.data] = acc - section_offsets[BR_SECTION_PROCS];
+		if (proc->pending_body.data) {
+			acc += writeBytes(&writer, proc->pending_body.data, proc->pending_body.length);
+		} else {
+			arrayForeach (BR_Op, op, proc->body) {
+				acc += writeOp(&writer, *op);
+			}
 		}
 	}
+	writer.failed |= acc - section_offsets[BR_SECTION_PROCS] > UINT32_MAX;
+	proc_offsets[src.seg_exec.length] = acc - section_offsets[BR_SECTION_PROCS];
+	if (lz_block) {
+		endCompression(&writer);
+		acc = getOutputOffset(&writer);
+	}
+// writing the index of the procedure bodies
+	section_offsets[BR_SECTION_PROC_INDEX] = acc;
+	for (size_t i = 0; i <= src.seg_exec.length; ++i) {
+		acc += writeInt32(&writer, proc_offsets[i]);
+	}
+	free(proc_offsets);
 // writing names
 // TODO: don't save names of internal procedures and data blocks to reduce bytecode size
 // TODO: add an option to not save the names of structs
+	section_offsets[BR_SECTION_NAMES] = acc;
+	if (lz_block) beginCompression(&writer, lz_block);
 	arrayForeach_as (const char*, nameArray, name, writer.names) {
-		acc += fwrite(*name, 1, strlen(*name) + 1, dst);
+		acc += writeBytes(&writer, *name, strlen(*name) + 1);
+	}
+	if (lz_block) {
+		endCompression(&writer);
+		acc = getOutputOffset(&writer);
 	}
+// writing the section table
+	section_offsets[BR_N_SECTION_KINDS] = acc;
+	for (uint8_t i = 0; i < BR_N_SECTION_KINDS; ++i) {
+		acc += writeInt32(&writer, i == BR_SECTION_PROCS || i == BR_SECTION_NAMES ? i | compressed_kind : i)
+			+ writeInt64(&writer, section_offsets[i])
+			+ writeInt64(&writer, section_offsets[i + 1] - section_offsets[i]);
+	}
+	acc += writeInt32(&writer, BR_N_SECTION_KINDS);
+	flushOutput(&writer);
 	nameArray_clear(&writer.names);
-	return acc;
+	BR_delNameIndex(&writer.name_ids);
+	free(writer.output);
+	free(lz_block);
+	return writer.failed ? -1 : acc;
 }
@@ -0,0 +1,27 @@
+.text
+"_main":
+.global "_main"
+	mov	x28, x1
+	mov	x27, x0
+	sub	sp, sp, 48
+	mov	x8, 5
+	str	x8, [sp, 24]
+	mov	x8, 7
+	str	x8, [sp, 16]
+	mov	x8, 9
+	str	x8, [sp, 8]
+	add	x8, sp, 8
+	str	x8, [sp, 0]
+	ldr	d0, [x8], 8
+	str	d0, [sp, 0]
+	fmov	x9, d0
+	ldr	x10, [sp, 8]
+	add	x3, x9, x10
+	ldr	x10, [sp, 16]
+	add	x3, x3, x10
+	mov	x4, xzr
+	add	x3, x4, x3
+	mov	x0, x3
+	bl	_exit
+	mov	x0, 0
+	bl	_exit
@@ -0,0 +1,67 @@
+.text
+"_sum":
+	sub	sp, sp, 80
+	mov	x8, 1
+	str	x8, [sp, 56]
+	mov	x8, 2
+	str	x8, [sp, 48]
+	mov	x5, 3
+	mov	x6, 4
+	mov	x7, 5
+	mov	x15, 6
+	mov	x3, 7
+	mov	x4, 8
+	add	x3, x4, x3
+	add	x3, x3, x15
+	add	x3, x3, x7
+	add	x3, x3, x6
+	add	x3, x3, x5
+	mov	x10, x8
+	add	x3, x3, x10
+	ret
+"_main":
+.global "_main"
+	mov	x28, x1
+	mov	x27, x0
+	sub	sp, sp, 144
+	mov	x8, 1
+	str	x8, [sp, 120]
+	mov	x8, 2
+	str	x8, [sp, 112]
+	mov	x5, 3
+	mov	x6, 4
+	mov	x7, 5
+	mov	x15, 6
+	mov	x19, 7
+	mov	x20, 8
+	mov	x21, 9
+	mov	x22, 10
+	mov	x23, 11
+	mov	x24, 12
+	mov	x25, 13
+	mov	x26, 14
+	mov	x3, 15
+	mov	x4, 16
+	add	x3, x4, x3
+	add	x3, x3, x26
+	add	x3, x3, x25
+	add	x3, x3, x24
+	add	x3, x3, x23
+	add	x3, x3, x22
+	add	x3, x3, x21
+	add	x3, x3, x20
+	add	x3, x3, x19
+	add	x3, x3, x15
+	add	x3, x3, x7
+	add	x3, x3, x6
+	add	x3, x3, x5
+	mov	x10, x8
+	add	x3, x3, x10
+	ldr	x10, [sp, 120]
+	add	x3, x3, x10
+	mov	x4, xzr
+	add	x3, x4, x3
+	mov	x0, x3
+	bl	_exit
+	mov	x0, 0
+	bl	_exit
@@ -0,0 +1,54 @@
+.data
+"_table":
+	.byte	30, 0, 0, 0, 0, 0, 0, 0, 7, 0
+.text
+.align 4
+".brb_db_impl_table":
+	ret
+.bss
+"_counter":
+	.zero	8
+.text
+.align 4
+".brb_db_impl_counter":
+	adrp	x12, "_counter"@PAGE
+	add	x12, x12, "_counter"@PAGEOFF
+	mov	x8, 1
+	str	x8, [x12, 0]
+	ret
+"_main":
+.global "_main"
+	mov	x28, x1
+	mov	x27, x0
+	bl	".brb_db_impl_table"
+	bl	".brb_db_impl_counter"
+	sub	sp, sp, 32
+	adrp	x8, "_table"@PAGE
+	add	x8, x8, "_table"@PAGEOFF
+	str	x8, [sp, 8]
+	ldr	d0, [x8], 8
+	str	d0, [sp, 8]
+	adrp	x3, "_table"@PAGE
+	add	x3, x3, "_table"@PAGEOFF
+	add	x9, x3, 8
+	str	x9, [sp, 0]
+	mov	x8, x9
+	ldrh	w10, [x8], 2
+	strh	w10, [sp, 6]
+	ldrh	w9, [sp, 6]
+	ldr	x10, [sp, 8]
+	add	x3, x9, x10
+	and	x3, x3, 0xffff
+	adrp	x8, "_counter"@PAGE
+	add	x8, x8, "_counter"@PAGEOFF
+	str	x8, [sp, 6]
+	ldr	d0, [x8], 8
+	str	d0, [sp, 6]
+	fmov	x9, d0
+	add	x3, x9, x3
+	mov	x4, xzr
+	add	x3, x4, x3
+	mov	x0, x3
+	bl	_exit
+	mov	x0, 0
+	bl	_exit
@@ -0,0 +1,50 @@
+.bss
+"_hello":
+	.zero	3
+.text
+.align 4
+".brb_db_impl_hello":
+	adrp	x12, "_hello"@PAGE
+	add	x12, x12, "_hello"@PAGEOFF
+	mov	x8, 10
+	strb	w8, [x12, 2]
+	mov	x8, 105
+	strb	w8, [x12, 1]
+	mov	x8, 72
+	strb	w8, [x12, 0]
+	ret
+"_write_hello":
+	sub	sp, sp, 48
+	mov	x8, 40
+	str	x8, [sp, 24]
+	mov	x3, 3
+	adrp	x4, "_hello"@PAGE
+	add	x4, x4, "_hello"@PAGEOFF
+	mov	x5, 1
+	mov	x0, x5
+	mov	x1, x4
+	mov	x2, x3
+	bl	_write
+	ret
+"_main":
+.global "_main"
+	mov	x28, x1
+	mov	x27, x0
+	bl	".brb_db_impl_hello"
+	sub	sp, sp, 48
+	mov	x19, 40
+	mov	x3, 3
+	adrp	x4, "_hello"@PAGE
+	add	x4, x4, "_hello"@PAGEOFF
+	mov	x5, 1
+	mov	x0, x5
+	mov	x1, x4
+	mov	x2, x3
+	bl	_write
+	add	x3, x19, 2
+	mov	x4, xzr
+	add	x3, x4, x3
+	mov	x0, x3
+	bl	_exit
+	mov	x0, 0
+	bl	_exit
@@ -0,0 +1,39 @@
+#!python3
+# startup benchmark of `BR_LOAD_LAZY`: the programs generated by `gen_procs.py` with 10k and 100k procedures of 40 operations each,
+# of which only the entry point runs, are saved as bytecode with `brtest -w` and then run by `brtest` with all the procedures decoded on load
+# and with `-L`, which only decodes the entry point; prints the best of 3 wall times of loading, preparing and running the module
+# as reported by `brtest -T`, and their sum
+# usage: bench_lazy.py [path to `brtest`, `build/bin/brtest` by default]
+
+import sys
+import subprocess
+import tempfile
+from pathlib import Path
+
+TESTS: Path = Path(__file__).parent
+BRTEST: str = sys.argv[1] if len(sys.argv) > 1 else str(TESTS.parent/"build"/"bin"/"brtest")
+SIZES: list[int] = [10000, 100000]
+N_REPEATS: int = 3
+STAGES: list[str] = ["load", "prepare", "run"]
+
+def time_stages(*args: str) -> dict[str, float]:
+	"returns the best of `N_REPEATS` wall times of every stage reported by `brtest -T <args>`, in milliseconds"
+	res: dict[str, float] = {}
+	for _ in range(N_REPEATS):
+		proc = subprocess.run([BRTEST, "-T", *args], stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, check=True)
+		for line in proc.stderr.splitlines():
+			stage, ms, _ = line.split()
+			res[stage] = min(res.get(stage, float("inf")), float(ms))
+	return res
+
+print(f"{'procs':>8} {'loading':>8}" + "".join(f" {stage:>11}" for stage in [*STAGES, "total"]))
+with tempfile.TemporaryDirectory() as tmp:
+	tmp = Path(tmp)
+	for n_procs in SIZES:
+		program, module = tmp/"procs.vbrb", tmp/"procs.brb"
+		with program.open("w") as f:
+			subprocess.run([sys.executable, str(TESTS/"gen_procs.py"), str(n_procs), "40"], stdout=f, check=True)
+		subprocess.run([BRTEST, "-w", str(module), str(program)], check=True)
+		for loading, args in [("eager", []), ("lazy", ["-L"])]:
+			times = time_stages(*args, str(module))
+			print(f"{n_procs:>8} {loading:>8}" + "".join(f" {times[stage]:>8.2f} ms" for stage in STAGES) + f" {sum(times[stage] for stage in STAGES):>8.2f} ms")
@@ -0,0 +1,33 @@
+#!python3
+# benchmark of the name lookups of the assembler, i.e. `BR_getProcIdByName`, `BR_getDataBlockIdByName` and `BR_getStructIdByName`,
+# on the programs generated by `gen_procs.py` with 1k, 10k and 100k procedures, as many data blocks and 100 structs, all referred to by name;
+# prints the best of 3 wall times of loading the assembly, as reported by `brtest -T`
+# usage: bench_names.py [path to `brtest`, `build/bin/brtest` by default]
+
+import sys
+import subprocess
+import tempfile
+from pathlib import Path
+
+TESTS: Path = Path(__file__).parent
+BRTEST: str = sys.argv[1] if len(sys.argv) > 1 else str(TESTS.parent/"build"/"bin"/"brtest")
+SIZES: list[int] = [1000, 10000, 100000]
+N_REPEATS: int = 3
+
+def time_stages(*args: str) -> dict[str, float]:
+	"returns the best of `N_REPEATS` wall times of every stage reported by `brtest -T <args>`, in milliseconds"
+	res: dict[str, float] = {}
+	for _ in range(N_REPEATS):
+		proc = subprocess.run([BRTEST, "-T", *args], stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, check=True)
+		for line in proc.stderr.splitlines():
+			stage, ms, _ = line.split()
+			res[stage] = min(res.get(stage, float("inf")), float(ms))
+	return res
+
+print(f"{'procs':>8} {'load':>11}")
+with tempfile.TemporaryDirectory() as tmp:
+	for n_procs in SIZES:
+		program = Path(tmp)/f"procs{n_procs}.vbrb"
+		with program.open("w") as f:
+			subprocess.run([sys.executable, str(TESTS/"gen_procs.py"), str(n_procs)], stdout=f, check=True)
+		print(f"{n_procs:>8} {time_stages(str(program))['load']:>8.2f} ms")
@@ -0,0 +1,36 @@
+#!python3
+# scaling benchmark of the stack queries of the analyzer, i.e. `BR_getStackRTSize`, `BR_getStackItemRTOffset` and `BR_getMaxStackRTSize`,
+# on the procedures of 1k, 10k and 100k operations generated by `gen_deep.py`;
+# prints the best of 3 wall times of every stage reported by `brtest -T`: loading the assembly, which analyzes every operation as it's added,
+# preparing the module, which queries the stack at every operation, running it, and compiling it to arm64 assembly with `brtest -S`
+# usage: bench_stack.py [path to `brtest`, `build/bin/brtest` by default]
+
+import sys
+import subprocess
+import tempfile
+from pathlib import Path
+
+TESTS: Path = Path(__file__).parent
+BRTEST: str = sys.argv[1] if len(sys.argv) > 1 else str(TESTS.parent/"build"/"bin"/"brtest")
+SIZES: list[int] = [1000, 10000, 100000]
+N_REPEATS: int = 3
+
+def time_stages(*args: str) -> dict[str, float]:
+	"returns the best of `N_REPEATS` wall times of every stage reported by `brtest -T <args>`, in milliseconds"
+	res: dict[str, float] = {}
+	for _ in range(N_REPEATS):
+		proc = subprocess.run([BRTEST, "-T", *args], stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, check=True)
+		for line in proc.stderr.splitlines():
+			stage, ms, _ = line.split()
+			res[stage] = min(res.get(stage, float("inf")), float(ms))
+	return res
+
+print(f"{'ops':>8} {'load':>10} {'prepare':>10} {'run':>10} {'compile':>10}")
+with tempfile.TemporaryDirectory() as tmp:
+	for n_ops in SIZES:
+		program = Path(tmp)/f"deep{n_ops}.vbrb"
+		with program.open("w") as f:
+			subprocess.run([sys.executable, str(TESTS/"gen_deep.py"), str(n_ops)], stdout=f, check=True)
+		times = time_stages(str(program))
+		times["compile"] = time_stages("-S", str(program))["compile"]
+		print(f"{n_ops:>8}" + "".join(f" {times[stage]:>7.2f} ms" for stage in ["load", "prepare", "run", "compile"]))
@@ -0,0 +1,41 @@
+#!python3
+# write throughput benchmark of `BR_writeModule` on modules of 1k to 1M operations: the ones generated by `gen_procs.py` with 10 operations
+# per procedure and half as many data blocks as procedures, where the names dominate, and a single procedure of 1M operations
+# generated by `gen_deep.py`, where they play no part; prints the best of 3 wall times of writing the module to a file, as reported by `brtest -T -w`
+# usage: bench_write.py [path to `brtest`, `build/bin/brtest` by default]
+
+import sys
+import subprocess
+import tempfile
+from pathlib import Path
+
+TESTS: Path = Path(__file__).parent
+BRTEST: str = sys.argv[1] if len(sys.argv) > 1 else str(TESTS.parent/"build"/"bin"/"brtest")
+# (number of operations, arguments of the generator)
+MODULES: list[tuple[int, list[str]]] = [
+	*((n_ops, ["gen_procs.py", str(n_ops // 10), "10", str(n_ops // 20)]) for n_ops in [1000, 10000, 100000, 1000000]),
+	(1000000, ["gen_deep.py", "1000000"])
+]
+N_REPEATS: int = 3
+
+def time_stages(*args: str) -> dict[str, float]:
+	"returns the best of `N_REPEATS` wall times of every stage reported by `brtest -T <args>`, in milliseconds"
+	res: dict[str, float] = {}
+	for _ in range(N_REPEATS):
+		proc = subprocess.run([BRTEST, "-T", *args], stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, check=True)
+		for line in proc.stderr.splitlines():
+			stage, ms, _ = line.split()
+			res[stage] = min(res.get(stage, float("inf")), float(ms))
+	return res
+
+print(f"{'ops':>8} {'procs':>7} {'write':>11} {'size':>10} {'throughput':>12}")
+with tempfile.TemporaryDirectory() as tmp:
+	tmp = Path(tmp)
+	for n_ops, generator in MODULES:
+		program, output = tmp/"module.vbrb", tmp/"module.brb"
+		with program.open("w") as f:
+			subprocess.run([sys.executable, str(TESTS/generator[0]), *generator[1:]], stdout=f, check=True)
+		ms = time_stages("-w", str(output), str(program))["write"]
+		size = output.stat().st_size
+		n_procs = int(generator[1]) if generator[0] == "gen_procs.py" else 1
+		print(f"{n_ops:>8} {n_procs:>7} {ms:>8.2f} ms {size / 1e3:>7.1f} KB {size / 1e3 / ms:>7.1f} MB/s")
@@ -0,0 +1,110 @@
+// driver for the checks in `tests/`, built by `build.py` as `build/bin/brtest`
+// usage: brtest [-D] [-L] [-T] [-f <flags>] [-n <runs>] [-t <threshold>] [-p <path>] <module>
+//        brtest [-D] [-L] [-T] -S <module>
+//        brtest [-D] [-L] [-T] -w <path> <module>
+// runs the module, given as BRidge assembly or bytecode, <runs> times, 1 by default, with the `BR_execModule` flags <flags>, 0 by default,
+// and prints the execution status of the last run to stdout after the output of the module;
+// `-t` sets `BR_PreparedModule::jit_threshold`, which only matters with `BR_EXEC_JIT` among <flags>;
+// `-p` saves the output of `BR_printOpProfile` after the last run to <path>;
+// `-S` prints the output of `BR_compileModule_darwin_arm64` instead of running the module;
+// `-w` saves the module as bytecode to <path> with `BR_writeModule` instead of running the module;
+// `-D` pre-evaluates the data blocks of the module with `BR_snapshotDataBlocks` after loading it;
+// `-L` loads a bytecode module with `BR_LOAD_LAZY`;
+// `-T` reports the wall time of loading the module and of every later stage to stderr, as `<stage> <milliseconds> ms` lines
+#include <br.h>
+#include <errno.h>
+
+int main(int argc, char** argv)
+{
+	uint32_t flags = 0, n_runs = 1, jit_threshold = BR_DEFAULT_JIT_THRESHOLD;
+	char* profile_path = NULL;
+	char* output_path = NULL;
+	char* input = NULL;
+	bool print_arm64 = false, snapshot_data = false, report_time = false, lazy = false;
+	for (int i = 1; i < argc; ++i) {
+		if (str_eq(argv[i], "-f") && i + 1 < argc) {
+			flags = strtoul(argv[++i], NULL, 0);
+		} else if (str_eq(argv[i], "-n") && i + 1 < argc) {
+			n_runs = strtoul(argv[++i], NULL, 0);
+		} else if (str_eq(argv[i], "-t") && i + 1 < argc) {
+			jit_threshold = strtoul(argv[++i], NULL, 0);
+		} else if (str_eq(argv[i], "-p") && i + 1 < argc) {
+			profile_path = argv[++i];
+		} else if (str_eq(argv[i], "-w") && i + 1 < argc) {
+			output_path = argv[++i];
+		} else if (str_eq(argv[i], "-S")) {
+			print_arm64 = true;
+		} else if (str_eq(argv[i], "-D")) {
+			snapshot_data = true;
+		} else if (str_eq(argv[i], "-L")) {
+			lazy = true;
+		} else if (str_eq(argv[i], "-T")) {
+			report_time = true;
+		} else if (!input) {
+			input = argv[i];
+		} else return eprintf("error: unexpected argument `%s`\n", argv[i]), 1;
+	}
+	if (!input) return eprintf("error: no input provided\n"), 1;
+// loading the module
+	struct timespec start;
+	BR_startTimerAt(&start);
+	FILE* const src = fopen(input, "rb");
+	if (!src) return eprintf("error: could not open `%s` (reason: %s)\n", input, strerror(errno)), 1;
+	BR_ModuleBuilder builder;
+	BR_Error err = BR_initModuleBuilder(&builder);
+	if (!err.type) err = sbuf_eq(BR_getFileExt_s(sbuf_fromstr(input)), sbuf_fromcstr("brb"))
+		? BR_loadFromBytecode(src, &builder, lazy ? BR_LOAD_LAZY : 0)
+		: BR_loadFromAssembly(src, input, &builder);
+	if (err.type) return BR_printErrorMsg(stderr, err, "loading error"), 1;
+	BR_Module module;
+	if ((err = BR_extractModule(builder, &module)).type)
+		return BR_printErrorMsg(stderr, err, "loading error"), 1;
+	if (report_time) eprintf("load %.3f ms\n", BR_endTimerAt(&start));
+	if (snapshot_data && (err = BR_snapshotDataBlocks(&module, NULL)).type)
+		return BR_printErrorMsg(stderr, err, "data block evaluation error"), 1;
+	if (output_path) {
+		FILE* const dst = fopen(output_path, "wb");
+		if (!dst) return eprintf("error: could not open `%s` (reason: %s)\n", output_path, strerror(errno)), 1;
+		BR_startTimerAt(&start);
+		bool failed = BR_writeModule(module, dst, 0) < 0;
+		failed |= fclose(dst) != 0;
+		if (report_time) eprintf("write %.3f ms\n", BR_endTimerAt(&start));
+		BR_delModule(module);
+		if (failed) return eprintf("error: could not write the module to `%s`\n", output_path), 1;
+		return 0;
+	}
+	if (print_arm64) {
+		char* entry_point_name = NULL;
+		BR_startTimerAt(&start);
+		const bool failed = BR_compileModule_darwin_arm64(&module, stdout, &entry_point_name, 1) < 0;
+		if (report_time) eprintf("compile %.3f ms\n", BR_endTimerAt(&start));
+		free(entry_point_name);
+		BR_delModule(module);
+		return failed;
+	}
+// running the module
+	BR_PreparedModule prepared;
+	BR_startTimerAt(&start);
+	if ((err = BR_prepareModule(module, &prepared, NULL, flags)).type)
+		return BR_printErrorMsg(stderr, err, "execution error"), 1;
+	if (report_time) eprintf("prepare %.3f ms\n", BR_endTimerAt(&start));
+	prepared.jit_threshold = jit_threshold;
+	BR_ExecEnv env = {0};
+	BR_startTimerAt(&start);
+	for (uint32_t i = 0; i < n_runs; ++i) {
+		if ((err = BR_runPreparedModule(&prepared, &env, (char*[]){input, NULL}, BR_DEFAULT_STACK_SIZE, NULL)).type)
+			return BR_printErrorMsg(stderr, err, "execution error"), 1;
+	}
+	if (report_time) eprintf("run %.3f ms\n", BR_endTimerAt(&start));
+	if (profile_path) {
+		FILE* const dst = fopen(profile_path, "w");
+		if (!dst || BR_printOpProfile(&env, dst) < 0)
+			return eprintf("error: could not write the profile to `%s`\n", profile_path), 1;
+		fclose(dst);
+	}
+	printf("status=%d exit=%d\n", env.exec_status.type, env.exec_status.exit_code);
+	BR_delExecEnv(&env);
+	BR_delPreparedModule(&prepared);
+	BR_delModule(module);
+	return 0;
+}
@@ -0,0 +1,43 @@
+#!python3
+# golden tests of the arm64 code generator: the assembly emitted by `BR_compileModule_darwin_arm64` for every `tests/arm64/<name>.vbrb`
+# must be the same as `tests/arm64/<name>.s`; the programs cover the cases of the register allocation in `allocRegs_arm64`:
+#	addr_spill.vbrb     - the values on the stack when `addr` is executed are kept in the stack frame
+#	sys_boundary.vbrb   - a value alive across `sys` gets a callee-saved register in the entry point, and stays in the stack frame elsewhere
+#	furthest_spill.vbrb - when the registers run out, the value with the furthest last use is spilled
+# the data blocks of the programs named `snapshot_*` are pre-evaluated with `BR_snapshotDataBlocks` before compiling them:
+#	snapshot_table.vbrb - a pre-evaluated block is emitted with its contents and an empty initializer, next to one that is still evaluated
+# usage: check_arm64.py [-u] [path to `brtest`, `build/bin/brtest` by default]
+# `-u` overwrites the expected output with the current one instead of comparing them
+
+import sys
+import difflib
+import subprocess
+from pathlib import Path
+
+TESTS: Path = Path(__file__).parent
+update: bool = False
+brtest: str = str(TESTS.parent/"build"/"bin"/"brtest")
+for arg in sys.argv[1:]:
+	if arg == "-u":
+		update = True
+	else:
+		brtest = arg
+
+n_failed: int = 0
+programs: list[Path] = sorted((TESTS/"arm64").glob("*.vbrb"))
+for program in programs:
+	expected_path = program.with_suffix(".s")
+	snapshot = ["-D"] if program.name.startswith("snapshot_") else []
+	proc = subprocess.run([brtest, *snapshot, "-S", str(program)], stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+	if proc.returncode:
+		print(f"FAILED: {program.name}:\n{proc.stderr}", end="")
+		n_failed += 1
+	elif update:
+		expected_path.write_text(proc.stdout)
+	elif not expected_path.exists() or proc.stdout != expected_path.read_text():
+		expected = expected_path.read_text().splitlines(keepends=True) if expected_path.exists() else []
+		print(f"MISMATCH: {program.name}")
+		sys.stdout.writelines(difflib.unified_diff(expected, proc.stdout.splitlines(keepends=True), str(expected_path), "output"))
+		n_failed += 1
+print(f"{len(programs)} programs {'updated' if update else 'checked'}, {n_failed} failures")
+sys.exit(n_failed > 0)
@@ -0,0 +1,52 @@
+#!python3
+# differential check of `BR_EXEC_JIT` against the interpreter: every program of the corpus must write the same bytes to stdout
+# and end with the same execution status and exit code when it's compiled right away and when it switches to the compiled code after the first run
+# usage: check_jit.py [path to `brtest`, `build/bin/brtest` by default]
+# the corpus is `tests/programs/*.vbrb` and the programs generated by `gen_ops.py`, `gen_idioms.py` and `gen_opmix.py`;
+# the JIT is only supported on x86-64, so elsewhere this only checks that `BR_EXEC_JIT` is ignored
+
+import sys
+import subprocess
+import tempfile
+from pathlib import Path
+
+TESTS: Path = Path(__file__).parent
+BRTEST: str = sys.argv[1] if len(sys.argv) > 1 else str(TESTS.parent/"build"/"bin"/"brtest")
+# flags for `BR_execModule`
+THREADED: int = 0x1
+FUSE: int = 0x2
+CACHE_TOP: int = 0x4
+JIT: int = 0x8
+JIT_FLAG_SETS: list[int] = [JIT, JIT | THREADED, JIT | THREADED | FUSE, JIT | THREADED | FUSE | CACHE_TOP]
+
+def run(program: Path, flags: int, n_runs: int, jit_threshold: int | None = None) -> tuple[bytes, int]:
+	args = [BRTEST, "-f", str(flags), "-n", str(n_runs)]
+	if jit_threshold is not None: args += ["-t", str(jit_threshold)]
+	proc = subprocess.run([*args, str(program)], stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+	return proc.stdout, proc.returncode
+
+def generate(generator: str, *args, dst: Path) -> Path:
+	with dst.open("w") as f:
+		subprocess.run([sys.executable, str(TESTS/generator), *map(str, args)], stdout=f, check=True)
+	return dst
+
+n_failed: int = 0
+with tempfile.TemporaryDirectory() as tmp:
+	tmp = Path(tmp)
+	corpus: list[Path] = sorted(TESTS.glob("programs/*.vbrb"))
+	corpus += [generate("gen_ops.py", seed, dst=tmp/f"ops{seed}.vbrb") for seed in [*range(1, 9), *range(11, 21)]]
+	corpus += [generate("gen_idioms.py", seed, 2000, dst=tmp/f"idioms{seed}.vbrb") for seed in range(1, 7)]
+	corpus.append(generate("gen_opmix.py", 3, dst=tmp/"opmix3.vbrb"))
+	for program in corpus:
+	# 3 runs, the first one interpreted and the others compiled
+		expected = run(program, 0, 3)
+		for flags in JIT_FLAG_SETS:
+			if run(program, flags, 3, 1) != expected:
+				print(f"MISMATCH: {program.name}, flags {flags}, threshold 1")
+				n_failed += 1
+	# a single run compiled right away
+		if run(program, JIT, 1, 0) != run(program, 0, 1):
+			print(f"MISMATCH: {program.name}, flags {JIT}, threshold 0")
+			n_failed += 1
+	print(f"{len(corpus)} programs checked, {n_failed} mismatches")
+sys.exit(n_failed > 0)
@@ -0,0 +1,52 @@
+#!python3
+# differential check of the native backends against the interpreter: the executables built by `bridge` from every program of the corpus
+# must write the same bytes to stdout and exit with the same code as the interpreter, both from the module as is
+# and from its bytecode saved by `bridge -BS`, whose immutable data blocks are pre-evaluated
+# usage: check_native.py [directory with `bridge` and `brtest`, `build/bin` by default]
+# the corpus is `tests/programs/*.vbrb` and `tests/arm64/*.vbrb`; the executables are built with the default backend, with `-a` and with `-C`,
+# so this needs the system assembler, linker and C compiler
+
+import re
+import sys
+import subprocess
+import tempfile
+from pathlib import Path
+
+TESTS: Path = Path(__file__).parent
+BIN: Path = Path(sys.argv[1]) if len(sys.argv) > 1 else TESTS.parent/"build"/"bin"
+# `bridge` options selecting the backend
+BACKENDS: list[list[str]] = [[], ["-a"], ["-C"]]
+# BR_EXC_EXIT
+EXEC_STATUS_EXIT: int = 1
+
+def interpret(program: Path) -> tuple[bytes, int]:
+	"returns the output of the program and the exit code a native executable is expected to exit with"
+	proc = subprocess.run([str(BIN/"brtest"), str(program)], stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+	output, _, status_line = proc.stdout.rpartition(b"status=")
+	status, exit_code = map(int, re.match(rb"(\d+) exit=(\d+)", status_line).groups())
+	return output, exit_code if status == EXEC_STATUS_EXIT else 0
+
+n_failed: int = 0
+with tempfile.TemporaryDirectory() as tmp:
+	tmp = Path(tmp)
+	corpus: list[Path] = sorted(TESTS.glob("programs/*.vbrb")) + sorted(TESTS.glob("arm64/*.vbrb"))
+	for program in corpus:
+		expected = interpret(program)
+		snapshot = tmp/f"{program.stem}.brb"
+		subprocess.run([str(BIN/"bridge"), "-BS", "-o", str(snapshot), str(program)], check=True)
+		if interpret(snapshot) != expected:
+			print(f"MISMATCH: {program.name}, interpreted after `-BS`")
+			n_failed += 1
+		for src, variant in [(program, ""), (snapshot, ", after `-BS`")]:
+			for backend in BACKENDS:
+				exe = tmp/program.stem
+				if subprocess.run([str(BIN/"bridge"), *backend, "-o", str(exe), str(src)]).returncode:
+					print(f"FAILED: {program.name}, options {backend}{variant}")
+					n_failed += 1
+					continue
+				proc = subprocess.run([str(exe)], stdout=subprocess.PIPE)
+				if (proc.stdout, proc.returncode) != expected:
+					print(f"MISMATCH: {program.name}, options {backend}{variant}")
+					n_failed += 1
+	print(f"{len(corpus)} programs checked, {n_failed} mismatches")
+sys.exit(n_failed > 0)
@@ -0,0 +1,15 @@
+#!python3
+# generates a program with a single procedure of about <n_ops> operations whose stack grows to half of that:
+# n/2 pushes, a `get` of the bottom item and then as many drops, for timing the stack queries of the analyzer
+# usage: gen_deep.py <n_ops>
+
+import sys
+
+n_ops: int = int(sys.argv[1])
+n_items: int = max((n_ops - 4) // 2, 1)
+
+print('void "main"() entry {')
+for _ in range(n_items): print("\ti64 1")
+print(f"\tget {n_items - 1}")
+for _ in range(n_items + 1): print("\tdrop")
+print("\tptr 0\n\tsys exit\n}")
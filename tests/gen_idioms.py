@@ -0,0 +1,33 @@
+#!python3
+# generates a program made of the idioms that the compiler and hand-written assembly use most, for profiling the superinstructions and checking the engines
+# usage: gen_idioms.py <seed> <number of idioms>
+
+import sys
+import random
+
+random.seed(int(sys.argv[1]))
+n_idioms: int = int(sys.argv[2])
+ops: list[str] = ['data "hello" { i8 10 i8 105 i8 72 }', 'data+ "counter" { i64 0 }', 'void "main"() entry {', "\ti64 1"]
+top_width: int = 64
+for _ in range(n_idioms):
+	r = random.random()
+	k = random.randint(1, 9)
+	if r < 0.3:
+		ops += [f"\t{random.choice(['i64', 'i64', 'i32'])} {k}", f"\t{random.choice(['add', 'sub', 'mul', 'xor', 'and', 'or'])}"]
+	elif r < 0.45:
+		ops += ["\tget 0", f"\t{random.choice(['add-i', 'mul-i', 'and-i', 'shl-i'])} {k}", "\tadd"]
+	elif r < 0.6:
+		ops += ["\taddr 1", f"\tget-from {'i64' if top_width == 64 else 'i32'}", f"\t{random.choice(['mul-i', 'add-i', 'sub-i'])} {k}", "\tadd"]
+	elif r < 0.75:
+		ops += ['\tdbaddr "counter"', "\tadd-i@64 1", "\tadd"]
+	elif r < 0.82:
+		ops += ["\tptr 3", '\tdbaddr "hello"', "\tbuiltin STDOUT", "\tsys write", "\tdrop"]
+	else:
+		ops += ["\tget 0", f"\t{random.choice(['shr-i', 'shl-i'])} {k}", "\txor"]
+# `get-from` reads either the whole top item or its low half, depending on the last literal added to it, so that the operations get operands of different widths
+	if ops[-1] in ("\tadd", "\tsub", "\tmul", "\txor", "\tand", "\tor") and ops[-2].startswith("\ti32"):
+		top_width = 32
+	elif ops[-2].startswith("\ti64"):
+		top_width = 64
+ops += ["\tptr 0", "\tadd", "\tsys exit", "}"]
+print("\n".join(ops))
@@ -0,0 +1,16 @@
+#!python3
+# generates the opcode-mix benchmark: a program made of <n> copies of a block of 14 common operations
+# usage: gen_opmix.py <n>
+
+import sys
+
+BLOCK: list[str] = [
+	"i64 5", "i64 7", "add", "add-i 3", "mul-i 3", "i32 9", "drop",
+	"get 0", "xor", "not", 'dbaddr "counter"', "add-i@64 1", "add", "drop"
+]
+
+print('data+ "counter" { i64 0 }')
+print('void "main"() entry {')
+for _ in range(int(sys.argv[1])):
+	for op in BLOCK: print("\t" + op)
+print('\tdbaddr "counter"\n\tget-from ptr\n\tsys exit\n}')
@@ -0,0 +1,77 @@
+#!python3
+# generates a program that executes every operation with every combination of operand widths and writes all the results to stdout,
+# for checking the engines against each other; the output only depends on <seed>
+# usage: gen_ops.py <seed>
+
+import sys
+import random
+
+random.seed(int(sys.argv[1]))
+# width suffix: (type, size)
+WIDTHS: dict[str, tuple[str, int]] = {"8": ("i8", 1), "16": ("i16", 2), "32": ("i32", 4), "p": ("ptr", 8), "64": ("i64", 8)}
+KINDS: list[str] = ["add", "sub", "mul", "div", "divs", "mod", "mods", "and", "or", "xor", "shl", "shr", "shrs"]
+
+ops: list[str] = []
+n_results: int = 0
+
+def store() -> None:
+	"pops the top item and writes it to the next 8-byte slot of the output"
+	global n_results
+	ops.extend(['dbaddr "out"', f"add-i {n_results * 8}", "set-at", "drop"])
+	n_results += 1
+
+def literal(width: str, nonzero: bool = False, small: bool = False) -> str:
+	type_name, size = WIDTHS[width]
+	value = random.randint(0, 7) if small else random.randint(1 if nonzero else 0, (1 << (8 * size)) - 1)
+	return f"{type_name} {value}"
+
+data_blocks: list[str] = [
+	f'data+ "v{width}" {{ {type_name} {random.randint(1, (1 << (8 * size)) - 1)} }}'
+	for width, (type_name, size) in WIDTHS.items()
+]
+for kind in KINDS:
+	is_shift = kind.startswith("sh")
+	for width in WIDTHS:
+	# binary forms with every combination of widths
+		for width2 in WIDTHS:
+			ops.extend([literal(width2, nonzero=kind in ("div", "divs", "mod", "mods"), small=is_shift), literal(width), kind])
+			store()
+	# forms with an immediate operand, on the stack and in memory
+		ops.append(literal(width))
+		k = random.randint(0, 7) if is_shift else random.randint(1, 1000)
+		ops.append(f"{kind}-i {k}")
+		store()
+		ops.extend([f'dbaddr "v{width}"', f"{kind}-i@{width} {k}"])
+		store()
+for width in WIDTHS:
+	ops.extend([literal(width), "not"])
+	store()
+	ops.extend([f'dbaddr "v{width}"', f"not-@{width}"])
+	store()
+# stack manipulation
+ops.extend(["i64 11", "i32 22", "i8 33", "get 2", "get 1"])
+store()
+store()
+store()
+ops.append("drop")
+ops.extend(["new i32", "drop", "zero i64"])
+store()
+ops.extend(["zero i64", "addr 0", "i64 99", "get 1", "set-at", "drop", "drop"])
+store()
+ops.extend(['dbaddr "v64"', "get-from i32"])
+store()
+ops.extend(['dbaddr "v16"', "get-from i16"])
+store()
+ops.extend(['dbaddr "v8"', 'dbaddr "v64"', "copy i8", "get-from i8"])
+store()
+# dumping the data blocks modified by the operations above
+for width, (type_name, _) in WIDTHS.items():
+	ops.extend([f'dbaddr "v{width}"', f"get-from {type_name}"])
+	store()
+ops.extend([f"ptr {n_results * 8}", 'dbaddr "out"', "builtin STDOUT", "sys write", "sys exit"])
+
+print("\n".join(data_blocks))
+print(f'data+ "out" {{ zero i64[{n_results}] }}')
+print('void "main"() entry {')
+for op in ops: print("\t" + op)
+print("}")
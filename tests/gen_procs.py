@@ -0,0 +1,23 @@
+#!python3
+# generates a program with <n_procs> procedures of <n_ops> operations each, 10 by default, that refer to <n_data_blocks> data blocks,
+# <n_procs> by default, and to <n_structs> structs, 100 by default, by name; only the entry point runs, and it just writes "Hi\n" to stdout,
+# so the program is for timing what scales with the size of a module: resolving the names, writing the module and loading it
+# usage: gen_procs.py <n_procs> [<n_ops> [<n_data_blocks> [<n_structs>]]]
+
+import sys
+
+n_procs: int = int(sys.argv[1])
+n_ops: int = int(sys.argv[2]) if len(sys.argv) > 2 else 10
+n_data_blocks: int = int(sys.argv[3]) if len(sys.argv) > 3 else n_procs
+n_structs: int = int(sys.argv[4]) if len(sys.argv) > 4 else 100
+
+for i in range(n_structs): print(f'struct "s{i}" {{ i64 i32 }}')
+for i in range(n_data_blocks): print(f'data "d{i}" {{ i64 {i} }}')
+print('data "hello" { i8 10 i8 105 i8 72 }')
+# every 5 operations read a data block and create a struct, leaving the stack as it was
+for i in range(n_procs - 1):
+	print(f'void "p{i}"() {{')
+	for j in range(n_ops // 5):
+		print(f'\tdbaddr "d{(i * 7 + j) % n_data_blocks}"\n\tget-from i64\n\tzero struct "s{(i + j) % n_structs}"\n\tdrop\n\tdrop')
+	print("}")
+print('void "main"() entry {\n\tptr 3\n\tdbaddr "hello"\n\tbuiltin STDOUT\n\tsys write\n\tdrop\n\tptr 0\n\tsys exit\n}')